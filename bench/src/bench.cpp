@@ -0,0 +1,160 @@
+#include "bench.h"
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Warm up blocks run before measuring, lets the caches and branch predictors settle
+#define BENCH_WARMUP_BLOCKS     8
+
+namespace {
+    std::atomic<uint64_t> allocCount(0);
+    std::atomic<uint64_t> allocBytes(0);
+
+    // Counts CPU events of the calling thread, the benchmarks run the blocks synchronously
+    class PerfCounters {
+    public:
+        PerfCounters() {
+#ifdef __linux__
+            const uint64_t configs[COUNTER_COUNT] = { PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CPU_CYCLES };
+            for (int i = 0; i < COUNTER_COUNT; i++) {
+                perf_event_attr attr;
+                memset(&attr, 0, sizeof(attr));
+                attr.type = PERF_TYPE_HARDWARE;
+                attr.size = sizeof(attr);
+                attr.config = configs[i];
+                attr.disabled = 1;
+                attr.exclude_kernel = 1;
+                attr.exclude_hv = 1;
+                fds[i] = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+            }
+#endif
+        }
+
+        ~PerfCounters() {
+#ifdef __linux__
+            for (int fd : fds) {
+                if (fd >= 0) { close(fd); }
+            }
+#endif
+        }
+
+        void start() {
+#ifdef __linux__
+            for (int fd : fds) {
+                if (fd < 0) { continue; }
+                ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+                ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+#endif
+        }
+
+        // Values are -1 for the counters that couldn't be opened
+        void stop(int64_t values[]) {
+            for (int i = 0; i < COUNTER_COUNT; i++) {
+                values[i] = -1;
+#ifdef __linux__
+                if (fds[i] < 0) { continue; }
+                ioctl(fds[i], PERF_EVENT_IOC_DISABLE, 0);
+                int64_t val;
+                if (read(fds[i], &val, sizeof(val)) == sizeof(val)) { values[i] = val; }
+#endif
+            }
+        }
+
+        static const int COUNTER_COUNT = 3;
+
+    private:
+        int fds[COUNTER_COUNT] = { -1, -1, -1 };
+    };
+}
+
+// Replacing the global allocator lets the benchmarks catch allocations in the hot path
+void* operator new(size_t size) {
+    allocCount.fetch_add(1, std::memory_order_relaxed);
+    allocBytes.fetch_add(size, std::memory_order_relaxed);
+    void* ptr = malloc(size ? size : 1);
+    if (!ptr) { throw std::bad_alloc(); }
+    return ptr;
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete(void* ptr, size_t size) noexcept {
+    free(ptr);
+}
+
+void operator delete[](void* ptr, size_t size) noexcept {
+    free(ptr);
+}
+
+namespace bench {
+    uint64_t getAllocCount() {
+        return allocCount.load();
+    }
+
+    uint64_t getAllocBytes() {
+        return allocBytes.load();
+    }
+
+    Result run(const Benchmark& bench, std::vector<dsp::complex_t>& input, int blockSize, int durationMs) {
+        RunFunc func = bench.create();
+        PerfCounters counters;
+        int inputSize = input.size();
+        int offset = 0;
+
+        auto nextBlock = [&]() {
+            int count = std::min<int>(blockSize, inputSize - offset);
+            func(count, &input[offset]);
+            offset += count;
+            if (offset >= inputSize) { offset = 0; }
+            return count;
+        };
+
+        for (int i = 0; i < BENCH_WARMUP_BLOCKS; i++) { nextBlock(); }
+
+        Result res;
+        res.name = bench.name;
+        res.samples = 0;
+        uint64_t allocs = getAllocCount();
+        uint64_t bytes = getAllocBytes();
+        auto start = std::chrono::steady_clock::now();
+        auto end = start + std::chrono::milliseconds(durationMs);
+        auto now = start;
+        counters.start();
+        while (now < end) {
+            res.samples += nextBlock();
+            now = std::chrono::steady_clock::now();
+        }
+        int64_t values[PerfCounters::COUNTER_COUNT];
+        counters.stop(values);
+
+        res.seconds = std::chrono::duration<double>(now - start).count();
+        res.msps = (double)res.samples / res.seconds / 1e6;
+        res.nsPerSample = res.seconds * 1e9 / (double)res.samples;
+        res.allocs = getAllocCount() - allocs;
+        res.allocBytes = getAllocBytes() - bytes;
+        res.cacheMisses = (values[0] >= 0) ? (double)values[0] / (double)res.samples : -1.0;
+        res.instructions = (values[1] >= 0) ? (double)values[1] / (double)res.samples : -1.0;
+        res.cycles = (values[2] >= 0) ? (double)values[2] / (double)res.samples : -1.0;
+        return res;
+    }
+}
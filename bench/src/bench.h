@@ -0,0 +1,58 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <functional>
+#include <stdint.h>
+#include <dsp/types.h>
+
+namespace bench {
+    // Processes a block of input samples, returns the number of output samples (or anything >= 0)
+    typedef std::function<int(int count, dsp::complex_t* in)> RunFunc;
+
+    struct Benchmark {
+        std::string name;
+        std::string description;
+
+        // Builds the block(s) under test and returns the function running them on a block of input
+        std::function<RunFunc()> create;
+    };
+
+    struct Result {
+        std::string name;
+        uint64_t samples;
+        double seconds;
+        double msps;
+        double nsPerSample;
+
+        // Heap allocations made while running (not while building the blocks)
+        uint64_t allocs;
+        uint64_t allocBytes;
+
+        // Hardware counters per sample, -1 if perf_event isn't available
+        double cacheMisses;
+        double instructions;
+        double cycles;
+    };
+
+    struct Check {
+        std::string name;
+        std::string description;
+
+        // Runs the optimised path against its reference and returns the error, the check fails above threshold
+        std::function<double()> measure;
+        double threshold;
+    };
+
+    // All benchmarks of core blocks and decoder front-ends
+    std::vector<Benchmark> getBenchmarks();
+
+    // Correctness checks of the optimised paths the benchmarks measure
+    std::vector<Check> getChecks();
+
+    // Run the benchmark on the input, cycling through it in blocks of blockSize for durationMs
+    Result run(const Benchmark& bench, std::vector<dsp::complex_t>& input, int blockSize, int durationMs);
+
+    // Allocation counters maintained by the global operator new
+    uint64_t getAllocCount();
+    uint64_t getAllocBytes();
+}
@@ -0,0 +1,185 @@
+#include "bench.h"
+#include <memory>
+#include <dsp/filter/fir.h>
+#include <dsp/multirate/power_decimator.h>
+#include <dsp/multirate/rational_resampler.h>
+#include <dsp/multirate/arbitrary_resampler.h>
+#include <dsp/channel/rx_vfo.h>
+#include <dsp/demod/fm.h>
+#include <dsp/demod/am.h>
+#include <dsp/demod/ssb.h>
+#include <dsp/demod/broadcast_fm.h>
+#include <dsp/demod/quadrature.h>
+#include <dsp/taps/low_pass.h>
+#include <pocsag/dsp.h>
+#include <meteor_demod.h>
+#include <mode_s_dsp.h>
+
+namespace bench {
+    namespace {
+        template <class T>
+        std::shared_ptr<std::vector<T>> outBuffer() {
+            return std::make_shared<std::vector<T>>(STREAM_BUFFER_SIZE);
+        }
+
+        // Taps are kept alive by the returned function, filters don't own them
+        std::shared_ptr<dsp::tap<float>> lowPassTaps(double cutoff, double transWidth, double samplerate, bool symmetric = true) {
+            std::shared_ptr<dsp::tap<float>> taps(new dsp::tap<float>(dsp::taps::lowPass(cutoff, transWidth, samplerate)), [](dsp::tap<float>* t) {
+                dsp::taps::free(*t);
+                delete t;
+            });
+
+            // Breaking the symmetry forces the generic dot product
+            if (!symmetric) { taps->taps[0] *= 1.5f; }
+            return taps;
+        }
+
+        Benchmark firComplex(std::string name, bool symmetric) {
+            return { name, "Channel filter, 2.4MS/s complex, 25kHz cutoff", [=]() -> RunFunc {
+                auto taps = lowPassTaps(25e3, 25e3, 2.4e6, symmetric);
+                auto fir = std::make_shared<dsp::filter::FIR<dsp::complex_t, float>>();
+                fir->init(NULL, *taps);
+                auto out = outBuffer<dsp::complex_t>();
+                return [=](int count, dsp::complex_t* in) { return fir->process(count, in, out->data()); };
+            } };
+        }
+
+        Benchmark firReal(std::string name) {
+            return { name, "Audio filter, real, 15kHz cutoff at 48kHz", []() -> RunFunc {
+                auto taps = lowPassTaps(15e3, 1.5e3, 48e3);
+                auto fir = std::make_shared<dsp::filter::FIR<float, float>>();
+                fir->init(NULL, *taps);
+                auto out = outBuffer<float>();
+                // The input is used as twice as many real samples
+                return [=](int count, dsp::complex_t* in) { return fir->process(count * 2, (float*)in, out->data()); };
+            } };
+        }
+
+        Benchmark powerDecimator(std::string name, int ratio) {
+            return { name, "Power of two decimator, complex", [=]() -> RunFunc {
+                auto decim = std::make_shared<dsp::multirate::PowerDecimator<dsp::complex_t>>();
+                decim->init(NULL, ratio);
+                auto out = outBuffer<dsp::complex_t>();
+                return [=](int count, dsp::complex_t* in) { return decim->process(count, in, out->data()); };
+            } };
+        }
+
+        Benchmark rationalResampler(std::string name, double inSamplerate, double outSamplerate) {
+            return { name, "Rational resampler (power decimator + polyphase or arbitrary), complex", [=]() -> RunFunc {
+                auto resamp = std::make_shared<dsp::multirate::RationalResampler<dsp::complex_t>>();
+                resamp->init(NULL, inSamplerate, outSamplerate);
+                auto out = outBuffer<dsp::complex_t>();
+                return [=](int count, dsp::complex_t* in) { return resamp->process(count, in, out->data()); };
+            } };
+        }
+
+        Benchmark arbitraryResampler(std::string name, double inSamplerate, double outSamplerate) {
+            return { name, "Arbitrary resampler alone, complex", [=]() -> RunFunc {
+                auto resamp = std::make_shared<dsp::multirate::ArbitraryResampler<dsp::complex_t>>();
+                resamp->init(NULL, inSamplerate, outSamplerate);
+                auto out = outBuffer<dsp::complex_t>();
+                return [=](int count, dsp::complex_t* in) { return resamp->process(count, in, out->data()); };
+            } };
+        }
+
+        Benchmark rxVfo(std::string name, double outSamplerate, double bandwidth, bool fused) {
+            return { name, "VFO from 2.4MS/s (translate, resample, filter)", [=]() -> RunFunc {
+                auto vfo = std::make_shared<dsp::channel::RxVFO>();
+                vfo->init(NULL, 2.4e6, outSamplerate, bandwidth, 312.5e3);
+                vfo->setFused(fused);
+                auto out = outBuffer<dsp::complex_t>();
+                return [=](int count, dsp::complex_t* in) { return vfo->process(count, in, out->data()); };
+            } };
+        }
+
+        Benchmark quadrature(std::string name, dsp::math::PolarAccuracy accuracy) {
+            return { name, std::string("FM discriminator, 250kS/s, ") + dsp::math::polar::getImplementation() + " kernels", [=]() -> RunFunc {
+                auto demod = std::make_shared<dsp::demod::Quadrature>();
+                demod->init(NULL, 75e3, 250e3);
+                demod->setAccuracy(accuracy);
+                auto out = outBuffer<float>();
+                return [=](int count, dsp::complex_t* in) { return demod->process(count, in, out->data()); };
+            } };
+        }
+    }
+
+    std::vector<Benchmark> getBenchmarks() {
+        std::vector<Benchmark> list;
+
+        // Filters
+        list.push_back(firComplex("fir.complex", true));
+        list.push_back(firComplex("fir.complex.generic", false));
+        list.push_back(firReal("fir.real"));
+
+        // Multirate
+        list.push_back(powerDecimator("decim.power.8", 8));
+        list.push_back(powerDecimator("decim.power.64", 64));
+        list.push_back(rationalResampler("resamp.rational.2400k_48k", 2.4e6, 48e3));
+        list.push_back(rationalResampler("resamp.rational.2400k_44k1", 2.4e6, 44.1e3));
+        list.push_back(arbitraryResampler("resamp.arbitrary.48k_44k1", 48e3, 44.1e3));
+
+        // Channels
+        list.push_back(rxVfo("vfo.nfm", 50e3, 12.5e3, true));
+        list.push_back(rxVfo("vfo.nfm.unfused", 50e3, 12.5e3, false));
+        list.push_back(rxVfo("vfo.wfm", 250e3, 200e3, true));
+
+        // Demodulators, running on the IF the radio module would give them
+        list.push_back(quadrature("quadrature", dsp::math::POLAR_ACCURACY_HIGH));
+        list.push_back(quadrature("quadrature.fast", dsp::math::POLAR_ACCURACY_FAST));
+        list.push_back({ "demod.nfm", "FM demodulator, 50kS/s IF", []() -> RunFunc {
+            auto demod = std::make_shared<dsp::demod::FM<dsp::stereo_t>>();
+            demod->init(NULL, 50e3, 12.5e3, true, false);
+            demod->setAccuracy(dsp::math::POLAR_ACCURACY_FAST);
+            auto out = outBuffer<dsp::stereo_t>();
+            return [=](int count, dsp::complex_t* in) { return demod->process(count, in, out->data()); };
+        } });
+        list.push_back({ "demod.am", "AM demodulator, 15kS/s IF", []() -> RunFunc {
+            auto demod = std::make_shared<dsp::demod::AM<dsp::stereo_t>>();
+            demod->init(NULL, dsp::demod::AM<dsp::stereo_t>::AGCMode::CARRIER, 10e3, 50.0 / 15e3, 5.0 / 15e3, 100.0 / 15e3, 15e3);
+            auto out = outBuffer<dsp::stereo_t>();
+            return [=](int count, dsp::complex_t* in) { return demod->process(count, in, out->data()); };
+        } });
+        list.push_back({ "demod.usb", "SSB demodulator, 24kS/s IF", []() -> RunFunc {
+            auto demod = std::make_shared<dsp::demod::SSB<dsp::stereo_t>>();
+            demod->init(NULL, dsp::demod::SSB<dsp::stereo_t>::Mode::USB, 2.8e3, 24e3, 50.0 / 24e3, 5.0 / 24e3);
+            auto out = outBuffer<dsp::stereo_t>();
+            return [=](int count, dsp::complex_t* in) { return demod->process(count, in, out->data()); };
+        } });
+        list.push_back({ "demod.wfm.stereo", "Broadcast FM stereo demodulator, 250kS/s IF to 50kS/s audio", []() -> RunFunc {
+            auto demod = std::make_shared<dsp::demod::BroadcastFM>();
+            demod->init(NULL, 75e3, 250e3, true, true, false, 5);
+            auto out = outBuffer<dsp::stereo_t>();
+            return [=](int count, dsp::complex_t* in) {
+                int rdsCount;
+                return demod->process(count, in, out->data(), rdsCount);
+            };
+        } });
+
+        // Decoder front-ends
+        list.push_back({ "decoder.pocsag", "POCSAG demodulator and clock recovery, 24kS/s", []() -> RunFunc {
+            auto dsp = std::make_shared<POCSAGDSP>();
+            dsp->init(NULL, 24000.0, 2400.0);
+            auto soft = outBuffer<float>();
+            auto out = outBuffer<uint8_t>();
+            return [=](int count, dsp::complex_t* in) { return dsp->process(count, in, soft->data(), out->data()); };
+        } });
+        list.push_back({ "decoder.meteor", "Meteor QPSK demodulator, 150kS/s", []() -> RunFunc {
+            auto demod = std::make_shared<dsp::demod::Meteor>();
+            demod->init(NULL, 72000.0, 150000.0, 33, 0.6f, 0.1f, 0.005f, false, false, 1e-6, 0.01);
+            auto out = outBuffer<dsp::complex_t>();
+            return [=](int count, dsp::complex_t* in) { return demod->process(count, in, out->data()); };
+        } });
+        list.push_back({ "decoder.mode_s", "Mode-S magnitude and preamble detection, 2MS/s", []() -> RunFunc {
+            std::shared_ptr<mode_s_context> ctx(new mode_s_context());
+            prepareContext(ctx.get(), [](char* msg, mode_s_message* mm) {});
+            auto block = std::make_shared<dsp::ModeSBlock>();
+            block->init(ctx.get(), NULL);
+            return [=](int count, dsp::complex_t* in) {
+                block->process(count, in);
+                return count;
+            };
+        } });
+
+        return list;
+    }
+}
@@ -0,0 +1,166 @@
+#include "bench.h"
+#include <dsp/channel/rx_vfo.h>
+#include <dsp/loop/lookahead_agc.h>
+#include <dsp/demod/broadcast_fm.h>
+
+// Largest difference between the fused and the unfused VFO, relative to the output RMS. Both paths
+// run the same blocks on the same samples so anything above rounding noise is a bug in the chunking.
+#define VFO_FUSED_MAX_ERROR     1e-4
+
+// Leakage of a single channel into the other one, 40dB of separation is about what a good receiver gets
+#define WFM_MAX_LEAKAGE         1e-2
+
+// The look-ahead AGC and its brute force reference do the same float operations
+#define AGC_MAX_ERROR           1e-6
+
+namespace bench {
+    namespace {
+        Check rxVfoFused(std::string name, double outSamplerate, double bandwidth, double offset) {
+            return { name, "Fused VFO against the unfused path, from 2.4MS/s", [=]() {
+                return dsp::channel::RxVFO::checkFused(2.4e6, outSamplerate, bandwidth, offset);
+            }, VFO_FUSED_MAX_ERROR };
+        }
+
+        // Same gain law as LookaheadAGC, with the peak found by rescanning the whole window for every sample
+        std::vector<float> bruteForceAGC(const std::vector<float>& in, float setPoint, float attack, float decay, float maxGain, float maxOutputAmp, int lookahead) {
+            std::vector<float> out(in.size());
+            float amp = setPoint;
+            for (int i = 0; i < (int)in.size(); i++) {
+                int oldest = i - lookahead;
+                float sample = (oldest >= 0) ? in[oldest] : 0.0f;
+                float inAmp = fabsf(sample);
+                float peak = 0.0f;
+                for (int j = std::max<int>(oldest, 0); j <= i; j++) { peak = std::max<float>(peak, fabsf(in[j])); }
+
+                float gain;
+                if (inAmp != 0.0f) {
+                    amp = (inAmp > amp) ? ((amp * (1.0f - attack)) + (inAmp * attack)) : ((amp * (1.0f - decay)) + (inAmp * decay));
+                    gain = std::min<float>(setPoint / amp, maxGain);
+                }
+                else {
+                    gain = 1.0f;
+                }
+                if (peak * gain > maxOutputAmp) {
+                    amp = peak;
+                    gain = std::min<float>(setPoint / amp, maxGain);
+                }
+                out[i] = sample * gain;
+            }
+            return out;
+        }
+
+        Check lookaheadAgc(std::string name, int lookahead) {
+            return { name, "Look-ahead AGC against a brute force sliding maximum, random block sizes", [=]() {
+                // Fast decay so that the gain follows the signal down and a wrong peak shows up in the output
+                const float setPoint = 1.0f, attack = 0.05f, decay = 0.5f, maxGain = 1e6f, maxOutputAmp = 10.0f;
+
+                // Bursts decaying over about a window restart at random, the long decreasing runs fill the
+                // whole window with maximum candidates
+                std::vector<float> in(200000);
+                float env = 0.0f;
+                float fade = expf(-1.0f / (float)(lookahead + 1));
+                for (auto& s : in) {
+                    if (rand() % 500 == 0) { env = 8.0f * (float)rand() / (float)RAND_MAX; }
+                    env *= fade;
+                    s = env + 0.001f * (float)rand() / (float)RAND_MAX;
+                }
+                std::vector<float> ref = bruteForceAGC(in, setPoint, attack, decay, maxGain, maxOutputAmp, lookahead);
+
+                dsp::loop::LookaheadAGC<float> agc(NULL, setPoint, attack, decay, maxGain, maxOutputAmp, lookahead, 1.0);
+                std::vector<float> out(in.size());
+                int offset = 0;
+                while (offset < (int)in.size()) {
+                    int count = std::min<int>(1 + rand() % 4096, in.size() - offset);
+                    agc.process(count, &in[offset], &out[offset]);
+                    offset += count;
+                }
+
+                double maxErr = 0.0;
+                for (int i = 0; i < (int)in.size(); i++) {
+                    maxErr = std::max<double>(maxErr, fabs(out[i] - ref[i]) / std::max<double>(fabs(ref[i]), 1.0));
+                }
+                return maxErr;
+            }, AGC_MAX_ERROR };
+        }
+
+        // Amplitude of the tone at freq in the samples, the tone has to fit a whole number of times
+        double toneAmplitude(const std::vector<float>& in, double freq, double samplerate) {
+            double re = 0.0, im = 0.0;
+            for (int i = 0; i < (int)in.size(); i++) {
+                double phase = 2.0 * M_PI * freq * (double)i / samplerate;
+                re += in[i] * cos(phase);
+                im += in[i] * sin(phase);
+            }
+            return 2.0 * sqrt(re * re + im * im) / (double)in.size();
+        }
+
+        Check wfmSeparation(std::string name, int decimation) {
+            return { name, "Broadcast FM stereo leakage with an ITU-R BS.450 multiplex, 250kS/s IF", [=]() {
+                const double samplerate = 250e3, deviation = 75e3, tone = 1000.0;
+                const int settle = 125000, measured = 125000;
+
+                // Measure a tone in either channel alone, the worst leakage counts
+                double worst = 0.0;
+                for (int channel = 0; channel < 2; channel++) {
+                    // BS.450: sin pilot at 19KHz and L-R on a 38KHz sin subcarrier in phase with it
+                    std::vector<dsp::complex_t> in(settle + measured);
+                    double phase = 0.0;
+                    for (int i = 0; i < (int)in.size(); i++) {
+                        double t = (double)i / samplerate;
+                        double audio = sin(2.0 * M_PI * tone * t);
+                        double left = channel ? 0.0 : audio;
+                        double right = channel ? audio : 0.0;
+                        double pilot = 2.0 * M_PI * 19000.0 * t;
+                        double mpx = 0.45 * (left + right) + 0.45 * (left - right) * sin(2.0 * pilot) + 0.1 * sin(pilot);
+                        phase = fmod(phase + 2.0 * M_PI * deviation * mpx / samplerate, 2.0 * M_PI);
+                        in[i] = { (float)cos(phase), (float)sin(phase) };
+                    }
+
+                    dsp::demod::BroadcastFM demod;
+                    demod.init(NULL, deviation, samplerate, true, true, false, decimation);
+                    std::vector<dsp::stereo_t> out(in.size());
+                    int outCount = 0;
+                    int rdsCount;
+                    for (int offset = 0; offset < (int)in.size(); offset += 5000) {
+                        outCount += demod.process(5000, &in[offset], &out[outCount], rdsCount);
+                    }
+
+                    // Skip the PLL locking and keep a whole number of tone periods
+                    double outSamplerate = demod.getOutSamplerate();
+                    int begin = outCount - (measured / decimation);
+                    std::vector<float> l, r;
+                    for (int i = begin; i < outCount; i++) {
+                        l.push_back(out[i].l);
+                        r.push_back(out[i].r);
+                    }
+                    double wanted = toneAmplitude(channel ? r : l, tone, outSamplerate);
+                    double leaked = toneAmplitude(channel ? l : r, tone, outSamplerate);
+                    worst = std::max<double>(worst, leaked / wanted);
+                }
+                return worst;
+            }, WFM_MAX_LEAKAGE };
+        }
+    }
+
+    std::vector<Check> getChecks() {
+        std::vector<Check> list;
+
+        // Channels
+        list.push_back(rxVfoFused("check.vfo.nfm", 50e3, 12.5e3, -450e3));
+        list.push_back(rxVfoFused("check.vfo.wfm", 250e3, 200e3, 300e3));
+        list.push_back(rxVfoFused("check.vfo.am", 15e3, 15e3, 12345.0));
+
+        // Demodulators
+        list.push_back(wfmSeparation("check.wfm.separation", 1));
+        list.push_back(wfmSeparation("check.wfm.separation.decim", 5));
+
+        // Loops, window lengths of 2^k are the edge case of the power of two rings
+        list.push_back(lookaheadAgc("check.agc.lookahead.1", 1));
+        list.push_back(lookaheadAgc("check.agc.lookahead.15", 15));
+        list.push_back(lookaheadAgc("check.agc.lookahead.16", 16));
+        list.push_back(lookaheadAgc("check.agc.lookahead.240", 240));
+        list.push_back(lookaheadAgc("check.agc.lookahead.255", 255));
+
+        return list;
+    }
+}
@@ -0,0 +1,272 @@
+#include "bench.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <fstream>
+#include <map>
+#include <json.hpp>
+#include <dsp/stream.h>
+
+using nlohmann::json;
+
+#define DEFAULT_DURATION_MS     1000
+#define DEFAULT_BLOCK_SIZE      16384
+#define DEFAULT_THRESHOLD       5.0
+
+// Length of the synthetic input, long enough not to fit in the caches
+#define SYNTHETIC_SAMPLES       (1 << 21)
+
+void printUsage(const char* exe) {
+    printf("Usage: %s [options]\n", exe);
+    printf("  --list                 List the benchmarks and checks and exit\n");
+    printf("  --no-checks            Skip the correctness checks\n");
+    printf("  --filter <text>        Only run benchmarks and checks whose name contains text\n");
+    printf("  --duration <ms>        Time spent on each benchmark (default %d)\n", DEFAULT_DURATION_MS);
+    printf("  --block <samples>      Samples given to the blocks per call (default %d)\n", DEFAULT_BLOCK_SIZE);
+    printf("  --input <file>         Recorded IQ instead of synthetic noise and tones\n");
+    printf("  --format <fmt>         Format of the input: wav, cu8, cs16 or cf32 (default from extension)\n");
+    printf("  --json <file>          Write the results as JSON\n");
+    printf("  --compare <file>       Compare with results previously saved with --json\n");
+    printf("  --threshold <percent>  Slowdown reported as a regression (default %.1f)\n", DEFAULT_THRESHOLD);
+}
+
+std::vector<dsp::complex_t> synthesize() {
+    // Noise with a few carriers spread over the band so that the demodulators have something to lock on
+    std::vector<dsp::complex_t> samples(SYNTHETIC_SAMPLES);
+    const double freqs[] = { 0.013, -0.087, 0.1302, 0.25 };
+    double phases[4] = { 0.0, 0.0, 0.0, 0.0 };
+    for (auto& s : samples) {
+        s.re = 0.05f * ((float)rand() / (float)RAND_MAX - 0.5f);
+        s.im = 0.05f * ((float)rand() / (float)RAND_MAX - 0.5f);
+        for (int i = 0; i < 4; i++) {
+            s.re += 0.2f * cosf(phases[i]);
+            s.im += 0.2f * sinf(phases[i]);
+            phases[i] = fmod(phases[i] + 2.0 * M_PI * freqs[i], 2.0 * M_PI);
+        }
+    }
+    return samples;
+}
+
+bool loadInput(const std::string& path, std::string format, std::vector<dsp::complex_t>& samples) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        fprintf(stderr, "Could not open %s\n", path.c_str());
+        return false;
+    }
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    if (format.empty()) {
+        size_t dot = path.rfind('.');
+        format = (dot != std::string::npos) ? path.substr(dot + 1) : "cf32";
+    }
+
+    // Find the sample format and the data chunk of a WAV recording
+    size_t start = 0;
+    size_t len = data.size();
+    if (format == "wav") {
+        if (data.size() < 12 || memcmp(&data[0], "RIFF", 4) || memcmp(&data[8], "WAVE", 4)) {
+            fprintf(stderr, "%s is not a WAV file\n", path.c_str());
+            return false;
+        }
+        uint16_t codec = 0;
+        uint16_t bits = 0;
+        size_t pos = 12;
+        while (pos + 8 <= data.size()) {
+            uint32_t chunkLen;
+            memcpy(&chunkLen, &data[pos + 4], 4);
+            if (!memcmp(&data[pos], "fmt ", 4) && pos + 24 <= data.size()) {
+                memcpy(&codec, &data[pos + 8], 2);
+                memcpy(&bits, &data[pos + 22], 2);
+            }
+            else if (!memcmp(&data[pos], "data", 4)) {
+                start = pos + 8;
+                len = std::min<size_t>(chunkLen, data.size() - start);
+                break;
+            }
+            pos += 8 + chunkLen + (chunkLen & 1);
+        }
+        if (!start) {
+            fprintf(stderr, "No samples found in %s\n", path.c_str());
+            return false;
+        }
+        if (codec == 3 && bits == 32) { format = "cf32"; }
+        else if (codec == 1 && bits == 16) { format = "cs16"; }
+        else if (codec == 1 && bits == 8) { format = "cu8"; }
+        else {
+            fprintf(stderr, "Unsupported WAV format (codec %d, %d bits)\n", codec, bits);
+            return false;
+        }
+    }
+
+    const uint8_t* raw = &data[start];
+    if (format == "cu8") {
+        samples.resize(len / 2);
+        for (size_t i = 0; i < samples.size(); i++) {
+            samples[i] = { ((float)raw[2 * i] - 127.5f) / 128.0f, ((float)raw[2 * i + 1] - 127.5f) / 128.0f };
+        }
+    }
+    else if (format == "cs16") {
+        samples.resize(len / 4);
+        for (size_t i = 0; i < samples.size(); i++) {
+            int16_t iq[2];
+            memcpy(iq, &raw[4 * i], 4);
+            samples[i] = { (float)iq[0] / 32768.0f, (float)iq[1] / 32768.0f };
+        }
+    }
+    else if (format == "cf32") {
+        samples.resize(len / sizeof(dsp::complex_t));
+        memcpy(samples.data(), raw, samples.size() * sizeof(dsp::complex_t));
+    }
+    else {
+        fprintf(stderr, "Unknown input format '%s'\n", format.c_str());
+        return false;
+    }
+
+    if (samples.empty()) {
+        fprintf(stderr, "%s contains no samples\n", path.c_str());
+        return false;
+    }
+    return true;
+}
+
+json toJson(const bench::Result& res) {
+    json j;
+    j["samples"] = res.samples;
+    j["seconds"] = res.seconds;
+    j["msps"] = res.msps;
+    j["nsPerSample"] = res.nsPerSample;
+    j["allocs"] = res.allocs;
+    j["allocBytes"] = res.allocBytes;
+    j["cacheMissesPerSample"] = res.cacheMisses;
+    j["instructionsPerSample"] = res.instructions;
+    j["cyclesPerSample"] = res.cycles;
+    return j;
+}
+
+int main(int argc, char* argv[]) {
+    bool list = false;
+    bool checks = true;
+    std::string filter;
+    int durationMs = DEFAULT_DURATION_MS;
+    int blockSize = DEFAULT_BLOCK_SIZE;
+    std::string inputPath;
+    std::string inputFormat;
+    std::string jsonPath;
+    std::string comparePath;
+    double threshold = DEFAULT_THRESHOLD;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = (i + 1 < argc);
+        if (arg == "--list") { list = true; }
+        else if (arg == "--no-checks") { checks = false; }
+        else if (arg == "--filter" && hasValue) { filter = argv[++i]; }
+        else if (arg == "--duration" && hasValue) { durationMs = std::max<int>(atoi(argv[++i]), 1); }
+        else if (arg == "--block" && hasValue) { blockSize = std::clamp<int>(atoi(argv[++i]), 1, STREAM_BUFFER_SIZE / 2); }
+        else if (arg == "--input" && hasValue) { inputPath = argv[++i]; }
+        else if (arg == "--format" && hasValue) { inputFormat = argv[++i]; }
+        else if (arg == "--json" && hasValue) { jsonPath = argv[++i]; }
+        else if (arg == "--compare" && hasValue) { comparePath = argv[++i]; }
+        else if (arg == "--threshold" && hasValue) { threshold = atof(argv[++i]); }
+        else {
+            printUsage(argv[0]);
+            return (arg == "--help" || arg == "-h") ? 0 : -1;
+        }
+    }
+
+    std::vector<bench::Benchmark> benchmarks = bench::getBenchmarks();
+    std::vector<bench::Check> checkList = bench::getChecks();
+    if (list) {
+        for (auto& b : benchmarks) {
+            printf("%-28s %s\n", b.name.c_str(), b.description.c_str());
+        }
+        for (auto& c : checkList) {
+            printf("%-28s %s\n", c.name.c_str(), c.description.c_str());
+        }
+        return 0;
+    }
+
+    // Load the baseline first to fail early
+    json baseline;
+    if (!comparePath.empty()) {
+        try {
+            std::ifstream file(comparePath);
+            file >> baseline;
+        }
+        catch (const std::exception& e) {
+            fprintf(stderr, "Could not load baseline %s: %s\n", comparePath.c_str(), e.what());
+            return -1;
+        }
+    }
+
+    std::vector<dsp::complex_t> input;
+    if (inputPath.empty()) {
+        input = synthesize();
+    }
+    else if (!loadInput(inputPath, inputFormat, input)) {
+        return -1;
+    }
+
+    json results;
+    results["input"] = inputPath.empty() ? "synthetic" : inputPath;
+    results["blockSize"] = blockSize;
+    results["durationMs"] = durationMs;
+
+    // A fast path giving wrong results isn't worth measuring
+    int failures = 0;
+    if (checks) {
+        printf("%-28s %12s %12s\n", "check", "error", "threshold");
+        for (auto& c : checkList) {
+            if (!filter.empty() && c.name.find(filter) == std::string::npos) { continue; }
+
+            double error = c.measure();
+            bool failed = !(error <= c.threshold);
+            if (failed) { failures++; }
+            results["checks"][c.name]["error"] = error;
+            results["checks"][c.name]["passed"] = !failed;
+            printf("%-28s %12.3g %12.3g  %s\n", c.name.c_str(), error, c.threshold, failed ? "FAILED" : "ok");
+            fflush(stdout);
+        }
+        printf("\n");
+    }
+
+    printf("%-28s %10s %10s %8s %12s %12s %12s\n", "benchmark", "MS/s", "ns/samp", "allocs", "misses/samp", "instr/samp", "cycles/samp");
+    int regressions = 0;
+    for (auto& b : benchmarks) {
+        if (!filter.empty() && b.name.find(filter) == std::string::npos) { continue; }
+
+        bench::Result res = bench::run(b, input, blockSize, durationMs);
+        results["benchmarks"][res.name] = toJson(res);
+        printf("%-28s %10.3f %10.3f %8llu %12.3f %12.1f %12.1f", res.name.c_str(), res.msps, res.nsPerSample,
+               (unsigned long long)res.allocs, res.cacheMisses, res.instructions, res.cycles);
+
+        // Slowdown relative to the baseline, in percent
+        if (baseline.contains("benchmarks") && baseline["benchmarks"].contains(res.name)) {
+            double base = baseline["benchmarks"][res.name]["nsPerSample"];
+            double change = (res.nsPerSample - base) * 100.0 / base;
+            bool regressed = (change > threshold);
+            if (regressed) { regressions++; }
+            printf("  %+7.1f%%%s", change, regressed ? "  REGRESSION" : "");
+        }
+        printf("\n");
+        fflush(stdout);
+    }
+
+    if (!jsonPath.empty()) {
+        std::ofstream file(jsonPath);
+        if (!file.is_open()) {
+            fprintf(stderr, "Could not write %s\n", jsonPath.c_str());
+            return -1;
+        }
+        file << results.dump(4);
+    }
+
+    if (failures) {
+        printf("%d check(s) failed\n", failures);
+    }
+    if (regressions) {
+        printf("%d benchmark(s) more than %.1f%% slower than the baseline\n", regressions, threshold);
+    }
+    return (failures || regressions) ? 1 : 0;
+}
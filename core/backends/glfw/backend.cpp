@@ -62,6 +62,35 @@ namespace backend {
         }
     }
 
+    // Input callbacks, ImGui chains its own callbacks to these so they only need to wake the scheduler
+    static void cursor_pos_callback(GLFWwindow* window, double x, double y) {
+        gui::frameScheduler.notifyInput();
+    }
+
+    static void mouse_button_callback(GLFWwindow* window, int button, int action, int mods) {
+        gui::frameScheduler.notifyInput();
+    }
+
+    static void scroll_callback(GLFWwindow* window, double xoffset, double yoffset) {
+        gui::frameScheduler.notifyInput();
+    }
+
+    static void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods) {
+        gui::frameScheduler.notifyInput();
+    }
+
+    static void char_callback(GLFWwindow* window, unsigned int c) {
+        gui::frameScheduler.notifyInput();
+    }
+
+    static void window_focus_callback(GLFWwindow* window, int focused) {
+        gui::frameScheduler.notifyInput();
+    }
+
+    static void window_refresh_callback(GLFWwindow* window) {
+        gui::frameScheduler.notifyInput();
+    }
+
     int init(std::string resDir) {
         // Load config
         core::configManager.acquire();
@@ -147,6 +176,15 @@ namespace backend {
         glfwSetWindowMaximizeCallback(window, maximized_callback);
     #endif
 
+        // Register input callbacks before ImGui installs its own so that they get chained
+        glfwSetCursorPosCallback(window, cursor_pos_callback);
+        glfwSetMouseButtonCallback(window, mouse_button_callback);
+        glfwSetScrollCallback(window, scroll_callback);
+        glfwSetKeyCallback(window, key_callback);
+        glfwSetCharCallback(window, char_callback);
+        glfwSetWindowFocusCallback(window, window_focus_callback);
+        glfwSetWindowRefreshCallback(window, window_refresh_callback);
+
         // Setup Dear ImGui context
         IMGUI_CHECKVERSION();
         ImGui::CreateContext();
@@ -217,8 +255,20 @@ namespace backend {
 
         // Main loop
         while (!glfwWindowShouldClose(window)) {
-            glfwPollEvents();
+            // Sleep until input, a frame request from another thread or the scheduler timeout
+            gui::frameScheduler.setSleeping(true);
+            double timeout = gui::frameScheduler.getWaitTimeout();
+            if (timeout > 0.0) {
+                glfwWaitEventsTimeout(timeout);
+            }
+            else {
+                glfwPollEvents();
+            }
+            gui::frameScheduler.setSleeping(false);
+
+            if (!gui::frameScheduler.shouldRender()) { continue; }
 
+            gui::frameScheduler.beginFrame();
             beginFrame();
             
             if (_maximized != maximized) {
@@ -270,12 +320,19 @@ namespace backend {
                 gui::mainWindow.draw();
             }
 
+            gui::frameScheduler.drawOverlay();
+
             render();
+            gui::frameScheduler.endFrame();
         }
 
         return 0;
     }
 
+    void wakeUp() {
+        glfwPostEmptyEvent();
+    }
+
     int end() {
         // Cleanup
         ImGui_ImplOpenGL3_Shutdown();
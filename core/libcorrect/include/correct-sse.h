@@ -5,9 +5,11 @@
 struct correct_convolutional_sse;
 typedef struct correct_convolutional_sse correct_convolutional_sse;
 
-/* SSE versions of libcorrect's convolutional encoder/decoder.
+/* SSE 4.1/NEON versions of libcorrect's convolutional encoder/decoder.
  * These instances should not be used with the non-sse functions,
  * and non-sse instances should not be used with the sse functions.
+ * When the library was built with either instruction set,
+ * correct_convolutional_create already uses this decoder for orders of 6 and up.
  */
 
 correct_convolutional_sse *correct_convolutional_sse_create(
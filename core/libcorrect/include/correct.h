@@ -227,6 +227,36 @@ ssize_t correct_reed_solomon_encode(correct_reed_solomon *rs, const uint8_t *msg
 ssize_t correct_reed_solomon_decode(correct_reed_solomon *rs, const uint8_t *encoded,
                                     size_t encoded_length, uint8_t *msg);
 
+/* correct_reed_solomon_decode_strided decodes a codeword whose
+ * symbols are stride bytes apart, e.g. one of the codewords of a
+ * frame interleaved symbol by symbol. The codeword is made of
+ * encoded[0], encoded[stride], ... encoded[(encoded_length - 1) * stride].
+ * Otherwise it behaves like correct_reed_solomon_decode.
+ *
+ * If corrected is not NULL, it receives the number of symbols that
+ * were corrected, or -1 if the codeword could not be decoded.
+ */
+ssize_t correct_reed_solomon_decode_strided(correct_reed_solomon *rs, const uint8_t *encoded,
+                                            size_t encoded_length, size_t stride, uint8_t *msg,
+                                            int *corrected);
+/* correct_reed_solomon_decode_interleaved decodes the depth codewords
+ * of a frame interleaved symbol by symbol, codeword i being made of
+ * encoded[i], encoded[i + depth], ... Each codeword is encoded_length
+ * bytes long.
+ *
+ * The payloads are written one after the other to msg, which should
+ * hold depth times the payload length. The payload of a codeword that
+ * could not be decoded is left untouched.
+ *
+ * If corrected is not NULL, it should hold depth items and receives
+ * the number of symbols corrected in each codeword, or -1 for the
+ * codewords that could not be decoded.
+ *
+ * This function returns the number of codewords that were decoded.
+ */
+size_t correct_reed_solomon_decode_interleaved(correct_reed_solomon *rs, const uint8_t *encoded,
+                                               size_t encoded_length, size_t depth, uint8_t *msg,
+                                               int *corrected);
 /* correct_reed_solomon_decode_with_erasures uses the rs
  * instance to decode a payload from a block containing payload
  * and parity bytes. Additionally, the user can provide the
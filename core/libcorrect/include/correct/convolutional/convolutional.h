@@ -7,6 +7,13 @@
 #include "correct/convolutional/history_buffer.h"
 #include "correct/convolutional/error_buffer.h"
 
+// the vector decoder in convolutional/sse is built for SSE 4.1 and NEON targets
+// it computes 32 states per iteration so it needs at least 64 states
+#if defined(__SSE4_1__) || defined(__ARM_NEON)
+#define CORRECT_CONVOLUTIONAL_SIMD
+#endif
+#define CORRECT_CONVOLUTIONAL_SIMD_MIN_ORDER 6
+
 struct correct_convolutional {
     const unsigned int *table;  // size 2**order
     size_t rate;                // e.g. 2, 3...
@@ -21,6 +28,9 @@ struct correct_convolutional {
     soft_measurement_t soft_measurement;
     history_buffer *history_buffer;
     error_buffer_t *errors;
+
+    // set when this is the base of a correct_convolutional_sse
+    bool is_simd;
 };
 
 correct_convolutional *_correct_convolutional_init(correct_convolutional *conv,
@@ -2,7 +2,11 @@
 #include "correct/convolutional/sse/lookup.h"
 // BIG HEAPING TODO sort out the include mess
 #include "correct-sse.h"
+#if defined(__SSE4_1__)
 #include <x86intrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
 
 struct correct_convolutional_sse {
     correct_convolutional base_conv;
@@ -1,5 +1,4 @@
 #include "correct/convolutional/lookup.h"
-#include <x86intrin.h>
 
 typedef unsigned int distance_quad_key_t;
 typedef unsigned int output_quad_t;
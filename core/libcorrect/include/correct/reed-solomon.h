@@ -10,6 +10,11 @@
 #include "correct.h"
 #include "correct/portable.h"
 
+// syndromes are computed 16 coefficients at a time with byte shuffles when available
+#if defined(__SSSE3__) || defined(__ARM_NEON)
+#define CORRECT_REED_SOLOMON_SIMD
+#endif
+
 // an element in GF(2^8)
 typedef uint8_t field_element_t;
 
@@ -60,6 +65,10 @@ struct correct_reed_solomon {
 
     field_logarithm_t **element_exp;
 
+    // multiplication tables for each generator root, used to find the syndromes
+    // 16 entries per nibble of root^16 with CORRECT_REED_SOLOMON_SIMD, 256 entries of root otherwise
+    field_element_t *syndrome_tables;
+
     // scratch
     // (do no allocations at steady state)
 
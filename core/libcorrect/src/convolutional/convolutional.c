@@ -1,4 +1,7 @@
 #include "correct/convolutional/convolutional.h"
+#ifdef CORRECT_CONVOLUTIONAL_SIMD
+#include "correct/convolutional/sse/convolutional.h"
+#endif
 
 // https://www.youtube.com/watch?v=b3_lVSrPB6w
 
@@ -28,11 +31,19 @@ correct_convolutional *_correct_convolutional_init(correct_convolutional *conv,
     conv->bit_reader = bit_reader_create(NULL, 0);
 
     conv->has_init_decode = false;
+    conv->is_simd = false;
     return conv;
 }
 
 correct_convolutional *correct_convolutional_create(size_t rate, size_t order,
                                                     const polynomial_t *poly) {
+#ifdef CORRECT_CONVOLUTIONAL_SIMD
+    // hand out the vector decoder when it's built in, it decodes the same stream
+    if (order >= CORRECT_CONVOLUTIONAL_SIMD_MIN_ORDER) {
+        correct_convolutional_sse *sse_conv = correct_convolutional_sse_create(rate, order, poly);
+        return sse_conv ? &sse_conv->base_conv : NULL;
+    }
+#endif
     correct_convolutional *conv = malloc(sizeof(correct_convolutional));
     correct_convolutional *init_conv = _correct_convolutional_init(conv, rate, order, poly);
     if (!init_conv) {
@@ -54,6 +65,12 @@ void _correct_convolutional_teardown(correct_convolutional *conv) {
 }
 
 void correct_convolutional_destroy(correct_convolutional *conv) {
+#ifdef CORRECT_CONVOLUTIONAL_SIMD
+    if (conv->is_simd) {
+        correct_convolutional_sse_destroy((correct_convolutional_sse *)conv);
+        return;
+    }
+#endif
     _correct_convolutional_teardown(conv);
     free(conv);
 }
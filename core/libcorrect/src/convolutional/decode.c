@@ -1,4 +1,7 @@
 #include "correct/convolutional/convolutional.h"
+#ifdef CORRECT_CONVOLUTIONAL_SIMD
+#include "correct/convolutional/sse/convolutional.h"
+#endif
 
 void conv_decode_print_iter(correct_convolutional *conv, unsigned int iter,
                             unsigned int winner_index) {
@@ -293,6 +296,11 @@ static ssize_t _convolutional_decode(correct_convolutional *conv, size_t num_enc
 // hard decoder
 ssize_t correct_convolutional_decode(correct_convolutional *conv, const uint8_t *encoded,
                                      size_t num_encoded_bits, uint8_t *msg) {
+#ifdef CORRECT_CONVOLUTIONAL_SIMD
+    if (conv->is_simd) {
+        return correct_convolutional_sse_decode((correct_convolutional_sse *)conv, encoded, num_encoded_bits, msg);
+    }
+#endif
     if (num_encoded_bits % conv->rate) {
         // XXX turn this into an error code
         // printf("encoded length of message must be a multiple of rate\n");
@@ -308,6 +316,11 @@ ssize_t correct_convolutional_decode(correct_convolutional *conv, const uint8_t
 
 ssize_t correct_convolutional_decode_soft(correct_convolutional *conv, const soft_t *encoded,
                                           size_t num_encoded_bits, uint8_t *msg) {
+#ifdef CORRECT_CONVOLUTIONAL_SIMD
+    if (conv->is_simd) {
+        return correct_convolutional_sse_decode_soft((correct_convolutional_sse *)conv, encoded, num_encoded_bits, msg);
+    }
+#endif
     if (num_encoded_bits % conv->rate) {
         // XXX turn this into an error code
         // printf("encoded length of message must be a multiple of rate\n");
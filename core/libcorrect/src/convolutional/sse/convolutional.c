@@ -8,6 +8,8 @@ correct_convolutional_sse *correct_convolutional_sse_create(size_t rate,
     if (!init_conv) {
         free(conv);
         conv = NULL;
+    } else {
+        conv->base_conv.is_simd = true;
     }
     return conv;
 }
@@ -74,6 +74,7 @@ static void convolutional_sse_decode_inner(correct_convolutional_sse *sse_conv,
             // low and low_plus_one share low_past_error
             //   note that they are the same when shifted right by 1
             // same goes for high and high_plus_one
+#if defined(__SSE4_1__)
             __m128i past_shuffle_mask =
                 _mm_set_epi32(0x07060706, 0x05040504, 0x03020302, 0x01000100);
             __m128i hist_mask =
@@ -218,6 +219,30 @@ static void convolutional_sse_decode_inner(correct_convolutional_sse *sse_conv,
                 _mm_storel_epi64((__m128i *)(history + low + offset + 16), hist1);
                 _mm_storel_epi64((__m128i *)(history + low + offset + 24), hist2);
             }
+#elif defined(__ARM_NEON)
+            // same 32 states as the SSE path, 4 vectors of 8 distances for each half
+            for (shift_register_t v = 0; v < 4; v++) {
+                // register states that differ only by their low order bit share a past error
+                uint16x4_t low_past = vld1_u16(read_errors + base + 4 * v);
+                uint16x4x2_t low_zip = vzip_u16(low_past, low_past);
+                uint16x8_t low_past_error = vcombine_u16(low_zip.val[0], low_zip.val[1]);
+
+                uint16x4_t high_past = vld1_u16(read_errors + highbase + base + 4 * v);
+                uint16x4x2_t high_zip = vzip_u16(high_past, high_past);
+                uint16x8_t high_past_error = vcombine_u16(high_zip.val[0], high_zip.val[1]);
+
+                // add the distance for this time slice from the oct table
+                distance_oct_key_t low_key = oct_lookup.keys[oct + v];
+                distance_oct_key_t high_key = oct_lookup.keys[oct_highbase + oct + v];
+                uint16x8_t low_error = vaddq_u16(low_past_error, vld1q_u16((const uint16_t *)(oct_lookup.distances + low_key)));
+                uint16x8_t high_error = vaddq_u16(high_past_error, vld1q_u16((const uint16_t *)(oct_lookup.distances + high_key)));
+
+                // keep the least error, the history bit is set when the state with the high order bit won
+                uint16x8_t min_error = vminq_u16(low_error, high_error);
+                vst1q_u16(write_errors + low + 8 * v, min_error);
+                vst1_u8(history + low + 8 * v, vmovn_u16(vcgtq_u16(low_error, min_error)));
+            }
+#endif
         }
 
         // bypass the call to history buffer
@@ -1,5 +1,21 @@
 #include "correct/reed-solomon/encode.h"
 
+#if defined(__SSSE3__)
+#include <x86intrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+
+// look up 16 bytes in a 16 byte table
+static inline uint8x16_t reed_solomon_table_lookup(uint8x16_t table, uint8x16_t index) {
+#if defined(__aarch64__)
+    return vqtbl1q_u8(table, index);
+#else
+    uint8x8x2_t halves = {{vget_low_u8(table), vget_high_u8(table)}};
+    return vcombine_u8(vtbl2_u8(halves, vget_low_u8(index)), vtbl2_u8(halves, vget_high_u8(index)));
+#endif
+}
+#endif
+
 // calculate all syndromes of the received polynomial at the roots of the generator
 // because we're evaluating at the roots of the generator, and because the transmitted
 //   polynomial was made to be a product of the generator, we know that the transmitted
@@ -9,21 +25,84 @@
 //   these syndromes are all zero, then we can conclude the error polynomial is also
 //   zero. if they're nonzero, then we know our message received an error in transit.
 // returns true if syndromes are all zero
-static bool reed_solomon_find_syndromes(field_t field, polynomial_t msgpoly, field_logarithm_t **generator_root_exp,
-                                        field_element_t *syndromes, size_t min_distance) {
+static bool reed_solomon_find_syndromes(correct_reed_solomon *rs, polynomial_t msgpoly, field_element_t *syndromes) {
     bool all_zero = true;
-    memset(syndromes, 0, min_distance * sizeof(field_element_t));
-    for (unsigned int i = 0; i < min_distance; i++) {
-        // profiling reveals that this function takes about 50% of the cpu time of
-        // decoding. so, in order to speed it up a little, we precompute and save
-        // the successive powers of the roots of the generator, which are
-        // located in generator_root_exp
-        field_element_t eval = polynomial_eval_lut(field, msgpoly, generator_root_exp[i]);
-        if (eval) {
+
+    // the leading zeros of a shortened block leave the syndromes at 0, skip them
+    int top = msgpoly.order;
+    while (top > 0 && !msgpoly.coeff[top]) {
+        top--;
+    }
+
+#ifdef CORRECT_REED_SOLOMON_SIMD
+    // this is the bulk of the decoding time when the block has no errors
+    // split the received polynomial into 16 interleaved ones, c(x) = sum of x^k * c_k(x^16) for k in [0, 15]
+    // every c_k gets a lane and is evaluated at root^16 with horner's method. multiplying a lane by
+    //   root^16 takes a table lookup for each nibble, which is what byte shuffles do 16 at a time
+    // the lanes are then the coefficients of a small polynomial that we evaluate at the root itself
+    // msgpoly has a spare zero coefficient so it is a whole number of vectors long
+    unsigned int vectors = top / 16 + 1;
+    field_element_t lanes[16];
+    polynomial_t lane_poly;
+    lane_poly.coeff = lanes;
+    lane_poly.order = 15;
+    for (unsigned int i = 0; i < rs->min_distance; i++) {
+        const field_element_t *table = rs->syndrome_tables + 32 * i;
+#if defined(__SSSE3__)
+        __m128i low_table = _mm_loadu_si128((const __m128i *)table);
+        __m128i high_table = _mm_loadu_si128((const __m128i *)(table + 16));
+        __m128i nibble_mask = _mm_set1_epi8(0x0f);
+        __m128i acc = _mm_setzero_si128();
+        for (int j = vectors - 1; j >= 0; j--) {
+            __m128i low = _mm_shuffle_epi8(low_table, _mm_and_si128(acc, nibble_mask));
+            __m128i high = _mm_shuffle_epi8(high_table, _mm_and_si128(_mm_srli_epi16(acc, 4), nibble_mask));
+            __m128i coeff = _mm_loadu_si128((const __m128i *)(msgpoly.coeff + 16 * j));
+            acc = _mm_xor_si128(_mm_xor_si128(low, high), coeff);
+        }
+        _mm_storeu_si128((__m128i *)lanes, acc);
+#elif defined(__ARM_NEON)
+        uint8x16_t low_table = vld1q_u8(table);
+        uint8x16_t high_table = vld1q_u8(table + 16);
+        uint8x16_t nibble_mask = vdupq_n_u8(0x0f);
+        uint8x16_t acc = vdupq_n_u8(0);
+        for (int j = vectors - 1; j >= 0; j--) {
+            uint8x16_t low = reed_solomon_table_lookup(low_table, vandq_u8(acc, nibble_mask));
+            uint8x16_t high = reed_solomon_table_lookup(high_table, vshrq_n_u8(acc, 4));
+            acc = veorq_u8(veorq_u8(low, high), vld1q_u8(msgpoly.coeff + 16 * j));
+        }
+        vst1q_u8(lanes, acc);
+#endif
+        // the precomputed powers of the root are exactly what we need for the lanes
+        syndromes[i] = polynomial_eval_lut(rs->field, lane_poly, rs->generator_root_exp[i]);
+        if (syndromes[i]) {
             all_zero = false;
         }
-        syndromes[i] = eval;
     }
+#else
+    // horner's method, highest order coefficient first. multiplying by a root is a single lookup in its
+    //   table. the syndromes are done 4 at a time in locals so the chains can overlap
+    for (unsigned int i = 0; i < rs->min_distance; i += 4) {
+        const field_element_t *table0 = rs->syndrome_tables + 256 * i;
+        const field_element_t *table1 = (i + 1 < rs->min_distance) ? table0 + 256 : table0;
+        const field_element_t *table2 = (i + 2 < rs->min_distance) ? table0 + 512 : table0;
+        const field_element_t *table3 = (i + 3 < rs->min_distance) ? table0 + 768 : table0;
+        field_element_t s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+        for (int j = top; j >= 0; j--) {
+            field_element_t coeff = msgpoly.coeff[j];
+            s0 = table0[s0] ^ coeff;
+            s1 = table1[s1] ^ coeff;
+            s2 = table2[s2] ^ coeff;
+            s3 = table3[s3] ^ coeff;
+        }
+        field_element_t results[4] = {s0, s1, s2, s3};
+        for (unsigned int k = 0; k < 4 && i + k < rs->min_distance; k++) {
+            syndromes[i + k] = results[k];
+            if (results[k]) {
+                all_zero = false;
+            }
+        }
+    }
+#endif
     return all_zero;
 }
 
@@ -260,7 +339,10 @@ void correct_reed_solomon_decoder_create(correct_reed_solomon *rs) {
     rs->has_init_decode = true;
     rs->syndromes = calloc(rs->min_distance, sizeof(field_element_t));
     rs->modified_syndromes = calloc(2 * rs->min_distance, sizeof(field_element_t));
-    rs->received_polynomial = polynomial_create(rs->block_length - 1);
+    // one spare coefficient past the end, always zero, so the syndrome search can work in whole vectors
+    rs->received_polynomial = polynomial_create(rs->block_length);
+    rs->received_polynomial.coeff[rs->block_length] = 0;
+    rs->received_polynomial.order = rs->block_length - 1;
     rs->error_locator = polynomial_create(rs->min_distance);
     rs->error_locator_log = polynomial_create(rs->min_distance);
     rs->erasure_locator = polynomial_create(rs->min_distance);
@@ -292,45 +374,37 @@ void correct_reed_solomon_decoder_create(correct_reed_solomon *rs) {
         polynomial_build_exp_lut(rs->field, i, rs->min_distance - 1, rs->element_exp[i]);
     }
 
+#ifdef CORRECT_REED_SOLOMON_SIMD
+    // products of root^16 with every low nibble and every high nibble, 32 bytes per root
+    rs->syndrome_tables = malloc(rs->min_distance * 32 * sizeof(field_element_t));
+    for (unsigned int i = 0; i < rs->min_distance; i++) {
+        field_element_t root = field_pow(rs->field, rs->generator_roots[i], 16);
+        for (field_operation_t j = 0; j < 16; j++) {
+            rs->syndrome_tables[32 * i + j] = field_mul(rs->field, root, j);
+            rs->syndrome_tables[32 * i + 16 + j] = field_mul(rs->field, root, j << 4);
+        }
+    }
+#else
+    // products of the root with every element, 256 bytes per root
+    rs->syndrome_tables = malloc(rs->min_distance * 256 * sizeof(field_element_t));
+    for (unsigned int i = 0; i < rs->min_distance; i++) {
+        for (field_operation_t j = 0; j < 256; j++) {
+            rs->syndrome_tables[256 * i + j] = field_mul(rs->field, rs->generator_roots[i], j);
+        }
+    }
+#endif
+
     rs->init_from_roots_scratch[0] = polynomial_create(rs->min_distance);
     rs->init_from_roots_scratch[1] = polynomial_create(rs->min_distance);
 }
 
-ssize_t correct_reed_solomon_decode(correct_reed_solomon *rs, const uint8_t *encoded, size_t encoded_length,
-                                    uint8_t *msg) {
-    if (encoded_length > rs->block_length) {
-        return -1;
-    }
-
+// decodes the codeword already loaded in received_polynomial
+static ssize_t reed_solomon_decode_received(correct_reed_solomon *rs, size_t encoded_length, uint8_t *msg,
+                                            int *corrected) {
     // the message is the non-remainder part
     size_t msg_length = encoded_length - rs->min_distance;
-    // if they handed us a nonfull block, we'll write in 0s
-    size_t pad_length = rs->block_length - encoded_length;
-
-    if (!rs->has_init_decode) {
-        // initialize rs for decoding
-        correct_reed_solomon_decoder_create(rs);
-    }
-
-    // we need to copy to our local buffer
-    // the buffer we're given has the coordinates in the wrong direction
-    // e.g. byte 0 corresponds to the 254th order coefficient
-    // so we're going to flip and then write padding
-    // the final copied buffer will look like
-    // | rem (rs->min_distance) | msg (msg_length) | pad (pad_length) |
-
-    for (unsigned int i = 0; i < encoded_length; i++) {
-        rs->received_polynomial.coeff[i] = encoded[encoded_length - (i + 1)];
-    }
-
-    // fill the pad_length with 0s
-    for (unsigned int i = 0; i < pad_length; i++) {
-        rs->received_polynomial.coeff[i + encoded_length] = 0;
-    }
 
-
-    bool all_zero = reed_solomon_find_syndromes(rs->field, rs->received_polynomial, rs->generator_root_exp,
-                                                rs->syndromes, rs->min_distance);
+    bool all_zero = reed_solomon_find_syndromes(rs, rs->received_polynomial, rs->syndromes);
 
     if (all_zero) {
         // syndromes were all zero, so there was no error in the message
@@ -338,6 +412,9 @@ ssize_t correct_reed_solomon_decode(correct_reed_solomon *rs, const uint8_t *enc
         for (unsigned int i = 0; i < msg_length; i++) {
             msg[i] = rs->received_polynomial.coeff[encoded_length - (i + 1)];
         }
+        if (corrected) {
+            *corrected = 0;
+        }
         return msg_length;
     }
 
@@ -358,12 +435,26 @@ ssize_t correct_reed_solomon_decode(correct_reed_solomon *rs, const uint8_t *enc
     if (!reed_solomon_factorize_error_locator(rs->field, 0, rs->error_locator_log, rs->error_roots, rs->element_exp)) {
         // roots couldn't be found, so there were too many errors to deal with
         // RS has failed for this message
+        if (corrected) {
+            *corrected = -1;
+        }
         return -1;
     }
 
     reed_solomon_find_error_locations(rs->field, rs->generator_root_gap, rs->error_roots, rs->error_locations,
                                       rs->error_locator.order, 0);
 
+    // the padding of a shortened block is known to be 0s, so an error located there
+    // means we landed on a codeword of the full length code, not of ours
+    for (unsigned int i = 0; i < rs->error_locator.order; i++) {
+        if (rs->error_locations[i] >= encoded_length) {
+            if (corrected) {
+                *corrected = -1;
+            }
+            return -1;
+        }
+    }
+
     reed_solomon_find_error_values(rs);
 
     for (unsigned int i = 0; i < rs->error_locator.order; i++) {
@@ -375,9 +466,77 @@ ssize_t correct_reed_solomon_decode(correct_reed_solomon *rs, const uint8_t *enc
         msg[i] = rs->received_polynomial.coeff[encoded_length - (i + 1)];
     }
 
+    if (corrected) {
+        *corrected = rs->error_locator.order;
+    }
     return msg_length;
 }
 
+ssize_t correct_reed_solomon_decode(correct_reed_solomon *rs, const uint8_t *encoded, size_t encoded_length,
+                                    uint8_t *msg) {
+    return correct_reed_solomon_decode_strided(rs, encoded, encoded_length, 1, msg, NULL);
+}
+
+ssize_t correct_reed_solomon_decode_strided(correct_reed_solomon *rs, const uint8_t *encoded,
+                                            size_t encoded_length, size_t stride, uint8_t *msg,
+                                            int *corrected) {
+    if (encoded_length > rs->block_length || encoded_length < rs->min_distance) {
+        if (corrected) {
+            *corrected = -1;
+        }
+        return -1;
+    }
+
+    // if they handed us a nonfull block, we'll write in 0s
+    size_t pad_length = rs->block_length - encoded_length;
+
+    if (!rs->has_init_decode) {
+        // initialize rs for decoding
+        correct_reed_solomon_decoder_create(rs);
+    }
+
+    // we need to copy to our local buffer
+    // the buffer we're given has the coordinates in the wrong direction
+    // e.g. byte 0 corresponds to the 254th order coefficient
+    // so we're going to flip and then write padding
+    // the final copied buffer will look like
+    // | rem (rs->min_distance) | msg (msg_length) | pad (pad_length) |
+    // interleaved codewords are gathered by this same copy, so they never need a separate pass
+
+    if (stride == 1) {
+        for (unsigned int i = 0; i < encoded_length; i++) {
+            rs->received_polynomial.coeff[i] = encoded[encoded_length - (i + 1)];
+        }
+    } else {
+        const uint8_t *symbol = encoded + (encoded_length - 1) * stride;
+        for (unsigned int i = 0; i < encoded_length; i++) {
+            rs->received_polynomial.coeff[i] = *symbol;
+            symbol -= stride;
+        }
+    }
+
+    // fill the pad_length with 0s
+    for (unsigned int i = 0; i < pad_length; i++) {
+        rs->received_polynomial.coeff[i + encoded_length] = 0;
+    }
+
+    return reed_solomon_decode_received(rs, encoded_length, msg, corrected);
+}
+
+size_t correct_reed_solomon_decode_interleaved(correct_reed_solomon *rs, const uint8_t *encoded,
+                                               size_t encoded_length, size_t depth, uint8_t *msg,
+                                               int *corrected) {
+    size_t msg_length = encoded_length - rs->min_distance;
+    size_t decoded = 0;
+    for (size_t i = 0; i < depth; i++) {
+        if (correct_reed_solomon_decode_strided(rs, encoded + i, encoded_length, depth, msg + i * msg_length,
+                                                corrected ? &corrected[i] : NULL) >= 0) {
+            decoded++;
+        }
+    }
+    return decoded;
+}
+
 ssize_t correct_reed_solomon_decode_with_erasures(correct_reed_solomon *rs, const uint8_t *encoded,
                                                   size_t encoded_length, const uint8_t *erasure_locations,
                                                   size_t erasure_length, uint8_t *msg) {
@@ -430,8 +589,7 @@ ssize_t correct_reed_solomon_decode_with_erasures(correct_reed_solomon *rs, cons
     rs->erasure_locator =
         reed_solomon_find_error_locator_from_roots(rs->field, erasure_length, rs->error_roots, rs->erasure_locator, rs->init_from_roots_scratch);
 
-    bool all_zero = reed_solomon_find_syndromes(rs->field, rs->received_polynomial, rs->generator_root_exp,
-                                                rs->syndromes, rs->min_distance);
+    bool all_zero = reed_solomon_find_syndromes(rs, rs->received_polynomial, rs->syndromes);
 
     if (all_zero) {
         // syndromes were all zero, so there was no error in the message
@@ -61,6 +61,7 @@ void correct_reed_solomon_destroy(correct_reed_solomon *rs) {
             free(rs->element_exp[i]);
         }
         free(rs->element_exp);
+        free(rs->syndrome_tables);
         polynomial_destroy(rs->init_from_roots_scratch[0]);
         polynomial_destroy(rs->init_from_roots_scratch[1]);
     }
@@ -0,0 +1,174 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "correct.h"
+
+#define MAX_DEPTH 8
+
+// Left in the payload of the codewords that couldn't be decoded
+#define UNTOUCHED 0xa5
+
+void print_test_type(size_t block_length, size_t message_length, size_t depth,
+                     size_t max_errors) {
+    printf(
+        "testing interleaved reed solomon block length=%zu, message length=%zu, "
+        "depth=%zu, errors up to %zu...",
+        block_length, message_length, depth, max_errors);
+}
+
+void fail_test(const char *reason, size_t codeword) {
+    printf("FAILED (%s, codeword %zu)\n", reason, codeword);
+    exit(1);
+}
+
+void pass_test() { printf("PASSED\n"); }
+
+void corrupt(uint8_t *encoded, size_t block_length, size_t num_errors) {
+    int indices[255];
+    for (size_t i = 0; i < block_length; i++) {
+        indices[i] = i;
+    }
+    for (size_t i = 0; i < num_errors; i++) {
+        size_t j = i + rand() % (block_length - i);
+        int temp = indices[i];
+        indices[i] = indices[j];
+        indices[j] = temp;
+        encoded[indices[i]] ^= 1 + rand() % 255;
+    }
+}
+
+// Symbols of the received codeword the decoder changed, found by re-encoding the payload it returned
+int count_corrected(correct_reed_solomon *rs, const uint8_t *received, const uint8_t *msg,
+                    size_t message_length) {
+    uint8_t reencoded[255];
+    size_t block_length = correct_reed_solomon_encode(rs, msg, message_length, reencoded);
+    int corrected = 0;
+    for (size_t i = 0; i < block_length; i++) {
+        if (reencoded[i] != received[i]) {
+            corrected++;
+        }
+    }
+    return corrected;
+}
+
+void run_tests(correct_reed_solomon *rs, size_t block_length, size_t min_distance,
+               size_t depth, size_t num_iterations) {
+    size_t message_length = block_length - min_distance;
+    // Past half the distance some codewords fail, which must match too
+    size_t max_errors = min_distance / 2 + 4;
+    print_test_type(block_length, message_length, depth, max_errors);
+
+    uint8_t msg[MAX_DEPTH][255];
+    uint8_t encoded[255];
+    uint8_t frame[MAX_DEPTH * 255];
+    uint8_t received[255];
+    uint8_t ref_msg[255];
+    uint8_t out[MAX_DEPTH * 255];
+    uint8_t strided_msg[255];
+    int corrected[MAX_DEPTH];
+    int injected[MAX_DEPTH];
+
+    for (size_t iter = 0; iter < num_iterations; iter++) {
+        // Encode depth codewords and interleave them symbol by symbol
+        for (size_t i = 0; i < depth; i++) {
+            for (size_t j = 0; j < message_length; j++) {
+                msg[i][j] = rand() % 256;
+            }
+            correct_reed_solomon_encode(rs, msg[i], message_length, encoded);
+            injected[i] = rand() % (max_errors + 1);
+            corrupt(encoded, block_length, injected[i]);
+            for (size_t j = 0; j < block_length; j++) {
+                frame[j * depth + i] = encoded[j];
+            }
+        }
+
+        memset(out, UNTOUCHED, sizeof(out));
+        size_t decoded = correct_reed_solomon_decode_interleaved(rs, frame, block_length, depth,
+                                                                 out, corrected);
+
+        // Every codeword must come out like it does from the plain decoder
+        size_t ref_decoded = 0;
+        for (size_t i = 0; i < depth; i++) {
+            for (size_t j = 0; j < block_length; j++) {
+                received[j] = frame[j * depth + i];
+            }
+            ssize_t ref_len = correct_reed_solomon_decode(rs, received, block_length, ref_msg);
+            uint8_t *payload = &out[i * message_length];
+
+            int strided_corrected;
+            ssize_t strided_len = correct_reed_solomon_decode_strided(rs, &frame[i], block_length, depth,
+                                                                      strided_msg, &strided_corrected);
+            if (strided_len != ref_len || strided_corrected != corrected[i]) {
+                fail_test("strided decode differs", i);
+            }
+
+            if (ref_len < 0) {
+                if (corrected[i] != -1) {
+                    fail_test("failure not reported", i);
+                }
+                for (size_t j = 0; j < message_length; j++) {
+                    if (payload[j] != UNTOUCHED) {
+                        fail_test("payload of a failed codeword written", i);
+                    }
+                }
+                continue;
+            }
+
+            ref_decoded++;
+            if ((size_t)ref_len != message_length || memcmp(payload, ref_msg, message_length) ||
+                memcmp(strided_msg, ref_msg, message_length)) {
+                fail_test("payload differs", i);
+            }
+
+            // Up to half the distance the decoder can't get it wrong. Past that it may settle on another
+            // codeword, but only one it reached by changing as many symbols as it reports.
+            if (injected[i] <= (int)min_distance / 2) {
+                if (memcmp(payload, msg[i], message_length) || corrected[i] != injected[i]) {
+                    fail_test("correctable codeword not corrected", i);
+                }
+            } else if (corrected[i] != count_corrected(rs, received, ref_msg, message_length)) {
+                fail_test("corrected count differs from the symbols changed", i);
+            }
+        }
+        if (decoded != ref_decoded) {
+            fail_test("decoded count differs", depth);
+        }
+    }
+    pass_test();
+}
+
+int main() {
+    // Fixed unless SEED is set, so that a failure can be reproduced
+    unsigned int seed = 1;
+    const char *seed_env = getenv("SEED");
+    if (seed_env) {
+        seed = strtoul(seed_env, NULL, 10);
+    }
+    printf("seed %u\n", seed);
+    srand(seed);
+
+    size_t min_distance = 32;
+    correct_reed_solomon *rs = correct_reed_solomon_create(
+        correct_rs_primitive_polynomial_ccsds, 1, 1, min_distance);
+
+    // CCSDS frames use depths 1 to 5 and 8, shortened codes keep the same layout
+    run_tests(rs, 255, min_distance, 1, 2000);
+    run_tests(rs, 255, min_distance, 4, 2000);
+    run_tests(rs, 255, min_distance, 5, 2000);
+    run_tests(rs, 255, min_distance, 8, 2000);
+    run_tests(rs, 160, min_distance, 4, 2000);
+
+    correct_reed_solomon_destroy(rs);
+
+    min_distance = 16;
+    rs = correct_reed_solomon_create(
+        correct_rs_primitive_polynomial_ccsds, 1, 1, min_distance);
+
+    run_tests(rs, 255, min_distance, 4, 2000);
+    run_tests(rs, 100, min_distance, 8, 2000);
+
+    correct_reed_solomon_destroy(rs);
+    return 0;
+}
@@ -8,6 +8,7 @@ namespace backend {
     void getMouseScreenPos(double& x, double& y);
     void setMouseScreenPos(double x, double y);
     int renderLoop();
+    void wakeUp();
     int end();
 	void minimizeWindow();
 	void quitApplication();
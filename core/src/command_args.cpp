@@ -9,6 +9,9 @@ void CommandArgsParser::defineAll() {
         define('r', "root", "Root directory, where all config files are stored", std::filesystem::absolute(root).string());
         define('s', "server", "Run in server mode");
         define('\0', "autostart", "Automatically start the SDR after loading");
+        define('\0', "log-json", "Also write the log as JSON lines to this file", "");
+        define('\0', "gps-nmea", "Read GPS NMEA from this replay file or terminal", "");
+        define('\0', "profile", "Log the load of the DSP blocks every N seconds (0 to disable)", 0);
 }
 
 int CommandArgsParser::parse(int argc, char* argv[]) {
@@ -1,9 +1,23 @@
 #include <config.h>
 #include <utils/flog.h>
+#include <utils/thread_role.h>
 #include <fstream>
+#include <functional>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 #include <filesystem>
 
+// Wait for the config to stop changing for this long before writing it
+#define AUTOSAVE_DEBOUNCE_MS    1000
+
+// But never delay a write by more than this while changes keep coming in
+#define AUTOSAVE_MAX_DELAY_MS   5000
+
+#define AUTOSAVE_POLL_MS        250
+
 ConfigManager::ConfigManager() {
 }
 
@@ -35,6 +49,13 @@ void ConfigManager::load(json def, bool lock) {
         std::ifstream file(path.c_str());
         file >> conf;
         file.close();
+
+        // Remember what is on disk so that saving an unmodified config is skipped
+        uint64_t seq = ++snapshotSeq;
+        std::lock_guard<std::mutex> lck(writeMtx);
+        lastHash = std::hash<std::string>{}(conf.dump(4));
+        lastHashValid = true;
+        writtenSeq = seq;
     }
     catch (const std::exception& e) {
         flog::error("Config file '{}' is corrupted, resetting it: {}", path, e.what());
@@ -45,11 +66,13 @@ void ConfigManager::load(json def, bool lock) {
 }
 
 void ConfigManager::save(bool lock) {
+    // Only copy the tree while locked, serialising and writing is done without holding the lock
     if (lock) { mtx.lock(); }
-    std::ofstream file(path.c_str());
-    file << conf.dump(4);
-    file.close();
+    json snapshot = conf;
+    uint64_t seq = ++snapshotSeq;
+    changed = false;
     if (lock) { mtx.unlock(); }
+    writeFile(snapshot, seq);
 }
 
 void ConfigManager::enableAutoSave() {
@@ -75,27 +98,106 @@ void ConfigManager::acquire() {
 }
 
 void ConfigManager::release(bool modified) {
-    changed |= modified;
+    if (modified) {
+        auto now = std::chrono::steady_clock::now();
+        if (!changed) { firstChange = now; }
+        lastChange = now;
+        changed = true;
+    }
     mtx.unlock();
 }
 
+void ConfigManager::writeFile(const json& snapshot, uint64_t seq) {
+    std::string data = snapshot.dump(4);
+    size_t hash = std::hash<std::string>{}(data);
+
+    std::lock_guard<std::mutex> lck(writeMtx);
+
+    // A save and the autosave can race here, never let an older snapshot replace a newer one
+    if (seq < writtenSeq) { return; }
+
+    // Skip the write entirely if the content didn't actually change
+    if (lastHashValid && hash == lastHash) {
+        writtenSeq = seq;
+        return;
+    }
+
+    // Write to a temporary file first so that a power loss can never leave a truncated config behind
+    std::string tmpPath = path + ".tmp";
+    int fd = open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        flog::error("Could not open '{0}' for writing: {1}", tmpPath, strerror(errno));
+        return;
+    }
+
+    const char* ptr = data.c_str();
+    size_t left = data.size();
+    while (left) {
+        ssize_t ret = ::write(fd, ptr, left);
+        if (ret < 0) {
+            if (errno == EINTR) { continue; }
+            flog::error("Could not write '{0}': {1}", tmpPath, strerror(errno));
+            close(fd);
+            unlink(tmpPath.c_str());
+            return;
+        }
+        ptr += ret;
+        left -= ret;
+    }
+
+    if (fsync(fd)) {
+        flog::error("Could not sync '{0}': {1}", tmpPath, strerror(errno));
+        close(fd);
+        unlink(tmpPath.c_str());
+        return;
+    }
+    close(fd);
+
+    // Atomically replace the old config
+    if (rename(tmpPath.c_str(), path.c_str())) {
+        flog::error("Could not replace '{0}': {1}", path, strerror(errno));
+        unlink(tmpPath.c_str());
+        return;
+    }
+
+    // Make sure the rename itself is persisted
+    std::string dir = std::filesystem::path(path).parent_path().string();
+    int dirFd = open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+    if (dirFd >= 0) {
+        fsync(dirFd);
+        close(dirFd);
+    }
+
+    lastHash = hash;
+    lastHashValid = true;
+    writtenSeq = seq;
+}
+
 void ConfigManager::autoSaveWorker() {
+    thread_role::apply(THREAD_ROLE_BACKGROUND, "config-save");
     while (autoSaveEnabled) {
-        if (!mtx.try_lock()) {
-            flog::warn("ConfigManager locked, waiting...");
-            std::this_thread::sleep_for(std::chrono::milliseconds(1000));
-            continue;
-        }
-        if (changed) {
-            changed = false;
-            save(false);
+        // Take a snapshot once the config stopped changing (or has been changing for too long)
+        bool doSave = false;
+        json snapshot;
+        uint64_t seq = 0;
+        {
+            std::lock_guard<std::mutex> lck(mtx);
+            auto now = std::chrono::steady_clock::now();
+            if (changed && (now - lastChange >= std::chrono::milliseconds(AUTOSAVE_DEBOUNCE_MS) || now - firstChange >= std::chrono::milliseconds(AUTOSAVE_MAX_DELAY_MS))) {
+                snapshot = conf;
+                seq = ++snapshotSeq;
+                changed = false;
+                doSave = true;
+            }
         }
-        mtx.unlock();
+
+        // Serialise and write without holding the config lock
+        if (doSave) { writeFile(snapshot, seq); }
 
         // Sleep but listen for wakeup call
         {
             std::unique_lock<std::mutex> lock(termMtx);
-            termCond.wait_for(lock, std::chrono::milliseconds(1000), [this]() { return termFlag; });
+            termCond.wait_for(lock, std::chrono::milliseconds(AUTOSAVE_POLL_MS), [this]() { return termFlag; });
         }
     }
-}
\ No newline at end of file
+}
@@ -3,6 +3,7 @@
 #include <thread>
 #include <string>
 #include <mutex>
+#include <chrono>
 #include <condition_variable>
 
 using nlohmann::json;
@@ -23,6 +24,7 @@ public:
 
 private:
     void autoSaveWorker();
+    void writeFile(const json& snapshot, uint64_t seq);
 
     std::string path = "";
     volatile bool changed = false;
@@ -30,7 +32,20 @@ private:
     std::thread autoSaveThread;
     std::mutex mtx;
 
+    // Number of the last snapshot taken of conf, protected by mtx
+    uint64_t snapshotSeq = 0;
+
+    // Time of the first and last modification since the last save, used to debounce writes
+    std::chrono::steady_clock::time_point firstChange;
+    std::chrono::steady_clock::time_point lastChange;
+
+    // Serialises writes to disk and protects the hash and snapshot number of the last written content
+    std::mutex writeMtx;
+    size_t lastHash = 0;
+    bool lastHashValid = false;
+    uint64_t writtenSeq = 0;
+
     std::mutex termMtx;
     std::condition_variable termCond;
     volatile bool termFlag = false;
-};
\ No newline at end of file
+};
@@ -21,6 +21,9 @@
 #include <stb_image_resize.h>
 #include <gui/gui.h>
 #include <signal_path/signal_path.h>
+#include <dsp/profiler.h>
+#include <dsp/scheduler.h>
+#include <utils/thread_role.h>
 
 #include <gui/widgets/waterfall_view.h>
 #include <gui/widgets/map_view.h>
@@ -149,7 +152,25 @@ int gpsdrpp_main(int argc, char* argv[]) {
         core::args.showHelp();
         return 0;
     }
+
+    // Optional machine readable log
+    std::string logJson = core::args["log-json"].s();
+    if (!logJson.empty() && !flog::setJsonSink(logJson)) {
+        flog::error("Could not open JSON log file {0}", logJson);
+    }
     
+    // Optional NMEA replay source instead of the GPS module
+    std::string gpsNmea = core::args["gps-nmea"].s();
+    if (!gpsNmea.empty()) {
+        core::gps.setNmeaSource(gpsNmea);
+    }
+
+    // Optional periodic log of the DSP block load, mostly useful in server mode
+    int profileInterval = core::args["profile"].i();
+    if (profileInterval > 0) {
+        dsp::profiler::startLogging(profileInterval);
+    }
+
     // Tell GPS to output 24MHz timepulse
     core::gps.outputReferenceClock(false);
 
@@ -228,8 +249,14 @@ int gpsdrpp_main(int argc, char* argv[]) {
 	defConfig["max"] = 0.0;
 	defConfig["fftHeight"] = 300;
 	
+	// Frame scheduler
+	defConfig["targetFps"] = 30;
+	defConfig["idleFps"] = 2;
+	defConfig["showFrameOverlay"] = false;
+	
 	// Map View
 	defConfig["tileServer"] = "https://tile.openstreetmap.org/";
+	defConfig["tileStore"] = "%ROOT%/tiles.mbtiles";
 	defConfig["zoom"] = 19;
 	defConfig["panLon"] = 0.0;
 	defConfig["panLat"] = 0.0;
@@ -308,6 +335,20 @@ int gpsdrpp_main(int argc, char* argv[]) {
 
     defConfig["lockMenuOrder"] = false;
 
+    // Thread policies, see utils/thread_role.h
+    for (int i = 0; i < _THREAD_ROLE_COUNT; i++) {
+        ThreadRole role = (ThreadRole)i;
+        thread_role::Policy policy = thread_role::getPolicy(role);
+        json& conf = defConfig["threadRoles"][thread_role::getName(role)];
+        conf["cpus"] = policy.cpus;
+        conf["rtPriority"] = policy.rtPriority;
+        conf["nice"] = policy.nice;
+    }
+
+    // DSP scheduling, 0 workers means one per core
+    defConfig["dspThreadPool"] = false;
+    defConfig["dspPoolWorkers"] = 0;
+
     defConfig["modulesDirectory"] = INSTALL_PREFIX "/lib/gpsdrpp/plugins";
     defConfig["resourcesDirectory"] = INSTALL_PREFIX "/share/gpsdrpp";
 
@@ -348,6 +389,28 @@ int gpsdrpp_main(int argc, char* argv[]) {
 	// Force fullscreen at start
 	core::configManager.conf["fullscreen"] = true;
 
+    // Load the thread policies, only threads started from now on use them
+    for (int i = 0; i < _THREAD_ROLE_COUNT; i++) {
+        ThreadRole role = (ThreadRole)i;
+        const char* name = thread_role::getName(role);
+        if (!core::configManager.conf["threadRoles"].contains(name)) { continue; }
+        json conf = core::configManager.conf["threadRoles"][name];
+        try {
+            thread_role::Policy policy;
+            policy.cpus = conf["cpus"].get<std::vector<int>>();
+            policy.rtPriority = conf["rtPriority"];
+            policy.nice = conf["nice"];
+            thread_role::setPolicy(role, policy);
+        }
+        catch (const std::exception& e) {
+            flog::error("Invalid policy for '{0}' threads: {1}", name, e.what());
+        }
+    }
+
+    // Must be set before any block is started
+    dsp::scheduler::setEnabled(core::configManager.conf["dspThreadPool"]);
+    dsp::scheduler::setWorkerCount(core::configManager.conf["dspPoolWorkers"]);
+
     core::configManager.release(true);
 
     if (serverMode) { return server::main(); }
@@ -371,6 +434,9 @@ int gpsdrpp_main(int argc, char* argv[]) {
     // Initialize SmGui in normal mode
     SmGui::init(false);
 
+    // Load frame pacing settings
+    gui::frameScheduler.init();
+
     if (!style::loadFonts(resDir)) { return -1; }
     thememenu::init(resDir);
     LoadingScreen::init();
@@ -421,6 +487,9 @@ int gpsdrpp_main(int argc, char* argv[]) {
 
     flog::info("Ready.");
 
+    // Threads started from the GUI inherit this policy unless they have their own role
+    thread_role::apply(THREAD_ROLE_GUI, "gpsdrpp");
+
     // Run render loop (TODO: CHECK RETURN VALUE)
     backend::renderLoop();
 
@@ -447,5 +516,6 @@ int gpsdrpp_main(int argc, char* argv[]) {
 	worker.stop();
 
     flog::info("Exiting successfully");
+    flog::flush();
     return 0;
 }
@@ -9,6 +9,7 @@
 #include <core.h>
 #include <rtl_sdr_source_interface.h>
 #include <utils/flog.h>
+#include <utils/thread_role.h>
 
 
 bool DeviceRefreshWorker::checkI2CDevice(int bus, int address) {
@@ -37,6 +38,7 @@ int DeviceRefreshWorker::executeCommand(const char* command) {
 }
 
 void DeviceRefreshWorker::workerLoop() {
+    thread_role::apply(THREAD_ROLE_BACKGROUND, "dev-refresh");
     while (!shouldStop.load()) {
         try {
 			if (core::modComManager.interfaceExists("RTL-SDR")) {
@@ -5,6 +5,12 @@
 #include <algorithm>
 #include "stream.h"
 #include "types.h"
+#include "profiler.h"
+#include "scheduler.h"
+#include "../utils/thread_role.h"
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
 
 namespace dsp {
     class generic_block {
@@ -15,7 +21,7 @@ namespace dsp {
         virtual int run() { return -1; }
     };
 
-    class block : public generic_block {
+    class block : public generic_block, public task {
     public:
         virtual ~block() {
             if (!_block_init) { return; }
@@ -63,16 +69,149 @@ namespace dsp {
 
         virtual int run() = 0;
 
+        // Name shown by the profiler, a "Group/" prefix gathers the blocks of a pipeline
+        void setProfileName(const std::string& name) { profileName = name; }
+        std::string getProfileName() { return profileName; }
+
+        const std::vector<untyped_stream*>& getInputs() { return inputs; }
+        const std::vector<untyped_stream*>& getOutputs() { return outputs; }
+
+        // Scheduling policy of the worker thread(s) of the block, takes effect on the next start
+        void setThreadRole(ThreadRole role) { threadRole = role; }
+
+        // Allow the block to run on the scheduler pool when it is enabled, takes effect on the next start.
+        // Blocks calling into hardware or audio APIs should keep their own thread.
+        void setPooled(bool enabled) { pooled = enabled; }
+
+        void wake() override {
+            int state = taskState.load();
+            while (true) {
+                if (state == TASK_IDLE) {
+                    if (taskState.compare_exchange_weak(state, TASK_QUEUED)) {
+                        scheduler::schedule(this);
+                        return;
+                    }
+                }
+                else if (state == TASK_RUNNING) {
+                    if (taskState.compare_exchange_weak(state, TASK_RERUN)) { return; }
+                }
+                else {
+                    // Already queued, or will run again
+                    return;
+                }
+            }
+        }
+
+        void execute() override {
+            taskState.store(TASK_RUNNING);
+            if (!taskStopping && runnable()) {
+                if (profiler::isEnabled()) {
+                    int64_t start = profiler::now();
+                    run();
+                    profStats.runTime.fetch_add(profiler::now() - start, std::memory_order_relaxed);
+                    profStats.runs.fetch_add(1, std::memory_order_relaxed);
+                }
+                else {
+                    run();
+                }
+            }
+
+            // Going idle under the lock lets doStop() know that the block isn't used by the pool anymore
+            std::lock_guard<std::mutex> lck(taskMtx);
+            int state = TASK_RUNNING;
+            if (taskState.compare_exchange_strong(state, TASK_IDLE)) {
+                taskCnd.notify_all();
+                return;
+            }
+
+            // Woken up while running, go back in the queue to let the other blocks run in between
+            taskState.store(TASK_QUEUED);
+            scheduler::schedule(this);
+        }
+
+        profiler::block_stats profStats;
+
     protected:
+        enum {
+            TASK_IDLE,
+            TASK_QUEUED,
+            TASK_RUNNING,
+            TASK_RERUN
+        };
+
+        // A pooled block only runs once run() can't block on any of its streams
+        bool runnable() {
+            if (inputs.empty()) { return false; }
+            for (auto& in : inputs) {
+                if (!in->readable()) { return false; }
+            }
+            for (auto& out : outputs) {
+                if (!out->writable()) { return false; }
+            }
+            return true;
+        }
+
+        void startTask() {
+            taskStopping = false;
+            taskStarted = true;
+            profiler::registerBlock(this);
+            for (auto& in : inputs) { in->setReaderTask(this); }
+            for (auto& out : outputs) { out->setWriterTask(this); }
+
+            // The streams may already be ready
+            wake();
+        }
+
+        void stopTask() {
+            // Once detached from the streams nothing can queue the block again
+            taskStopping = true;
+            for (auto& in : inputs) { in->setReaderTask(NULL); }
+            for (auto& out : outputs) { out->setWriterTask(NULL); }
+            {
+                std::unique_lock<std::mutex> lck(taskMtx);
+                taskCnd.wait(lck, [this]() { return taskState.load() == TASK_IDLE; });
+            }
+            profiler::unregisterBlock(this);
+            taskStarted = false;
+        }
+
+        // Thread names are limited to 15 characters, the group is left out
+        void applyThreadRole() {
+            std::string name = profileName.substr(profileName.find('/') + 1);
+            thread_role::apply(threadRole, name.empty() ? "dsp" : name);
+        }
+
         void workerLoop() {
-            while (run() >= 0) {}
+            applyThreadRole();
+            profiler::registerBlock(this);
+            while (true) {
+                // Only pay for the timestamps while profiling
+                if (!profiler::isEnabled()) {
+                    if (run() < 0) { break; }
+                    continue;
+                }
+                int64_t start = profiler::now();
+                if (run() < 0) { break; }
+                profStats.runTime.fetch_add(profiler::now() - start, std::memory_order_relaxed);
+                profStats.runs.fetch_add(1, std::memory_order_relaxed);
+            }
+            profiler::unregisterBlock(this);
         }
 
         virtual void doStart() {
+            if (poolable && pooled && scheduler::isEnabled()) {
+                startTask();
+                return;
+            }
             workerThread = std::thread(&block::workerLoop, this);
         }
 
         virtual void doStop() {
+            if (taskStarted) {
+                stopTask();
+                return;
+            }
+
             for (auto& in : inputs) {
                 in->stopReader();
             }
@@ -103,22 +242,37 @@ namespace dsp {
 
         void registerInput(untyped_stream* inStream) {
             inputs.push_back(inStream);
+            updateMetaSources();
         }
 
         void unregisterInput(untyped_stream* inStream) {
             inputs.erase(std::remove(inputs.begin(), inputs.end(), inStream), inputs.end());
+            updateMetaSources();
         }
 
         void registerOutput(untyped_stream* outStream) {
             outputs.push_back(outStream);
+            updateMetaSources();
         }
 
         void unregisterOutput(untyped_stream* outStream) {
             outputs.erase(std::remove(outputs.begin(), outputs.end(), outStream), outputs.end());
+            outStream->setMetaSource(NULL);
+        }
+
+        // By default, outputs carry the metadata of the first input
+        void updateMetaSources() {
+            untyped_stream* source = (forwardMeta && !inputs.empty()) ? inputs[0] : NULL;
+            for (auto& out : outputs) {
+                out->setMetaSource(source);
+            }
         }
 
         bool _block_init = false;
 
+        // Must be disabled by blocks that write their outputs from a different thread than the one reading their input
+        bool forwardMeta = true;
+
         std::recursive_mutex ctrlMtx;
 
         std::vector<untyped_stream*> inputs;
@@ -128,5 +282,18 @@ namespace dsp {
         bool tempStopped = false;
         int tempStopDepth = 0;
         std::thread workerThread;
+        std::string profileName;
+
+        // Must only be enabled by blocks whose run() reads each input and swaps each output at most once,
+        // and doesn't wait on anything else. All outputs must be registered.
+        bool poolable = false;
+        bool pooled = true;
+        ThreadRole threadRole = THREAD_ROLE_DSP_BULK;
+
+        bool taskStarted = false;
+        std::atomic<bool> taskStopping{false};
+        std::atomic<int> taskState{TASK_IDLE};
+        std::mutex taskMtx;
+        std::condition_variable taskCnd;
     };
 }
\ No newline at end of file
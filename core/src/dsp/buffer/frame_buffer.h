@@ -28,6 +28,8 @@ namespace dsp::buffer {
                 buffers[i] = buffer::alloc<T>(STREAM_BUFFER_SIZE);
             }
 
+            // The output is written by a different thread, metadata is queued along with the samples instead
+            base_type::forwardMeta = false;
             base_type::registerInput(in);
             base_type::registerOutput(&out);
             base_type::_block_init = true;
@@ -55,6 +57,7 @@ namespace dsp::buffer {
 
             if (bypass) {
                 memcpy(out.writeBuf, _in->readBuf, count * sizeof(T));
+                out.setMeta(_in->getMeta());
                 _in->flush();
                 if (!out.swap(count)) { return -1; }
                 return count;
@@ -65,6 +68,7 @@ namespace dsp::buffer {
                 std::lock_guard<std::mutex> lck(bufMtx);
                 memcpy(buffers[writeCur], _in->readBuf, count * sizeof(T));
                 sizes[writeCur] = count;
+                metas[writeCur] = _in->getMeta();
                 writeCur++;
                 writeCur = ((writeCur) % TEST_BUFFER_SIZE);
             }
@@ -74,6 +78,7 @@ namespace dsp::buffer {
         }
 
         void worker() {
+            base_type::applyThreadRole();
             while (true) {
                 // Wait for data
                 std::unique_lock lck(bufMtx);
@@ -83,6 +88,7 @@ namespace dsp::buffer {
                 // Write one to output buffer and unlock in preparation to swap buffers
                 int count = sizes[readCur];
                 memcpy(out.writeBuf, buffers[readCur], count * sizeof(T));
+                out.setMeta(metas[readCur]);
                 readCur++;
                 readCur = ((readCur) % TEST_BUFFER_SIZE);
                 lck.unlock();
@@ -126,6 +132,7 @@ namespace dsp::buffer {
         std::condition_variable cnd;
         T* buffers[TEST_BUFFER_SIZE];
         int sizes[TEST_BUFFER_SIZE];
+        stream_meta metas[TEST_BUFFER_SIZE];
 
         bool stopWorker = false;
     };
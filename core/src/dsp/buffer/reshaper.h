@@ -26,6 +26,7 @@ namespace dsp::buffer {
             _keep = keep;
             _skip = skip;
             ringBuf.init(keep * 2);
+            base_type::forwardMeta = false;
             base_type::registerInput(_in);
             base_type::registerOutput(&out);
             base_type::_block_init = true;
@@ -75,6 +76,7 @@ namespace dsp::buffer {
         }
 
         void loop() {
+            base_type::applyThreadRole();
             while (run() >= 0)
                 ;
         }
@@ -99,6 +101,7 @@ namespace dsp::buffer {
         }
 
         void bufferWorker() {
+            base_type::applyThreadRole();
             T* buf = new T[_keep];
             bool delay = _skip < 0;
 
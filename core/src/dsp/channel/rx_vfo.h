@@ -1,6 +1,12 @@
 #pragma once
 #include "frequency_xlator.h"
 #include "../multirate/rational_resampler.h"
+#include "../taps/tap_cache.h"
+#include <vector>
+#include <stdlib.h>
+
+// Number of input samples going through all stages at once, small enough to stay in L1 with the stage buffers
+#define RX_VFO_CHUNK_SIZE   2048
 
 namespace dsp::channel {
     class RxVFO : public Processor<complex_t, complex_t> {
@@ -13,7 +19,7 @@ namespace dsp::channel {
         ~RxVFO() {
             if (!base_type::_block_init) { return; }
             base_type::stop();
-            taps::free(ftaps);
+            buffer::free(chunk);
         }
 
         void init(stream<complex_t>* in, double inSamplerate, double outSamplerate, double bandwidth, double offset) {
@@ -22,12 +28,13 @@ namespace dsp::channel {
             _bandwidth = bandwidth;
             _offset = offset;
             filterNeeded = (_bandwidth != _outSamplerate);
-            ftaps.taps = NULL;
 
             xlator.init(NULL, -_offset, _inSamplerate);
             resamp.init(NULL, _inSamplerate, _outSamplerate);
-            generateTaps();
-            filter.init(NULL, ftaps);
+            ftaps = taps::cache.get(tapDesign());
+            tap<float> t = *ftaps;
+            filter.init(NULL, t);
+            chunk = buffer::alloc<complex_t>(RX_VFO_CHUNK_SIZE);
 
             base_type::init(in);
         }
@@ -51,8 +58,9 @@ namespace dsp::channel {
             filterNeeded = (_bandwidth != _outSamplerate);
             resamp.setOutSamplerate(_outSamplerate);
             if (filterNeeded) {
-                generateTaps();
-                filter.setTaps(ftaps);
+                // The samplerate changed, the old taps can't be used in the meantime
+                std::lock_guard<std::mutex> lck2(filterMtx);
+                applyTaps(taps::cache.get(tapDesign()));
             }
             base_type::tempStart();
         }
@@ -64,8 +72,15 @@ namespace dsp::channel {
             _bandwidth = bandwidth;
             filterNeeded = (_bandwidth != _outSamplerate);
             if (filterNeeded) {
-                generateTaps();
-                filter.setTaps(ftaps);
+                // If not cached, the taps are designed in the background and swapped in by the DSP thread
+                pendingDesign = tapDesign();
+                taps::SharedTaps t = taps::cache.request(pendingDesign);
+                if (t) {
+                    applyTaps(t);
+                }
+                else {
+                    tapsPending = true;
+                }
             }
         }
 
@@ -86,17 +101,49 @@ namespace dsp::channel {
             base_type::tempStart();
         }
 
+        // Use the chunked path (default) or the original one doing each stage over the whole block
+        void setFused(bool fused) {
+            assert(base_type::_block_init);
+            std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
+            base_type::tempStop();
+            _fused = fused;
+            base_type::tempStart();
+        }
+
         inline int process(int count, const complex_t* in, complex_t* out) {
-            xlator.process(count, in, out);
-            if (!filterNeeded) {
-                return resamp.process(count, out, out);
-            }
-            count = resamp.process(count, out, out);
-            {
+            if (tapsPending) {
                 std::lock_guard<std::mutex> lck(filterMtx);
-                filter.process(count, out, out);
+                taps::SharedTaps t = taps::cache.request(pendingDesign);
+                if (t) { applyTaps(t); }
+            }
+
+            if (!_fused) {
+                xlator.process(count, in, out);
+                if (!filterNeeded) {
+                    return resamp.process(count, out, out);
+                }
+                count = resamp.process(count, out, out);
+                {
+                    std::lock_guard<std::mutex> lck(filterMtx);
+                    filter.process(count, out, out);
+                }
+                return count;
+            }
+
+            // Take the input through all stages a chunk at a time, so that only the input and the
+            // (decimated) output go through memory instead of the full rate block three times
+            int outCount = 0;
+            for (int i = 0; i < count; i += RX_VFO_CHUNK_SIZE) {
+                int n = std::min<int>(RX_VFO_CHUNK_SIZE, count - i);
+                xlator.process(n, &in[i], chunk);
+                n = resamp.process(n, chunk, &out[outCount]);
+                if (filterNeeded) {
+                    std::lock_guard<std::mutex> lck(filterMtx);
+                    filter.process(n, &out[outCount], &out[outCount]);
+                }
+                outCount += n;
             }
-            return count;
+            return outCount;
         }
 
         int run() {
@@ -113,18 +160,59 @@ namespace dsp::channel {
             return outCount;
         }
 
+        // Runs the same noise through the chunked and the original path and returns the largest
+        // difference between their outputs relative to the output RMS
+        static double checkFused(double inSamplerate, double outSamplerate, double bandwidth, double offset, int blocks = 16, int blockSize = 100000) {
+            RxVFO fused(NULL, inSamplerate, outSamplerate, bandwidth, offset);
+            RxVFO ref(NULL, inSamplerate, outSamplerate, bandwidth, offset);
+            ref.setFused(false);
+
+            std::vector<complex_t> in(blockSize);
+            // The output buffers are also used for intermediate stages running at a higher rate
+            std::vector<complex_t> outFused(blockSize * std::max<double>(1.0, outSamplerate / inSamplerate) + 16);
+            std::vector<complex_t> outRef(outFused.size());
+            double maxErr = 0.0;
+            double power = 0.0;
+            int total = 0;
+            for (int b = 0; b < blocks; b++) {
+                for (auto& s : in) {
+                    s = { (float)rand() / (float)RAND_MAX - 0.5f, (float)rand() / (float)RAND_MAX - 0.5f };
+                }
+                int countFused = fused.process(blockSize, in.data(), outFused.data());
+                int countRef = ref.process(blockSize, in.data(), outRef.data());
+                if (countFused != countRef) { return INFINITY; }
+                for (int i = 0; i < countRef; i++) {
+                    maxErr = std::max<double>(maxErr, (outFused[i] - outRef[i]).amplitude());
+                    power += outRef[i].amplitude() * outRef[i].amplitude();
+                }
+                total += countRef;
+            }
+            return total ? maxErr / sqrt(power / (double)total) : 0.0;
+        }
+
     protected:
-        void generateTaps() {
-            taps::free(ftaps);
+        taps::TapDesign tapDesign() {
             double filterWidth = _bandwidth / 2.0;
-            ftaps = taps::lowPass(filterWidth, filterWidth * 0.1, _outSamplerate);
+            return taps::lowPassDesign(filterWidth, filterWidth * 0.1, _outSamplerate);
+        }
+
+        // Must be called with filterMtx held
+        void applyTaps(taps::SharedTaps t) {
+            ftaps = t;
+            tap<float> copy = *ftaps;
+            filter.setTaps(copy);
+            tapsPending = false;
         }
 
         FrequencyXlator xlator;
         multirate::RationalResampler<complex_t> resamp;
         filter::FIR<complex_t, float> filter;
-        tap<float> ftaps;
+        taps::SharedTaps ftaps;
+        taps::TapDesign pendingDesign;
+        std::atomic<bool> tapsPending = false;
         bool filterNeeded;
+        bool _fused = true;
+        complex_t* chunk = NULL;
 
         double _inSamplerate;
         double _outSamplerate;
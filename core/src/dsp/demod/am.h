@@ -1,6 +1,6 @@
 #pragma once
 #include "../processor.h"
-#include "../loop/agc.h"
+#include "../loop/lookahead_agc.h"
 #include "../correction/dc_blocker.h"
 #include "../convert/mono_to_stereo.h"
 #include "../filter/fir.h"
@@ -31,8 +31,8 @@ namespace dsp::demod {
             _bandwidth = bandwidth;
             _samplerate = samplerate;
 
-            carrierAgc.init(NULL, 1.0, agcAttack, agcDecay, 10e6, 10.0, INFINITY);
-            audioAgc.init(NULL, 1.0, agcAttack, agcDecay, 10e6, 10.0, INFINITY);
+            carrierAgc.init(NULL, 1.0, agcAttack, agcDecay, 10e6, 10.0, round(samplerate * LOOKAHEAD_AGC_DEFAULT_TIME), INFINITY);
+            audioAgc.init(NULL, 1.0, agcAttack, agcDecay, 10e6, 10.0, round(samplerate * LOOKAHEAD_AGC_DEFAULT_TIME), INFINITY);
             dcBlock.init(NULL, dcBlockRate);
             lpfTaps = taps::lowPass(bandwidth / 2.0, (bandwidth / 2.0) * 0.1, samplerate);
             lpf.init(NULL, lpfTaps);
@@ -149,8 +149,8 @@ namespace dsp::demod {
         double _samplerate;
         double _bandwidth;
 
-        loop::AGC<complex_t> carrierAgc;
-        loop::AGC<float> audioAgc;
+        loop::LookaheadAGC<complex_t> carrierAgc;
+        loop::LookaheadAGC<float> audioAgc;
         correction::DCBlocker<float> dcBlock;
         tap<float> lpfTaps;
         filter::FIR<float, float> lpf;
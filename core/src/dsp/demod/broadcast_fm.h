@@ -3,16 +3,15 @@
 #include "../taps/low_pass.h"
 #include "../taps/band_pass.h"
 #include "../filter/fir.h"
+#include "../filter/decimating_fir.h"
 #include "../loop/pll.h"
 #include "../convert/l_r_to_stereo.h"
 #include "../convert/real_to_complex.h"
-#include "../convert/complex_to_real.h"
-#include "../math/conjugate.h"
 #include "../math/delay.h"
-#include "../math/multiply.h"
 #include "../math/add.h"
 #include "../math/subtract.h"
 #include "../multirate/rational_resampler.h"
+#include "../channel/frequency_xlator.h"
 
 namespace dsp::demod {
     class BroadcastFM : public Processor<complex_t, stereo_t> {
@@ -20,11 +19,12 @@ namespace dsp::demod {
     public:
         BroadcastFM() {}
 
-        BroadcastFM(stream<complex_t>* in, double deviation, double samplerate, bool stereo = true, bool lowPass = true, bool rdsOut = false) { init(in, deviation, samplerate, stereo, lowPass); }
+        BroadcastFM(stream<complex_t>* in, double deviation, double samplerate, bool stereo = true, bool lowPass = true, bool rdsOut = false, int decimation = 1) { init(in, deviation, samplerate, stereo, lowPass, rdsOut, decimation); }
 
         ~BroadcastFM() {
             if (!base_type::_block_init) { return; }
             base_type::stop();
+            buffer::free(lpr);
             buffer::free(lmr);
             buffer::free(l);
             buffer::free(r);
@@ -32,37 +32,40 @@ namespace dsp::demod {
             taps::free(audioFirTaps);
         }
 
-        virtual void init(stream<complex_t>* in, double deviation, double samplerate, bool stereo = true, bool lowPass = true, bool rdsOut = false) {
+        // The audio output runs at samplerate / decimation, L+R and L-R are decimated right after being mixed down
+        virtual void init(stream<complex_t>* in, double deviation, double samplerate, bool stereo = true, bool lowPass = true, bool rdsOut = false, int decimation = 1) {
             _deviation = deviation;
             _samplerate = samplerate;
             _stereo = stereo;
             _lowPass = lowPass;
             _rdsOut = rdsOut;
+            _decimation = std::max<int>(decimation, 1);
             
             demod.init(NULL, _deviation, _samplerate);
             pilotFirTaps = taps::bandPass<complex_t>(18750.0, 19250.0, 3000.0, _samplerate, true);
             pilotFir.init(NULL, pilotFirTaps);
             rtoc.init(NULL);
             pilotPLL.init(NULL, 25000.0 / _samplerate, 0.0, math::hzToRads(19000.0, _samplerate), math::hzToRads(18750.0, _samplerate), math::hzToRads(19250.0, _samplerate));
-            lprDelay.init(NULL, ((pilotFirTaps.size - 1) / 2) + 1);
-            lmrDelay.init(NULL, ((pilotFirTaps.size - 1) / 2) + 1);
-            audioFirTaps = taps::lowPass(15000.0, 4000.0, _samplerate);
-            alFir.init(NULL, audioFirTaps);
-            arFir.init(NULL, audioFirTaps);
+            mpxDelay.init(NULL, ((pilotFirTaps.size - 1) / 2) + 1);
+            audioFirTaps = generateAudioTaps();
+            lprFir.init(NULL, audioFirTaps, _decimation);
+            lmrFir.init(NULL, audioFirTaps, _decimation);
             xlator.init(NULL, -57000.0, samplerate);
             rdsResamp.init(NULL, samplerate, 5000.0);
 
+            lpr = buffer::alloc<float>(STREAM_BUFFER_SIZE);
             lmr = buffer::alloc<float>(STREAM_BUFFER_SIZE);
             l = buffer::alloc<float>(STREAM_BUFFER_SIZE);
             r = buffer::alloc<float>(STREAM_BUFFER_SIZE);
 
-            lprDelay.out.free();
-            arFir.out.free();
-            alFir.out.free();
+            mpxDelay.out.free();
+            lprFir.out.free();
+            lmrFir.out.free();
             xlator.out.free();
             rdsResamp.out.free();
 
             base_type::init(in);
+            base_type::registerOutput(&this->rdsOut);
         }
 
         void setDeviation(double deviation) {
@@ -85,13 +88,9 @@ namespace dsp::demod {
             
             pilotPLL.setFrequencyLimits(math::hzToRads(18750.0, _samplerate), math::hzToRads(19250.0, _samplerate));
             pilotPLL.setInitialFreq(math::hzToRads(19000.0, _samplerate));
-            lprDelay.setDelay(((pilotFirTaps.size - 1) / 2) + 1);
-            lmrDelay.setDelay(((pilotFirTaps.size - 1) / 2) + 1);
+            mpxDelay.setDelay(((pilotFirTaps.size - 1) / 2) + 1);
 
-            taps::free(audioFirTaps);
-            audioFirTaps = taps::lowPass(15000.0, 4000.0, _samplerate);
-            alFir.setTaps(audioFirTaps);
-            arFir.setTaps(audioFirTaps);
+            updateAudioTaps();
 
             xlator.setOffset(-57000.0, samplerate);
             rdsResamp.setInSamplerate(samplerate);
@@ -100,6 +99,18 @@ namespace dsp::demod {
             base_type::tempStart();
         }
 
+        void setDecimation(int decimation) {
+            assert(base_type::_block_init);
+            std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
+            base_type::tempStop();
+            _decimation = std::max<int>(decimation, 1);
+            lprFir.setDecimation(_decimation);
+            lmrFir.setDecimation(_decimation);
+            updateAudioTaps();
+            reset();
+            base_type::tempStart();
+        }
+
         void setStereo(bool stereo) {
             assert(base_type::_block_init);
             std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
@@ -114,6 +125,7 @@ namespace dsp::demod {
             std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
             base_type::tempStop();
             _lowPass = lowPass;
+            updateAudioTaps();
             reset();
             base_type::tempStart();
         }
@@ -127,6 +139,13 @@ namespace dsp::demod {
             base_type::tempStart();
         }
 
+        // Trade discriminator accuracy for speed, see math::PolarAccuracy
+        void setAccuracy(math::PolarAccuracy accuracy) {
+            assert(base_type::_block_init);
+            std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
+            demod.setAccuracy(accuracy);
+        }
+
         void reset() {
             assert(base_type::_block_init);
             std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
@@ -134,84 +153,77 @@ namespace dsp::demod {
             demod.reset();
             pilotFir.reset();
             pilotPLL.reset();
-            lprDelay.reset();
-            lmrDelay.reset();
-            alFir.reset();
-            arFir.reset();
+            mpxDelay.reset();
+            lprFir.reset();
+            lmrFir.reset();
             base_type::tempStart();
         }
 
+        double getOutSamplerate() {
+            return _samplerate / (double)_decimation;
+        }
+
         inline int process(int count, complex_t* in, stereo_t* out, int& rdsOutCount, complex_t* rdsout = NULL) {
             // Demodulate
             demod.process(count, in, demod.out.writeBuf);
-            if (_stereo) {
-                // Convert to complex
+
+            // Convert to complex for the pilot and RDS filters
+            if (_stereo || _rdsOut) {
                 rtoc.process(count, demod.out.writeBuf, rtoc.out.writeBuf);
+            }
 
-                // Filter out pilot and run through PLL
+            // Filter out pilot and run through PLL
+            if (_stereo) {
                 pilotFir.process(count, rtoc.out.writeBuf, pilotFir.out.writeBuf);
                 pilotPLL.process(count, pilotFir.out.writeBuf, pilotPLL.out.writeBuf);
+            }
 
-                // Delay
-                lprDelay.process(count, demod.out.writeBuf, demod.out.writeBuf);
-                lmrDelay.process(count, rtoc.out.writeBuf, lmrDelay.out.writeBuf);
-                
-                // conjugate PLL output to down convert twice the L-R signal
-                math::Conjugate::process(count, pilotPLL.out.writeBuf, pilotPLL.out.writeBuf);
-                math::Multiply<dsp::complex_t>::process(count, lmrDelay.out.writeBuf, pilotPLL.out.writeBuf, lmrDelay.out.writeBuf);
-                math::Multiply<dsp::complex_t>::process(count, lmrDelay.out.writeBuf, pilotPLL.out.writeBuf, lmrDelay.out.writeBuf);
-
-                // Do RDS demod
-                if (_rdsOut) {
-                    // Translate to 0Hz
-                    xlator.process(count, rtoc.out.writeBuf, rtoc.out.writeBuf);
-
-                    // Resample to the output samplerate
-                    rdsOutCount = rdsResamp.process(count, rtoc.out.writeBuf, rdsout);
-                }
-
-                // Convert output back to real for further processing
-                convert::ComplexToReal::process(count, lmrDelay.out.writeBuf, lmr);
+            // Do RDS demod
+            if (_rdsOut) {
+                // Translate to 0Hz
+                xlator.process(count, rtoc.out.writeBuf, rtoc.out.writeBuf);
 
-                // Amplify by 2x
-                volk_32f_s32f_multiply_32f(lmr, lmr, 2.0f, count);
+                // Resample to the output samplerate
+                rdsOutCount = rdsResamp.process(count, rtoc.out.writeBuf, rdsout);
+            }
 
-                // Do L = (L+R) + (L-R), R = (L+R) - (L-R)
-                math::Add<float>::process(count, demod.out.writeBuf, lmr, l);
-                math::Subtract<float>::process(count, demod.out.writeBuf, lmr, r);
+            if (_stereo) {
+                // Delay the MPX to line it up with the PLL output
+                mpxDelay.process(count, demod.out.writeBuf, lpr);
+
+                // Mix L-R down with Re(conj(pll)^2) = re^2 - im^2, and amplify by 2x
+                complex_t* pilot = pilotPLL.out.writeBuf;
+                for (int i = 0; i < count; i++) {
+                    float re = pilot[i].re;
+                    float im = pilot[i].im;
+                    lmr[i] = 2.0f * lpr[i] * (re * re - im * im);
+                }
 
-                // Filter if needed
-                if (_lowPass) {
-                    alFir.process(count, l, l);
-                    arFir.process(count, r, r);
+                // Filter and decimate both branches before doing anything else with them
+                int outCount = count;
+                if (filterAudio()) {
+                    outCount = lprFir.process(count, lpr, lpr);
+                    lmrFir.process(count, lmr, lmr);
                 }
 
+                // Do L = (L+R) + (L-R), R = (L+R) - (L-R)
+                math::Add<float>::process(outCount, lpr, lmr, l);
+                math::Subtract<float>::process(outCount, lpr, lmr, r);
+
                 // Interleave into stereo
-                convert::LRToStereo::process(count, l, r, out);
+                convert::LRToStereo::process(outCount, l, r, out);
+                return outCount;
             }
-            else {
-                // Process RDS if needed. Note: find a way to not have to copy half the code from the stereo demod
-                if (_rdsOut) {
-                    // Convert to complex
-                    rtoc.process(count, demod.out.writeBuf, rtoc.out.writeBuf);
-
-                    // Translate to 0Hz
-                    xlator.process(count, rtoc.out.writeBuf, rtoc.out.writeBuf);
-
-                    // Resample to the output samplerate
-                    rdsOutCount = rdsResamp.process(count, rtoc.out.writeBuf, rdsout);
-                }
-
-                // Filter if needed
-                if (_lowPass) {
-                    alFir.process(count, demod.out.writeBuf, demod.out.writeBuf);
-                }
 
-                // Interleave raw MPX to stereo
-                convert::LRToStereo::process(count, demod.out.writeBuf, demod.out.writeBuf, out);
+            // Filter and decimate if needed
+            int outCount = count;
+            if (filterAudio()) {
+                outCount = lprFir.process(count, demod.out.writeBuf, demod.out.writeBuf);
             }
 
-            return count;
+            // Interleave raw MPX to stereo
+            convert::LRToStereo::process(outCount, demod.out.writeBuf, demod.out.writeBuf, out);
+            return outCount;
         }
 
         int run() {
@@ -219,10 +231,12 @@ namespace dsp::demod {
             if (count < 0) { return -1; }
 
             int rdsOutCount = 0;
-            process(count, base_type::_in->readBuf, base_type::out.writeBuf, rdsOutCount, rdsOut.writeBuf);
+            int outCount = process(count, base_type::_in->readBuf, base_type::out.writeBuf, rdsOutCount, rdsOut.writeBuf);
 
             base_type::_in->flush();
-            if (!base_type::out.swap(count)) { return -1; }
+            if (outCount) {
+                if (!base_type::out.swap(outCount)) { return -1; }
+            }
             if (rdsOutCount && _rdsOut) {
                 if (!rdsOut.swap(rdsOutCount)) { return -1; }
             }
@@ -232,11 +246,30 @@ namespace dsp::demod {
         stream<complex_t> rdsOut;
 
     protected:
+        // Without low pass the audio only needs filtering to keep the decimation from aliasing
+        inline bool filterAudio() {
+            return _lowPass || _decimation > 1;
+        }
+
+        tap<float> generateAudioTaps() {
+            if (_lowPass || _decimation == 1) { return taps::lowPass(15000.0, 4000.0, _samplerate); }
+            double outNyquist = getOutSamplerate() / 2.0;
+            return taps::lowPass(outNyquist * 0.8, outNyquist * 0.2, _samplerate);
+        }
+
+        void updateAudioTaps() {
+            taps::free(audioFirTaps);
+            audioFirTaps = generateAudioTaps();
+            lprFir.setTaps(audioFirTaps);
+            lmrFir.setTaps(audioFirTaps);
+        }
+
         double _deviation;
         double _samplerate;
         bool _stereo;
         bool _lowPass;
         bool _rdsOut;
+        int _decimation;
 
         Quadrature demod;
         tap<complex_t> pilotFirTaps;
@@ -244,13 +277,13 @@ namespace dsp::demod {
         convert::RealToComplex rtoc;
         channel::FrequencyXlator xlator;
         loop::PLL pilotPLL;
-        math::Delay<float> lprDelay;
-        math::Delay<complex_t> lmrDelay;
+        math::Delay<float> mpxDelay;
         tap<float> audioFirTaps;
-        filter::FIR<float, float> arFir;
-        filter::FIR<float, float> alFir;
+        filter::DecimatingFIR<float, float> lprFir;
+        filter::DecimatingFIR<float, float> lmrFir;
         multirate::RationalResampler<dsp::complex_t> rdsResamp;
 
+        float* lpr;
         float* lmr;
         float* l;
         float* r;
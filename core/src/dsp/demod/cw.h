@@ -2,7 +2,7 @@
 #include "../processor.h"
 #include "../channel/frequency_xlator.h"
 #include "../convert/complex_to_real.h"
-#include "../loop/agc.h"
+#include "../loop/lookahead_agc.h"
 #include "../convert/mono_to_stereo.h"
 
 namespace dsp::demod {
@@ -19,7 +19,7 @@ namespace dsp::demod {
             _samplerate = samplerate;
             
             xlator.init(NULL, tone, samplerate);
-            agc.init(NULL, 1.0, agcAttack, agcDecay, 10e6, 10.0, INFINITY);
+            agc.init(NULL, 1.0, agcAttack, agcDecay, 10e6, 10.0, round(_samplerate * LOOKAHEAD_AGC_DEFAULT_TIME), INFINITY);
 
             if constexpr (std::is_same_v<T, float>) {
                 agc.out.free();
@@ -50,8 +50,11 @@ namespace dsp::demod {
         void setSamplerate(double samplerate) {
             assert(base_type::_block_init);
             std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
+            base_type::tempStop();
             _samplerate = samplerate;
             xlator.setOffset(_tone, _samplerate);
+            agc.setLookahead(round(_samplerate * LOOKAHEAD_AGC_DEFAULT_TIME));
+            base_type::tempStart();
         }
 
         inline int process(int count, const complex_t* in, T* out) {
@@ -84,7 +87,7 @@ namespace dsp::demod {
         double _samplerate;
 
         dsp::channel::FrequencyXlator xlator;
-        dsp::loop::AGC<float> agc;
+        dsp::loop::LookaheadAGC<float> agc;
 
     };
 }
\ No newline at end of file
@@ -74,6 +74,13 @@ namespace dsp::demod {
             updateFilter(_lowPass, highPass);
         }
 
+        // Trade discriminator accuracy for speed, see math::PolarAccuracy
+        void setAccuracy(math::PolarAccuracy accuracy) {
+            assert(base_type::_block_init);
+            std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
+            demod.setAccuracy(accuracy);
+        }
+
         void reset() {
             assert(base_type::_block_init);
             std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
@@ -2,7 +2,7 @@
 #include "../processor.h"
 #include "../channel/frequency_xlator.h" 
 #include "../convert/complex_to_real.h"
-#include "../loop/agc.h"
+#include "../loop/lookahead_agc.h"
 #include "../convert/mono_to_stereo.h"
 
 namespace dsp::demod {
@@ -26,7 +26,7 @@ namespace dsp::demod {
             _samplerate = samplerate;
 
             xlator.init(NULL, getTranslation(), _samplerate);
-            agc.init(NULL, 1.0, agcAttack, agcDecay, 10e6, 10.0, INFINITY);
+            agc.init(NULL, 1.0, agcAttack, agcDecay, 10e6, 10.0, round(_samplerate * LOOKAHEAD_AGC_DEFAULT_TIME), INFINITY);
 
             if constexpr (std::is_same_v<T, float>) {
                 agc.out.free();
@@ -59,6 +59,7 @@ namespace dsp::demod {
             base_type::tempStop();
             _samplerate = samplerate;
             xlator.setOffset(getTranslation(), _samplerate);
+            agc.setLookahead(round(_samplerate * LOOKAHEAD_AGC_DEFAULT_TIME));
             base_type::tempStart();
         }
 
@@ -119,7 +120,7 @@ namespace dsp::demod {
         double _bandwidth;
         double _samplerate;
         channel::FrequencyXlator xlator;
-        loop::AGC<float> agc;
+        loop::LookaheadAGC<float> agc;
 
     };
 };
\ No newline at end of file
@@ -0,0 +1,123 @@
+#include "interleaved_rs.h"
+#include "../scheduler.h"
+#include <atomic>
+#include <memory>
+#include <condition_variable>
+#include <algorithm>
+#include <assert.h>
+
+namespace dsp::fec {
+    // Work shared by the caller and the helpers, codewords are claimed one at a time
+    struct InterleavedRS::Job {
+        InterleavedRS* rs;
+        int depth;
+        const uint8_t* in;
+        uint8_t* out;
+
+        std::atomic<int> next{0};
+        std::atomic<int> done{0};
+        std::mutex mtx;
+        std::condition_variable cnd;
+    };
+
+    // Helpers can still be queued after the frame is done, they only keep the job alive and leave without a codeword
+    class InterleavedRS::Helper : public dsp::task {
+    public:
+        Helper(std::shared_ptr<Job> job) : job(job) {}
+
+        void wake() {}
+
+        void execute() {
+            decodeCodewords(job.get());
+            delete this;
+        }
+
+    private:
+        std::shared_ptr<Job> job;
+    };
+
+    InterleavedRS::~InterleavedRS() {
+        for (auto& r : rs) { correct_reed_solomon_destroy(r); }
+    }
+
+    void InterleavedRS::init(uint16_t primitivePolynomial, uint8_t firstRoot, uint8_t rootGap, int numRoots, int depth, int blockSize) {
+        assert(depth > 0 && blockSize > numRoots);
+        _depth = depth;
+        _blockSize = blockSize;
+        _numRoots = numRoots;
+
+        for (int i = 0; i < depth; i++) {
+            rs.push_back(correct_reed_solomon_create(primitivePolynomial, firstRoot, rootGap, numRoots));
+        }
+        corrected.resize(depth, 0);
+    }
+
+    bool InterleavedRS::decode(const uint8_t* in, uint8_t* out) {
+        auto job = std::make_shared<Job>();
+        job->rs = this;
+        job->depth = _depth;
+        job->in = in;
+        job->out = out;
+
+        // Clean codewords only cost a syndrome check, only bring in the pool once the stream has errors
+        if (lastHadErrors) {
+            int helpers = std::min<int>(_depth - 1, dsp::scheduler::getWorkerCount());
+            for (int i = 0; i < helpers; i++) {
+                dsp::scheduler::schedule(new Helper(job));
+            }
+        }
+
+        // Take a share of the codewords, then wait for the ones the helpers took
+        decodeCodewords(job.get());
+        if (job->done < _depth) {
+            std::unique_lock<std::mutex> lck(job->mtx);
+            job->cnd.wait(lck, [&job, this]() { return job->done == _depth; });
+        }
+
+        int failed = 0;
+        int total = 0;
+        for (int i = 0; i < _depth; i++) {
+            if (corrected[i] < 0) { failed++; continue; }
+            total += corrected[i];
+        }
+        lastHadErrors = (failed || total);
+
+        {
+            std::lock_guard<std::mutex> lck(statsMtx);
+            stats.frames++;
+            stats.failedFrames += (failed > 0);
+            stats.codewords += _depth;
+            stats.failedCodewords += failed;
+            stats.correctedSymbols += total;
+        }
+
+        return !failed;
+    }
+
+    RSStats InterleavedRS::getStats() {
+        std::lock_guard<std::mutex> lck(statsMtx);
+        return stats;
+    }
+
+    void InterleavedRS::resetStats() {
+        std::lock_guard<std::mutex> lck(statsMtx);
+        stats = RSStats();
+    }
+
+    void InterleavedRS::decodeCodewords(Job* job) {
+        while (true) {
+            int i = job->next.fetch_add(1);
+            if (i >= job->depth) { return; }
+
+            InterleavedRS* _this = job->rs;
+            int payload = _this->getPayloadSize();
+            correct_reed_solomon_decode_strided(_this->rs[i], &job->in[i], _this->_blockSize, _this->_depth, &job->out[i * payload], &_this->corrected[i]);
+
+            // Nothing but the job may be touched after the last codeword is done, the caller could be gone
+            if (job->done.fetch_add(1) + 1 == job->depth) {
+                std::lock_guard<std::mutex> lck(job->mtx);
+                job->cnd.notify_all();
+            }
+        }
+    }
+}
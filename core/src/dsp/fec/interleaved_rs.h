@@ -0,0 +1,70 @@
+#pragma once
+#include <stdint.h>
+#include <mutex>
+#include <vector>
+
+extern "C" {
+    #include <correct.h>
+}
+
+namespace dsp::fec {
+    // Error correction totals since the decoder was created or the stats were reset
+    struct RSStats {
+        uint64_t frames = 0;
+        uint64_t failedFrames = 0;
+        uint64_t codewords = 0;
+        uint64_t failedCodewords = 0;
+        uint64_t correctedSymbols = 0;
+    };
+
+    // Reed-Solomon decoder for frames made of several codewords interleaved symbol by symbol. The codewords are
+    // deinterleaved while being loaded into the decoder, and when the stream has errors they're spread over the
+    // scheduler pool with the calling thread taking its share, so decode() never waits on an idle pool.
+    class InterleavedRS {
+    public:
+        InterleavedRS() {}
+
+        InterleavedRS(uint16_t primitivePolynomial, uint8_t firstRoot, uint8_t rootGap, int numRoots, int depth, int blockSize = 255) {
+            init(primitivePolynomial, firstRoot, rootGap, numRoots, depth, blockSize);
+        }
+
+        ~InterleavedRS();
+
+        void init(uint16_t primitivePolynomial, uint8_t firstRoot, uint8_t rootGap, int numRoots, int depth, int blockSize = 255);
+
+        /**
+         * Decode a frame.
+         * @param in Frame of depth * blockSize interleaved symbols.
+         * @param out Payloads of the codewords, one after the other.
+         * @return True if all codewords could be decoded. Payloads of the codewords that failed are left untouched.
+        */
+        bool decode(const uint8_t* in, uint8_t* out);
+
+        // Symbols corrected in each codeword of the last frame, -1 for the codewords that failed
+        const int* getCorrected() { return corrected.data(); }
+
+        RSStats getStats();
+        void resetStats();
+
+        int getDepth() { return _depth; }
+        int getPayloadSize() { return _blockSize - _numRoots; }
+
+    private:
+        struct Job;
+        class Helper;
+
+        static void decodeCodewords(Job* job);
+
+        int _depth = 0;
+        int _blockSize = 0;
+        int _numRoots = 0;
+
+        // One decoder per codeword since they hold state while decoding
+        std::vector<correct_reed_solomon*> rs;
+        std::vector<int> corrected;
+        bool lastHadErrors = false;
+
+        std::mutex statsMtx;
+        RSStats stats;
+    };
+}
@@ -1,6 +1,7 @@
 #pragma once
 #include "../processor.h"
 #include "../taps/tap.h"
+#include "fir_kernel.h"
 
 namespace dsp::filter {
     template <class D, class T>
@@ -19,6 +20,7 @@ namespace dsp::filter {
 
         virtual void init(stream<D>* in, tap<T>& taps) {
             _taps = taps;
+            kernel.setTaps(_taps);
 
             // Allocate and clear buffer
             buffer = buffer::alloc<D>(STREAM_BUFFER_SIZE + 64000);
@@ -35,6 +37,7 @@ namespace dsp::filter {
 
             int oldTC = _taps.size;
             _taps = taps;
+            kernel.setTaps(_taps);
 
             // Update start of buffer
             bufStart = &buffer[_taps.size - 1];
@@ -65,15 +68,7 @@ namespace dsp::filter {
             
             // Do convolution
             for (int i = 0; i < count; i++) {
-                if constexpr (std::is_same_v<D, float> && std::is_same_v<T, float>) {
-                    volk_32f_x2_dot_prod_32f(&out[i], &buffer[i], _taps.taps, _taps.size);
-                }
-                if constexpr ((std::is_same_v<D, complex_t> || std::is_same_v<D, stereo_t>) && std::is_same_v<T, float>) {
-                    volk_32fc_32f_dot_prod_32fc((lv_32fc_t*)&out[i], (lv_32fc_t*)&buffer[i], _taps.taps, _taps.size);
-                }
-                if constexpr ((std::is_same_v<D, complex_t> || std::is_same_v<D, stereo_t>) && std::is_same_v<T, complex_t>) {
-                    volk_32fc_x2_dot_prod_32fc((lv_32fc_t*)&out[i], (lv_32fc_t*)&buffer[i], (lv_32fc_t*)_taps.taps, _taps.size);
-                }
+                kernel.dot(&out[i], &buffer[i]);
             }
 
             // Move unused data
@@ -95,6 +90,7 @@ namespace dsp::filter {
 
     protected:
         tap<T> _taps;
+        FIRKernel<D, T> kernel;
         D* buffer;
         D* bufStart;
     };
@@ -0,0 +1,322 @@
+#pragma once
+#include <math.h>
+#include <algorithm>
+#include <type_traits>
+#include "../types.h"
+#include "../taps/tap.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define FIR_KERNEL_AVX2
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define FIR_KERNEL_NEON
+#endif
+
+// Taps within this fraction of the largest tap are considered equal (or zero)
+#define FIR_KERNEL_TOLERANCE    1e-6f
+
+namespace dsp::filter {
+    enum FIRKernelType {
+        FIR_KERNEL_GENERIC,
+        FIR_KERNEL_SYMMETRIC,
+        FIR_KERNEL_HALF_BAND
+    };
+
+    // Dot products specialised on the shape of real taps. Linear phase filters are symmetric, so
+    // samples sharing the same tap are added before the multiply (x[i] + x[n-1-i]) which halves the
+    // multiplies. Half-band filters additionally have every other tap at zero, those are skipped.
+    // Samples are either one float (real) or two floats (complex, stereo), the taps given to the
+    // complex kernels are duplicated so that they line up with the interleaved samples.
+    namespace kernels {
+#if defined(FIR_KERNEL_AVX2)
+        inline float hsum(__m256 v) {
+            __m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+            s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+            s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+            return _mm_cvtss_f32(s);
+        }
+
+        inline void hsumComplex(__m256 v, float& re, float& im) {
+            __m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+            s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+            re += _mm_cvtss_f32(s);
+            im += _mm_cvtss_f32(_mm_shuffle_ps(s, s, 1));
+        }
+#endif
+
+        // sum(taps[i] * (x[i] + x[n-1-i])) for i < half
+        inline float symmetricReal(const float* x, const float* taps, int half, int n) {
+            int i = 0;
+            float sum = 0.0f;
+#if defined(FIR_KERNEL_AVX2)
+            const __m256i rev = _mm256_set_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+            __m256 acc = _mm256_setzero_ps();
+            for (; i + 8 <= half; i += 8) {
+                __m256 a = _mm256_loadu_ps(&x[i]);
+                __m256 b = _mm256_permutevar8x32_ps(_mm256_loadu_ps(&x[n - 8 - i]), rev);
+                acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_loadu_ps(&taps[i]), _mm256_add_ps(a, b)));
+            }
+            sum = hsum(acc);
+#elif defined(FIR_KERNEL_NEON)
+            float32x4_t acc = vdupq_n_f32(0.0f);
+            for (; i + 4 <= half; i += 4) {
+                float32x4_t a = vld1q_f32(&x[i]);
+                float32x4_t b = vrev64q_f32(vld1q_f32(&x[n - 4 - i]));
+                b = vextq_f32(b, b, 2);
+                acc = vfmaq_f32(acc, vld1q_f32(&taps[i]), vaddq_f32(a, b));
+            }
+            sum = vaddvq_f32(acc);
+#endif
+            for (; i < half; i++) {
+                sum += taps[i] * (x[i] + x[n - 1 - i]);
+            }
+            return sum;
+        }
+
+        // sum(taps[i] * (x[i] + x[n-1-i])) for i < half, x being interleaved complex samples
+        inline void symmetricComplex(const float* x, const float* taps, int half, int n, float& re, float& im) {
+            int i = 0;
+            re = 0.0f;
+            im = 0.0f;
+#if defined(FIR_KERNEL_AVX2)
+            const __m256i rev = _mm256_set_epi32(1, 0, 3, 2, 5, 4, 7, 6);
+            __m256 acc = _mm256_setzero_ps();
+            for (; i + 4 <= half; i += 4) {
+                __m256 a = _mm256_loadu_ps(&x[2 * i]);
+                __m256 b = _mm256_permutevar8x32_ps(_mm256_loadu_ps(&x[2 * (n - 4 - i)]), rev);
+                acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_loadu_ps(&taps[2 * i]), _mm256_add_ps(a, b)));
+            }
+            hsumComplex(acc, re, im);
+#elif defined(FIR_KERNEL_NEON)
+            float32x4_t acc = vdupq_n_f32(0.0f);
+            for (; i + 2 <= half; i += 2) {
+                float32x4_t a = vld1q_f32(&x[2 * i]);
+                float32x4_t b = vld1q_f32(&x[2 * (n - 2 - i)]);
+                b = vextq_f32(b, b, 2);
+                acc = vfmaq_f32(acc, vld1q_f32(&taps[2 * i]), vaddq_f32(a, b));
+            }
+            float32x2_t s = vadd_f32(vget_low_f32(acc), vget_high_f32(acc));
+            re = vget_lane_f32(s, 0);
+            im = vget_lane_f32(s, 1);
+#endif
+            for (; i < half; i++) {
+                const float* a = &x[2 * i];
+                const float* b = &x[2 * (n - 1 - i)];
+                re += taps[2 * i] * (a[0] + b[0]);
+                im += taps[2 * i] * (a[1] + b[1]);
+            }
+        }
+
+        // sum(taps[j] * (x[2j] + x[n-1-2j])) for j < count, the odd taps being zero
+        inline float halfBandReal(const float* x, const float* taps, int count, int n) {
+            int j = 0;
+            float sum = 0.0f;
+#if defined(FIR_KERNEL_AVX2)
+            const __m256i rev = _mm256_set_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+            __m256 acc = _mm256_setzero_ps();
+            for (; j + 8 <= count; j += 8) {
+                // Even samples from the start, odd ones (relative to the load) from the end
+                const float* l = &x[2 * j];
+                const float* r = &x[n - 16 - 2 * j];
+                __m256 a = _mm256_shuffle_ps(_mm256_loadu_ps(l), _mm256_loadu_ps(l + 8), _MM_SHUFFLE(2, 0, 2, 0));
+                __m256 b = _mm256_shuffle_ps(_mm256_loadu_ps(r), _mm256_loadu_ps(r + 8), _MM_SHUFFLE(3, 1, 3, 1));
+                a = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(a), _MM_SHUFFLE(3, 1, 2, 0)));
+                b = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(b), _MM_SHUFFLE(3, 1, 2, 0)));
+                b = _mm256_permutevar8x32_ps(b, rev);
+                acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_loadu_ps(&taps[j]), _mm256_add_ps(a, b)));
+            }
+            sum = hsum(acc);
+#elif defined(FIR_KERNEL_NEON)
+            float32x4_t acc = vdupq_n_f32(0.0f);
+            for (; j + 4 <= count; j += 4) {
+                float32x4_t a = vld2q_f32(&x[2 * j]).val[0];
+                float32x4_t b = vrev64q_f32(vld2q_f32(&x[n - 8 - 2 * j]).val[1]);
+                b = vextq_f32(b, b, 2);
+                acc = vfmaq_f32(acc, vld1q_f32(&taps[j]), vaddq_f32(a, b));
+            }
+            sum = vaddvq_f32(acc);
+#endif
+            for (; j < count; j++) {
+                sum += taps[j] * (x[2 * j] + x[n - 1 - 2 * j]);
+            }
+            return sum;
+        }
+
+        // sum(taps[j] * (x[2j] + x[n-1-2j])) for j < count, x being interleaved complex samples
+        inline void halfBandComplex(const float* x, const float* taps, int count, int n, float& re, float& im) {
+            int j = 0;
+            re = 0.0f;
+            im = 0.0f;
+#if defined(FIR_KERNEL_AVX2)
+            __m256 acc = _mm256_setzero_ps();
+            for (; j + 4 <= count; j += 4) {
+                // Complex samples are handled as doubles to move them around in one piece
+                const float* l = &x[4 * j];
+                const float* r = &x[2 * (n - 8 - 2 * j)];
+                __m256d a = _mm256_unpacklo_pd(_mm256_loadu_pd((const double*)l), _mm256_loadu_pd((const double*)(l + 8)));
+                __m256d b = _mm256_unpackhi_pd(_mm256_loadu_pd((const double*)r), _mm256_loadu_pd((const double*)(r + 8)));
+                a = _mm256_permute4x64_pd(a, _MM_SHUFFLE(3, 1, 2, 0));
+                b = _mm256_permute4x64_pd(b, _MM_SHUFFLE(0, 2, 1, 3));
+                __m256 sum = _mm256_add_ps(_mm256_castpd_ps(a), _mm256_castpd_ps(b));
+                acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_loadu_ps(&taps[2 * j]), sum));
+            }
+            hsumComplex(acc, re, im);
+#elif defined(FIR_KERNEL_NEON)
+            float32x4_t acc = vdupq_n_f32(0.0f);
+            for (; j + 2 <= count; j += 2) {
+                float64x2_t a = vld2q_f64((const double*)&x[4 * j]).val[0];
+                float64x2_t b = vld2q_f64((const double*)&x[2 * (n - 4 - 2 * j)]).val[1];
+                b = vextq_f64(b, b, 1);
+                float32x4_t sum = vaddq_f32(vreinterpretq_f32_f64(a), vreinterpretq_f32_f64(b));
+                acc = vfmaq_f32(acc, vld1q_f32(&taps[2 * j]), sum);
+            }
+            float32x2_t s = vadd_f32(vget_low_f32(acc), vget_high_f32(acc));
+            re = vget_lane_f32(s, 0);
+            im = vget_lane_f32(s, 1);
+#endif
+            for (; j < count; j++) {
+                const float* a = &x[4 * j];
+                const float* b = &x[2 * (n - 1 - 2 * j)];
+                re += taps[2 * j] * (a[0] + b[0]);
+                im += taps[2 * j] * (a[1] + b[1]);
+            }
+        }
+    }
+
+    // Picks the cheapest dot product for a set of taps. The taps are still owned by the caller,
+    // only the folded copy used by the specialised kernels is owned by the kernel.
+    template <class D, class T>
+    class FIRKernel {
+    public:
+        FIRKernel() {}
+        FIRKernel(const FIRKernel&) = delete;
+        FIRKernel& operator=(const FIRKernel&) = delete;
+
+        ~FIRKernel() {
+            buffer::free(folded);
+        }
+
+        void setTaps(const tap<T>& taps) {
+            _taps = taps;
+            buffer::free(folded);
+            folded = NULL;
+            type = FIR_KERNEL_GENERIC;
+            if constexpr (REAL || COMPLEX) {
+                classify();
+            }
+        }
+
+        inline FIRKernelType getType() const { return type; }
+
+        inline void dot(D* out, const D* x) const {
+            if constexpr (REAL) {
+                if (type == FIR_KERNEL_SYMMETRIC) {
+                    float sum = kernels::symmetricReal(x, folded, foldCount, _taps.size);
+                    if (hasCenter) { sum += center * x[_taps.size / 2]; }
+                    *out = sum;
+                    return;
+                }
+                if (type == FIR_KERNEL_HALF_BAND) {
+                    const float* hx = &x[offset];
+                    *out = kernels::halfBandReal(hx, folded, foldCount, _taps.size - 2 * offset) + center * x[_taps.size / 2];
+                    return;
+                }
+            }
+            if constexpr (COMPLEX) {
+                // Works for both complex_t and stereo_t, both being two interleaved floats
+                float* fout = (float*)out;
+                const float* fx = (const float*)x;
+                const float* mid = &fx[2 * (_taps.size / 2)];
+                if (type == FIR_KERNEL_SYMMETRIC) {
+                    kernels::symmetricComplex(fx, folded, foldCount, _taps.size, fout[0], fout[1]);
+                    if (hasCenter) {
+                        fout[0] += center * mid[0];
+                        fout[1] += center * mid[1];
+                    }
+                    return;
+                }
+                if (type == FIR_KERNEL_HALF_BAND) {
+                    kernels::halfBandComplex(&fx[2 * offset], folded, foldCount, _taps.size - 2 * offset, fout[0], fout[1]);
+                    fout[0] += center * mid[0];
+                    fout[1] += center * mid[1];
+                    return;
+                }
+            }
+
+            if constexpr (std::is_same_v<D, float> && std::is_same_v<T, float>) {
+                volk_32f_x2_dot_prod_32f(out, x, _taps.taps, _taps.size);
+            }
+            if constexpr ((std::is_same_v<D, complex_t> || std::is_same_v<D, stereo_t>) && std::is_same_v<T, float>) {
+                volk_32fc_32f_dot_prod_32fc((lv_32fc_t*)out, (lv_32fc_t*)x, _taps.taps, _taps.size);
+            }
+            if constexpr ((std::is_same_v<D, complex_t> || std::is_same_v<D, stereo_t>) && std::is_same_v<T, complex_t>) {
+                volk_32fc_x2_dot_prod_32fc((lv_32fc_t*)out, (lv_32fc_t*)x, (lv_32fc_t*)_taps.taps, _taps.size);
+            }
+        }
+
+    private:
+        static constexpr bool REAL = std::is_same_v<D, float> && std::is_same_v<T, float>;
+        static constexpr bool COMPLEX = (std::is_same_v<D, complex_t> || std::is_same_v<D, stereo_t>) && std::is_same_v<T, float>;
+        static constexpr int FLOATS_PER_SAMPLE = COMPLEX ? 2 : 1;
+
+        void classify() {
+            const float* t = _taps.taps;
+            int n = _taps.size;
+            if (n < 3 || !t) { return; }
+
+            float peak = 0.0f;
+            for (int i = 0; i < n; i++) {
+                peak = std::max<float>(peak, fabsf(t[i]));
+            }
+            float tol = peak * FIR_KERNEL_TOLERANCE;
+
+            // Linear phase filters have symmetric taps
+            for (int i = 0; i < n / 2; i++) {
+                if (fabsf(t[i] - t[n - 1 - i]) > tol) { return; }
+            }
+
+            // Half-band filters have an odd length and every other tap from the center at zero.
+            // Depending on the length, the outermost taps are either non-zero or zero.
+            int c = n / 2;
+            bool halfBand = (n & 1) && n >= 7;
+            for (int i = c - 2; halfBand && i >= 0; i -= 2) {
+                if (fabsf(t[i]) > tol) { halfBand = false; }
+            }
+            if (halfBand) {
+                type = FIR_KERNEL_HALF_BAND;
+                offset = (c & 1) ? 0 : 1;
+                foldCount = (c + 1 - offset) / 2;
+                center = t[c];
+                folded = buffer::alloc<float>(foldCount * FLOATS_PER_SAMPLE);
+                for (int j = 0; j < foldCount; j++) {
+                    fillTap(j, t[offset + 2 * j]);
+                }
+                return;
+            }
+
+            type = FIR_KERNEL_SYMMETRIC;
+            foldCount = n / 2;
+            hasCenter = (n & 1);
+            center = t[c];
+            folded = buffer::alloc<float>(foldCount * FLOATS_PER_SAMPLE);
+            for (int i = 0; i < foldCount; i++) {
+                fillTap(i, t[i]);
+            }
+        }
+
+        inline void fillTap(int i, float val) {
+            for (int k = 0; k < FLOATS_PER_SAMPLE; k++) {
+                folded[i * FLOATS_PER_SAMPLE + k] = val;
+            }
+        }
+
+        tap<T> _taps;
+        FIRKernelType type = FIR_KERNEL_GENERIC;
+        float* folded = NULL;
+        int foldCount = 0;
+        int offset = 0;
+        bool hasCenter = false;
+        float center = 0.0f;
+    };
+}
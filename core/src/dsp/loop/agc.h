@@ -1,5 +1,6 @@
 #pragma once
 #include "../processor.h"
+#include "../math/polar_kernel.h"
 
 namespace dsp::loop {
     template <class T>
@@ -10,6 +11,14 @@ namespace dsp::loop {
 
         AGC(stream<T>* in, double setPoint, double attack, double decay, double maxGain, double maxOutputAmp, double initGain = 1.0) { init(in, setPoint, attack, decay, maxGain, maxOutputAmp, initGain); }
 
+        ~AGC() {
+            if (!base_type::_block_init) { return; }
+            base_type::stop();
+            if constexpr (std::is_same_v<T, complex_t>) {
+                buffer::free(amps);
+            }
+        }
+
         void init(stream<T>* in, double setPoint, double attack, double decay, double maxGain, double maxOutputAmp, double initGain = 1.0) {
             _setPoint = setPoint;
             _attack = attack;
@@ -20,6 +29,10 @@ namespace dsp::loop {
             _maxOutputAmp = maxOutputAmp;
             _initGain = initGain;
             amp = _setPoint / _initGain;
+            // init() may be called again on the same block
+            if constexpr (std::is_same_v<T, complex_t>) {
+                if (!amps) { amps = buffer::alloc<float>(STREAM_BUFFER_SIZE); }
+            }
             base_type::init(in);
         }
 
@@ -68,11 +81,16 @@ namespace dsp::loop {
         }
 
         inline int process(int count, T* in, T* out) {
+            // Compute all amplitudes at once, the loop below depends on the previous sample
+            if constexpr (std::is_same_v<T, complex_t>) {
+                math::polar::magnitude(in, amps, count);
+            }
+
             for (int i = 0; i < count; i++) {
                 // Get signal amplitude
                 float inAmp, gain;
                 if constexpr (std::is_same_v<T, complex_t>) {
-                    inAmp = in[i].amplitude();
+                    inAmp = amps[i];
                 }
                 if constexpr (std::is_same_v<T, float>) {
                     inAmp = fabsf(in[i]);
@@ -92,7 +110,7 @@ namespace dsp::loop {
                     float maxAmp = 0;
                     for (int j = i; j < count; j++) {
                         if constexpr (std::is_same_v<T, complex_t>) {
-                            inAmp = in[j].amplitude();
+                            inAmp = amps[j];
                         }
                         if constexpr (std::is_same_v<T, float>) {
                             inAmp = fabsf(in[j]);
@@ -131,6 +149,7 @@ namespace dsp::loop {
         float _initGain;
 
         float amp = 1.0;
+        float* amps = NULL;
 
     };
 }
\ No newline at end of file
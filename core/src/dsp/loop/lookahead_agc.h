@@ -0,0 +1,226 @@
+#pragma once
+#include "../processor.h"
+#include "../math/polar_kernel.h"
+
+// Look-ahead used by the demodulators, in seconds
+#define LOOKAHEAD_AGC_DEFAULT_TIME  0.005
+
+namespace dsp::loop {
+    // Same gain law as AGC, but the output is delayed by a fixed look-ahead. Peaks are found with a sliding
+    // window maximum over the look-ahead instead of rescanning the rest of the block, so the cost per sample
+    // is constant and the output does not depend on how the input is split into blocks.
+    template <class T>
+    class LookaheadAGC : public Processor<T, T> {
+        using base_type = Processor<T, T>;
+    public:
+        LookaheadAGC() {}
+
+        LookaheadAGC(stream<T>* in, double setPoint, double attack, double decay, double maxGain, double maxOutputAmp, int lookahead, double initGain = 1.0) { init(in, setPoint, attack, decay, maxGain, maxOutputAmp, lookahead, initGain); }
+
+        ~LookaheadAGC() {
+            if (!base_type::_block_init) { return; }
+            base_type::stop();
+            freeWindow();
+            buffer::free(amps);
+        }
+
+        void init(stream<T>* in, double setPoint, double attack, double decay, double maxGain, double maxOutputAmp, int lookahead, double initGain = 1.0) {
+            _setPoint = setPoint;
+            _attack = attack;
+            _invAttack = 1.0f - _attack;
+            _decay = decay;
+            _invDecay = 1.0f - _decay;
+            _maxGain = maxGain;
+            _maxOutputAmp = maxOutputAmp;
+            _initGain = initGain;
+            amp = _setPoint / _initGain;
+
+            // init() may be called again on the same block
+            if (!amps) { amps = buffer::alloc<float>(STREAM_BUFFER_SIZE); }
+            if (delay) { freeWindow(); }
+            allocWindow(lookahead);
+
+            base_type::init(in);
+        }
+
+        void setSetPoint(double setPoint) {
+            assert(base_type::_block_init);
+            std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
+            _setPoint = setPoint;
+        }
+
+        void setAttack(double attack) {
+            assert(base_type::_block_init);
+            std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
+            _attack = attack;
+            _invAttack = 1.0f - _attack;
+        }
+
+        void setDecay(double decay) {
+            assert(base_type::_block_init);
+            std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
+            _decay = decay;
+            _invDecay = 1.0f - _decay;
+        }
+
+        void setMaxGain(double maxGain) {
+            assert(base_type::_block_init);
+            std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
+            _maxGain = maxGain;
+        }
+
+        void setMaxOutputAmp(double maxOutputAmp) {
+            assert(base_type::_block_init);
+            std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
+            _maxOutputAmp = maxOutputAmp;
+        }
+
+        void setInitialGain(double initGain) {
+            assert(base_type::_block_init);
+            std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
+            _initGain = initGain;
+        }
+
+        void setLookahead(int lookahead) {
+            assert(base_type::_block_init);
+            std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
+            base_type::tempStop();
+            freeWindow();
+            allocWindow(lookahead);
+            amp = _setPoint / _initGain;
+            base_type::tempStart();
+        }
+
+        int getLookahead() {
+            return _window - 1;
+        }
+
+        void reset() {
+            assert(base_type::_block_init);
+            std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
+            base_type::tempStop();
+            amp = _setPoint / _initGain;
+            clearWindow();
+            base_type::tempStart();
+        }
+
+        inline int process(int count, T* in, T* out) {
+            // Envelope of the whole block first, it doesn't depend on the gain
+            if constexpr (std::is_same_v<T, complex_t>) {
+                math::polar::magnitude(in, amps, count);
+            }
+            if constexpr (std::is_same_v<T, float>) {
+                for (int i = 0; i < count; i++) { amps[i] = fabsf(in[i]); }
+            }
+
+            for (int i = 0; i < count; i++) {
+                // Push the new sample into the delay line
+                uint64_t newest = written++;
+                delay[newest & mask] = in[i];
+                delayAmps[newest & mask] = amps[i];
+
+                // Drop the front of the deque once it left the window, before pushing so that it never holds more than _window entries
+                if (maxCount && maxQueue[maxHead & mask] + _window <= newest) {
+                    maxHead++;
+                    maxCount--;
+                }
+
+                // Keep the window maximum at the front of the deque, anything smaller than the new sample can't be it anymore
+                while (maxCount && maxAmps[(maxHead + maxCount - 1) & mask] <= amps[i]) { maxCount--; }
+                maxQueue[(maxHead + maxCount) & mask] = newest;
+                maxAmps[(maxHead + maxCount) & mask] = amps[i];
+                maxCount++;
+
+                // Sample leaving the delay line and the largest amplitude coming up after it
+                uint64_t oldest = newest - (_window - 1);
+                T sample = delay[oldest & mask];
+                float inAmp = delayAmps[oldest & mask];
+                float peak = maxAmps[maxHead & mask];
+
+                // Update average amplitude
+                float gain;
+                if (inAmp != 0.0f) {
+                    amp = (inAmp > amp) ? ((amp * _invAttack) + (inAmp * _attack)) : ((amp * _invDecay) + (inAmp * _decay));
+                    gain = std::min<float>(_setPoint / amp, _maxGain);
+                }
+                else {
+                    gain = 1.0f;
+                }
+
+                // If a peak within the look-ahead would clip, settle on it before it arrives
+                if (peak * gain > _maxOutputAmp) {
+                    amp = peak;
+                    gain = std::min<float>(_setPoint / amp, _maxGain);
+                }
+
+                // Scale output by gain
+                out[i] = sample * gain;
+            }
+            return count;
+        }
+
+        int run() {
+            int count = base_type::_in->read();
+            if (count < 0) { return -1; }
+
+            process(count, base_type::_in->readBuf, base_type::out.writeBuf);
+
+            base_type::_in->flush();
+            if (!base_type::out.swap(count)) { return -1; }
+            return count;
+        }
+
+    protected:
+        void allocWindow(int lookahead) {
+            // The window holds the outgoing sample and the look-ahead, rounded up to a power of two for the rings
+            _window = std::max<int>(lookahead, 0) + 1;
+            int size = 1;
+            while (size < _window) { size <<= 1; }
+            mask = size - 1;
+            delay = buffer::alloc<T>(size);
+            delayAmps = buffer::alloc<float>(size);
+            maxQueue = buffer::alloc<uint64_t>(size);
+            maxAmps = buffer::alloc<float>(size);
+            clearWindow();
+        }
+
+        void freeWindow() {
+            buffer::free(delay);
+            buffer::free(delayAmps);
+            buffer::free(maxQueue);
+            buffer::free(maxAmps);
+        }
+
+        void clearWindow() {
+            buffer::clear(delay, mask + 1);
+            buffer::clear(delayAmps, mask + 1);
+            written = 0;
+            maxHead = 0;
+            maxCount = 0;
+        }
+
+        float _setPoint;
+        float _attack;
+        float _invAttack;
+        float _decay;
+        float _invDecay;
+        float _maxGain;
+        float _maxOutputAmp;
+        float _initGain;
+        int _window;
+
+        float amp = 1.0;
+        float* amps = NULL;
+
+        // Delay line and sliding maximum, indexed by the absolute sample number
+        T* delay = NULL;
+        float* delayAmps = NULL;
+        uint64_t* maxQueue = NULL;
+        float* maxAmps = NULL;
+        uint64_t mask = 0;
+        uint64_t written = 0;
+        uint64_t maxHead = 0;
+        int maxCount = 0;
+
+    };
+}
@@ -0,0 +1,475 @@
+#include "polar_kernel.h"
+#include <math.h>
+#include <float.h>
+#include <algorithm>
+#include <utils/flog.h>
+#include "constants.h"
+
+#if defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__))
+#include <immintrin.h>
+#define POLAR_KERNEL_X86
+#define POLAR_AVX2 __attribute__((target("avx2,fma")))
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define POLAR_KERNEL_NEON
+#endif
+
+// Minimax polynomial for atan(z) with z in [0, 1], odd powers up to z^11
+#define POLAR_ATAN_C1   0.99997726f
+#define POLAR_ATAN_C3   -0.33262347f
+#define POLAR_ATAN_C5   0.19354346f
+#define POLAR_ATAN_C7   -0.11643287f
+#define POLAR_ATAN_C9   0.05265332f
+#define POLAR_ATAN_C11  -0.01172120f
+
+// atan(z) ~= z * (pi/4 + (1 - z) * (A + B * z))
+#define POLAR_FAST_A    0.2447f
+#define POLAR_FAST_B    0.0663f
+
+#define POLAR_PI_2      (FL_M_PI / 2.0f)
+#define POLAR_PI_4      (FL_M_PI / 4.0f)
+
+namespace dsp::math::polar {
+    namespace {
+        typedef void (*DiscriminateFunc)(const complex_t* in, float* out, int count, complex_t& last, float gain, PolarAccuracy accuracy);
+        typedef void (*PhaseFunc)(const complex_t* in, float* out, int count, PolarAccuracy accuracy);
+        typedef void (*MagnitudeFunc)(const complex_t* in, float* out, int count);
+        typedef void (*NormalizeFunc)(const complex_t* in, complex_t* out, int count);
+
+        struct Implementation {
+            const char* name;
+            DiscriminateFunc discriminate;
+            PhaseFunc phase;
+            MagnitudeFunc magnitude;
+            NormalizeFunc normalize;
+        };
+
+        // ================= GENERIC =================
+
+        namespace generic {
+            template <bool FAST>
+            inline float atan2(float y, float x) {
+                float ax = fabsf(x);
+                float ay = fabsf(y);
+                float z = std::min(ax, ay) / std::max(std::max(ax, ay), FLT_MIN);
+                float a;
+                if constexpr (FAST) {
+                    a = z * (POLAR_PI_4 + (1.0f - z) * (POLAR_FAST_A + POLAR_FAST_B * z));
+                }
+                else {
+                    float z2 = z * z;
+                    a = z * (POLAR_ATAN_C1 + z2 * (POLAR_ATAN_C3 + z2 * (POLAR_ATAN_C5 + z2 * (POLAR_ATAN_C7 + z2 * (POLAR_ATAN_C9 + z2 * POLAR_ATAN_C11)))));
+                }
+                if (ay > ax) { a = POLAR_PI_2 - a; }
+                if (x < 0.0f) { a = FL_M_PI - a; }
+                return (y < 0.0f) ? -a : a;
+            }
+
+            template <bool FAST>
+            inline float discriminate(const complex_t& cur, const complex_t& prev) {
+                return atan2<FAST>(cur.im * prev.re - cur.re * prev.im, cur.re * prev.re + cur.im * prev.im);
+            }
+
+            template <bool FAST>
+            void discriminate(const complex_t* in, float* out, int count, complex_t& last, float gain, int start) {
+                for (int i = start; i < count; i++) {
+                    out[i] = discriminate<FAST>(in[i], (i > 0) ? in[i - 1] : last) * gain;
+                }
+            }
+
+            template <bool FAST>
+            void phase(const complex_t* in, float* out, int count, int start) {
+                for (int i = start; i < count; i++) {
+                    out[i] = atan2<FAST>(in[i].im, in[i].re);
+                }
+            }
+
+            void magnitude(const complex_t* in, float* out, int count, int start) {
+                for (int i = start; i < count; i++) {
+                    out[i] = sqrtf(in[i].re * in[i].re + in[i].im * in[i].im);
+                }
+            }
+
+            void normalize(const complex_t* in, complex_t* out, int count, int start) {
+                for (int i = start; i < count; i++) {
+                    float mag = sqrtf(in[i].re * in[i].re + in[i].im * in[i].im);
+                    float inv = (mag > 0.0f) ? 1.0f / mag : 0.0f;
+                    out[i] = { in[i].re * inv, in[i].im * inv };
+                }
+            }
+
+            void discriminateAll(const complex_t* in, float* out, int count, complex_t& last, float gain, PolarAccuracy accuracy) {
+                if (accuracy == POLAR_ACCURACY_FAST) { discriminate<true>(in, out, count, last, gain, 0); }
+                else { discriminate<false>(in, out, count, last, gain, 0); }
+                last = in[count - 1];
+            }
+
+            void phaseAll(const complex_t* in, float* out, int count, PolarAccuracy accuracy) {
+                if (accuracy == POLAR_ACCURACY_FAST) { phase<true>(in, out, count, 0); }
+                else { phase<false>(in, out, count, 0); }
+            }
+
+            void magnitudeAll(const complex_t* in, float* out, int count) { magnitude(in, out, count, 0); }
+            void normalizeAll(const complex_t* in, complex_t* out, int count) { normalize(in, out, count, 0); }
+
+            const Implementation impl = { "generic", discriminateAll, phaseAll, magnitudeAll, normalizeAll };
+        }
+
+#if defined(POLAR_KERNEL_X86)
+        // ================= SSE2 =================
+
+        namespace sse2 {
+            inline __m128 select(__m128 mask, __m128 a, __m128 b) {
+                return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+            }
+
+            template <bool FAST>
+            inline __m128 atan2(__m128 y, __m128 x) {
+                const __m128 sign = _mm_set1_ps(-0.0f);
+                const __m128 zero = _mm_setzero_ps();
+                __m128 ax = _mm_andnot_ps(sign, x);
+                __m128 ay = _mm_andnot_ps(sign, y);
+                __m128 z = _mm_div_ps(_mm_min_ps(ax, ay), _mm_max_ps(_mm_max_ps(ax, ay), _mm_set1_ps(FLT_MIN)));
+                __m128 a;
+                if constexpr (FAST) {
+                    __m128 p = _mm_add_ps(_mm_set1_ps(POLAR_FAST_A), _mm_mul_ps(_mm_set1_ps(POLAR_FAST_B), z));
+                    p = _mm_add_ps(_mm_set1_ps(POLAR_PI_4), _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(1.0f), z), p));
+                    a = _mm_mul_ps(z, p);
+                }
+                else {
+                    __m128 z2 = _mm_mul_ps(z, z);
+                    __m128 p = _mm_add_ps(_mm_set1_ps(POLAR_ATAN_C9), _mm_mul_ps(z2, _mm_set1_ps(POLAR_ATAN_C11)));
+                    p = _mm_add_ps(_mm_set1_ps(POLAR_ATAN_C7), _mm_mul_ps(z2, p));
+                    p = _mm_add_ps(_mm_set1_ps(POLAR_ATAN_C5), _mm_mul_ps(z2, p));
+                    p = _mm_add_ps(_mm_set1_ps(POLAR_ATAN_C3), _mm_mul_ps(z2, p));
+                    p = _mm_add_ps(_mm_set1_ps(POLAR_ATAN_C1), _mm_mul_ps(z2, p));
+                    a = _mm_mul_ps(z, p);
+                }
+                a = select(_mm_cmpgt_ps(ay, ax), _mm_sub_ps(_mm_set1_ps(POLAR_PI_2), a), a);
+                a = select(_mm_cmplt_ps(x, zero), _mm_sub_ps(_mm_set1_ps(FL_M_PI), a), a);
+                return _mm_xor_ps(a, _mm_and_ps(_mm_cmplt_ps(y, zero), sign));
+            }
+
+            // Split 4 interleaved complex samples into their real and imaginary parts
+            inline void load(const complex_t* in, __m128& re, __m128& im) {
+                __m128 a = _mm_loadu_ps((const float*)in);
+                __m128 b = _mm_loadu_ps((const float*)&in[2]);
+                re = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+                im = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+            }
+
+            template <bool FAST>
+            void discriminate(const complex_t* in, float* out, int count, complex_t& last, float gain) {
+                if (count <= 0) { return; }
+                out[0] = generic::discriminate<FAST>(in[0], last) * gain;
+                const __m128 g = _mm_set1_ps(gain);
+                int i = 1;
+                for (; i + 4 <= count; i += 4) {
+                    __m128 cr, ci, pr, pi;
+                    load(&in[i], cr, ci);
+                    load(&in[i - 1], pr, pi);
+                    __m128 re = _mm_add_ps(_mm_mul_ps(cr, pr), _mm_mul_ps(ci, pi));
+                    __m128 im = _mm_sub_ps(_mm_mul_ps(ci, pr), _mm_mul_ps(cr, pi));
+                    _mm_storeu_ps(&out[i], _mm_mul_ps(atan2<FAST>(im, re), g));
+                }
+                generic::discriminate<FAST>(in, out, count, last, gain, i);
+                last = in[count - 1];
+            }
+
+            template <bool FAST>
+            void phase(const complex_t* in, float* out, int count) {
+                int i = 0;
+                for (; i + 4 <= count; i += 4) {
+                    __m128 re, im;
+                    load(&in[i], re, im);
+                    _mm_storeu_ps(&out[i], atan2<FAST>(im, re));
+                }
+                generic::phase<FAST>(in, out, count, i);
+            }
+
+            void magnitude(const complex_t* in, float* out, int count) {
+                int i = 0;
+                for (; i + 4 <= count; i += 4) {
+                    __m128 re, im;
+                    load(&in[i], re, im);
+                    _mm_storeu_ps(&out[i], _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(re, re), _mm_mul_ps(im, im))));
+                }
+                generic::magnitude(in, out, count, i);
+            }
+
+            void normalize(const complex_t* in, complex_t* out, int count) {
+                const __m128 zero = _mm_setzero_ps();
+                int i = 0;
+                for (; i + 2 <= count; i += 2) {
+                    // Squares of each part, then added with their neighbour so both parts hold |x|^2
+                    __m128 x = _mm_loadu_ps((const float*)&in[i]);
+                    __m128 sq = _mm_mul_ps(x, x);
+                    __m128 mag = _mm_sqrt_ps(_mm_add_ps(sq, _mm_shuffle_ps(sq, sq, _MM_SHUFFLE(2, 3, 0, 1))));
+                    __m128 inv = _mm_and_ps(_mm_cmpgt_ps(mag, zero), _mm_div_ps(_mm_set1_ps(1.0f), _mm_max_ps(mag, _mm_set1_ps(FLT_MIN))));
+                    _mm_storeu_ps((float*)&out[i], _mm_mul_ps(x, inv));
+                }
+                generic::normalize(in, out, count, i);
+            }
+
+            void discriminateAll(const complex_t* in, float* out, int count, complex_t& last, float gain, PolarAccuracy accuracy) {
+                if (accuracy == POLAR_ACCURACY_FAST) { discriminate<true>(in, out, count, last, gain); }
+                else { discriminate<false>(in, out, count, last, gain); }
+            }
+
+            void phaseAll(const complex_t* in, float* out, int count, PolarAccuracy accuracy) {
+                if (accuracy == POLAR_ACCURACY_FAST) { phase<true>(in, out, count); }
+                else { phase<false>(in, out, count); }
+            }
+
+            const Implementation impl = { "sse2", discriminateAll, phaseAll, magnitude, normalize };
+        }
+
+        // ================= AVX2 =================
+
+        // Only built for the functions below, the rest of the binary doesn't require AVX2
+        namespace avx2 {
+            POLAR_AVX2 inline __m256 select(__m256 mask, __m256 a, __m256 b) {
+                return _mm256_blendv_ps(b, a, mask);
+            }
+
+            template <bool FAST>
+            POLAR_AVX2 inline __m256 atan2(__m256 y, __m256 x) {
+                const __m256 sign = _mm256_set1_ps(-0.0f);
+                const __m256 zero = _mm256_setzero_ps();
+                __m256 ax = _mm256_andnot_ps(sign, x);
+                __m256 ay = _mm256_andnot_ps(sign, y);
+                __m256 z = _mm256_div_ps(_mm256_min_ps(ax, ay), _mm256_max_ps(_mm256_max_ps(ax, ay), _mm256_set1_ps(FLT_MIN)));
+                __m256 a;
+                if constexpr (FAST) {
+                    __m256 p = _mm256_fmadd_ps(_mm256_set1_ps(POLAR_FAST_B), z, _mm256_set1_ps(POLAR_FAST_A));
+                    p = _mm256_fmadd_ps(_mm256_sub_ps(_mm256_set1_ps(1.0f), z), p, _mm256_set1_ps(POLAR_PI_4));
+                    a = _mm256_mul_ps(z, p);
+                }
+                else {
+                    __m256 z2 = _mm256_mul_ps(z, z);
+                    __m256 p = _mm256_fmadd_ps(z2, _mm256_set1_ps(POLAR_ATAN_C11), _mm256_set1_ps(POLAR_ATAN_C9));
+                    p = _mm256_fmadd_ps(z2, p, _mm256_set1_ps(POLAR_ATAN_C7));
+                    p = _mm256_fmadd_ps(z2, p, _mm256_set1_ps(POLAR_ATAN_C5));
+                    p = _mm256_fmadd_ps(z2, p, _mm256_set1_ps(POLAR_ATAN_C3));
+                    p = _mm256_fmadd_ps(z2, p, _mm256_set1_ps(POLAR_ATAN_C1));
+                    a = _mm256_mul_ps(z, p);
+                }
+                a = select(_mm256_cmp_ps(ay, ax, _CMP_GT_OQ), _mm256_sub_ps(_mm256_set1_ps(POLAR_PI_2), a), a);
+                a = select(_mm256_cmp_ps(x, zero, _CMP_LT_OQ), _mm256_sub_ps(_mm256_set1_ps(FL_M_PI), a), a);
+                return _mm256_xor_ps(a, _mm256_and_ps(_mm256_cmp_ps(y, zero, _CMP_LT_OQ), sign));
+            }
+
+            // Split 8 interleaved complex samples into their real and imaginary parts. The lanes come
+            // out in the order 0 1 4 5 2 3 6 7, see reorder().
+            POLAR_AVX2 inline void load(const complex_t* in, __m256& re, __m256& im) {
+                __m256 a = _mm256_loadu_ps((const float*)in);
+                __m256 b = _mm256_loadu_ps((const float*)&in[4]);
+                re = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+                im = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+            }
+
+            POLAR_AVX2 inline __m256 reorder(__m256 v) {
+                return _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(v), _MM_SHUFFLE(3, 1, 2, 0)));
+            }
+
+            template <bool FAST>
+            POLAR_AVX2 void discriminate(const complex_t* in, float* out, int count, complex_t& last, float gain) {
+                if (count <= 0) { return; }
+                out[0] = generic::discriminate<FAST>(in[0], last) * gain;
+                const __m256 g = _mm256_set1_ps(gain);
+                int i = 1;
+                for (; i + 8 <= count; i += 8) {
+                    __m256 cr, ci, pr, pi;
+                    load(&in[i], cr, ci);
+                    load(&in[i - 1], pr, pi);
+                    __m256 re = _mm256_fmadd_ps(cr, pr, _mm256_mul_ps(ci, pi));
+                    __m256 im = _mm256_fmsub_ps(ci, pr, _mm256_mul_ps(cr, pi));
+                    _mm256_storeu_ps(&out[i], reorder(_mm256_mul_ps(atan2<FAST>(im, re), g)));
+                }
+                generic::discriminate<FAST>(in, out, count, last, gain, i);
+                last = in[count - 1];
+            }
+
+            template <bool FAST>
+            POLAR_AVX2 void phase(const complex_t* in, float* out, int count) {
+                int i = 0;
+                for (; i + 8 <= count; i += 8) {
+                    __m256 re, im;
+                    load(&in[i], re, im);
+                    _mm256_storeu_ps(&out[i], reorder(atan2<FAST>(im, re)));
+                }
+                generic::phase<FAST>(in, out, count, i);
+            }
+
+            POLAR_AVX2 void magnitude(const complex_t* in, float* out, int count) {
+                int i = 0;
+                for (; i + 8 <= count; i += 8) {
+                    __m256 re, im;
+                    load(&in[i], re, im);
+                    _mm256_storeu_ps(&out[i], reorder(_mm256_sqrt_ps(_mm256_fmadd_ps(re, re, _mm256_mul_ps(im, im)))));
+                }
+                generic::magnitude(in, out, count, i);
+            }
+
+            POLAR_AVX2 void normalize(const complex_t* in, complex_t* out, int count) {
+                const __m256 zero = _mm256_setzero_ps();
+                int i = 0;
+                for (; i + 4 <= count; i += 4) {
+                    __m256 x = _mm256_loadu_ps((const float*)&in[i]);
+                    __m256 sq = _mm256_mul_ps(x, x);
+                    __m256 mag = _mm256_sqrt_ps(_mm256_add_ps(sq, _mm256_permute_ps(sq, _MM_SHUFFLE(2, 3, 0, 1))));
+                    __m256 inv = _mm256_and_ps(_mm256_cmp_ps(mag, zero, _CMP_GT_OQ), _mm256_div_ps(_mm256_set1_ps(1.0f), _mm256_max_ps(mag, _mm256_set1_ps(FLT_MIN))));
+                    _mm256_storeu_ps((float*)&out[i], _mm256_mul_ps(x, inv));
+                }
+                generic::normalize(in, out, count, i);
+            }
+
+            POLAR_AVX2 void discriminateAll(const complex_t* in, float* out, int count, complex_t& last, float gain, PolarAccuracy accuracy) {
+                if (accuracy == POLAR_ACCURACY_FAST) { discriminate<true>(in, out, count, last, gain); }
+                else { discriminate<false>(in, out, count, last, gain); }
+            }
+
+            POLAR_AVX2 void phaseAll(const complex_t* in, float* out, int count, PolarAccuracy accuracy) {
+                if (accuracy == POLAR_ACCURACY_FAST) { phase<true>(in, out, count); }
+                else { phase<false>(in, out, count); }
+            }
+
+            const Implementation impl = { "avx2", discriminateAll, phaseAll, magnitude, normalize };
+        }
+#endif
+
+#if defined(POLAR_KERNEL_NEON)
+        // ================= NEON =================
+
+        namespace neon {
+            template <bool FAST>
+            inline float32x4_t atan2(float32x4_t y, float32x4_t x) {
+                const float32x4_t zero = vdupq_n_f32(0.0f);
+                float32x4_t ax = vabsq_f32(x);
+                float32x4_t ay = vabsq_f32(y);
+                float32x4_t z = vdivq_f32(vminq_f32(ax, ay), vmaxq_f32(vmaxq_f32(ax, ay), vdupq_n_f32(FLT_MIN)));
+                float32x4_t a;
+                if constexpr (FAST) {
+                    float32x4_t p = vfmaq_f32(vdupq_n_f32(POLAR_FAST_A), vdupq_n_f32(POLAR_FAST_B), z);
+                    p = vfmaq_f32(vdupq_n_f32(POLAR_PI_4), vsubq_f32(vdupq_n_f32(1.0f), z), p);
+                    a = vmulq_f32(z, p);
+                }
+                else {
+                    float32x4_t z2 = vmulq_f32(z, z);
+                    float32x4_t p = vfmaq_f32(vdupq_n_f32(POLAR_ATAN_C9), z2, vdupq_n_f32(POLAR_ATAN_C11));
+                    p = vfmaq_f32(vdupq_n_f32(POLAR_ATAN_C7), z2, p);
+                    p = vfmaq_f32(vdupq_n_f32(POLAR_ATAN_C5), z2, p);
+                    p = vfmaq_f32(vdupq_n_f32(POLAR_ATAN_C3), z2, p);
+                    p = vfmaq_f32(vdupq_n_f32(POLAR_ATAN_C1), z2, p);
+                    a = vmulq_f32(z, p);
+                }
+                a = vbslq_f32(vcgtq_f32(ay, ax), vsubq_f32(vdupq_n_f32(POLAR_PI_2), a), a);
+                a = vbslq_f32(vcltq_f32(x, zero), vsubq_f32(vdupq_n_f32(FL_M_PI), a), a);
+                return vbslq_f32(vcltq_f32(y, zero), vnegq_f32(a), a);
+            }
+
+            template <bool FAST>
+            void discriminate(const complex_t* in, float* out, int count, complex_t& last, float gain) {
+                if (count <= 0) { return; }
+                out[0] = generic::discriminate<FAST>(in[0], last) * gain;
+                int i = 1;
+                for (; i + 4 <= count; i += 4) {
+                    float32x4x2_t c = vld2q_f32((const float*)&in[i]);
+                    float32x4x2_t p = vld2q_f32((const float*)&in[i - 1]);
+                    float32x4_t re = vfmaq_f32(vmulq_f32(c.val[1], p.val[1]), c.val[0], p.val[0]);
+                    float32x4_t im = vfmsq_f32(vmulq_f32(c.val[1], p.val[0]), c.val[0], p.val[1]);
+                    vst1q_f32(&out[i], vmulq_n_f32(atan2<FAST>(im, re), gain));
+                }
+                generic::discriminate<FAST>(in, out, count, last, gain, i);
+                last = in[count - 1];
+            }
+
+            template <bool FAST>
+            void phase(const complex_t* in, float* out, int count) {
+                int i = 0;
+                for (; i + 4 <= count; i += 4) {
+                    float32x4x2_t c = vld2q_f32((const float*)&in[i]);
+                    vst1q_f32(&out[i], atan2<FAST>(c.val[1], c.val[0]));
+                }
+                generic::phase<FAST>(in, out, count, i);
+            }
+
+            void magnitude(const complex_t* in, float* out, int count) {
+                int i = 0;
+                for (; i + 4 <= count; i += 4) {
+                    float32x4x2_t c = vld2q_f32((const float*)&in[i]);
+                    vst1q_f32(&out[i], vsqrtq_f32(vfmaq_f32(vmulq_f32(c.val[1], c.val[1]), c.val[0], c.val[0])));
+                }
+                generic::magnitude(in, out, count, i);
+            }
+
+            void normalize(const complex_t* in, complex_t* out, int count) {
+                const float32x4_t zero = vdupq_n_f32(0.0f);
+                int i = 0;
+                for (; i + 4 <= count; i += 4) {
+                    float32x4x2_t c = vld2q_f32((const float*)&in[i]);
+                    float32x4_t mag = vsqrtq_f32(vfmaq_f32(vmulq_f32(c.val[1], c.val[1]), c.val[0], c.val[0]));
+                    float32x4_t inv = vbslq_f32(vcgtq_f32(mag, zero), vdivq_f32(vdupq_n_f32(1.0f), vmaxq_f32(mag, vdupq_n_f32(FLT_MIN))), zero);
+                    c.val[0] = vmulq_f32(c.val[0], inv);
+                    c.val[1] = vmulq_f32(c.val[1], inv);
+                    vst2q_f32((float*)&out[i], c);
+                }
+                generic::normalize(in, out, count, i);
+            }
+
+            void discriminateAll(const complex_t* in, float* out, int count, complex_t& last, float gain, PolarAccuracy accuracy) {
+                if (accuracy == POLAR_ACCURACY_FAST) { discriminate<true>(in, out, count, last, gain); }
+                else { discriminate<false>(in, out, count, last, gain); }
+            }
+
+            void phaseAll(const complex_t* in, float* out, int count, PolarAccuracy accuracy) {
+                if (accuracy == POLAR_ACCURACY_FAST) { phase<true>(in, out, count); }
+                else { phase<false>(in, out, count); }
+            }
+
+            const Implementation impl = { "neon", discriminateAll, phaseAll, magnitude, normalize };
+        }
+#endif
+
+        const Implementation& select() {
+#if defined(POLAR_KERNEL_X86)
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) { return avx2::impl; }
+            return sse2::impl;
+#elif defined(POLAR_KERNEL_NEON)
+            return neon::impl;
+#endif
+            return generic::impl;
+        }
+
+        const Implementation& impl() {
+            static const Implementation& selected = []() -> const Implementation& {
+                const Implementation& i = select();
+                flog::info("[DSP] Using {0} polar kernels", i.name);
+                return i;
+            }();
+            return selected;
+        }
+    }
+
+    const char* getImplementation() {
+        return impl().name;
+    }
+
+    void discriminate(const complex_t* in, float* out, int count, complex_t& last, float gain, PolarAccuracy accuracy) {
+        if (count <= 0) { return; }
+        impl().discriminate(in, out, count, last, gain, accuracy);
+    }
+
+    void phase(const complex_t* in, float* out, int count, PolarAccuracy accuracy) {
+        impl().phase(in, out, count, accuracy);
+    }
+
+    void magnitude(const complex_t* in, float* out, int count) {
+        impl().magnitude(in, out, count);
+    }
+
+    void normalize(const complex_t* in, complex_t* out, int count) {
+        impl().normalize(in, out, count);
+    }
+}
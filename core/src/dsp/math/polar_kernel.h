@@ -0,0 +1,28 @@
+#pragma once
+#include "../types.h"
+
+namespace dsp::math {
+    enum PolarAccuracy {
+        POLAR_ACCURACY_HIGH,    // Within 2e-6 rad of atan2f
+        POLAR_ACCURACY_FAST     // Within 1.6e-3 rad, enough for FSK slicers and voice
+    };
+
+    // Vectorised polar conversions. The implementation (AVX2, SSE2, NEON or generic) is picked once at
+    // runtime from what the CPU supports, they all use the same approximations and only differ by rounding.
+    namespace polar {
+        // Name of the implementation in use
+        const char* getImplementation();
+
+        // out[i] = arg(in[i] * conj(in[i-1])) * gain, last holds in[-1] and is updated to the last sample
+        void discriminate(const complex_t* in, float* out, int count, complex_t& last, float gain, PolarAccuracy accuracy);
+
+        // out[i] = arg(in[i])
+        void phase(const complex_t* in, float* out, int count, PolarAccuracy accuracy);
+
+        // out[i] = |in[i]|
+        void magnitude(const complex_t* in, float* out, int count);
+
+        // out[i] = in[i] / |in[i]|, zero samples stay zero
+        void normalize(const complex_t* in, complex_t* out, int count);
+    }
+}
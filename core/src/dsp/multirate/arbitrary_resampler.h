@@ -0,0 +1,169 @@
+#pragma once
+#include <atomic>
+#include "../processor.h"
+#include "../taps/low_pass.h"
+#include "polyphase_bank.h"
+
+// Number of polyphase branches, the output is linearly interpolated between two neighbouring ones
+#define ARBITRARY_RESAMPLER_PHASES  128
+
+namespace dsp::multirate {
+    // Resampler for any ratio, including irrational ones. Unlike the rational polyphase resampler,
+    // the size of the filter bank does not depend on the ratio, and the ratio can be changed on the
+    // fly without resetting the filter (eg. to correct for clock drift).
+    template<class T>
+    class ArbitraryResampler : public Processor<T, T> {
+        using base_type = Processor<T, T>;
+    public:
+        ArbitraryResampler() {}
+
+        ArbitraryResampler(stream<T>* in, double inSamplerate, double outSamplerate) { init(in, inSamplerate, outSamplerate); }
+
+        ~ArbitraryResampler() {
+            if (!base_type::_block_init) { return; }
+            base_type::stop();
+            buffer::free(buffer);
+            freePolyphaseBank(phases);
+        }
+
+        void init(stream<T>* in, double inSamplerate, double outSamplerate) {
+            _inSamplerate = inSamplerate;
+            _outSamplerate = outSamplerate;
+            step = _inSamplerate / _outSamplerate;
+
+            // Build filter bank
+            buildBank();
+
+            // Allocate delay buffer
+            buffer = buffer::alloc<T>(STREAM_BUFFER_SIZE + 64000);
+            bufStart = &buffer[phases.tapsPerPhase - 1];
+            buffer::clear<T>(buffer, phases.tapsPerPhase - 1);
+
+            base_type::init(in);
+        }
+
+        void setRates(double inSamplerate, double outSamplerate) {
+            assert(base_type::_block_init);
+            std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
+            base_type::tempStop();
+            _inSamplerate = inSamplerate;
+            _outSamplerate = outSamplerate;
+            step = _inSamplerate / _outSamplerate;
+
+            // Re-generate polyphase bank
+            freePolyphaseBank(phases);
+            buildBank();
+
+            // Reset buffer
+            bufStart = &buffer[phases.tapsPerPhase - 1];
+            reset();
+
+            base_type::tempStart();
+        }
+
+        // Slightly change the ratio without touching the filter, can be called from any thread
+        // while running. Meant for small corrections, the filter is still designed for the rates
+        // given to init() or setRates().
+        void setCorrection(double ppm) {
+            step = (_inSamplerate / _outSamplerate) * (1.0 + ppm * 1e-6);
+        }
+
+        void reset() {
+            assert(base_type::_block_init);
+            std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
+            base_type::tempStop();
+            buffer::clear<T>(buffer, phases.tapsPerPhase - 1);
+            mu = 0.0;
+            offset = 0;
+            base_type::tempStart();
+        }
+
+        inline int process(int count, const T* in, T* out) {
+            int outCount = 0;
+            double _step = step;
+
+            // Copy input to buffer
+            memcpy(bufStart, in, count * sizeof(T));
+
+            while (offset < count) {
+                // Find the two phases surrounding the fractional position
+                double pos = mu * (double)ARBITRARY_RESAMPLER_PHASES;
+                int phase = (int)pos;
+                float frac = (float)(pos - (double)phase);
+
+                T a, b;
+                if constexpr (std::is_same_v<T, float>) {
+                    volk_32f_x2_dot_prod_32f(&a, &buffer[offset], phases.phases[phase], phases.tapsPerPhase);
+                    volk_32f_x2_dot_prod_32f(&b, &buffer[offset], phases.phases[phase + 1], phases.tapsPerPhase);
+                }
+                if constexpr (std::is_same_v<T, complex_t> || std::is_same_v<T, stereo_t>) {
+                    volk_32fc_32f_dot_prod_32fc((lv_32fc_t*)&a, (lv_32fc_t*)&buffer[offset], phases.phases[phase], phases.tapsPerPhase);
+                    volk_32fc_32f_dot_prod_32fc((lv_32fc_t*)&b, (lv_32fc_t*)&buffer[offset], phases.phases[phase + 1], phases.tapsPerPhase);
+                }
+                out[outCount++] = a * (1.0f - frac) + b * frac;
+
+                // Advance by the ratio, keeping the fractional part
+                mu += _step;
+                int adv = (int)mu;
+                offset += adv;
+                mu -= (double)adv;
+            }
+            offset -= count;
+
+            // Move delay
+            memmove(buffer, &buffer[count], (phases.tapsPerPhase - 1) * sizeof(T));
+
+            return outCount;
+        }
+
+        int run() {
+            int count = base_type::_in->read();
+            if (count < 0) { return -1; }
+
+            int outCount = process(count, base_type::_in->readBuf, base_type::out.writeBuf);
+
+            // Swap if some data was generated
+            base_type::_in->flush();
+            if (outCount) {
+                if (!base_type::out.swap(outCount)) { return -1; }
+            }
+            return outCount;
+        }
+
+    protected:
+        void buildBank() {
+            // Prototype filter running at the rate of the input upsampled by the phase count
+            double tapSamplerate = _inSamplerate * (double)ARBITRARY_RESAMPLER_PHASES;
+            double tapBandwidth = std::min<double>(_inSamplerate, _outSamplerate) / 2.0;
+            tap<float> proto = taps::lowPass(tapBandwidth, tapBandwidth * 0.1, tapSamplerate);
+
+            // Phase p advances by p/PHASES of a sample. An extra phase, the first one advanced by a full
+            // sample, is added so that the last phase has a neighbour to interpolate with (its first tap
+            // would apply to the next sample, it's left out since the window makes it practically zero).
+            // Each phase is stored reversed so that it can be used with a forward dot product.
+            int phaseCount = ARBITRARY_RESAMPLER_PHASES + 1;
+            phases.phaseCount = phaseCount;
+            phases.tapsPerPhase = (proto.size + ARBITRARY_RESAMPLER_PHASES - 1) / ARBITRARY_RESAMPLER_PHASES;
+            phases.phases = buffer::alloc<float*>(phaseCount);
+            for (int p = 0; p < phaseCount; p++) {
+                phases.phases[p] = buffer::alloc<float>(phases.tapsPerPhase);
+                for (int k = 0; k < phases.tapsPerPhase; k++) {
+                    int id = p + k * ARBITRARY_RESAMPLER_PHASES;
+                    float val = (id < proto.size) ? proto.taps[id] * (float)ARBITRARY_RESAMPLER_PHASES : 0.0f;
+                    phases.phases[p][phases.tapsPerPhase - 1 - k] = val;
+                }
+            }
+
+            taps::free(proto);
+        }
+
+        double _inSamplerate;
+        double _outSamplerate;
+        std::atomic<double> step;
+        PolyphaseBank<float> phases;
+        double mu = 0.0;
+        int offset = 0;
+        T* buffer;
+        T* bufStart;
+    };
+}
@@ -5,10 +5,14 @@
 #include "../filter/decimating_fir.h"
 #include "../taps/from_array.h"
 #include "polyphase_resampler.h"
+#include "arbitrary_resampler.h"
 #include "power_decimator.h"
 #include "../taps/low_pass.h"
 #include "../window/nuttall.h"
 
+// Above this interpolation factor, the arbitrary resampler is used instead of an exact polyphase one
+#define RATIONAL_RESAMPLER_MAX_INTERP   64
+
 namespace dsp::multirate {
     template<class T>
     class RationalResampler : public Processor<T, T> {
@@ -32,9 +36,11 @@ namespace dsp::multirate {
             rtaps = taps::lowPass(0.25, 0.1, 1.0);
             decim.init(NULL, 2);
             resamp.init(NULL, 1, 1, rtaps);
+            arbResamp.init(NULL, 2.0, 1.0);
 
             decim.out.free();
             resamp.out.free();
+            arbResamp.out.free();
 
             // Proper configuration
             reconfigure();
@@ -48,6 +54,7 @@ namespace dsp::multirate {
             base_type::tempStop();
             decim.reset();
             resamp.reset();
+            arbResamp.reset();
             base_type::tempStart();
         }
 
@@ -79,15 +86,31 @@ namespace dsp::multirate {
             base_type::tempStart();
         }
 
+        // Correct the output rate by a small amount (eg. clock drift). The change is smooth once the
+        // arbitrary resampler is in use, the first non-zero correction may switch to it.
+        void setCorrection(double ppm) {
+            assert(base_type::_block_init);
+            std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
+            _correction = ppm;
+            if (useArbitrary) {
+                arbResamp.setCorrection(_correction);
+                return;
+            }
+            if (_correction == 0.0) { return; }
+            base_type::tempStop();
+            reconfigure();
+            base_type::tempStart();
+        }
+
         inline int process(int count, const T* in, T* out) {
             switch(mode) {
                 case Mode::BOTH:
                     count = decim.process(count, in, out);
-                    return resamp.process(count, out, out);
+                    return resample(count, out, out);
                 case Mode::DECIM_ONLY:
                     return decim.process(count, in, out);
                 case Mode::RESAMP_ONLY:
-                    return resamp.process(count, in, out);
+                    return resample(count, in, out);
                 case Mode::NONE:
                     memcpy(out, in, count * sizeof(T));
                     return count;
@@ -136,20 +159,25 @@ namespace dsp::multirate {
             int gcd = std::gcd(IntSR, OutSR);
             int interp = OutSR / gcd;
             int decim = IntSR / gcd;
-
-            // Check for excessive error
-            double actualOutSR = (double)IntSR * (double)interp / (double)decim;
-            double error = abs((actualOutSR - _outSamplerate) / _outSamplerate) * 100.0;
-            if (error > 0.01) {
-                fprintf(stderr, "Warning: resampling error is over 0.01%%: %lf\n", error);
-            }
+            bool exact = (IntSR == intSamplerate && OutSR == _outSamplerate && _correction == 0.0);
             
             // If the power decimator already did all the work, don't use the resampler
-            if (interp == decim) {
+            if (interp == decim && exact) {
+                useArbitrary = false;
                 mode = useDecim ? Mode::DECIM_ONLY : Mode::NONE;
                 return;
             }
 
+            // Awkward or inexact ratios would need a huge polyphase bank, use the arbitrary resampler
+            useArbitrary = (!exact || interp > RATIONAL_RESAMPLER_MAX_INTERP);
+            if (useArbitrary) {
+                arbResamp.setRates(intSamplerate, _outSamplerate);
+                arbResamp.setCorrection(_correction);
+                printf("[Resamp] predec: %d, arbitrary: %lf -> %lf\n", predecRatio, intSamplerate, _outSamplerate);
+                mode = useDecim ? Mode::BOTH : Mode::RESAMP_ONLY;
+                return;
+            }
+
             // Configure the polyphase resampler
             double tapSamplerate = intSamplerate * (double)interp;
             double tapBandwidth = std::min<double>(_inSamplerate, _outSamplerate) / 2.0;
@@ -159,16 +187,23 @@ namespace dsp::multirate {
             for (int i = 0; i < rtaps.size; i++) { rtaps.taps[i] *= (float)interp; }
             resamp.setRatio(interp, decim, rtaps);
 
-            printf("[Resamp] predec: %d, interp: %d, decim: %d, inacc: %lf%%, taps: %d\n", predecRatio, interp, decim, error, rtaps.size);
+            printf("[Resamp] predec: %d, interp: %d, decim: %d, taps: %d\n", predecRatio, interp, decim, rtaps.size);
 
             mode = useDecim ? Mode::BOTH : Mode::RESAMP_ONLY;
         }
         
+        inline int resample(int count, const T* in, T* out) {
+            return useArbitrary ? arbResamp.process(count, in, out) : resamp.process(count, in, out);
+        }
+        
         PowerDecimator<T> decim;
         PolyphaseResampler<T> resamp;
+        ArbitraryResampler<T> arbResamp;
         tap<float> rtaps;
         double _inSamplerate;
         double _outSamplerate;
+        double _correction = 0.0;
+        bool useArbitrary = false;
         Mode mode;
     };
 }
\ No newline at end of file
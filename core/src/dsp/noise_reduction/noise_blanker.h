@@ -1,5 +1,6 @@
 #pragma once
 #include "../processor.h"
+#include "../math/polar_kernel.h"
 
 namespace dsp::noise_reduction {
     class NoiseBlanker : public Processor<complex_t, complex_t> {
@@ -9,10 +10,18 @@ namespace dsp::noise_reduction {
 
         NoiseBlanker(stream<complex_t>* in, double rate, double level) { init(in, rate, level); }
 
+        ~NoiseBlanker() {
+            if (!base_type::_block_init) { return; }
+            base_type::stop();
+            buffer::free(amps);
+        }
+
         void init(stream<complex_t>* in, double rate, double level) {
             _rate = rate;
             _invRate = 1.0f - _rate;
             _level = level;
+            // init() may be called again on the same block
+            if (!amps) { amps = buffer::alloc<float>(STREAM_BUFFER_SIZE); }
             base_type::init(in);
         }
 
@@ -36,9 +45,12 @@ namespace dsp::noise_reduction {
         }
 
         inline int process(int count, complex_t* in, complex_t* out) {
+            // Compute all amplitudes at once, the loop below depends on the previous sample
+            math::polar::magnitude(in, amps, count);
+
             for (int i = 0; i < count; i++) {
                 // Get signal amplitude
-                float inAmp = in[i].amplitude();
+                float inAmp = amps[i];
 
                 // Update average amplitude
                 float gain = 1.0f;
@@ -73,6 +85,7 @@ namespace dsp::noise_reduction {
         float _level;
 
         float amp = 1.0;
+        float* amps = NULL;
 
     };
 }
\ No newline at end of file
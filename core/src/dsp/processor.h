@@ -51,6 +51,7 @@ namespace dsp {
             _in = in;
             registerInput(_in);
             registerOutput(&out);
+            poolable = true;
             _block_init = true;
         }
 
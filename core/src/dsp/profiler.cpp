@@ -0,0 +1,178 @@
+#include "profiler.h"
+#include "block.h"
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <algorithm>
+#include <typeinfo>
+#include <math.h>
+#include <utils/flog.h>
+#include <utils/thread_role.h>
+#ifdef __GNUC__
+#include <cxxabi.h>
+#include <stdlib.h>
+#endif
+
+namespace dsp::profiler {
+    namespace {
+        struct Entry {
+            uint64_t serial;
+            std::string name;
+        };
+
+        std::atomic<bool> enabled(false);
+
+        std::mutex regMtx;
+        std::map<block*, Entry> blocks;
+        uint64_t nextSerial = 0;
+
+        std::mutex logMtx;
+        std::condition_variable logCnd;
+        bool stopLog = false;
+
+        // Joins the log thread on exit, whichever way main returns
+        struct LogThread {
+            ~LogThread() { stopLogging(); }
+            std::thread thread;
+        } logThread;
+
+        // Name of the block class, for blocks that weren't given a profile name
+        std::string typeName(block* blk) {
+            const char* raw = typeid(*blk).name();
+#ifdef __GNUC__
+            int status;
+            char* demangled = abi::__cxa_demangle(raw, NULL, NULL, &status);
+            if (status == 0 && demangled) {
+                std::string name = demangled;
+                ::free(demangled);
+                return name;
+            }
+#endif
+            return raw;
+        }
+
+        void logWorker(int intervalSec) {
+            thread_role::apply(THREAD_ROLE_BACKGROUND, "profiler");
+            Sampler sampler;
+            sampler.sample();
+            std::unique_lock<std::mutex> lck(logMtx);
+            while (!logCnd.wait_for(lck, std::chrono::seconds(intervalSec), [] { return stopLog; })) {
+                std::vector<BlockInfo> infos = sampler.sample();
+                std::sort(infos.begin(), infos.end(), [](const BlockInfo& a, const BlockInfo& b) { return a.load > b.load; });
+                flog::info("[Profiler] {0} blocks running", (int)infos.size());
+                for (auto& info : infos) {
+                    flog::info("[Profiler] {0}: load {1}%, wait {2}%, {3} kS/s, {4} runs/s, {5} full", info.name, (int)round(info.load * 100.0),
+                               (int)round(info.waitLoad * 100.0), (int)round(info.sampleRate / 1e3), (int)round(info.runRate), info.queueFull);
+                }
+            }
+        }
+    }
+
+    void setEnabled(bool en) {
+        enabled.store(en, std::memory_order_relaxed);
+    }
+
+    bool isEnabled() {
+        return enabled.load(std::memory_order_relaxed);
+    }
+
+    int64_t now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    void registerBlock(block* blk) {
+        std::string name = blk->getProfileName();
+        if (name.empty()) { name = typeName(blk); }
+        std::lock_guard<std::mutex> lck(regMtx);
+        blocks[blk] = { nextSerial++, name };
+    }
+
+    void unregisterBlock(block* blk) {
+        std::lock_guard<std::mutex> lck(regMtx);
+        blocks.erase(blk);
+    }
+
+    std::vector<BlockInfo> Sampler::sample() {
+        int64_t time = now();
+        if (lastTime && time - lastTime < PROFILER_MIN_INTERVAL_NS) { return last; }
+        double elapsed = (double)(time - lastTime) / 1e9;
+        bool first = !lastTime;
+        lastTime = time;
+
+        std::vector<BlockInfo> infos;
+        std::map<uint64_t, Previous> current;
+        {
+            // Registered blocks can't be destroyed until their worker thread unregisters them
+            std::lock_guard<std::mutex> lck(regMtx);
+            for (auto& [blk, entry] : blocks) {
+                BlockInfo info;
+                info.name = entry.name;
+                size_t sep = entry.name.find('/');
+                info.group = (sep != std::string::npos) ? entry.name.substr(0, sep) : "Other";
+
+                Previous cur;
+                cur.runTime = blk->profStats.runTime.load(std::memory_order_relaxed);
+                cur.runs = blk->profStats.runs.load(std::memory_order_relaxed);
+                cur.wait = 0;
+                cur.queueFull = 0;
+                for (auto& in : blk->getInputs()) {
+                    info.inputs.push_back(in);
+                    cur.wait += in->stats.readWait.load(std::memory_order_relaxed);
+                }
+                for (auto& out : blk->getOutputs()) {
+                    info.outputs.push_back(out);
+                    cur.wait += out->stats.writeWait.load(std::memory_order_relaxed);
+                    cur.queueFull += out->stats.fullEvents.load(std::memory_order_relaxed);
+                }
+                untyped_stream* rateStream = !blk->getInputs().empty() ? blk->getInputs()[0] : (!blk->getOutputs().empty() ? blk->getOutputs()[0] : NULL);
+                cur.samples = rateStream ? rateStream->stats.samples.load(std::memory_order_relaxed) : 0;
+                current[entry.serial] = cur;
+
+                // Blocks that started since the last sample only get counted from the next one
+                auto it = previous.find(entry.serial);
+                if (!first && it != previous.end() && elapsed > 0.0) {
+                    const Previous& prev = it->second;
+                    double runTime = (double)(cur.runTime - prev.runTime) / 1e9;
+                    double wait = (double)(cur.wait - prev.wait) / 1e9;
+                    info.load = std::clamp((runTime - wait) / elapsed, 0.0, 1.0);
+                    info.waitLoad = std::clamp(wait / elapsed, 0.0, 1.0);
+                    info.sampleRate = (double)(cur.samples - prev.samples) / elapsed;
+                    info.runRate = (double)(cur.runs - prev.runs) / elapsed;
+                    info.queueFull = cur.queueFull - prev.queueFull;
+                }
+                infos.push_back(info);
+            }
+        }
+        previous = std::move(current);
+
+        // Link the blocks through the streams they share
+        for (auto& info : infos) {
+            for (auto& out : info.outputs) {
+                for (int i = 0; i < infos.size(); i++) {
+                    const auto& ins = infos[i].inputs;
+                    if (std::find(ins.begin(), ins.end(), out) != ins.end()) { info.consumers.push_back(i); }
+                }
+            }
+        }
+
+        last = infos;
+        return infos;
+    }
+
+    void startLogging(int intervalSec) {
+        stopLogging();
+        setEnabled(true);
+        stopLog = false;
+        logThread.thread = std::thread(logWorker, std::max<int>(intervalSec, 1));
+    }
+
+    void stopLogging() {
+        {
+            std::lock_guard<std::mutex> lck(logMtx);
+            stopLog = true;
+        }
+        logCnd.notify_all();
+        if (logThread.thread.joinable()) { logThread.thread.join(); }
+    }
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <atomic>
+#include <string>
+#include <vector>
+#include <map>
+#include <stdint.h>
+
+// Minimum time between two samples of the block counters
+#define PROFILER_MIN_INTERVAL_NS    100000000
+
+namespace dsp {
+    class block;
+    class untyped_stream;
+
+    namespace profiler {
+        // Counters of a block, only updated while the profiler is enabled
+        struct block_stats {
+            std::atomic<uint64_t> runTime{0};   // Time spent in run(), including the waits on the streams, in ns
+            std::atomic<uint64_t> runs{0};
+        };
+
+        // Counters of a stream, waits are only timed when the caller actually has to block
+        struct stream_stats {
+            std::atomic<uint64_t> samples{0};       // Samples swapped by the writer
+            std::atomic<uint64_t> readWait{0};      // Time the reader waited for data, in ns
+            std::atomic<uint64_t> writeWait{0};     // Time the writer waited for the reader to be done, in ns
+            std::atomic<uint64_t> fullEvents{0};    // Swaps that found the previous buffer still in use
+        };
+
+        struct BlockInfo {
+            std::string name;
+            std::string group;                      // Part of the name before the first '/', "Other" if none
+            std::vector<const untyped_stream*> inputs;
+            std::vector<const untyped_stream*> outputs;
+            std::vector<int> consumers;             // Indices of the blocks reading one of the outputs
+            double load = 0.0;                      // Fraction of the time spent processing
+            double waitLoad = 0.0;                  // Fraction of the time spent waiting on the streams
+            double sampleRate = 0.0;                // Samples per second on the first input, or first output for sources
+            double runRate = 0.0;                   // Calls to run() per second
+            uint64_t queueFull = 0;                 // Output swaps that had to wait for the reader
+        };
+
+        void setEnabled(bool enabled);
+        bool isEnabled();
+
+        // Steady clock in ns, used for all timestamps of the profiler
+        int64_t now();
+
+        // Called by the worker thread of the blocks when it starts and exits
+        void registerBlock(block* blk);
+        void unregisterBlock(block* blk);
+
+        // Keeps the counters of the previous sample, each user of the profiler must have its own
+        class Sampler {
+        public:
+            // Blocks running since the previous call with their load over that interval.
+            // Returns the previous result if called again in less than PROFILER_MIN_INTERVAL_NS.
+            std::vector<BlockInfo> sample();
+
+        private:
+            struct Previous {
+                uint64_t runTime;
+                uint64_t wait;
+                uint64_t samples;
+                uint64_t runs;
+                uint64_t queueFull;
+            };
+
+            std::map<uint64_t, Previous> previous;
+            std::vector<BlockInfo> last;
+            int64_t lastTime = 0;
+        };
+
+        // Log the load of the blocks every intervalSec seconds, used by --profile
+        void startLogging(int intervalSec);
+        void stopLogging();
+    }
+}
@@ -14,6 +14,7 @@ namespace dsp::routing {
             base_type::registerOutput(&outA);
             base_type::registerOutput(&outB);
             base_type::init(in);
+            base_type::poolable = true;
         }
 
         int run() {
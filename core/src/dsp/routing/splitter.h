@@ -8,7 +8,12 @@ namespace dsp::routing {
     public:
         Splitter() {}
 
-        Splitter(stream<T>* in) { base_type::init(in); }
+        Splitter(stream<T>* in) { init(in); }
+
+        void init(stream<T>* in) {
+            base_type::init(in);
+            base_type::poolable = true;
+        }
 
         void bindStream(stream<T>* stream) {
             assert(base_type::_block_init);
@@ -0,0 +1,136 @@
+#include "scheduler.h"
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <utils/flog.h>
+#include <utils/thread_role.h>
+
+namespace dsp::scheduler {
+    namespace {
+        struct Worker {
+            std::mutex mtx;
+            std::deque<task*> queue;
+            std::thread thread;
+        };
+
+        // Fixed pool of workers each with their own queue, idle workers steal from the others
+        class Pool {
+        public:
+            Pool(int count) {
+                for (int i = 0; i < count; i++) {
+                    workers.push_back(std::make_unique<Worker>());
+                }
+                for (int i = 0; i < count; i++) {
+                    workers[i]->thread = std::thread(&Pool::worker, this, i);
+                }
+                flog::info("[Scheduler] Started pool with {0} workers", count);
+            }
+
+            void push(task* t) {
+                int id = (current >= 0) ? current : (int)(next.fetch_add(1, std::memory_order_relaxed) % workers.size());
+                pending.fetch_add(1);
+                {
+                    std::lock_guard<std::mutex> lck(workers[id]->mtx);
+                    workers[id]->queue.push_back(t);
+                }
+
+                // Only go through the sleep mutex when a worker might be waiting
+                if (sleeping.load()) {
+                    { std::lock_guard<std::mutex> lck(sleepMtx); }
+                    sleepCnd.notify_one();
+                }
+            }
+
+        private:
+            // Own queue from the back to stay in cache, other queues from the front
+            task* pop(int id) {
+                {
+                    std::lock_guard<std::mutex> lck(workers[id]->mtx);
+                    auto& queue = workers[id]->queue;
+                    if (!queue.empty()) {
+                        task* t = queue.back();
+                        queue.pop_back();
+                        return t;
+                    }
+                }
+                for (int i = 1; i < workers.size(); i++) {
+                    Worker& victim = *workers[(id + i) % workers.size()];
+                    std::lock_guard<std::mutex> lck(victim.mtx);
+                    if (!victim.queue.empty()) {
+                        task* t = victim.queue.front();
+                        victim.queue.pop_front();
+                        return t;
+                    }
+                }
+                return NULL;
+            }
+
+            void worker(int id) {
+                current = id;
+                thread_role::apply(THREAD_ROLE_DSP_BULK, "dsp-pool-" + std::to_string(id));
+                while (true) {
+                    task* t = pop(id);
+                    if (t) {
+                        pending.fetch_sub(1);
+                        t->execute();
+                        continue;
+                    }
+
+                    std::unique_lock<std::mutex> lck(sleepMtx);
+                    sleeping.fetch_add(1);
+                    sleepCnd.wait(lck, [this]() { return pending.load() > 0; });
+                    sleeping.fetch_sub(1);
+                }
+            }
+
+            std::vector<std::unique_ptr<Worker>> workers;
+            std::atomic<unsigned int> next{0};
+            std::atomic<int> pending{0};
+            std::atomic<int> sleeping{0};
+            std::mutex sleepMtx;
+            std::condition_variable sleepCnd;
+
+            static thread_local int current;
+        };
+
+        thread_local int Pool::current = -1;
+
+        std::atomic<bool> enabled(false);
+        int workerCount = 0;
+        std::once_flag poolInit;
+
+        // Never destroyed, blocks may still be stopping while the statics get destroyed on exit
+        Pool* pool = NULL;
+    }
+
+    void setEnabled(bool en) {
+        enabled = en;
+    }
+
+    bool isEnabled() {
+        return enabled;
+    }
+
+    void setWorkerCount(int count) {
+        if (pool) {
+            flog::warn("[Scheduler] Worker count changed after the pool was started, ignoring");
+            return;
+        }
+        workerCount = count;
+    }
+
+    int getWorkerCount() {
+        if (workerCount > 0) { return workerCount; }
+        return std::max<int>(std::thread::hardware_concurrency(), 1);
+    }
+
+    void schedule(task* t) {
+        std::call_once(poolInit, []() { pool = new Pool(getWorkerCount()); });
+        pool->push(t);
+    }
+}
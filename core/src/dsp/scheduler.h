@@ -0,0 +1,28 @@
+#pragma once
+
+namespace dsp {
+    // Work that can be run by the scheduler pool, implemented by the blocks
+    class task {
+    public:
+        virtual ~task() {}
+
+        // Called by the streams when the task may be able to make progress, must not block
+        virtual void wake() = 0;
+
+        // Called by a pool worker after the task was given to schedule()
+        virtual void execute() = 0;
+    };
+
+    namespace scheduler {
+        // Blocks that support it run on the pool instead of their own thread, only affects blocks started afterwards
+        void setEnabled(bool enabled);
+        bool isEnabled();
+
+        // Number of pool workers, defaults to the number of cores. Must be set before the pool is first used.
+        void setWorkerCount(int count);
+        int getWorkerCount();
+
+        // Queue the task on the pool, tasks scheduled from a worker go to its own queue first
+        void schedule(task* t);
+    }
+}
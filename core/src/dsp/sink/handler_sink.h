@@ -16,6 +16,11 @@ namespace dsp::sink {
             base_type::init(in);
         }
 
+        // Metadata of the block being handled, only valid from within the handler
+        stream_meta getMeta() {
+            return base_type::_in->getMeta();
+        }
+
         int run() {
             int count = base_type::_in->read();
             if (count < 0) { return -1; }
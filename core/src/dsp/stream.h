@@ -1,17 +1,38 @@
 #pragma once
 #include <string.h>
+#include <stdint.h>
 #include <mutex>
 #include <condition_variable>
 #include <volk/volk.h>
 #include "buffer/buffer.h"
+#include "profiler.h"
+#include "scheduler.h"
+#include <atomic>
 
 // 1MSample buffer
 #define STREAM_BUFFER_SIZE 1000000
 
+// Stream metadata flags
+#define STREAM_META_VALID           (1 << 0)    // Timing information was filled in by the source
+#define STREAM_META_GPS_TIME        (1 << 1)    // utcTime is disciplined by the GPS
+#define STREAM_META_DISCONTINUITY   (1 << 2)    // Samples were lost right before this block
+
 namespace dsp {
+    // Timing of the first sample of a block. Blocks that change the sample rate pass it through
+    // unchanged, so sampleIndex is always counted at the source sample rate.
+    struct stream_meta {
+        uint64_t sampleIndex = 0;   // Index of the first sample since the source was started
+        double sampleRate = 0.0;    // Sample rate of the source
+        int64_t sourceTime = 0;     // Steady clock time of the first sample, in ns
+        int64_t utcTime = 0;        // UTC estimate of the first sample, in ns since the epoch
+        uint32_t flags = 0;
+    };
+
     class untyped_stream {
     public:
         virtual ~untyped_stream() {}
+        virtual stream_meta getMeta() { return stream_meta(); }
+        virtual void setMetaSource(untyped_stream* source) {}
         virtual bool swap(int size) { return false; }
         virtual int read() { return -1; }
         virtual void flush() {}
@@ -19,6 +40,36 @@ namespace dsp {
         virtual void clearWriteStop() {}
         virtual void stopReader() {}
         virtual void clearReadStop() {}
+
+        // Used by the scheduler, true if read() or swap() wouldn't block
+        virtual bool readable() { return false; }
+        virtual bool writable() { return false; }
+
+        // Pooled blocks get woken up when the stream has data for them or can take their output
+        void setReaderTask(task* t) {
+            std::lock_guard<std::mutex> lck(taskMtx);
+            readerTask = t;
+        }
+
+        void setWriterTask(task* t) {
+            std::lock_guard<std::mutex> lck(taskMtx);
+            writerTask = t;
+        }
+
+        profiler::stream_stats stats;
+
+    protected:
+        inline void wakeTask(std::atomic<task*>& t) {
+            // Checking first avoids the mutex when no pooled block uses the stream
+            if (!t.load(std::memory_order_relaxed)) { return; }
+            std::lock_guard<std::mutex> lck(taskMtx);
+            task* current = t.load(std::memory_order_relaxed);
+            if (current) { current->wake(); }
+        }
+
+        std::mutex taskMtx;
+        std::atomic<task*> readerTask{NULL};
+        std::atomic<task*> writerTask{NULL};
     };
 
     template <class T>
@@ -44,11 +95,29 @@ namespace dsp {
             {
                 // Wait to either swap or stop
                 std::unique_lock<std::mutex> lck(swapMtx);
+                bool timed = (!canSwap && !writerStop && profiler::isEnabled());
+                int64_t start = timed ? profiler::now() : 0;
                 swapCV.wait(lck, [this] { return (canSwap || writerStop); });
 
                 // If writer was stopped, abandon operation
                 if (writerStop) { return false; }
 
+                // The reader is still busy with the previous buffer
+                if (timed) {
+                    stats.writeWait.fetch_add(profiler::now() - start, std::memory_order_relaxed);
+                    stats.fullEvents.fetch_add(1, std::memory_order_relaxed);
+                }
+                stats.samples.fetch_add(size, std::memory_order_relaxed);
+
+                // Take the metadata given by the writer, or forward the one of its input
+                if (writeMetaSet) {
+                    readMeta = writeMeta;
+                    writeMetaSet = false;
+                }
+                else if (metaSource) {
+                    readMeta = metaSource->getMeta();
+                }
+
                 // Swap buffers
                 dataSize = size;
                 T* temp = writeBuf;
@@ -63,6 +132,7 @@ namespace dsp {
                 dataReady = true;
             }
             rdyCV.notify_all();
+            wakeTask(readerTask);
 
             return true;
         }
@@ -70,9 +140,32 @@ namespace dsp {
         virtual inline int read() {
             // Wait for data to be ready or to be stopped
             std::unique_lock<std::mutex> lck(rdyMtx);
+            bool timed = (!dataReady && !readerStop && profiler::isEnabled());
+            int64_t start = timed ? profiler::now() : 0;
             rdyCV.wait(lck, [this] { return (dataReady || readerStop); });
+            if (readerStop) { return -1; }
+            if (timed) { stats.readWait.fetch_add(profiler::now() - start, std::memory_order_relaxed); }
+
+            // Keep a copy so that it stays valid until the next read even once the writer swaps again
+            meta = readMeta;
+            return dataSize;
+        }
+
+        // Set the metadata of the next block, must be called by the writer before swap()
+        inline void setMeta(const stream_meta& meta) {
+            writeMeta = meta;
+            writeMetaSet = true;
+        }
+
+        // Metadata of the block returned by the last read(), must only be called by the reader
+        virtual stream_meta getMeta() {
+            return meta;
+        }
 
-            return (readerStop ? -1 : dataSize);
+        // Stream whose current metadata is forwarded when the writer doesn't set any
+        virtual void setMetaSource(untyped_stream* source) {
+            std::lock_guard<std::mutex> lck(swapMtx);
+            metaSource = source;
         }
 
         virtual inline void flush() {
@@ -89,6 +182,17 @@ namespace dsp {
             }
 
             swapCV.notify_all();
+            wakeTask(writerTask);
+        }
+
+        virtual bool readable() {
+            std::lock_guard<std::mutex> lck(rdyMtx);
+            return dataReady;
+        }
+
+        virtual bool writable() {
+            std::lock_guard<std::mutex> lck(swapMtx);
+            return canSwap;
         }
 
         virtual void stopWriter() {
@@ -138,5 +242,11 @@ namespace dsp {
         bool writerStop = false;
 
         int dataSize = 0;
+
+        stream_meta writeMeta;
+        bool writeMetaSet = false;
+        stream_meta readMeta;
+        stream_meta meta;
+        untyped_stream* metaSource = NULL;
     };
 }
\ No newline at end of file
@@ -0,0 +1,115 @@
+#include "tap_cache.h"
+#include "../types.h"
+#include "low_pass.h"
+#include "high_pass.h"
+#include "band_pass.h"
+#include <algorithm>
+#include <utils/thread_role.h>
+
+namespace dsp::taps {
+    TapCache cache;
+
+    TapCache::~TapCache() {
+        {
+            std::lock_guard<std::mutex> lck(mtx);
+            stopWorker = true;
+        }
+        cnd.notify_all();
+        if (workerThread.joinable()) { workerThread.join(); }
+    }
+
+    SharedTaps TapCache::get(const TapDesign& design) {
+        SharedTaps taps = lookup(design);
+        if (taps) { return taps; }
+        taps = build(design);
+        insert(design, taps);
+        return taps;
+    }
+
+    SharedTaps TapCache::request(const TapDesign& design) {
+        SharedTaps taps = lookup(design);
+        if (taps) { return taps; }
+
+        std::lock_guard<std::mutex> lck(mtx);
+        bool queued = std::find(queue.begin(), queue.end(), design) != queue.end();
+        if (!queued && !(designing && current == design)) {
+            queue.push_back(design);
+        }
+        if (!workerThread.joinable()) {
+            workerThread = std::thread(&TapCache::worker, this);
+        }
+        cnd.notify_one();
+        return NULL;
+    }
+
+    void TapCache::clear() {
+        std::lock_guard<std::mutex> lck(mtx);
+        entries.clear();
+        lru.clear();
+    }
+
+    SharedTaps TapCache::build(const TapDesign& design) {
+        tap<float> taps;
+        switch (design.type) {
+        case TAP_TYPE_LOW_PASS:
+            taps = lowPass(design.cutoff, design.transWidth, design.samplerate, design.oddTapCount);
+            break;
+        case TAP_TYPE_HIGH_PASS:
+            taps = highPass(design.cutoff, design.transWidth, design.samplerate, design.oddTapCount);
+            break;
+        case TAP_TYPE_BAND_PASS:
+            taps = bandPass<float>(design.cutoff, design.cutoff2, design.transWidth, design.samplerate, design.oddTapCount);
+            break;
+        }
+
+        // Free the taps along with the last reference
+        return SharedTaps(new tap<float>(taps), [](const tap<float>* t) {
+            tap<float> copy = *t;
+            free(copy);
+            delete t;
+        });
+    }
+
+    SharedTaps TapCache::lookup(const TapDesign& design) {
+        std::lock_guard<std::mutex> lck(mtx);
+        auto it = entries.find(design);
+        if (it == entries.end()) { return NULL; }
+        lru.splice(lru.begin(), lru, it->second.lruIt);
+        return it->second.taps;
+    }
+
+    void TapCache::insert(const TapDesign& design, SharedTaps taps) {
+        std::lock_guard<std::mutex> lck(mtx);
+        auto it = entries.find(design);
+        if (it != entries.end()) { return; }
+        lru.push_front(design);
+        entries[design] = { taps, lru.begin() };
+        while (entries.size() > TAP_CACHE_MAX_ENTRIES) {
+            entries.erase(lru.back());
+            lru.pop_back();
+        }
+    }
+
+    void TapCache::worker() {
+        thread_role::apply(THREAD_ROLE_BACKGROUND, "tap-design");
+        while (true) {
+            TapDesign next;
+            {
+                std::unique_lock<std::mutex> lck(mtx);
+                cnd.wait(lck, [this]() { return !queue.empty() || stopWorker; });
+                if (stopWorker) { return; }
+
+                // Only the latest request matters when a bandwidth is being dragged
+                next = queue.back();
+                queue.clear();
+                current = next;
+                designing = true;
+            }
+            SharedTaps taps = build(next);
+            insert(next, taps);
+
+            std::lock_guard<std::mutex> lck(mtx);
+            designing = false;
+        }
+    }
+}
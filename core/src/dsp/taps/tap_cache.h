@@ -0,0 +1,95 @@
+#pragma once
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <deque>
+#include <list>
+#include <unordered_map>
+#include <module.h>
+#include "tap.h"
+
+// Maximum number of tap sets kept around once no longer used
+#define TAP_CACHE_MAX_ENTRIES   64
+
+namespace dsp::taps {
+    enum TapType {
+        TAP_TYPE_LOW_PASS,
+        TAP_TYPE_HIGH_PASS,
+        TAP_TYPE_BAND_PASS
+    };
+
+    // Parameters of a real (float) filter designed by the taps:: functions (all of them use a
+    // nuttall window). For a band pass, cutoff is the start and cutoff2 the end of the band.
+    struct TapDesign {
+        TapType type;
+        double cutoff;
+        double cutoff2;
+        double transWidth;
+        double samplerate;
+        bool oddTapCount;
+
+        bool operator==(const TapDesign& b) const {
+            return type == b.type && cutoff == b.cutoff && cutoff2 == b.cutoff2 && transWidth == b.transWidth &&
+                   samplerate == b.samplerate && oddTapCount == b.oddTapCount;
+        }
+    };
+
+    struct TapDesignHash {
+        size_t operator()(const TapDesign& d) const {
+            size_t h = std::hash<int>()(d.type) ^ (d.oddTapCount ? 0x9E3779B9 : 0);
+            for (double v : { d.cutoff, d.cutoff2, d.transWidth, d.samplerate }) {
+                h = (h * 31) ^ std::hash<double>()(v);
+            }
+            return h;
+        }
+    };
+
+    inline TapDesign lowPassDesign(double cutoff, double transWidth, double sampleRate, bool oddTapCount = false) {
+        return { TAP_TYPE_LOW_PASS, cutoff, 0.0, transWidth, sampleRate, oddTapCount };
+    }
+
+    // Cached taps are shared, they stay valid for as long as someone holds them even once evicted
+    typedef std::shared_ptr<const tap<float>> SharedTaps;
+
+    // Process wide cache of designed taps. Designing long filters (double precision sinc and window
+    // for every tap) is too slow to do on the GUI thread while the user drags a bandwidth, so misses
+    // can be designed by a background worker while the old taps keep being used.
+    class TapCache {
+    public:
+        ~TapCache();
+
+        // Return the taps, designing them on the calling thread if not cached
+        SharedTaps get(const TapDesign& design);
+
+        // Return the taps if cached, otherwise return NULL and design them in the background.
+        // Only the latest pending request is designed, so keep calling it until it succeeds.
+        SharedTaps request(const TapDesign& design);
+
+        void clear();
+
+    private:
+        struct Entry {
+            SharedTaps taps;
+            std::list<TapDesign>::iterator lruIt;
+        };
+
+        static SharedTaps build(const TapDesign& design);
+        SharedTaps lookup(const TapDesign& design);
+        void insert(const TapDesign& design, SharedTaps taps);
+        void worker();
+
+        std::mutex mtx;
+        std::unordered_map<TapDesign, Entry, TapDesignHash> entries;
+        std::list<TapDesign> lru;
+
+        std::condition_variable cnd;
+        std::deque<TapDesign> queue;
+        std::thread workerThread;
+        TapDesign current;
+        bool designing = false;
+        bool stopWorker = false;
+    };
+
+    SDRPP_EXPORT TapCache cache;
+}
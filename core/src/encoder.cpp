@@ -5,6 +5,7 @@
 #include <chrono>
 #include <sys/time.h>
 #include <core.h>
+#include <utils/thread_role.h>
 #include <radio_interface.h>
 #include <signal_path/signal_path.h>
 #include <gui/gui.h>
@@ -134,11 +135,13 @@ void Encoder::setDirection(int dir) {
 		} else if (dir == 1) {
 			cwCallback(this);
 		}
+		gui::frameScheduler.requestFrame();
 	}
 }
 
 // Monitor encoder rotation
 void Encoder::rotationMonitor() {
+    thread_role::apply(THREAD_ROLE_GUI, "encoder-rot");
     struct gpiod_chip *chip_a, *chip_b;
     struct gpiod_line *line_a;
     struct gpiod_line *line_b;
@@ -250,6 +253,7 @@ void Encoder::rotationMonitor() {
 }
 
 void Encoder::clickingMonitor() {
+    thread_role::apply(THREAD_ROLE_GUI, "encoder-click");
 
 	struct gpiod_chip *chip_c = gpiod_chip_open(chipC);
     if (!chip_c) {
@@ -306,6 +310,7 @@ void Encoder::clickingMonitor() {
 						pressedCallback(this);
 					}
 				}
+				gui::frameScheduler.requestFrame();
 			}
         }
         lastDownUpEvent = event.event_type;
@@ -3,9 +3,15 @@
 #include <string>
 #include <sstream>
 #include <utils/flog.h>
+#include <utils/thread_role.h>
 #include <core.h>
 #include <signal_path/signal_path.h>
 #include <linux/i2c-dev.h>
+#include <linux/i2c.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <string.h>
+#include <algorithm>
 #include <sys/ioctl.h>
 #include <fcntl.h>
 #include <unistd.h>
@@ -16,17 +22,11 @@
 Gps::Gps() {
 	lock_fd = open(GPS_I2C_LOCK, O_CREAT | O_RDWR, 0666);
 
-	utc_hour = 0xFF;
-    utc_minute = 0xFF;
-    utc_second = 0xFF;
-    latitude_md = 0;
-    longitude_md = 0;
-    fix_quality = 0;
-    used_satellites = 0;
-
-    satellites.reserve(MAX_SATELLITES);
-
-	readerBuffer.resize(BUFFER_SIZE);
+    state.update([](GpsState& s) {
+        s.utc_hour = 0xFF;
+        s.utc_minute = 0xFF;
+        s.utc_second = 0xFF;
+    });
 
     initialize();
 }
@@ -102,43 +102,50 @@ Gps::~Gps() {
     if (m8n_fd >= 0) {
         close(m8n_fd);
     }
+    if (nmeaSourceFd >= 0) {
+        close(nmeaSourceFd);
+    }
     close(lock_fd);
 }
 
 uint8_t Gps::getUtcHour() {
-    return utc_hour;
+    return state.load().utc_hour;
 }
 
 uint8_t Gps::getUtcMinute() {
-    return utc_minute;
+    return state.load().utc_minute;
 }
 
 uint8_t Gps::getUtcSecond() {
-    return utc_second;
+    return state.load().utc_second;
 }
 
 int32_t Gps::getLatitudeMicrodegrees() {
-    return latitude_md;
+    return state.load().latitude_md;
 }
 
 int32_t Gps::getLongitudeMicrodegrees() {
-    return longitude_md;
+    return state.load().longitude_md;
 }
 
 double Gps::getLatitude() {
-    return (double)latitude_md / 1000000.0f;
+    return (double)getLatitudeMicrodegrees() / 1000000.0f;
 }
 
 double Gps::getLongitude() {
-    return (double)longitude_md / 1000000.0f;
+    return (double)getLongitudeMicrodegrees() / 1000000.0f;
 }
 
 uint8_t Gps::getFixQuality() {
-    return fix_quality;
+    return state.load().fix_quality;
 }
 
 uint8_t Gps::getUsedSatellites() {
-    return used_satellites;
+    return state.load().used_satellites;
+}
+
+GpsState Gps::getState() {
+    return state.load();
 }
 
 int Gps::acquireLock() {
@@ -155,34 +162,67 @@ void Gps::releaseLock() {
 }
 
 void Gps::pollState() {
+    thread_role::apply(THREAD_ROLE_BACKGROUND, "gps-poll");
     while (pollerRunning) {
         std::this_thread::sleep_for(std::chrono::milliseconds(GPS_POLL_INTERVAL_MS));
 
-        readRegister(stm8_fd, GPS_I2C_GPS_UTC_HOUR, &utc_hour);
-        readRegister(stm8_fd, GPS_I2C_GPS_UTC_MINUTE, &utc_minute);
-        readRegister(stm8_fd, GPS_I2C_GPS_UTC_SECOND, &utc_second);
-
-        readRegister(stm8_fd, GPS_I2C_GPS_FIX_QUALITY, &fix_quality);
-
-        if (fix_quality != 0) {
-            uint8_t lat_0, lat_1, lat_2, lat_3;
-            if (readRegister(stm8_fd, GPS_I2C_GPS_LATITUDE_L, &lat_0)
-                && readRegister(stm8_fd, GPS_I2C_GPS_LATITUDE_ML, &lat_1)
-                && readRegister(stm8_fd, GPS_I2C_GPS_LATITUDE_MH, &lat_2)
-                && readRegister(stm8_fd, GPS_I2C_GPS_LATITUDE_H, &lat_3)) {
-                    latitude_md = (((int32_t)lat_0) | ((int32_t)lat_1 << 8) | ((int32_t)lat_2 << 16) | ((int32_t)lat_3 << 24));
-            }
-            uint8_t lon_0, lon_1, lon_2, lon_3;
-            if (readRegister(stm8_fd, GPS_I2C_GPS_LONGITUDE_L, &lon_0)
-                && readRegister(stm8_fd, GPS_I2C_GPS_LONGITUDE_ML, &lon_1)
-                && readRegister(stm8_fd, GPS_I2C_GPS_LONGITUDE_MH, &lon_2)
-                && readRegister(stm8_fd, GPS_I2C_GPS_LONGITUDE_H, &lon_3)) {
-                    longitude_md = (((int32_t)lon_0) | ((int32_t)lon_1 << 8) | ((int32_t)lon_2 << 16) | ((int32_t)lon_3 << 24));
+        // Position and time come from the replayed NMEA instead
+        if (nmeaSourceFd >= 0) { continue; }
+
+        // Read the whole register block in a single transfer
+        uint8_t regs[GPS_I2C_STATE_SIZE];
+        if (!readRegisters(stm8_fd, GPS_I2C_STM8_ADDRESS, GPS_I2C_STATE_FIRST_REG, regs, GPS_I2C_STATE_SIZE)) { continue; }
+        auto reg = [&regs](int addr) { return regs[addr - GPS_I2C_STATE_FIRST_REG]; };
+
+        state.update([&reg](GpsState& s) {
+            s.utc_hour = reg(GPS_I2C_GPS_UTC_HOUR);
+            s.utc_minute = reg(GPS_I2C_GPS_UTC_MINUTE);
+            s.utc_second = reg(GPS_I2C_GPS_UTC_SECOND);
+            s.fix_quality = reg(GPS_I2C_GPS_FIX_QUALITY);
+            if (s.fix_quality != 0) {
+                s.latitude_md = (((int32_t)reg(GPS_I2C_GPS_LATITUDE_L)) | ((int32_t)reg(GPS_I2C_GPS_LATITUDE_ML) << 8) | ((int32_t)reg(GPS_I2C_GPS_LATITUDE_MH) << 16) | ((int32_t)reg(GPS_I2C_GPS_LATITUDE_H) << 24));
+                s.longitude_md = (((int32_t)reg(GPS_I2C_GPS_LONGITUDE_L)) | ((int32_t)reg(GPS_I2C_GPS_LONGITUDE_ML) << 8) | ((int32_t)reg(GPS_I2C_GPS_LONGITUDE_MH) << 16) | ((int32_t)reg(GPS_I2C_GPS_LONGITUDE_H) << 24));
             }
+            s.used_satellites = reg(GPS_I2C_GPS_USED_SATELLITES);
+        });
+        if (reg(GPS_I2C_GPS_FIX_QUALITY) != 0) {
+            updateUtcOffset(reg(GPS_I2C_GPS_UTC_HOUR), reg(GPS_I2C_GPS_UTC_MINUTE), reg(GPS_I2C_GPS_UTC_SECOND));
         }
+    }
+}
+
+void Gps::updateUtcOffset(uint8_t hour, uint8_t minute, uint8_t second) {
+    using namespace std::chrono;
+    const int64_t day = 86400000000000LL;
+    if (hour > 23 || minute > 59 || second > 60) { return; }
+
+    // The GPS only gives the time of day, compare it to the time of day of the system clock
+    int64_t now = duration_cast<nanoseconds>(system_clock::now().time_since_epoch()).count();
+    int64_t gpsTime = (((int64_t)hour * 3600) + ((int64_t)minute * 60) + (int64_t)second) * 1000000000LL;
+    int64_t diff = gpsTime - (now % day);
+    if (diff > day / 2) { diff -= day; }
+    else if (diff < -day / 2) { diff += day; }
 
-        readRegister(stm8_fd, GPS_I2C_GPS_USED_SATELLITES, &used_satellites);
+    // Start over if the system clock was stepped
+    if (utcOffsetCount && std::abs(diff - utcOffset.load()) > 2000000000LL) {
+        utcOffsetCount = 0;
+        utcOffsetPos = 0;
     }
+
+    utcOffsets[utcOffsetPos] = diff;
+    utcOffsetPos = (utcOffsetPos + 1) % GPS_UTC_OFFSET_WINDOW;
+    utcOffsetCount = std::min<int>(utcOffsetCount + 1, GPS_UTC_OFFSET_WINDOW);
+
+    // The reported second is truncated and read late, so every reading underestimates the
+    // offset by up to a second. Keeping the largest one converges to the real offset.
+    utcOffset = *std::max_element(utcOffsets, utcOffsets + utcOffsetCount);
+    utcOffsetValid = true;
+}
+
+bool Gps::getUtcOffset(int64_t& offset) {
+    if (!utcOffsetValid) { return false; }
+    offset = utcOffset;
+    return true;
 }
 
 bool Gps::sendData(unsigned char * data, uint8_t size) {
@@ -253,109 +293,120 @@ int Gps::readLine(unsigned char * line) {
 }
 
 std::vector<Satellite> Gps::getSatellites() {
-    return satellites;
+    GpsState s = state.load();
+    return std::vector<Satellite>(s.satellites, s.satellites + s.satellite_count);
 }
 
-unsigned char Gps::calculateNmeaChecksum(const std::string& sentence) {
+bool Gps::verifyNmeaChecksum(const char* sentence, int length) {
+    // Checksum covers everything between '$' and '*'
     unsigned char checksum = 0;
-    size_t i = 1;   // skip '$' at the beginning
-    while (i < sentence.length() && sentence[i] != '*') {
+    int i = 1;
+    for (; i < length && sentence[i] != '*'; i++) {
         checksum ^= sentence[i];
-        i++;
     }
-    return checksum;
+    if (i + 3 > length) { return false; }
+    char hex[3] = { sentence[i + 1], sentence[i + 2], 0 };
+    if (!std::isxdigit(hex[0]) || !std::isxdigit(hex[1])) { return false; }
+    return (unsigned char)std::strtol(hex, nullptr, 16) == checksum;
 }
 
-bool Gps::verifyNmeaChecksum(const std::string& sentence) {
-    size_t asterisk_pos = sentence.find('*');
-    if (asterisk_pos == std::string::npos || asterisk_pos + 3 > sentence.length()) {
-        return false;
+int Gps::splitFields(char* sentence, char** fields, int maxFields) {
+    // Split in place, keeping empty fields. Skips the leading '$' and stops at the checksum.
+    int count = 0;
+    char* p = (sentence[0] == '$') ? sentence + 1 : sentence;
+    fields[count++] = p;
+    for (; *p && *p != '*'; p++) {
+        if (*p != ',') { continue; }
+        *p = 0;
+        if (count >= maxFields) { break; }
+        fields[count++] = p + 1;
     }
-    std::string checksum_str = sentence.substr(asterisk_pos + 1, 2);
-    if (!std::isxdigit(checksum_str[0]) || !std::isxdigit(checksum_str[1])) {
-        return false;
-    }
-    unsigned char expected_checksum = static_cast<unsigned char>(std::strtol(checksum_str.c_str(), nullptr, 16));
-    unsigned char calculated_checksum = calculateNmeaChecksum(sentence);
-    return (expected_checksum == calculated_checksum);
+    *p = 0;
+    return count;
 }
 
-void Gps::parseGSV(const std::string& sentence) {
-    std::vector<std::string> fields;
-    int field_count = splitFieldsPreserveEmpty(sentence, fields);
+int32_t Gps::parseCoordinate(const char* value, const char* hemisphere) {
+    // NMEA coordinates are formatted as (d)ddmm.mmmm
+    if (!value[0]) { return 0; }
+    double raw = std::strtod(value, nullptr);
+    double deg = (double)((int)(raw / 100.0));
+    double md = (deg + ((raw - (deg * 100.0)) / 60.0)) * 1000000.0;
+    if (hemisphere[0] == 'S' || hemisphere[0] == 'W') { md = -md; }
+    return (int32_t)md;
+}
 
-    if (field_count < 4) return;
+void Gps::parseGSV(char** fields, int count) {
+    if (count < 4) return;
 
-    std::lock_guard<std::mutex> lock(dataMutex);
     auto current_time = std::chrono::steady_clock::now();
 
-    int total_sats = std::atoi(fields[3].c_str());
-    int sats_in_msg = (total_sats > 4) ? 4 : total_sats;
+    state.update([&](GpsState& s) {
+        // extract information for each satellite (up to 4 per message)
+        for (int i = 0; i < 4; i++) {
+            int prn_idx = 4 + i * 4;
+            int cno_idx = 7 + i * 4;
 
-    // extract information for each satellite
-    for (int i = 0; i < sats_in_msg && i < 4; i++) {
-        int prn_idx = 4 + i * 4;
-        int cno_idx = 7 + i * 4;
+            if (prn_idx >= count || !fields[prn_idx][0]) break;
 
-        if (prn_idx >= field_count || fields[prn_idx].empty()) break;
+            int prn = std::atoi(fields[prn_idx]);
+            if (prn <= 0) continue;
 
-        int prn = std::atoi(fields[prn_idx].c_str());
-        if (prn <= 0) continue;
+            int cno = (cno_idx < count && fields[cno_idx][0]) ? std::atoi(fields[cno_idx]) : -1;
 
-        int cno = (cno_idx < field_count && !fields[cno_idx].empty()) ? std::atoi(fields[cno_idx].c_str()) : -1;
-
-        // find or create satellite record
-        auto it = std::find_if(satellites.begin(), satellites.end(), [prn](const Satellite& s) { return s.prn == prn; });
-        if (it == satellites.end() && satellites.size() < MAX_SATELLITES) {
-            Satellite new_sat;
-            new_sat.prn = prn;
-            new_sat.system = getSatelliteSystem(prn);
-            new_sat.cno = cno;
-            new_sat.valid = (cno > 0);
-            new_sat.last_update = current_time;
-            satellites.push_back(new_sat);
-        } else if (it != satellites.end()) {
+            // find or create satellite record
+            Satellite* end = s.satellites + s.satellite_count;
+            Satellite* it = std::find_if(s.satellites, end, [prn](const Satellite& sat) { return sat.prn == prn; });
+            if (it == end) {
+                if (s.satellite_count >= MAX_SATELLITES) { continue; }
+                s.satellite_count++;
+                it->prn = prn;
+                it->system = getSatelliteSystem(prn);
+            }
             it->cno = cno;
             it->valid = (cno > 0);
             it->last_update = current_time;
         }
-    }
+    });
 }
 
-int Gps::splitFieldsPreserveEmpty(const std::string& sentence, std::vector<std::string>& fields) {
-    fields.clear();
-    if (sentence.empty()) return 0;
-    size_t start = (sentence[0] == '$') ? 1 : 0;
-    size_t star_pos = sentence.find('*', start);
-    size_t end = (star_pos == std::string::npos) ? sentence.length() : star_pos;
-    size_t pos = start;
-    while (pos <= end) {
-        size_t next_comma = sentence.find(',', pos);
-        if (next_comma == std::string::npos || next_comma > end) {
-            next_comma = end;
+void Gps::parseGGA(char** fields, int count) {
+    // $xxGGA,time,lat,N/S,lon,E/W,quality,numSV,...
+    if (count < 8) return;
+
+    state.update([&](GpsState& s) {
+        const char* time = fields[1];
+        if (strlen(time) >= 6) {
+            s.utc_hour = (time[0] - '0') * 10 + (time[1] - '0');
+            s.utc_minute = (time[2] - '0') * 10 + (time[3] - '0');
+            s.utc_second = (time[4] - '0') * 10 + (time[5] - '0');
+        }
+        s.fix_quality = std::atoi(fields[6]);
+        if (s.fix_quality != 0) {
+            s.latitude_md = parseCoordinate(fields[2], fields[3]);
+            s.longitude_md = parseCoordinate(fields[4], fields[5]);
         }
-        fields.emplace_back(sentence.substr(pos, next_comma - pos));
-        if (next_comma == end) break;
-        pos = next_comma + 1;
+        s.used_satellites = std::atoi(fields[7]);
+    });
+    GpsState s = state.load();
+    if (s.fix_quality != 0) {
+        updateUtcOffset(s.utc_hour, s.utc_minute, s.utc_second);
     }
-    return static_cast<int>(fields.size());
 }
 
 void Gps::cleanupExpiredSatellites() {
-    std::lock_guard<std::mutex> lock(dataMutex);
     auto current_time = std::chrono::steady_clock::now();
-    satellites.erase(
-        std::remove_if(satellites.begin(), satellites.end(),
-                      [current_time](const Satellite& sat) {
-                          auto age = std::chrono::duration_cast<std::chrono::seconds>(
-                              current_time - sat.last_update).count();
-                          return age > SATELLITE_TIMEOUT;
-                      }),
-        satellites.end()
-    );
-}
-
-std::string Gps::getSatelliteSystem(int prn) {
+    state.update([current_time](GpsState& s) {
+        Satellite* end = std::remove_if(s.satellites, s.satellites + s.satellite_count,
+                                        [current_time](const Satellite& sat) {
+                                            auto age = std::chrono::duration_cast<std::chrono::seconds>(
+                                                current_time - sat.last_update).count();
+                                            return age > SATELLITE_TIMEOUT;
+                                        });
+        s.satellite_count = end - s.satellites;
+    });
+}
+
+const char* Gps::getSatelliteSystem(int prn) {
     if (prn >= 1 && prn <= 32) {
         return "GPS";
     } else if (prn >= 33 && prn <= 64) {
@@ -381,8 +432,32 @@ void Gps::registerNmeaCallback(std::function<void(const std::string&)> callback)
     nmeaReceivedCallbacks.push_back(callback);
 }
 
+bool Gps::setNmeaSource(const std::string& path) {
+    if (readerRunning.load()) {
+        flog::error("Cannot change the NMEA source while the reader is running");
+        return false;
+    }
+    if (nmeaSourceFd >= 0) {
+        close(nmeaSourceFd);
+        nmeaSourceFd = -1;
+    }
+    nmeaSourcePath = path;
+    nmeaSourceHungUp = false;
+    if (path.empty()) { return true; }
+
+    nmeaSourceFd = open(path.c_str(), O_RDONLY | O_NOCTTY);
+    if (nmeaSourceFd < 0) {
+        flog::error("Could not open NMEA source '{0}': {1}", path, strerror(errno));
+        return false;
+    }
+    struct stat st;
+    nmeaSourceIsFile = (fstat(nmeaSourceFd, &st) == 0 && S_ISREG(st.st_mode));
+    flog::info("Reading NMEA from {0} ({1})", path, nmeaSourceIsFile ? "replay file" : "terminal");
+    return true;
+}
+
 bool Gps::startReader() {
-    if (m8n_fd < 0) {
+    if (m8n_fd < 0 && nmeaSourceFd < 0) {
         flog::error("M8N device not initialized yet.");
         return false;
     }
@@ -429,158 +504,231 @@ bool Gps::readRegister(int fd, uint8_t reg, uint8_t* data) {
     return true;
 }
 
-int Gps::getAvailableBytes() {
-    uint8_t high_byte, low_byte;
-    if (readRegister(m8n_fd, DATA_LENGTH_HIGH_REG, &high_byte) < 0) {
-        return -1;
+bool Gps::readRegisters(int fd, uint8_t addr, uint8_t reg, uint8_t* data, int count) {
+    if (fd < 0) {
+        flog::warn("readRegisters: invalid fd");
+        return false;
     }
-    if (readRegister(m8n_fd, DATA_LENGTH_LOW_REG, &low_byte) < 0) {
-        return -1;
+    if (acquireLock() < 0) {
+        flog::warn("readRegisters: failed to lock GPS I2C device");
+        return false;
     }
-    int available = (high_byte << 8) | low_byte;
-    if (available == NO_DATA_VALUE) {
-        return 0;
+
+    // Register address write followed by a repeated start and the block read, as one transaction
+    struct i2c_msg msgs[2];
+    msgs[0].addr = addr;
+    msgs[0].flags = 0;
+    msgs[0].len = 1;
+    msgs[0].buf = &reg;
+    msgs[1].addr = addr;
+    msgs[1].flags = I2C_M_RD;
+    msgs[1].len = count;
+    msgs[1].buf = data;
+    struct i2c_rdwr_ioctl_data xfer;
+    xfer.msgs = msgs;
+    xfer.nmsgs = 2;
+    if (ioctl(fd, I2C_RDWR, &xfer) < 0) {
+        flog::warn("readRegisters: transfer failed");
+        releaseLock();
+        return false;
     }
-    return available;
+    releaseLock();
+    return true;
 }
 
-int Gps::readDataStream(uint8_t* buffer, int count) {
+int Gps::readAvailable(uint8_t* buffer, int maxCount) {
     if (acquireLock() < 0) {
-        flog::warn("readDataStream: failed to lock GPS I2C device");
+        flog::warn("readAvailable: failed to lock GPS I2C device");
         return -1;
     }
-    uint8_t reg = DATA_STREAM_REG;
-    if (write(m8n_fd, &reg, 1) != 1) {
-        flog::warn("readDataStream: failed to set address");
+
+    // Length registers are adjacent, read both at once
+    uint8_t reg = DATA_LENGTH_HIGH_REG;
+    uint8_t len[2];
+    struct i2c_msg msgs[2];
+    msgs[0].addr = GPS_I2C_M8N_ADDRESS;
+    msgs[0].flags = 0;
+    msgs[0].len = 1;
+    msgs[0].buf = &reg;
+    msgs[1].addr = GPS_I2C_M8N_ADDRESS;
+    msgs[1].flags = I2C_M_RD;
+    msgs[1].len = 2;
+    msgs[1].buf = len;
+    struct i2c_rdwr_ioctl_data xfer;
+    xfer.msgs = msgs;
+    xfer.nmsgs = 2;
+    if (ioctl(m8n_fd, I2C_RDWR, &xfer) < 0) {
+        flog::warn("readAvailable: failed to read data length");
         releaseLock();
         return -1;
     }
-    int bytes_read = read(m8n_fd, buffer, count);
-    if (bytes_read < 0) {
-        flog::warn("readDataStream: failed to read data stream");
+    int available = ((int)len[0] << 8) | len[1];
+    if (available == NO_DATA_VALUE || !available) {
+        releaseLock();
+        return 0;
+    }
+
+    // Read the data stream while still holding the lock
+    reg = DATA_STREAM_REG;
+    msgs[1].len = std::min<int>(available, maxCount);
+    msgs[1].buf = buffer;
+    if (ioctl(m8n_fd, I2C_RDWR, &xfer) < 0) {
+        flog::warn("readAvailable: failed to read data stream");
         releaseLock();
         return -1;
     }
     releaseLock();
+    return msgs[1].len;
+}
+
+int Gps::readSource(uint8_t* buffer, int maxCount) {
+    // Wait for data on terminals instead of polling
+    if (!nmeaSourceIsFile) {
+        struct pollfd pfd = { nmeaSourceFd, POLLIN, 0 };
+        int ret = poll(&pfd, 1, 100);
+        if (ret <= 0) { return ret; }
+        if (!(pfd.revents & POLLIN)) { return reopenSource(); }
+    }
+    int bytes_read = read(nmeaSourceFd, buffer, maxCount);
+    if (bytes_read < 0 && errno == EINTR) { return 0; }
+
+    // Loop replay files
+    if (nmeaSourceIsFile) {
+        if (!bytes_read) { lseek(nmeaSourceFd, 0, SEEK_SET); }
+        return bytes_read;
+    }
+
+    // A terminal that was hung up keeps reporting end of file or an error without ever blocking
+    if (bytes_read <= 0) { return reopenSource(); }
+    if (nmeaSourceHungUp) {
+        flog::info("NMEA source '{0}' is back", nmeaSourcePath);
+        nmeaSourceHungUp = false;
+    }
     return bytes_read;
 }
 
-void Gps::processNmeaBuffer() {
-    std::lock_guard<std::mutex> lock(bufferMutex);
+int Gps::reopenSource() {
+    if (!nmeaSourceHungUp) {
+        flog::warn("NMEA source '{0}' hung up, reopening it", nmeaSourcePath);
+        nmeaSourceHungUp = true;
+    }
 
-    while (true) {
-        // Find start of NMEA sentence ($ character)
-        auto start_it = std::find(readerBuffer.begin(), readerBuffer.begin() + readerBufferLength, '$');
-        // No NMEA start found, clear buffer
-        if (start_it == readerBuffer.begin() + readerBufferLength) {
-            readerBufferLength = 0;
-            return;
-        }
-        // Remove data before NMEA start
-        size_t start_pos = std::distance(readerBuffer.begin(), start_it);
-        if (start_pos > 0) {
-            std::memmove(readerBuffer.data(), readerBuffer.data() + start_pos,
-                       readerBufferLength - start_pos);
-            readerBufferLength -= start_pos;
-        }
-        // Find end of NMEA sentence (\r or \n)
-        auto end_it = std::find_if(readerBuffer.begin() + 1,
-                                 readerBuffer.begin() + readerBufferLength,
-                                 [](uint8_t c) { return c == '\r' || c == '\n'; });
-        // No complete sentence found yet
-        if (end_it == readerBuffer.begin() + readerBufferLength) {
-            return;
+    // Keep the same descriptor number so that nothing else has to know about it
+    int fd = open(nmeaSourcePath.c_str(), O_RDONLY | O_NOCTTY);
+    if (fd >= 0) {
+        dup2(fd, nmeaSourceFd);
+        close(fd);
+    }
+    return -1;
+}
+
+int Gps::feedNmea(const uint8_t* data, int count, bool stopAtEpoch, bool& epochEnded) {
+    epochEnded = false;
+    for (int i = 0; i < count; i++) {
+        char c = data[i];
+
+        // '$' always starts a new sentence, anything before it is garbage
+        if (c == '$') {
+            nmeaLine[0] = c;
+            nmeaLineLength = 1;
+            continue;
         }
-        // Extract complete NMEA sentence
-        size_t sentence_end = std::distance(readerBuffer.begin(), end_it);
-        std::string nmea_sentence(readerBuffer.begin(), readerBuffer.begin() + sentence_end);
-
-        // Print NMEA sentence
-        //std::cout << "NMEA: " << nmea_sentence << "\n";
-
-        // Process GSV
-        if (nmea_sentence[0] == '$') {
-            if (verifyNmeaChecksum(nmea_sentence)) {
-                processedNMEA ++;
-                if (nmea_sentence.find("GSV") != std::string::npos) {
-                    parseGSV(nmea_sentence);
-                }
+        if (!nmeaLineLength) { continue; }
+
+        if (c == '\r' || c == '\n') {
+            nmeaLine[nmeaLineLength] = 0;
+            bool epoch = processSentence(nmeaLine, nmeaLineLength);
+            nmeaLineLength = 0;
+            if (epoch && stopAtEpoch) {
+                epochEnded = true;
+                return i + 1;
             }
+            continue;
         }
 
-        // Call callback if registered
+        // Drop sentences that are too long to be valid
+        if (nmeaLineLength >= MAX_LINE_LEN - 1) {
+            nmeaLineLength = 0;
+            continue;
+        }
+        nmeaLine[nmeaLineLength++] = c;
+    }
+    return count;
+}
+
+bool Gps::processSentence(char* sentence, int length) {
+    if (!verifyNmeaChecksum(sentence, length)) { return false; }
+    state.update([](GpsState& s) { s.processed_nmea++; });
+
+    // Callbacks get the sentence before it is split
+    if (!nmeaReceivedCallbacks.empty()) {
+        std::string str(sentence, length);
         for (const auto& callback : nmeaReceivedCallbacks) {
             if (callback) {
-                callback(nmea_sentence);
+                callback(str);
             }
         }
-        // Remove processed sentence from buffer
-        size_t sentence_len = sentence_end + 1;
-        // Skip additional \r or \n characters
-        while (sentence_len < readerBufferLength &&
-               (readerBuffer[sentence_len] == '\r' || readerBuffer[sentence_len] == '\n')) {
-            sentence_len++;
-        }
+    }
 
-        std::memmove(readerBuffer.data(), readerBuffer.data() + sentence_len, readerBufferLength - sentence_len);
-        readerBufferLength -= sentence_len;
+    char* fields[NMEA_MAX_FIELDS];
+    int count = splitFields(sentence, fields, NMEA_MAX_FIELDS);
+    if (strlen(fields[0]) != 5) { return false; }
+
+    // Skip the talker ID (GP, GL, GN, etc)
+    const char* type = fields[0] + 2;
+    if (!strcmp(type, "GSV")) {
+        parseGSV(fields, count);
+    }
+    else if (!strcmp(type, "GGA")) {
+        // With the board present, time and position come from the STM8 registers
+        if (nmeaSourceFd >= 0) { parseGGA(fields, count); }
+        return true;
     }
+    return false;
 }
 
 void Gps::readerLoop() {
+    thread_role::apply(THREAD_ROLE_BACKGROUND, "gps-reader");
     using namespace std::chrono;
     auto last_cleanup = steady_clock::now();
+    nmeaLineLength = 0;
     while (readerRunning.load()) {
-        try {
-            int available_bytes = getAvailableBytes();
-            if (available_bytes <= 0) {
-                std::this_thread::sleep_for(milliseconds(50));
-                continue;
+        int bytes_read;
+        if (nmeaSourceFd >= 0) {
+            bytes_read = readSource(readerBuffer, BUFFER_SIZE);
+            if (bytes_read < 0) {
+                std::this_thread::sleep_for(milliseconds(NMEA_SOURCE_RETRY_MS));
             }
-            // Avoid overflowing buffer
-            int bytes_to_read = available_bytes;
-            {
-                std::lock_guard<std::mutex> lock(bufferMutex);
-                if (readerBufferLength + bytes_to_read > BUFFER_SIZE - 1) {
-                    bytes_to_read = BUFFER_SIZE - 1 - readerBufferLength;
-                    if (bytes_to_read <= 0) {
-                        std::cout << "Buffer full, resetting...\n";
-                        readerBufferLength = 0;
-                        continue;
-                    }
-                }
-            }
-            // Read available data
-            std::vector<uint8_t> temp_buffer(bytes_to_read);
-            int bytes_read = readDataStream(temp_buffer.data(), bytes_to_read);
-
-            if (bytes_read > 0) {
-                {
-                    std::lock_guard<std::mutex> lock(bufferMutex);
-                    std::memcpy(readerBuffer.data() + readerBufferLength,
-                              temp_buffer.data(), bytes_read);
-                    readerBufferLength += bytes_read;
-                }
-                processNmeaBuffer();
-            } else {
-                std::this_thread::sleep_for(milliseconds(10));
+        }
+        else {
+            bytes_read = readAvailable(readerBuffer, BUFFER_SIZE);
+            if (bytes_read <= 0) {
+                std::this_thread::sleep_for(milliseconds(50));
             }
-            // Cleanup expired satellites
-            auto current_time = steady_clock::now();
-            if (duration_cast<seconds>(current_time - last_cleanup).count() >= 5) {
-                cleanupExpiredSatellites();
-                last_cleanup = current_time;
+        }
+
+        // Replay files are paced to one fix per epoch, everything else is consumed at once
+        int offset = 0;
+        while (offset < bytes_read) {
+            bool epochEnded;
+            offset += feedNmea(&readerBuffer[offset], bytes_read - offset, nmeaSourceIsFile, epochEnded);
+            if (epochEnded) {
+                std::this_thread::sleep_for(milliseconds(NMEA_REPLAY_EPOCH_MS));
+                if (!readerRunning.load()) { break; }
             }
-            std::this_thread::sleep_for(milliseconds(1));
-        } catch (const std::exception& e) {
-            std::cerr << "Exception in reader loop: " << e.what() << "\n";
-            std::this_thread::sleep_for(milliseconds(100));
+        }
+
+        // Cleanup expired satellites
+        auto current_time = steady_clock::now();
+        if (duration_cast<seconds>(current_time - last_cleanup).count() >= 5) {
+            cleanupExpiredSatellites();
+            last_cleanup = current_time;
         }
     }
 }
 
 int32_t Gps::getProcessedNMEA() {
-    return processedNMEA;
+    return state.load().processed_nmea;
 }
 
 void Gps::outputReferenceClock(bool lockToGpsFreq) {
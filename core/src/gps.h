@@ -8,6 +8,7 @@
 #include <functional>
 #include <string>
 #include <chrono>
+#include <utils/seqlock.h>
 
 /*
  * This abstractive GPS is implemented with a NEO M8N module and an STM8S003F3
@@ -44,15 +45,39 @@
 #define GPS_I2C_GPS_FIX_QUALITY     14
 #define GPS_I2C_GPS_USED_SATELLITES 15
 
+// The STM8 state registers are contiguous and read in a single transfer
+#define GPS_I2C_STATE_FIRST_REG     GPS_I2C_GPS_UTC_HOUR
+#define GPS_I2C_STATE_SIZE          (GPS_I2C_GPS_USED_SATELLITES - GPS_I2C_GPS_UTC_HOUR + 1)
+
+#define NMEA_MAX_FIELDS             32
+#define NMEA_REPLAY_EPOCH_MS        1000
+#define NMEA_SOURCE_RETRY_MS        1000
+
+// Number of UTC readings used to estimate the offset of the system clock
+#define GPS_UTC_OFFSET_WINDOW       16
 
 typedef struct {
     int prn;
     int cno;
     int valid;
-    std::string system;
+    const char* system;
     std::chrono::steady_clock::time_point last_update;
 } Satellite;
 
+// Everything known about the GPS, published as a whole so that readers always see a consistent fix
+typedef struct {
+    uint8_t utc_hour;           // UTC hour
+    uint8_t utc_minute;         // UTC minute
+    uint8_t utc_second;         // UTC second
+    int32_t latitude_md;        // Latitude in microdegrees (1e-6 degrees)
+    int32_t longitude_md;       // Longitude in microdegrees (1e-6 degrees)
+    uint8_t fix_quality;        // Fix quality
+    uint8_t used_satellites;    // Used satellites
+    int32_t processed_nmea;     // Number of valid NMEA sentences received
+    int satellite_count;
+    Satellite satellites[MAX_SATELLITES];
+} GpsState;
+
 class Gps {
 public:
     Gps();
@@ -89,8 +114,11 @@ public:
     
     void outputReferenceClock(bool lockToGpsFreq);
     
-    int32_t processedNMEA = 0;
     std::vector<Satellite> getSatellites();
+    GpsState getState();
+
+    // Offset to add to the system clock to get GPS UTC, in ns. Returns false until the GPS has a fix.
+    bool getUtcOffset(int64_t& offset);
     
     bool sendData(unsigned char * data, uint8_t size);
     int readLine(unsigned char * line);
@@ -99,6 +127,9 @@ public:
     bool startReader();
     void stopReader();
     int32_t getProcessedNMEA();
+
+    // Read NMEA from a replay file or a (pseudo) terminal instead of the M8N, for testing without the board
+    bool setNmeaSource(const std::string& path);
 	
 private:
     bool initialized = false;
@@ -107,23 +138,22 @@ private:
     int stm8_fd = -1;
     std::thread pollingThread;
     std::atomic<bool> pollerRunning{false};
-    
-    uint8_t utc_hour;     // UTC hour
-    uint8_t utc_minute;   // UTC minute
-    uint8_t utc_second;   // UTC second
-    int32_t latitude_md;  // Latitude in microdegrees (1e-6 degrees)
-    int32_t longitude_md; // Longitude in microdegrees (1e-6 degrees)
-    uint8_t fix_quality;  // Fix quality
-    uint8_t used_satellites;   // Used satellites
-    
+
+    SeqLock<GpsState> state;
+
+    void updateUtcOffset(uint8_t hour, uint8_t minute, uint8_t second);
+    int64_t utcOffsets[GPS_UTC_OFFSET_WINDOW];
+    int utcOffsetCount = 0;
+    int utcOffsetPos = 0;
+    std::atomic<int64_t> utcOffset{0};
+    std::atomic<bool> utcOffsetValid{false};
+
     bool readRegister(int fd, uint8_t reg, uint8_t* data);
+    bool readRegisters(int fd, uint8_t addr, uint8_t reg, uint8_t* data, int count);
     
     int acquireLock();
 	void releaseLock();
 	void pollState();
-	
-	std::vector<Satellite> satellites;
-	std::mutex dataMutex;
 
     static constexpr int DATA_STREAM_REG = 0xFF;
     static constexpr int DATA_LENGTH_HIGH_REG = 0xFD;
@@ -133,22 +163,33 @@ private:
     int m8n_fd = -1;
     std::thread readingThread;
     std::atomic<bool> readerRunning{false};
-    std::vector<uint8_t> readerBuffer;
-    size_t readerBufferLength = 0;
-    std::mutex bufferMutex;
     std::vector<std::function<void(const std::string&)>> nmeaReceivedCallbacks;
+
+    // Alternative NMEA source (replay file or terminal)
+    std::string nmeaSourcePath;
+    int nmeaSourceFd = -1;
+    bool nmeaSourceIsFile = false;
+    bool nmeaSourceHungUp = false;
+
+    // Fixed buffers, nothing is allocated while streaming NMEA
+    uint8_t readerBuffer[BUFFER_SIZE];
+    char nmeaLine[MAX_LINE_LEN];
+    int nmeaLineLength = 0;
     
-    int getAvailableBytes();
-    int readDataStream(uint8_t* buffer, int count);
-    void processNmeaBuffer();
+    int readAvailable(uint8_t* buffer, int maxCount);
+    int readSource(uint8_t* buffer, int maxCount);
+    int reopenSource();
+    int feedNmea(const uint8_t* data, int count, bool stopAtEpoch, bool& epochEnded);
+    bool processSentence(char* sentence, int length);
     void readerLoop();
 
-    unsigned char calculateNmeaChecksum(const std::string& sentence);
-    bool verifyNmeaChecksum(const std::string& sentence);
-    void parseGSV(const std::string& sentence);
-    int splitFieldsPreserveEmpty(const std::string& sentence, std::vector<std::string>& fields);
+    static bool verifyNmeaChecksum(const char* sentence, int length);
+    static int splitFields(char* sentence, char** fields, int maxFields);
+    static int32_t parseCoordinate(const char* value, const char* hemisphere);
+    void parseGSV(char** fields, int count);
+    void parseGGA(char** fields, int count);
     void cleanupExpiredSatellites();
-    std::string getSatelliteSystem(int prn);
+    static const char* getSatelliteSystem(int prn);
 };
 
 #endif // GPS_H
@@ -0,0 +1,158 @@
+#include <gui/frame_scheduler.h>
+#include <imgui.h>
+#include <backend.h>
+#include <core.h>
+#include <gui/style.h>
+#include <algorithm>
+#include <time.h>
+#include <sys/resource.h>
+
+// Keep drawing at the target framerate for a little while after the last input so that
+// ImGui hover states, popups and animations have time to settle
+#define INPUT_HOLD_TIME     0.5
+
+// Longest time the render loop sleeps when the idle framerate is set to 0
+#define MAX_IDLE_TIMEOUT    5.0
+
+// Accept waking up slightly early to avoid going back to sleep for a few microseconds
+#define TIMING_TOLERANCE    0.001
+
+namespace {
+    double timevalToSec(const timeval& tv) {
+        return (double)tv.tv_sec + ((double)tv.tv_usec / 1000000.0);
+    }
+
+    double getProcessCPUTime() {
+        rusage usage;
+        if (getrusage(RUSAGE_SELF, &usage)) { return 0.0; }
+        return timevalToSec(usage.ru_utime) + timevalToSec(usage.ru_stime);
+    }
+
+    double getThreadCPUTime() {
+        timespec ts;
+        if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts)) { return 0.0; }
+        return (double)ts.tv_sec + ((double)ts.tv_nsec / 1000000000.0);
+    }
+}
+
+void FrameScheduler::init() {
+    core::configManager.acquire();
+    setTargetFPS(core::configManager.conf["targetFps"]);
+    setIdleFPS(core::configManager.conf["idleFps"]);
+    showOverlay = core::configManager.conf["showFrameOverlay"];
+    core::configManager.release();
+
+    statsStart = clock::now();
+    statsProcCPU = getProcessCPUTime();
+    statsThreadCPU = getThreadCPUTime();
+}
+
+void FrameScheduler::requestFrame() {
+    // Only wake up the render loop on the first request, further ones are merged into the same frame
+    if (!damaged.exchange(true) && sleeping) {
+        backend::wakeUp();
+    }
+}
+
+void FrameScheduler::notifyInput() {
+    damaged = true;
+    lastInput = clock::now();
+}
+
+double FrameScheduler::getWaitTimeout() {
+    auto now = clock::now();
+    double sinceLast = std::chrono::duration<double>(now - lastFrame).count();
+
+    // Damaged or interacting, draw as soon as the target framerate allows it
+    if (damaged || isInteracting(now)) {
+        return std::max<double>(0.0, (1.0 / (double)targetFPS) - sinceLast);
+    }
+
+    // Otherwise only refresh at the idle rate (clock, GPS status, etc)
+    int idle = idleFPS;
+    double idleInterval = (idle > 0) ? (1.0 / (double)idle) : MAX_IDLE_TIMEOUT;
+    return std::max<double>(0.0, idleInterval - sinceLast);
+}
+
+bool FrameScheduler::shouldRender() {
+    return getWaitTimeout() <= TIMING_TOLERANCE;
+}
+
+void FrameScheduler::setSleeping(bool sleeping) {
+    this->sleeping = sleeping;
+}
+
+void FrameScheduler::beginFrame() {
+    // Clear the damage before drawing so that anything arriving during the frame schedules another one
+    damaged = false;
+    frameStart = clock::now();
+    lastFrame = frameStart;
+}
+
+void FrameScheduler::endFrame() {
+    auto now = clock::now();
+    double frameTime = std::chrono::duration<double>(now - frameStart).count();
+    statsFrames++;
+    statsFrameTimeSum += frameTime;
+    statsFrameTimeMax = std::max<double>(statsFrameTimeMax, frameTime);
+    updateStats(now);
+}
+
+void FrameScheduler::setTargetFPS(int fps) {
+    targetFPS = std::clamp<int>(fps, 1, 240);
+}
+
+int FrameScheduler::getTargetFPS() {
+    return targetFPS;
+}
+
+void FrameScheduler::setIdleFPS(int fps) {
+    idleFPS = std::clamp<int>(fps, 0, 240);
+}
+
+int FrameScheduler::getIdleFPS() {
+    return idleFPS;
+}
+
+void FrameScheduler::drawOverlay() {
+    if (!showOverlay) { return; }
+
+    char buf[256];
+    snprintf(buf, sizeof(buf), "%.1f FPS\nFrame: %.2f ms avg, %.2f ms max\nCPU: %.1f%% process, %.1f%% GUI thread",
+             fps, frameTimeAvg, frameTimeMax, procCPU, guiCPU);
+
+    ImDrawList* drawList = ImGui::GetForegroundDrawList();
+    ImVec2 textSize = ImGui::CalcTextSize(buf);
+    ImVec2 pad(5.0f * style::uiScale, 5.0f * style::uiScale);
+    ImVec2 pos(pad.x, ImGui::GetIO().DisplaySize.y - textSize.y - (3.0f * pad.y));
+    drawList->AddRectFilled(pos, ImVec2(pos.x + textSize.x + (2.0f * pad.x), pos.y + textSize.y + (2.0f * pad.y)), IM_COL32(0, 0, 0, 180));
+    drawList->AddText(ImVec2(pos.x + pad.x, pos.y + pad.y), IM_COL32(255, 255, 0, 255), buf);
+}
+
+bool FrameScheduler::isInteracting(clock::time_point now) {
+    if (std::chrono::duration<double>(now - lastInput).count() < INPUT_HOLD_TIME) { return true; }
+    if (ImGui::GetCurrentContext() == NULL) { return false; }
+    ImGuiIO& io = ImGui::GetIO();
+    return ImGui::IsAnyMouseDown() || io.WantTextInput;
+}
+
+void FrameScheduler::updateStats(clock::time_point now) {
+    double elapsed = std::chrono::duration<double>(now - statsStart).count();
+    if (elapsed < 1.0) { return; }
+
+    double procTime = getProcessCPUTime();
+    double threadTime = getThreadCPUTime();
+
+    fps = (float)statsFrames / elapsed;
+    frameTimeAvg = statsFrames ? (float)(statsFrameTimeSum * 1000.0 / (double)statsFrames) : 0.0f;
+    frameTimeMax = (float)(statsFrameTimeMax * 1000.0);
+    procCPU = (float)(100.0 * (procTime - statsProcCPU) / elapsed);
+    guiCPU = (float)(100.0 * (threadTime - statsThreadCPU) / elapsed);
+
+    statsStart = now;
+    statsProcCPU = procTime;
+    statsThreadCPU = threadTime;
+    statsFrames = 0;
+    statsFrameTimeSum = 0.0;
+    statsFrameTimeMax = 0.0;
+}
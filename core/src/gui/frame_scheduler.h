@@ -0,0 +1,66 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+
+// Decides when the render loop has to draw a new frame. Instead of redrawing as fast as
+// vsync allows, the render loop sleeps until either user input arrives, some thread reports
+// new content (FFT frame, decoder event, etc) through requestFrame(), or the idle timeout expires.
+class FrameScheduler {
+public:
+    void init();
+
+    // Thread-safe, may be called from DSP/decoder threads
+    void requestFrame();
+
+    // Called from the backend whenever user input or a window event was received
+    void notifyInput();
+
+    // Maximum time in seconds the render loop may block waiting for events
+    double getWaitTimeout();
+
+    // Returns true if a frame must be drawn now, false if the loop should go back to sleep
+    bool shouldRender();
+
+    // Thread-safe, tells the render loop it is (or isn't) about to block waiting for events
+    void setSleeping(bool sleeping);
+
+    void beginFrame();
+    void endFrame();
+
+    void setTargetFPS(int fps);
+    int getTargetFPS();
+    void setIdleFPS(int fps);
+    int getIdleFPS();
+
+    void drawOverlay();
+
+    bool showOverlay = false;
+
+private:
+    typedef std::chrono::steady_clock clock;
+
+    bool isInteracting(clock::time_point now);
+    void updateStats(clock::time_point now);
+
+    std::atomic<bool> damaged = true;
+    std::atomic<bool> sleeping = false;
+    std::atomic<int> targetFPS = 30;
+    std::atomic<int> idleFPS = 2;
+
+    clock::time_point lastFrame = clock::now();
+    clock::time_point lastInput = clock::now();
+    clock::time_point frameStart;
+
+    // Statistics for the overlay (only accessed from the render thread)
+    clock::time_point statsStart = clock::now();
+    double statsProcCPU = 0.0;
+    double statsThreadCPU = 0.0;
+    int statsFrames = 0;
+    double statsFrameTimeSum = 0.0;
+    double statsFrameTimeMax = 0.0;
+    float frameTimeAvg = 0.0f;
+    float frameTimeMax = 0.0f;
+    float fps = 0.0f;
+    float procCPU = 0.0f;
+    float guiCPU = 0.0f;
+};
@@ -2,6 +2,7 @@
 
 namespace gui {
     MainWindow mainWindow;
+    FrameScheduler frameScheduler;
     ImGui::WaterFall waterfall;
     FrequencySelect freqSelect;
     ThemeManager themeManager;
@@ -9,6 +9,7 @@
 #include <gui/widgets/side_bar.h>
 #include <gui/widgets/main_view.h>
 #include <gui/widgets/func_select.h>
+#include <gui/frame_scheduler.h>
 
 namespace gui {
     SDRPP_EXPORT ImGui::WaterFall waterfall;
@@ -16,6 +17,7 @@ namespace gui {
     SDRPP_EXPORT Menu menu;
     SDRPP_EXPORT ThemeManager themeManager;
     SDRPP_EXPORT MainWindow mainWindow;
+    SDRPP_EXPORT FrameScheduler frameScheduler;
     extern SideBar sideBar;
     extern MainView mainView;
 	extern ImGui::FunctionSelect funcSelectA;
@@ -20,6 +20,7 @@
 #include <gui/menus/vfo_color.h>
 #include <gui/menus/module_manager.h>
 #include <gui/menus/theme.h>
+#include <gui/menus/profiler.h>
 #include <gui/dialogs/credits.h>
 #include <filesystem>
 #include <signal_path/source.h>
@@ -80,6 +81,7 @@ void MainWindow::init() {
     gui::menu.registerEntry("Theme", thememenu::draw, NULL);
     gui::menu.registerEntry("VFO Color", vfo_color_menu::draw, NULL);
     gui::menu.registerEntry("Module Manager", module_manager_menu::draw, NULL);
+    gui::menu.registerEntry("Profiler", profiler_menu::draw, NULL);
 
     gui::freqSelect.init();
 
@@ -172,6 +174,7 @@ void MainWindow::init() {
     displaymenu::init();
     vfo_color_menu::init();
     module_manager_menu::init();
+    profiler_menu::init();
 	
     // Update UI settings
     LoadingScreen::show("Loading configuration");
@@ -230,6 +233,7 @@ float* MainWindow::acquireFFTBuffer(void* ctx) {
 
 void MainWindow::releaseFFTBuffer(void* ctx) {
     gui::waterfall.pushFFT();
+    gui::frameScheduler.requestFrame();
 }
 
 void MainWindow::vfoAddedHandler(VFOManager::VFO* vfo, void* ctx) {
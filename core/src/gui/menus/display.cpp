@@ -28,6 +28,8 @@ namespace displaymenu {
     int fftSmoothingSpeed = 100;
     bool snrSmoothing = false;
     int snrSmoothingSpeed = 20;
+    int targetFps = 30;
+    int idleFps = 2;
 
     OptionList<int, int> fftSizes;
     OptionList<float, float> uiScales;
@@ -104,6 +106,9 @@ namespace displaymenu {
         gui::waterfall.setSNRSmoothing(snrSmoothing);
         updateFFTSpeeds();
 
+        targetFps = gui::frameScheduler.getTargetFPS();
+        idleFps = gui::frameScheduler.getIdleFPS();
+
         // Define and load UI scales
         uiScales.define(1.0f, "100%", 1.0f);
         uiScales.define(2.0f, "200%", 2.0f);
@@ -230,6 +235,32 @@ namespace displaymenu {
             core::configManager.release(true);
         }
 
+        ImGui::LeftLabel("Max Framerate");
+        ImGui::SetNextItemWidth(menuWidth - ImGui::GetCursorPosX());
+        if (ImGui::InputInt("##sdrpp_target_fps", &targetFps, 1, 10)) {
+            gui::frameScheduler.setTargetFPS(targetFps);
+            targetFps = gui::frameScheduler.getTargetFPS();
+            core::configManager.acquire();
+            core::configManager.conf["targetFps"] = targetFps;
+            core::configManager.release(true);
+        }
+
+        ImGui::LeftLabel("Idle Framerate");
+        ImGui::SetNextItemWidth(menuWidth - ImGui::GetCursorPosX());
+        if (ImGui::InputInt("##sdrpp_idle_fps", &idleFps, 1, 10)) {
+            gui::frameScheduler.setIdleFPS(idleFps);
+            idleFps = gui::frameScheduler.getIdleFPS();
+            core::configManager.acquire();
+            core::configManager.conf["idleFps"] = idleFps;
+            core::configManager.release(true);
+        }
+
+        if (ImGui::Checkbox("Show Frame Statistics##_sdrpp", &gui::frameScheduler.showOverlay)) {
+            core::configManager.acquire();
+            core::configManager.conf["showFrameOverlay"] = gui::frameScheduler.showOverlay;
+            core::configManager.release(true);
+        }
+
         if (colorMapNames.size() > 0) {
             ImGui::LeftLabel("Color Map");
             ImGui::SetNextItemWidth(menuWidth - ImGui::GetCursorPosX());
@@ -0,0 +1,88 @@
+#include <gui/menus/profiler.h>
+#include <gui/style.h>
+#include <imgui.h>
+#include <dsp/profiler.h>
+#include <algorithm>
+#include <map>
+
+namespace profiler_menu {
+    bool enabled = false;
+    dsp::profiler::Sampler sampler;
+    std::vector<dsp::profiler::BlockInfo> infos;
+
+    void init() {
+        enabled = dsp::profiler::isEnabled();
+    }
+
+    void draw(void* ctx) {
+        if (ImGui::Checkbox("Profile DSP blocks##_profiler_enabled", &enabled)) {
+            dsp::profiler::setEnabled(enabled);
+        }
+        if (!enabled) {
+            infos.clear();
+            return;
+        }
+
+        // The sampler only updates the counters every PROFILER_MIN_INTERVAL_NS
+        infos = sampler.sample();
+
+        // Gather the blocks of each pipeline
+        std::map<std::string, std::vector<int>> groups;
+        for (int i = 0; i < infos.size(); i++) {
+            groups[infos[i].group].push_back(i);
+        }
+
+        if (!ImGui::BeginTable("Profiler Table", 4, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY, ImVec2(0, 300.0f * style::uiScale))) {
+            return;
+        }
+        ImGui::TableSetupColumn("Block");
+        ImGui::TableSetupColumn("Load", ImGuiTableColumnFlags_WidthFixed, 60.0f * style::uiScale);
+        ImGui::TableSetupColumn("MS/s", ImGuiTableColumnFlags_WidthFixed, 45.0f * style::uiScale);
+        ImGui::TableSetupColumn("Full", ImGuiTableColumnFlags_WidthFixed, 35.0f * style::uiScale);
+        ImGui::TableSetupScrollFreeze(4, 1);
+        ImGui::TableHeadersRow();
+
+        for (auto& [group, blocks] : groups) {
+            ImGui::TableNextRow();
+            ImGui::TableSetColumnIndex(0);
+            bool open = ImGui::TreeNodeEx(group.c_str(), ImGuiTreeNodeFlags_DefaultOpen | ImGuiTreeNodeFlags_SpanFullWidth);
+
+            // Load of the busiest block, it's the one limiting the pipeline
+            float groupLoad = 0.0f;
+            for (int i : blocks) { groupLoad = std::max<float>(groupLoad, infos[i].load); }
+            ImGui::TableSetColumnIndex(1);
+            ImGui::ProgressBar(groupLoad, ImVec2(-1, 0), "");
+            if (!open) { continue; }
+
+            for (int i : blocks) {
+                auto& info = infos[i];
+                ImGui::TableNextRow();
+                ImGui::TableSetColumnIndex(0);
+                std::string name = info.name.rfind(group + "/", 0) ? info.name : info.name.substr(group.size() + 1);
+                ImGui::TreeNodeEx(name.c_str(), ImGuiTreeNodeFlags_Leaf | ImGuiTreeNodeFlags_NoTreePushOnOpen | ImGuiTreeNodeFlags_SpanFullWidth);
+                if (ImGui::IsItemHovered()) {
+                    // Show where the output of the block goes
+                    ImGui::BeginTooltip();
+                    ImGui::Text("Waiting %d%%, %.0f runs/s", (int)round(info.waitLoad * 100.0), info.runRate);
+                    for (int c : info.consumers) {
+                        ImGui::Text("-> %s", infos[c].name.c_str());
+                    }
+                    ImGui::EndTooltip();
+                }
+
+                ImGui::TableSetColumnIndex(1);
+                char buf[16];
+                sprintf(buf, "%d%%", (int)round(info.load * 100.0));
+                ImGui::ProgressBar(info.load, ImVec2(-1, 0), buf);
+
+                ImGui::TableSetColumnIndex(2);
+                ImGui::Text("%.3f", info.sampleRate / 1e6);
+
+                ImGui::TableSetColumnIndex(3);
+                ImGui::Text("%d", (int)info.queueFull);
+            }
+            ImGui::TreePop();
+        }
+        ImGui::EndTable();
+    }
+}
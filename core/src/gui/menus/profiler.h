@@ -0,0 +1,6 @@
+#pragma once
+
+namespace profiler_menu {
+    void init();
+    void draw(void* ctx);
+}
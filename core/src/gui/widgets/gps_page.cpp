@@ -106,7 +106,7 @@ void GPSPage::drawSatelliteTable() {
                 ImGui::TableNextRow();
                 
                 ImGui::TableSetColumnIndex(0);
-                ImGui::Text("%s", sat.system.c_str());
+                ImGui::Text("%s", sat.system);
                 
                 ImGui::TableSetColumnIndex(1);
                 ImGui::Text("%d", sat.prn);
@@ -0,0 +1,332 @@
+#include <gui/widgets/map_tile_cache.h>
+#include <gui/gui.h>
+#include <utils/flog.h>
+#include <utils/thread_role.h>
+#include <imgui/stb_image.h>
+#include <curl/curl.h>
+#include <sstream>
+#include <algorithm>
+
+namespace {
+    struct DownloadContext {
+        MapTileCache* cache;
+        uint64_t key;
+        std::vector<uint8_t>* data;
+    };
+}
+
+void MapTileCache::init(const std::string& storePath, const std::string& legacyDir, const std::string& tileServerURL) {
+    this->tileServerURL = tileServerURL;
+
+    // Index the store once instead of checking for every tile on every frame
+    if (store.open(storePath)) {
+        store.importFiles(legacyDir);
+        std::lock_guard<std::mutex> lck(mtx);
+        onDisk.clear();
+        store.forEach([this](int tileX, int tileY, int zoom) {
+            onDisk.insert(makeKey(tileX, tileY, zoom));
+        });
+        flog::info("Found {0} map tiles in {1}", (int)onDisk.size(), storePath);
+    }
+
+    // Must be done before any thread creates a curl handle
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+
+    // Leave at least one core to the DSP
+    int workerCount = std::clamp<int>((int)std::thread::hardware_concurrency() - 1, 1, 2);
+    stopWorkers = false;
+    for (int i = 0; i < workerCount; i++) {
+        workers.push_back(std::thread(&MapTileCache::decodeWorker, this));
+    }
+    for (int i = 0; i < MAP_TILE_DOWNLOAD_WORKERS; i++) {
+        workers.push_back(std::thread(&MapTileCache::downloadWorker, this));
+    }
+}
+
+void MapTileCache::deinit() {
+    {
+        std::lock_guard<std::mutex> lck(mtx);
+        stopWorkers = true;
+    }
+    cnd.notify_all();
+    downloadCnd.notify_all();
+    for (auto& worker : workers) {
+        if (worker.joinable()) { worker.join(); }
+    }
+    workers.clear();
+
+    // Free everything that was not uploaded yet
+    for (auto& tile : decoded) {
+        stbi_image_free(tile.pixels);
+    }
+    decoded.clear();
+    decodeQueue.clear();
+    pending.clear();
+    downloadQueue.clear();
+    downloading.clear();
+    store.close();
+
+    for (auto& [key, tex] : textures) {
+        glDeleteTextures(1, &tex.id);
+    }
+    textures.clear();
+    lru.clear();
+}
+
+void MapTileCache::beginFrame() {
+    frame++;
+
+    // Take at most the upload budget, the rest waits for the next frame
+    std::vector<DecodedTile> toUpload;
+    bool remaining;
+    {
+        std::lock_guard<std::mutex> lck(mtx);
+        int count = std::min<int>(decoded.size(), MAP_TILE_UPLOADS_PER_FRAME);
+        toUpload.assign(decoded.begin(), decoded.begin() + count);
+        decoded.erase(decoded.begin(), decoded.begin() + count);
+        remaining = !decoded.empty();
+    }
+
+    for (auto& tile : toUpload) {
+        GLuint tex = 0;
+        glGenTextures(1, &tex);
+        if (tex) {
+            glBindTexture(GL_TEXTURE_2D, tex);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, tile.width, tile.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, tile.pixels);
+
+            lru.push_front(tile.key);
+            textures[tile.key] = { tex, frame, lru.begin() };
+        }
+        stbi_image_free(tile.pixels);
+
+        std::lock_guard<std::mutex> lck(mtx);
+        pending.erase(tile.key);
+    }
+
+    evictTextures();
+
+    if (remaining) { gui::frameScheduler.requestFrame(); }
+}
+
+int MapTileCache::getTile(int tileX, int tileY, int zoom, GLuint& texture) {
+    int maxTileCoord = (1 << zoom) - 1;
+    if (tileX < 0 || tileX > maxTileCoord || tileY < 0 || tileY > maxTileCoord) {
+        return MAP_TILE_INVALID;
+    }
+
+    uint64_t key = makeKey(tileX, tileY, zoom);
+    auto it = textures.find(key);
+    if (it != textures.end()) {
+        // Move to the front of the LRU
+        it->second.lastUsed = frame;
+        lru.splice(lru.begin(), lru, it->second.lruIt);
+        texture = it->second.id;
+        return MAP_TILE_READY;
+    }
+
+    return request(key, true, true);
+}
+
+void MapTileCache::prefetch(int tileX, int tileY, int zoom, bool download) {
+    int maxTileCoord = (1 << zoom) - 1;
+    if (zoom < 0 || tileX < 0 || tileX > maxTileCoord || tileY < 0 || tileY > maxTileCoord) { return; }
+    uint64_t key = makeKey(tileX, tileY, zoom);
+    if (textures.find(key) != textures.end()) { return; }
+    request(key, false, download);
+}
+
+int MapTileCache::request(uint64_t key, bool highPriority, bool download) {
+    std::lock_guard<std::mutex> lck(mtx);
+    if (pending.find(key) != pending.end()) {
+        // Tiles needed on screen get ahead of the prefetched ones
+        if (highPriority) {
+            auto it = std::find(decodeQueue.begin(), decodeQueue.end(), key);
+            if (it != decodeQueue.end() && it != decodeQueue.begin()) {
+                decodeQueue.erase(it);
+                decodeQueue.push_front(key);
+            }
+        }
+        return MAP_TILE_LOADING;
+    }
+
+    if (onDisk.find(key) != onDisk.end()) {
+        if (highPriority) {
+            decodeQueue.push_front(key);
+        }
+        else {
+            decodeQueue.push_back(key);
+        }
+        pending.insert(key);
+
+        // Drop the oldest low priority requests when panning faster than tiles can be decoded
+        while (decodeQueue.size() > MAP_TILE_MAX_QUEUED) {
+            pending.erase(decodeQueue.back());
+            decodeQueue.pop_back();
+        }
+        cnd.notify_one();
+        return MAP_TILE_LOADING;
+    }
+
+    // Keep track of when it was last needed so that downloads can be cancelled once scrolled away
+    auto it = downloading.find(key);
+    if (it != downloading.end()) {
+        it->second = frame;
+        if (highPriority) {
+            auto qit = std::find(downloadQueue.begin(), downloadQueue.end(), key);
+            if (qit != downloadQueue.end() && qit != downloadQueue.begin()) {
+                downloadQueue.erase(qit);
+                downloadQueue.push_front(key);
+            }
+        }
+        return MAP_TILE_DOWNLOADING;
+    }
+
+    if (!download || store.isReadOnly()) { return MAP_TILE_INVALID; }
+    downloading[key] = frame;
+    if (highPriority) {
+        downloadQueue.push_front(key);
+    }
+    else {
+        downloadQueue.push_back(key);
+    }
+    while (downloadQueue.size() > MAP_TILE_MAX_QUEUED) {
+        downloading.erase(downloadQueue.back());
+        downloadQueue.pop_back();
+    }
+    downloadCnd.notify_one();
+    return MAP_TILE_DOWNLOADING;
+}
+
+bool MapTileCache::isWanted(uint64_t key) {
+    std::lock_guard<std::mutex> lck(mtx);
+    auto it = downloading.find(key);
+    return it != downloading.end() && it->second + MAP_TILE_CANCEL_FRAMES >= frame;
+}
+
+size_t MapTileCache::writeCallback(void* ptr, size_t size, size_t nmemb, void* ctx) {
+    DownloadContext* dlCtx = (DownloadContext*)ctx;
+    uint8_t* data = (uint8_t*)ptr;
+    dlCtx->data->insert(dlCtx->data->end(), data, data + (size * nmemb));
+    return size * nmemb;
+}
+
+int MapTileCache::progressCallback(void* ctx, curl_off_t dltotal, curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow) {
+    // Returning non-zero aborts the transfer
+    DownloadContext* dlCtx = (DownloadContext*)ctx;
+    return dlCtx->cache->isWanted(dlCtx->key) ? 0 : 1;
+}
+
+void MapTileCache::downloadWorker() {
+    thread_role::apply(THREAD_ROLE_BACKGROUND, "tile-download");
+
+    // One handle per worker, reusing it keeps the connection to the tile server alive
+    CURL* curl = curl_easy_init();
+    if (!curl) {
+        flog::warn("Failed to initialize CURL");
+        return;
+    }
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, writeCallback);
+    curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, progressCallback);
+    curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+    curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1L);
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(curl, CURLOPT_USERAGENT, "TileDownloader/1.0 (your_email@example.com)");
+
+    std::vector<uint8_t> data;
+    while (true) {
+        uint64_t key;
+        {
+            std::unique_lock<std::mutex> lck(mtx);
+            downloadCnd.wait(lck, [this]() { return !downloadQueue.empty() || stopWorkers; });
+            if (stopWorkers) { break; }
+            key = downloadQueue.front();
+            downloadQueue.pop_front();
+
+            // Skip tiles that went off screen while queued
+            if (downloading[key] + MAP_TILE_CANCEL_FRAMES < frame) {
+                downloading.erase(key);
+                continue;
+            }
+        }
+
+        int tileX, tileY, zoom;
+        splitKey(key, tileX, tileY, zoom);
+        std::ostringstream urlStream;
+        urlStream << tileServerURL << zoom << "/" << tileX << "/" << tileY << ".png";
+        std::string url = urlStream.str();
+
+        data.clear();
+        DownloadContext ctx = { this, key, &data };
+        curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &ctx);
+        curl_easy_setopt(curl, CURLOPT_XFERINFODATA, &ctx);
+        CURLcode res = curl_easy_perform(curl);
+
+        bool success = false;
+        if (res == CURLE_OK && !data.empty()) {
+            success = store.write(tileX, tileY, zoom, data.data(), data.size());
+        }
+        else if (res != CURLE_ABORTED_BY_CALLBACK) {
+            flog::warn("Failed to download tile {0}/{1}/{2}: {3}", zoom, tileX, tileY, curl_easy_strerror(res));
+        }
+
+        {
+            std::lock_guard<std::mutex> lck(mtx);
+            downloading.erase(key);
+            if (success) { onDisk.insert(key); }
+        }
+        if (success) { gui::frameScheduler.requestFrame(); }
+    }
+
+    curl_easy_cleanup(curl);
+}
+
+void MapTileCache::decodeWorker() {
+    thread_role::apply(THREAD_ROLE_BACKGROUND, "tile-decode");
+    std::vector<uint8_t> data;
+    while (true) {
+        uint64_t key;
+        {
+            std::unique_lock<std::mutex> lck(mtx);
+            cnd.wait(lck, [this]() { return !decodeQueue.empty() || stopWorkers; });
+            if (stopWorkers) { return; }
+            key = decodeQueue.front();
+            decodeQueue.pop_front();
+        }
+
+        int tileX, tileY, zoom;
+        splitKey(key, tileX, tileY, zoom);
+        int w, h, ch;
+        uint8_t* pixels = NULL;
+        if (store.read(tileX, tileY, zoom, data)) {
+            pixels = stbi_load_from_memory(data.data(), data.size(), &w, &h, &ch, 4);
+        }
+
+        std::lock_guard<std::mutex> lck(mtx);
+        if (!pixels) {
+            // Corrupted tile, forget about it so that it gets downloaded again
+            flog::warn("Failed to decode tile {0}/{1}/{2}", zoom, tileX, tileY);
+            onDisk.erase(key);
+            pending.erase(key);
+            continue;
+        }
+        decoded.push_back({ key, w, h, pixels });
+        gui::frameScheduler.requestFrame();
+    }
+}
+
+void MapTileCache::evictTextures() {
+    // Never evict what was drawn in the previous frame, even if that means going over the limit
+    while (textures.size() > MAP_TILE_MAX_TEXTURES) {
+        uint64_t key = lru.back();
+        auto it = textures.find(key);
+        if (it->second.lastUsed + 1 >= frame) { break; }
+        glDeleteTextures(1, &it->second.id);
+        textures.erase(it);
+        lru.pop_back();
+    }
+}
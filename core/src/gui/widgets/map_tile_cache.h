@@ -0,0 +1,109 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <deque>
+#include <list>
+#include <unordered_map>
+#include <unordered_set>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <stdint.h>
+#include <utils/opengl_include_code.h>
+#include <gui/widgets/map_tile_store.h>
+#include <curl/curl.h>
+
+#define MAP_TILE_INVALID            -1
+#define MAP_TILE_READY              0
+#define MAP_TILE_LOADING            1
+#define MAP_TILE_DOWNLOADING        2
+
+// Maximum number of tile textures kept on the GPU (256x256 RGBA, 256KB each)
+#define MAP_TILE_MAX_TEXTURES       192
+
+// Maximum number of decoded tiles uploaded to the GPU per frame
+#define MAP_TILE_UPLOADS_PER_FRAME  4
+
+// Decode and download requests beyond this are dropped, they are requested again if still needed
+#define MAP_TILE_MAX_QUEUED         64
+
+// Number of parallel downloads, tile servers usually ask for no more than two connections
+#define MAP_TILE_DOWNLOAD_WORKERS   2
+
+// Downloads of tiles that weren't requested for this many frames are cancelled
+#define MAP_TILE_CANCEL_FRAMES      2
+
+// Keeps track of the map tiles available in the tile store, downloads and decodes them in the
+// background and caches a bounded number of them as textures. Only getTile() and beginFrame()
+// touch GL and must be called from the render thread.
+class MapTileCache {
+public:
+    // Tiles from the old per-file cache found in legacyDir are moved into the store
+    void init(const std::string& storePath, const std::string& legacyDir, const std::string& tileServerURL);
+    void deinit();
+
+    // Upload decoded tiles within the per-frame budget and evict old textures
+    void beginFrame();
+
+    // Returns the texture of a tile if ready, otherwise schedules its loading or download
+    int getTile(int tileX, int tileY, int zoom, GLuint& texture);
+
+    // Load a tile ahead of time at low priority. Only tiles already in the store are loaded
+    // unless download is true.
+    void prefetch(int tileX, int tileY, int zoom, bool download);
+
+private:
+    struct Texture {
+        GLuint id;
+        uint64_t lastUsed;
+        std::list<uint64_t>::iterator lruIt;
+    };
+
+    struct DecodedTile {
+        uint64_t key;
+        int width;
+        int height;
+        uint8_t* pixels;
+    };
+
+    static inline uint64_t makeKey(int tileX, int tileY, int zoom) {
+        return ((uint64_t)zoom << 48) | ((uint64_t)tileX << 24) | (uint64_t)tileY;
+    }
+
+    static inline void splitKey(uint64_t key, int& tileX, int& tileY, int& zoom) {
+        zoom = (int)(key >> 48);
+        tileX = (int)((key >> 24) & 0xFFFFFF);
+        tileY = (int)(key & 0xFFFFFF);
+    }
+
+    static size_t writeCallback(void* ptr, size_t size, size_t nmemb, void* ctx);
+    static int progressCallback(void* ctx, curl_off_t dltotal, curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow);
+
+    int request(uint64_t key, bool highPriority, bool download);
+    bool isWanted(uint64_t key);
+    void decodeWorker();
+    void downloadWorker();
+    void evictTextures();
+
+    std::string tileServerURL;
+    MapTileStore store;
+    std::atomic<uint64_t> frame = 0;
+
+    // Shared with the workers
+    std::mutex mtx;
+    std::condition_variable cnd;
+    std::unordered_set<uint64_t> onDisk;
+    std::unordered_set<uint64_t> pending;
+    std::deque<uint64_t> decodeQueue;
+    std::vector<DecodedTile> decoded;
+    std::unordered_map<uint64_t, uint64_t> downloading;   // Last frame the tile was requested in
+    std::deque<uint64_t> downloadQueue;
+    std::condition_variable downloadCnd;
+    bool stopWorkers = false;
+    std::vector<std::thread> workers;
+
+    // Render thread only
+    std::unordered_map<uint64_t, Texture> textures;
+    std::list<uint64_t> lru;
+};
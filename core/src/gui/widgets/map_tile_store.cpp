@@ -0,0 +1,170 @@
+#include <gui/widgets/map_tile_store.h>
+#include <utils/flog.h>
+#include <sqlite3.h>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdio.h>
+#include <string.h>
+
+MapTileStore::~MapTileStore() {
+    close();
+}
+
+bool MapTileStore::open(const std::string& path) {
+    std::lock_guard<std::mutex> lck(mtx);
+    if (sqlite3_open_v2(path.c_str(), &db, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_NOMUTEX, NULL) != SQLITE_OK) {
+        flog::error("Could not open tile store {0}: {1}", path, db ? sqlite3_errmsg(db) : "out of memory");
+        sqlite3_close(db);
+        db = NULL;
+        return false;
+    }
+
+    // WAL avoids rewriting the whole page on every insert, which matters a lot on SD cards
+    exec("PRAGMA journal_mode=WAL;");
+    exec("PRAGMA synchronous=NORMAL;");
+    exec("CREATE TABLE IF NOT EXISTS metadata (name TEXT, value TEXT);");
+    exec("CREATE TABLE IF NOT EXISTS tiles (zoom_level INTEGER, tile_column INTEGER, tile_row INTEGER, tile_data BLOB);");
+
+    // Tile table might be a view in a pre-seeded file
+    sqlite3_stmt* stmt;
+    readOnly = false;
+    if (sqlite3_prepare_v2(db, "SELECT type FROM sqlite_master WHERE name='tiles';", -1, &stmt, NULL) == SQLITE_OK) {
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            readOnly = !strcmp((const char*)sqlite3_column_text(stmt, 0), "view");
+        }
+        sqlite3_finalize(stmt);
+    }
+    if (readOnly) {
+        flog::warn("Tile store {0} is read only, missing tiles won't be downloaded", path);
+    }
+    else {
+        exec("CREATE UNIQUE INDEX IF NOT EXISTS tile_index ON tiles (zoom_level, tile_column, tile_row);");
+    }
+
+    sqlite3_prepare_v2(db, "SELECT tile_data FROM tiles WHERE zoom_level=? AND tile_column=? AND tile_row=?;", -1, &readStmt, NULL);
+    if (!readOnly) {
+        sqlite3_prepare_v2(db, "INSERT OR REPLACE INTO tiles (zoom_level, tile_column, tile_row, tile_data) VALUES (?, ?, ?, ?);", -1, &writeStmt, NULL);
+    }
+    if (!readStmt) {
+        flog::error("Tile store {0} is invalid: {1}", path, sqlite3_errmsg(db));
+        sqlite3_close(db);
+        db = NULL;
+        return false;
+    }
+    return true;
+}
+
+void MapTileStore::close() {
+    std::lock_guard<std::mutex> lck(mtx);
+    if (!db) { return; }
+    sqlite3_finalize(readStmt);
+    sqlite3_finalize(writeStmt);
+    readStmt = NULL;
+    writeStmt = NULL;
+    sqlite3_close(db);
+    db = NULL;
+}
+
+bool MapTileStore::isOpen() {
+    std::lock_guard<std::mutex> lck(mtx);
+    return db != NULL;
+}
+
+bool MapTileStore::isReadOnly() {
+    std::lock_guard<std::mutex> lck(mtx);
+    return readOnly;
+}
+
+bool MapTileStore::read(int tileX, int tileY, int zoom, std::vector<uint8_t>& data) {
+    std::lock_guard<std::mutex> lck(mtx);
+    if (!db) { return false; }
+    sqlite3_bind_int(readStmt, 1, zoom);
+    sqlite3_bind_int(readStmt, 2, tileX);
+    sqlite3_bind_int(readStmt, 3, (1 << zoom) - 1 - tileY);
+    bool found = false;
+    if (sqlite3_step(readStmt) == SQLITE_ROW) {
+        const uint8_t* blob = (const uint8_t*)sqlite3_column_blob(readStmt, 0);
+        int len = sqlite3_column_bytes(readStmt, 0);
+        data.assign(blob, blob + len);
+        found = (len > 0);
+    }
+    sqlite3_reset(readStmt);
+    return found;
+}
+
+bool MapTileStore::write(int tileX, int tileY, int zoom, const uint8_t* data, int len) {
+    std::lock_guard<std::mutex> lck(mtx);
+    if (!db || !writeStmt) { return false; }
+    sqlite3_bind_int(writeStmt, 1, zoom);
+    sqlite3_bind_int(writeStmt, 2, tileX);
+    sqlite3_bind_int(writeStmt, 3, (1 << zoom) - 1 - tileY);
+    sqlite3_bind_blob(writeStmt, 4, data, len, SQLITE_STATIC);
+    bool ok = (sqlite3_step(writeStmt) == SQLITE_DONE);
+    if (!ok) {
+        flog::warn("Could not store tile {0}/{1}/{2}: {3}", zoom, tileX, tileY, sqlite3_errmsg(db));
+    }
+    sqlite3_reset(writeStmt);
+    sqlite3_clear_bindings(writeStmt);
+    return ok;
+}
+
+void MapTileStore::forEach(std::function<void(int tileX, int tileY, int zoom)> handler) {
+    std::lock_guard<std::mutex> lck(mtx);
+    if (!db) { return; }
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, "SELECT zoom_level, tile_column, tile_row FROM tiles;", -1, &stmt, NULL) != SQLITE_OK) { return; }
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        int zoom = sqlite3_column_int(stmt, 0);
+        int tileX = sqlite3_column_int(stmt, 1);
+        int tileY = (1 << zoom) - 1 - sqlite3_column_int(stmt, 2);
+        handler(tileX, tileY, zoom);
+    }
+    sqlite3_finalize(stmt);
+}
+
+int MapTileStore::importFiles(const std::string& dir) {
+    if (isReadOnly()) { return 0; }
+    int count = 0;
+    std::error_code ec;
+    std::vector<std::filesystem::path> imported;
+    {
+        std::lock_guard<std::mutex> lck(mtx);
+        exec("BEGIN;");
+    }
+    for (const auto& entry : std::filesystem::directory_iterator(dir, ec)) {
+        int zoom, tileX, tileY;
+        std::string name = entry.path().filename().string();
+        if (sscanf(name.c_str(), "tile_%d_%d_%d.png", &zoom, &tileX, &tileY) != 3) { continue; }
+        std::ifstream file(entry.path(), std::ios::binary);
+        std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        if (!data.empty()) {
+            if (!write(tileX, tileY, zoom, data.data(), data.size())) { continue; }
+            count++;
+        }
+        imported.push_back(entry.path());
+    }
+    {
+        std::lock_guard<std::mutex> lck(mtx);
+        exec("COMMIT;");
+    }
+
+    // Only delete the files once they're safely committed
+    for (const auto& path : imported) {
+        std::filesystem::remove(path, ec);
+    }
+    if (count) {
+        flog::info("Imported {0} map tiles into the tile store", count);
+    }
+    return count;
+}
+
+bool MapTileStore::exec(const char* sql) {
+    char* err = NULL;
+    if (sqlite3_exec(db, sql, NULL, NULL, &err) != SQLITE_OK) {
+        flog::warn("Tile store query failed: {0}", err ? err : "unknown error");
+        sqlite3_free(err);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <mutex>
+#include <functional>
+#include <stdint.h>
+
+struct sqlite3;
+struct sqlite3_stmt;
+
+// Map tiles stored in a single MBTiles (SQLite) file instead of one PNG file per tile.
+// Tiles are addressed with the usual XYZ scheme, the row flip of MBTiles is done internally.
+// Any MBTiles file made by standard tools can be used to seed it for offline use.
+class MapTileStore {
+public:
+    ~MapTileStore();
+
+    bool open(const std::string& path);
+    void close();
+    bool isOpen();
+
+    // Stores that use a view for the tile table (deduplicated MBTiles) can only be read
+    bool isReadOnly();
+
+    bool read(int tileX, int tileY, int zoom, std::vector<uint8_t>& data);
+    bool write(int tileX, int tileY, int zoom, const uint8_t* data, int len);
+
+    // Calls handler for every tile in the store
+    void forEach(std::function<void(int tileX, int tileY, int zoom)> handler);
+
+    // Move tile_z_x_y.png files from the old per-file cache into the store
+    int importFiles(const std::string& dir);
+
+private:
+    bool exec(const char* sql);
+
+    std::mutex mtx;
+    sqlite3* db = NULL;
+    sqlite3_stmt* readStmt = NULL;
+    sqlite3_stmt* writeStmt = NULL;
+    bool readOnly = false;
+};
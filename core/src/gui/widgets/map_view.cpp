@@ -1,23 +1,12 @@
 #include <gui/widgets/map_view.h>
 #include <gui/icons.h>
-#include <thread>
-#include <ostream>
 #include <utils/flog.h>
-#include <curl/curl.h>
 #include <cmath>
-#include <fstream>
-#include <sstream>
 #include <filesystem>
-#include <imgui/stb_image.h>
 #include <core.h>
 #include <gui/widgets/mode_s_page.h>
 
 
-#define TILE_INVALID			-1
-#define TILE_EXISTS				0
-#define TILE_DOWNLOAD_STARTED	1
-#define TILE_DOWNLOADING		2
-
 #define TILE_WIDTH				256
 #define TILE_HALF_WIDTH			128
 #define TILE_HEIGHT				256
@@ -30,157 +19,6 @@
 #define OSM_ICON_HEIGHT			40
 
 
-std::mutex MapView::MapTileProvider::downloadingFilesMutex;
-std::unordered_set<std::string> MapView::MapTileProvider::downloadingFiles;
-
-bool MapView::MapTileProvider::tileFileExists(const std::string& filename) {
-	std::ifstream f(filename.c_str());
-	return f.good();
-}
-
-bool MapView::MapTileProvider::isTileFileEmpty(const std::string& filename) {
-    try {
-        return std::filesystem::file_size(filename) == 0;
-    } catch (const std::filesystem::filesystem_error&) {
-        return false;
-    }
-}
-
-bool MapView::MapTileProvider::addToDownloadingList(const std::string& filename) {
-	std::lock_guard<std::mutex> lock(downloadingFilesMutex);
-	if (downloadingFiles.find(filename) != downloadingFiles.end()) {
-		return false;
-	}
-	downloadingFiles.insert(filename);
-	return true;
-}
-
-void MapView::MapTileProvider::removeFromDownloadingList(const std::string& filename) {
-	std::lock_guard<std::mutex> lock(downloadingFilesMutex);
-	downloadingFiles.erase(filename);
-}
-
-bool MapView::MapTileProvider::downloadTile(int tileX, int tileY, int zoom, const std::string& outputFile) {
-    CURL* curl = curl_easy_init();
-    if (!curl) {
-		flog::warn("Failed to initialize CURL");
-        return false;
-    }
-
-    std::ostringstream urlStream;
-    urlStream << tileServerURL << zoom << "/" << tileX << "/" << tileY << ".png";
-    std::string url = urlStream.str();
-	
-	std::string outputFilePath = tilesDir + "/" + outputFile;
-    FILE* file = fopen(outputFilePath.c_str(), "wb");
-    if (!file) {
-		flog::warn("Failed to open file for writing: {0}", outputFile);
-        curl_easy_cleanup(curl);
-        return false;
-    }
-
-    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, writeFileCallback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, file);
-
-    // User-Agent header
-    curl_easy_setopt(curl, CURLOPT_USERAGENT, "TileDownloader/1.0 (your_email@example.com)");
-
-    CURLcode res = curl_easy_perform(curl);
-    if (res != CURLE_OK) {
-		flog::warn("CURL error: {0}", curl_easy_strerror(res));
-        fclose(file);
-        curl_easy_cleanup(curl);
-        return false;
-    }
-
-    fclose(file);
-    curl_easy_cleanup(curl);
-    return true;
-}
-
-int MapView::MapTileProvider::requestTile(int tileX, int tileY, int zoom, const std::string& outputFile) {
-	
-	int maxTileCoord = (1 << zoom) - 1;
-	if (tileX < 0 || tileX > maxTileCoord || tileY < 0 || tileY > maxTileCoord) {
-		return TILE_INVALID;
-	}
-	
-	std::string tileFilePath = tilesDir + "/" + outputFile;
-	if (tileFileExists(tileFilePath) && !isTileFileEmpty(tileFilePath)) {
-		return TILE_EXISTS;
-	}
-	
-	if (!addToDownloadingList(outputFile)) {
-		return TILE_DOWNLOADING;
-	}
-
-	std::thread downloadThread([this, tileX, tileY, zoom, outputFile]() {
-		auto cleanup = [this, outputFile]() {
-			removeFromDownloadingList(outputFile);
-		};
-		try {
-			bool success = downloadTile(tileX, tileY, zoom, outputFile);
-			if (!success) {
-				flog::warn("Failed to download tile: {0}", outputFile);
-                std::error_code ec;
-                std::filesystem::remove(tilesDir + "/" + outputFile, ec);
-			} else {
-				flog::info("Download OK: {0}", outputFile);
-			}
-		}
-		catch (const std::exception& e) {
-			flog::warn("Exception while downloading tile: {0}", e.what());
-			std::error_code ec;
-            std::filesystem::remove(tilesDir + "/" + outputFile, ec);
-		}
-		cleanup();
-	});
-	
-	downloadThread.detach();
-	
-	return TILE_DOWNLOAD_STARTED;
-}
-
-GLuint MapView::MapTileProvider::getTexture(std::string tileFile) {
-	auto it = textureMap.find(tileFile);
-	if (it != textureMap.end()) {
-		return it->second;
-	}
-	
-    int w, h, ch;
-	std::string path = tilesDir + "/" + tileFile;
-    uint8_t* data = stbi_load(path.c_str(), &w, &h, &ch, 4);
-	if (!data) {
-		return 0;
-	}
-
-    GLuint tex;
-    glGenTextures(1, &tex);
-	if (tex == 0) {
-        stbi_image_free(data);
-        return 0;
-    }
-	
-    glBindTexture(GL_TEXTURE_2D, tex);
-	
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-	
-    stbi_image_free(data);
-	
-	if (tex != 0) {
-		textureMap[tileFile] = tex;
-	}
-	
-    return tex;
-}
-
-
 double MapView::OSMScaleBar::calculateGroundResolution(double latitude, int zoomLevel) {
     double latitudeRad = latitude * M_PI / 180.0;
     return (cos(latitudeRad) * 2.0 * M_PI * EARTH_RADIUS) / (TILE_SIZE * pow(2.0, zoomLevel));
@@ -296,7 +134,8 @@ const char* MapView::getLabel() {
 
 void MapView::init() {
 	core::configManager.acquire();
-	provider.tileServerURL = core::configManager.conf["tileServer"];
+	std::string tileServerURL = core::configManager.conf["tileServer"];
+	std::string tileStorePath = core::configManager.conf["tileStore"];
 	zoom = core::configManager.conf["zoom"];
 	panLon = core::configManager.conf["panLon"];
 	panLat = core::configManager.conf["panLat"];
@@ -305,9 +144,16 @@ void MapView::init() {
 	longitude = core::configManager.conf["longitude"];
 	latitude = core::configManager.conf["latitude"];
     core::configManager.release();
+
+	// The store can be replaced by a pre-seeded MBTiles file for offline use
+	if (tileStorePath.rfind("%ROOT%", 0) == 0) {
+		tileStorePath = rootPath + tileStorePath.substr(6);
+	}
+	tileCache.init(tileStorePath, tilesDir, tileServerURL);
 }
 
 void MapView::deinit() {
+	tileCache.deinit();
 	core::configManager.acquire();
 	core::configManager.conf["longitude"] = longitude;
 	core::configManager.conf["latitude"] = latitude;
@@ -357,6 +203,8 @@ void MapView::draw() {
 	ImGui::PushStyleVar(ImGuiStyleVar_ChildBorderSize, 0.0f);
 	ImGui::BeginChild("Map View", ImVec2(0, 0), true, ImGuiWindowFlags_NoScrollbar | ImGuiWindowFlags_NoScrollWithMouse);
 	
+	tileCache.beginFrame();
+	
 	bool posLocked = (core::gps.getFixQuality() != 0);
 	if (posLocked) {
 		prevPosLocked = true;
@@ -377,14 +225,11 @@ void MapView::draw() {
 	int pxOffsetX, pxOffsetY;
 	latLonToTilePixel(latitude, longitude, tileX, tileY, pxOffsetX, pxOffsetY);
 	
-	std::string outputFile = "tile_" + std::to_string(zoom) + "_" + 
-							std::to_string(tileX) + "_" + 
-							std::to_string(tileY) + ".png";
-
-	int result = provider.requestTile(tileX, tileY, zoom, outputFile);
-	if (result == TILE_EXISTS) {
+	GLuint centerTexture = 0;
+	int result = tileCache.getTile(tileX, tileY, zoom, centerTexture);
+	if (result != MAP_TILE_INVALID) {
 		// Center tile
-		ImTextureID tile = (ImTextureID)(uintptr_t)provider.getTexture(outputFile);
+		ImTextureID tile = (ImTextureID)(uintptr_t)centerTexture;
 		
 		ImVec2 availableRegion = ImGui::GetContentRegionAvail();
 		float offsetX = (availableRegion.x - TILE_WIDTH) * 0.5f;
@@ -411,10 +256,12 @@ void MapView::draw() {
 		ImVec2 tileScreenPos = ImVec2(ImGui::GetCursorPosX() + offsetX, ImGui::GetCursorPosY() + offsetY);
 		ImGui::SetCursorPos(tileScreenPos);
 		ImVec2 tileGlobalPos = ImGui::GetCursorScreenPos();
-		ImGui::Image(
-			(void*)(intptr_t)tile, 
-			ImVec2(TILE_WIDTH, TILE_HEIGHT)
-		);
+		if (result == MAP_TILE_READY) {
+			ImGui::Image(
+				(void*)(intptr_t)tile, 
+				ImVec2(TILE_WIDTH, TILE_HEIGHT)
+			);
+		}
 		
 		// Other tiles around
 		float tileCenterOffsetX = tileScreenPos.x - TILE_HALF_WIDTH;
@@ -430,19 +277,17 @@ void MapView::draw() {
 		for (int y = startY; y <= endY; ++y) {
 			for (int x = startX; x <= endX; ++x) {
 				if (x != tileX || y != tileY) {
-					std::string outputFile = "tile_" + std::to_string(zoom) + "_" + 
-							std::to_string(x) + "_" + 
-							std::to_string(y) + ".png";
-					int res = provider.requestTile(x, y, zoom, outputFile);
-					if (res == TILE_EXISTS) {
+					GLuint texture = 0;
+					int res = tileCache.getTile(x, y, zoom, texture);
+					if (res == MAP_TILE_READY) {
 						ImVec2 tilePos = ImVec2(tileScreenPos.x + (x - tileX) * TILE_WIDTH, tileScreenPos.y + (y - tileY) * TILE_HEIGHT);
 						ImGui::SetCursorPos(tilePos);
-						ImTextureID tile = (ImTextureID)(uintptr_t)provider.getTexture(outputFile);
+						ImTextureID tile = (ImTextureID)(uintptr_t)texture;
 						ImGui::Image(
 							(void*)(intptr_t)tile, 
 							ImVec2(TILE_WIDTH, TILE_HEIGHT)
 						);
-					} else if (res == TILE_DOWNLOADING) {
+					} else if (res == MAP_TILE_DOWNLOADING) {
 						ImVec2 tilePos = ImVec2(tileScreenPos.x + (x - tileX) * TILE_WIDTH, tileScreenPos.y + (y - tileY) * TILE_HEIGHT);
 						const char* text = "Downloading...";
 						ImVec2 textSize = ImGui::CalcTextSize(text);
@@ -457,6 +302,32 @@ void MapView::draw() {
 			}
 		}
 		
+		// Prefetch the ring around the visible tiles for panning
+		for (int x = startX - 1; x <= endX + 1; ++x) {
+			tileCache.prefetch(x, startY - 1, zoom, true);
+			tileCache.prefetch(x, endY + 1, zoom, true);
+		}
+		for (int y = startY; y <= endY; ++y) {
+			tileCache.prefetch(startX - 1, y, zoom, true);
+			tileCache.prefetch(endX + 1, y, zoom, true);
+		}
+		
+		// And the tiles already on disk for the adjacent zoom levels
+		if (zoom < 19) {
+			for (int y = tileY * 2 - 1; y <= tileY * 2 + 2; ++y) {
+				for (int x = tileX * 2 - 1; x <= tileX * 2 + 2; ++x) {
+					tileCache.prefetch(x, y, zoom + 1, false);
+				}
+			}
+		}
+		if (zoom > 1) {
+			for (int y = startY >> 1; y <= endY >> 1; ++y) {
+				for (int x = startX >> 1; x <= endX >> 1; ++x) {
+					tileCache.prefetch(x, y, zoom - 1, false);
+				}
+			}
+		}
+		
 		// Current position marker
 		ImVec2 markerPos = ImVec2(tileGlobalPos.x + pxOffsetX, tileGlobalPos.y + pxOffsetY);
 		ImDrawList* drawList = ImGui::GetWindowDrawList();
@@ -605,7 +476,8 @@ void MapView::latLonToTilePixel(double lat, double lon, int &tileX, int &tileY,
 }
 
 void MapView::setRootPath(std::string path) {
+	rootPath = path;
 	std::string tilesPath = path + "/tiles";
 	std::filesystem::create_directory(tilesPath);
-    provider.tilesDir = tilesPath;
+    tilesDir = tilesPath;
 }
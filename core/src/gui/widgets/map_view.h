@@ -1,10 +1,7 @@
 #pragma once
 #include <gui/widgets/main_view.h>
+#include <gui/widgets/map_tile_cache.h>
 #include <string>
-#include <cstdio>
-#include <unordered_set>
-#include <mutex>
-#include <utils/opengl_include_code.h>
 
 class MapView : public MainView::TabView {
 public:
@@ -25,26 +22,6 @@ private:
 	MapView();
     ~MapView();
 	
-	class MapTileProvider {
-	private:
-		static std::mutex downloadingFilesMutex;
-		static std::unordered_set<std::string> downloadingFiles;
-		std::unordered_map<std::string, GLuint> textureMap;
-		bool tileFileExists(const std::string& filename);
-		bool isTileFileEmpty(const std::string& filename);
-		bool addToDownloadingList(const std::string& filename);
-		void removeFromDownloadingList(const std::string& filename);
-		bool downloadTile(int tileX, int tileY, int zoom, const std::string& outputFile);
-		static size_t writeFileCallback(void* ptr, size_t size, size_t nmemb, FILE* stream) {
-			return fwrite(ptr, size, nmemb, stream);
-		}
-	public:
-		std::string tileServerURL;
-		std::string tilesDir;
-		int requestTile(int tileX, int tileY, int zoom, const std::string& outputFile);
-		GLuint getTexture(std::string tileFile);
-	};
-	
     class OSMScaleBar {
     private:
         static constexpr double EARTH_RADIUS = 6378137.0; // WGS84 ellipsoid semi-major axis
@@ -65,7 +42,9 @@ private:
         double getGroundResolution(double latitude, int zoomLevel);
     };
     
-	MapTileProvider provider;
+	MapTileCache tileCache;
+	std::string rootPath;
+	std::string tilesDir;
 
     OSMScaleBar scaleBar;
 
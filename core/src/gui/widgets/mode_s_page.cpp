@@ -86,6 +86,8 @@ void ModeSPage::addLog(const std::string& message) {
 			log_content += l + "\n";
 		}
 	}
+
+	gui::frameScheduler.requestFrame();
 }
 
 void ModeSPage::processMessage(struct mode_s_message * mm) {
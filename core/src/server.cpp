@@ -1,6 +1,7 @@
 #include "server.h"
 #include "core.h"
 #include <utils/flog.h>
+#include <utils/thread_role.h>
 #include <version.h>
 #include <config.h>
 #include <filesystem>
@@ -11,6 +12,9 @@
 #include "dsp/compression/sample_stream_compressor.h"
 #include "dsp/sink/handler_sink.h"
 #include <zstd.h>
+#include <algorithm>
+#include <thread>
+#include <condition_variable>
 
 namespace server {
     dsp::stream<dsp::complex_t> dummyInput;
@@ -40,6 +44,15 @@ namespace server {
 
     net::Listener listener;
 
+    // Rejected clients, kept until the disconnect command went out. Only used by the network thread.
+    std::vector<net::Conn> rejected;
+
+    // Starting or stopping a source can take a while, the network thread hands it over to the source thread
+    std::thread sourceThread;
+    std::mutex sourceMtx;
+    std::condition_variable sourceCnd;
+    bool sourceWanted = false;
+
     OptionList<std::string, std::string> sourceList;
     int sourceId = 0;
     bool running = false;
@@ -148,6 +161,8 @@ namespace server {
         if (sourceList.keyExists(sourceName)) { sourceId = sourceList.keyId(sourceName); }
         sigpath::sourceManager.selectSource(sourceList[sourceId]);
 
+        sourceThread = std::thread(sourceWorker);
+
         // TODO: Use command line option
         std::string host = (std::string)core::args["addr"];
         int port = (int)core::args["port"];
@@ -161,6 +176,9 @@ namespace server {
     }
 
     void _clientHandler(net::Conn conn, void* ctx) {
+        // Forget the rejected clients that are gone
+        rejected.erase(std::remove_if(rejected.begin(), rejected.end(), [](const net::Conn& c) { return !c->isOpen(); }), rejected.end());
+
         // Reject if someone else is already connected
         if (client && client->isOpen()) {
             flog::info("REJECTED Connection from {0}:{1}, another client is already connected.", "TODO", "TODO");
@@ -172,13 +190,12 @@ namespace server {
             tmp_phdr->size = sizeof(PacketHeader) + sizeof(CommandHeader);
             tmp_phdr->type = PACKET_TYPE_COMMAND;
             tmp_chdr->cmd = COMMAND_DISCONNECT;
-            conn->write(tmp_phdr->size, buf);
+            conn->writeAsync(tmp_phdr->size, buf);
 
-            // TODO: Find something cleaner
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            // Close once the command is out, without holding up the network thread
+            conn->closeAfterFlush();
+            rejected.push_back(std::move(conn));
 
-            conn->close();
-            
             // Start another async accept
             listener->acceptAsync(_clientHandler, NULL);
             return;
@@ -189,7 +206,7 @@ namespace server {
         client->readAsync(sizeof(PacketHeader), rbuf, _packetHandler, NULL);
 
         // Perform settings reset
-        sigpath::sourceManager.stop();
+        setSourceRunning(false);
         comp.setPCMType(dsp::compression::PCM_TYPE_I16);
         compression = false;
 
@@ -203,20 +220,29 @@ namespace server {
     void _packetHandler(int count, uint8_t* buf, void* ctx) {
         PacketHeader* hdr = (PacketHeader*)buf;
 
-        // Read the rest of the data (TODO: CHECK SIZE OR SHIT WILL BE FUCKED + ADD TIMEOUT)
-        int len = 0;
-        int read = 0;
+        // Drop clients sending packets that don't fit the buffer
+        if (hdr->size < sizeof(PacketHeader) || hdr->size > SERVER_MAX_PACKET_SIZE) {
+            flog::error("Invalid packet size from client: {}", hdr->size);
+            client->close();
+            return;
+        }
+
+        // Read the rest of the data without blocking the network thread
         int goal = hdr->size - sizeof(PacketHeader);
-        while (len < goal) {
-            read = client->read(goal - len, &buf[sizeof(PacketHeader) + len]);
-            if (read < 0) { return; };
-            len += read;
+        if (goal > 0) {
+            client->readAsync(goal, &buf[sizeof(PacketHeader)], _packetBodyHandler, NULL);
+            return;
         }
+        _packetBodyHandler(0, &buf[sizeof(PacketHeader)], NULL);
+    }
+
+    void _packetBodyHandler(int count, uint8_t* buf, void* ctx) {
+        PacketHeader* hdr = (PacketHeader*)rbuf;
 
         // Parse and process
         if (hdr->type == PACKET_TYPE_COMMAND && hdr->size >= sizeof(PacketHeader) + sizeof(CommandHeader)) {
-            CommandHeader* chdr = (CommandHeader*)&buf[sizeof(PacketHeader)];
-            commandHandler((Command)chdr->cmd, &buf[sizeof(PacketHeader) + sizeof(CommandHeader)], hdr->size - sizeof(PacketHeader) - sizeof(CommandHeader));
+            CommandHeader* chdr = (CommandHeader*)&rbuf[sizeof(PacketHeader)];
+            commandHandler((Command)chdr->cmd, &rbuf[sizeof(PacketHeader) + sizeof(CommandHeader)], hdr->size - sizeof(PacketHeader) - sizeof(CommandHeader));
         }
         else {
             sendError(ERROR_INVALID_PACKET);
@@ -242,6 +268,35 @@ namespace server {
         if (client && client->isOpen()) { client->write(bb_pkt_hdr->size, bbuf); }
     }
 
+    void setSourceRunning(bool run) {
+        {
+            std::lock_guard<std::mutex> lck(sourceMtx);
+            sourceWanted = run;
+        }
+        sourceCnd.notify_all();
+    }
+
+    void sourceWorker() {
+        thread_role::apply(THREAD_ROLE_BACKGROUND, "server-source");
+        bool started = false;
+        std::unique_lock<std::mutex> lck(sourceMtx);
+        while (true) {
+            // Only the latest request matters, a start and stop sent in a row cancel out
+            sourceCnd.wait(lck, [&]() { return sourceWanted != started; });
+            started = sourceWanted;
+            lck.unlock();
+
+            if (started) {
+                sigpath::sourceManager.start();
+            }
+            else {
+                sigpath::sourceManager.stop();
+            }
+
+            lck.lock();
+        }
+    }
+
     void setInput(dsp::stream<dsp::complex_t>* stream) {
         comp.setInput(stream);
     }
@@ -280,11 +335,11 @@ namespace server {
             }
         }
         else if (cmd == COMMAND_START) {
-            sigpath::sourceManager.start();
+            setSourceRunning(true);
             running = true;
         }
         else if (cmd == COMMAND_STOP) {
-            sigpath::sourceManager.stop();
+            setSourceRunning(false);
             running = false;
         }
         else if (cmd == COMMAND_SET_FREQUENCY && len == 8) {
@@ -10,8 +10,12 @@ namespace server {
 
     void _clientHandler(net::Conn conn, void* ctx);
     void _packetHandler(int count, uint8_t* buf, void* ctx);
+    void _packetBodyHandler(int count, uint8_t* buf, void* ctx);
     void _testServerHandler(uint8_t* data, int count, void* ctx);
 
+    void setSourceRunning(bool run);
+    void sourceWorker();
+
     void drawMenu();
 
     void commandHandler(Command cmd, uint8_t* data, int len);
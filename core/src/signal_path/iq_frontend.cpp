@@ -66,6 +66,27 @@ void IQFrontEnd::init(dsp::stream<dsp::complex_t>* in, double sampleRate, bool b
 
     split.bindStream(&fftIn);
 
+    // Names shown by the profiler
+    inBuf.setProfileName("IQFrontEnd/Input Buffer");
+    decim.setProfileName("IQFrontEnd/Decimator");
+    dcBlock.setProfileName("IQFrontEnd/DC Blocker");
+    conjugate.setProfileName("IQFrontEnd/Conjugate");
+    split.setProfileName("IQFrontEnd/Splitter");
+    reshape.setProfileName("IQFrontEnd/FFT Reshaper");
+    fftSink.setProfileName("IQFrontEnd/FFT");
+
+    // Dropping samples here affects every VFO, the FFT can wait. The pool workers all run as DSP bulk,
+    // so the critical blocks keep a thread of their own.
+    inBuf.setThreadRole(THREAD_ROLE_DSP_CRITICAL);
+    decim.setThreadRole(THREAD_ROLE_DSP_CRITICAL);
+    dcBlock.setThreadRole(THREAD_ROLE_DSP_CRITICAL);
+    conjugate.setThreadRole(THREAD_ROLE_DSP_CRITICAL);
+    split.setThreadRole(THREAD_ROLE_DSP_CRITICAL);
+    decim.setPooled(false);
+    dcBlock.setPooled(false);
+    conjugate.setPooled(false);
+    split.setPooled(false);
+
     _init = true;
 }
 
@@ -147,6 +168,7 @@ dsp::channel::RxVFO* IQFrontEnd::addVFO(std::string name, double sampleRate, dou
     // Create VFO and its input stream
     dsp::stream<dsp::complex_t>* vfoIn = new dsp::stream<dsp::complex_t>;
     dsp::channel::RxVFO* vfo = new dsp::channel::RxVFO(vfoIn, effectiveSr, sampleRate, bandwidth, offset);
+    vfo->setProfileName("VFO/" + name);
 
     // Register them
     vfoStreams[name] = vfoIn;
@@ -0,0 +1,76 @@
+#include <signal_path/sample_clock.h>
+#include <core.h>
+#include <chrono>
+
+namespace {
+    template <class Clock>
+    int64_t nowNs() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+    }
+}
+
+void SampleClock::reset(double sampleRate) {
+    this->sampleRate = sampleRate;
+    sampleIndex = 0;
+    discontinuity = false;
+    anchored = false;
+}
+
+void SampleClock::markDiscontinuity() {
+    discontinuity = true;
+}
+
+void SampleClock::stamp(dsp::stream_meta& meta, int count) {
+    int64_t steadyNow = nowNs<std::chrono::steady_clock>();
+    int64_t systemNow = nowNs<std::chrono::system_clock>();
+
+    // The block was received with its last sample, go back to the first one
+    int64_t blockLength = (int64_t)((double)count * 1e9 / sampleRate);
+    int64_t steadyStart = steadyNow - blockLength;
+    int64_t systemStart = systemNow - blockLength;
+
+    int64_t gpsOffset;
+    bool gps = core::gps.getUtcOffset(gpsOffset);
+    if (gps) { systemStart += gpsOffset; }
+
+    if (!anchored || gps != anchorGps) {
+        anchorGps = gps;
+        anchor(steadyStart, systemStart);
+    }
+    else {
+        int64_t expected = anchorSteady + (int64_t)((double)(sampleIndex - anchorIndex) * 1e9 / sampleRate);
+        int64_t late = steadyStart - expected;
+        if (discontinuity || late > SAMPLE_CLOCK_MAX_LATENCY_NS) {
+            // Samples were dropped somewhere, skip the index forward by the missing time
+            if (late > 0) { sampleIndex += (uint64_t)((double)late * sampleRate / 1e9); }
+            discontinuity = true;
+            anchor(steadyStart, systemStart);
+        }
+        else if (late < 0) {
+            // Arrived earlier than ever, the anchor included some transfer latency
+            anchorSteady += late;
+            anchorUtc += late;
+        }
+        else {
+            anchorSteady += late / SAMPLE_CLOCK_DRIFT_TRACKING;
+        }
+    }
+
+    meta.sampleIndex = sampleIndex;
+    meta.sampleRate = sampleRate;
+    meta.sourceTime = steadyStart;
+    meta.utcTime = anchorUtc + (int64_t)((double)(sampleIndex - anchorIndex) * 1e9 / sampleRate);
+    meta.flags = STREAM_META_VALID;
+    if (anchorGps) { meta.flags |= STREAM_META_GPS_TIME; }
+    if (discontinuity) { meta.flags |= STREAM_META_DISCONTINUITY; }
+
+    discontinuity = false;
+    sampleIndex += count;
+}
+
+void SampleClock::anchor(int64_t steadyTime, int64_t systemTime) {
+    anchored = true;
+    anchorIndex = sampleIndex;
+    anchorSteady = steadyTime;
+    anchorUtc = systemTime;
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <dsp/stream.h>
+
+// Samples arriving this much later than the sample count predicts are assumed to have been lost
+#define SAMPLE_CLOCK_MAX_LATENCY_NS     500000000LL
+
+// Time constant (in blocks) used to follow the drift between the host clock and the sample clock
+#define SAMPLE_CLOCK_DRIFT_TRACKING     1024
+
+// Generates the timing metadata of a source. The sample count is used as the time base since the
+// SDR is clocked from the GPS disciplined reference, the host and GPS clocks are only used to
+// anchor it in absolute time and to detect lost samples.
+class SampleClock {
+public:
+    // Must be called when the source is started or its samplerate changes
+    void reset(double sampleRate);
+
+    // Call when the source knows that samples were lost (USB error, restarted transfer, etc)
+    void markDiscontinuity();
+
+    // Fill in the metadata for a block of count samples that was just received
+    void stamp(dsp::stream_meta& meta, int count);
+
+private:
+    void anchor(int64_t steadyTime, int64_t systemTime);
+
+    double sampleRate = 0.0;
+    uint64_t sampleIndex = 0;
+    bool discontinuity = false;
+
+    bool anchored = false;
+    bool anchorGps = false;
+    uint64_t anchorIndex = 0;
+    int64_t anchorSteady = 0;
+    int64_t anchorUtc = 0;
+};
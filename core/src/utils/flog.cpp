@@ -1,15 +1,28 @@
 #include "flog.h"
-#include <mutex>
+#include <atomic>
+#include <algorithm>
+#include <thread>
 #include <chrono>
 #include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <inttypes.h>
+#include <time.h>
+#include <semaphore.h>
 
 #define FORMAT_BUF_SIZE 16
 #define ESCAPE_CHAR     '\\'
 
-namespace flog {
-    std::mutex outMtx;
+// Size of a single formatted message and number of messages that can be waiting for the writer
+#define MSG_SIZE        512
+#define QUEUE_SIZE      512
+
+// An identical message is printed at most RATE_LIMIT_COUNT times per RATE_LIMIT_WINDOW_MS
+#define RATE_LIMIT_SLOTS        256
+#define RATE_LIMIT_COUNT        2
+#define RATE_LIMIT_WINDOW_MS    1000
 
+namespace flog {
     const char* TYPE_STR[_TYPE_COUNT] = {
         "DEBUG",
         "INFO",
@@ -25,32 +38,320 @@ namespace flog {
         "\x1B[31m",
     };
 
-    void __log__(Type type, const char* fmt, const std::vector<std::string>& args) {
-        // Reserve a buffer for the final output
-        int argCount = args.size();
-        int fmtLen = strlen(fmt) + 1;
-        int totSize = fmtLen;
-        for (const auto& a : args) { totSize += a.size(); }
-        std::string out;
-        out.reserve(totSize);
-        
-        // Get output stream depending on type
+    struct Message {
+        Type type;
+        int64_t timestamp; // Wall clock, in nanoseconds since epoch
+        uint32_t suppressed;
+        int len;
+        char text[MSG_SIZE];
+    };
+
+    // Bounded lock-free multi-producer single-consumer queue. Producers never block, when
+    // the queue is full the message is dropped and counted instead.
+    class MessageQueue {
+    public:
+        MessageQueue() {
+            for (size_t i = 0; i < QUEUE_SIZE; i++) { slots[i].seq.store(i, std::memory_order_relaxed); }
+        }
+
+        Message* beginPush(size_t& pos) {
+            pos = head.load(std::memory_order_relaxed);
+            while (true) {
+                Slot& slot = slots[pos % QUEUE_SIZE];
+                size_t seq = slot.seq.load(std::memory_order_acquire);
+                intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+                if (!diff) {
+                    if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                        return &slot.msg;
+                    }
+                }
+                else if (diff < 0) {
+                    return NULL;
+                }
+                else {
+                    pos = head.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        void endPush(size_t pos) {
+            slots[pos % QUEUE_SIZE].seq.store(pos + 1, std::memory_order_release);
+        }
+
+        Message* front() {
+            Slot& slot = slots[tail % QUEUE_SIZE];
+            size_t seq = slot.seq.load(std::memory_order_acquire);
+            if ((intptr_t)seq - (intptr_t)(tail + 1) < 0) { return NULL; }
+            return &slot.msg;
+        }
+
+        void pop() {
+            Slot& slot = slots[tail % QUEUE_SIZE];
+            slot.seq.store(tail + QUEUE_SIZE, std::memory_order_release);
+            tail++;
+        }
+
+    private:
+        struct Slot {
+            std::atomic<size_t> seq;
+            Message msg;
+        };
+
+        Slot slots[QUEUE_SIZE];
+        alignas(64) std::atomic<size_t> head = 0;
+        alignas(64) size_t tail = 0;
+    };
+
+    // Direct mapped table of recently seen messages, collisions simply reset the limiter
+    struct RateLimitSlot {
+        std::atomic<uint64_t> hash = 0;
+        std::atomic<int64_t> windowStart = 0;
+        std::atomic<uint32_t> count = 0;
+        std::atomic<uint32_t> suppressed = 0;
+    };
+
+    enum LoggerState {
+        LOGGER_STATE_NONE,
+        LOGGER_STATE_RUNNING,
+        LOGGER_STATE_DESTROYED
+    };
+
+    // Constant initialised, so usable before and after the logger itself exists
+    std::atomic<int> loggerState = LOGGER_STATE_NONE;
+    std::atomic<int> minLevel = TYPE_DEBUG;
+
+    class Logger {
+    public:
+        Logger() {
+            sem_init(&sem, 0, 0);
+            running = true;
+            workerThread = std::thread(&Logger::worker, this);
+            loggerState = LOGGER_STATE_RUNNING;
+        }
+
+        ~Logger() {
+            running = false;
+            sem_post(&sem);
+            if (workerThread.joinable()) { workerThread.join(); }
+            if (jsonFile) { fclose(jsonFile); }
+            sem_destroy(&sem);
+            loggerState = LOGGER_STATE_DESTROYED;
+        }
+
+        void push(Type type, int64_t timestamp, const char* text, int len) {
+            // Drop duplicates that repeat too quickly
+            uint32_t suppressed = 0;
+            if (!rateLimit(text, len, suppressed)) { return; }
+
+            size_t pos;
+            Message* msg = queue.beginPush(pos);
+            if (!msg) {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                sem_post(&sem);
+                return;
+            }
+            msg->type = type;
+            msg->timestamp = timestamp;
+            msg->suppressed = suppressed;
+            msg->len = len;
+            memcpy(msg->text, text, len);
+            msg->text[len] = 0;
+            queue.endPush(pos);
+            sem_post(&sem);
+        }
+
+        bool setJsonSink(const std::string& path) {
+            FILE* file = NULL;
+            if (!path.empty()) {
+                file = fopen(path.c_str(), "a");
+                if (!file) { return false; }
+            }
+            FILE* old = jsonFile.exchange(file);
+            if (old) {
+                // Let the writer finish anything it might be doing with the old file
+                flush();
+                fclose(old);
+            }
+            return true;
+        }
+
+        void flush() {
+            uint64_t target = pushed.load();
+            while (written.load() < target && running) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+
+    private:
+        static uint64_t hashMessage(const char* text, int len) {
+            // FNV-1a
+            uint64_t hash = 14695981039346656037ULL;
+            for (int i = 0; i < len; i++) {
+                hash ^= (uint8_t)text[i];
+                hash *= 1099511628211ULL;
+            }
+            return hash ? hash : 1;
+        }
+
+        bool rateLimit(const char* text, int len, uint32_t& suppressed) {
+            uint64_t hash = hashMessage(text, len);
+            int64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+            RateLimitSlot& slot = rateLimitSlots[hash % RATE_LIMIT_SLOTS];
+
+            // New message, take over the slot
+            if (slot.hash.load(std::memory_order_relaxed) != hash) {
+                slot.hash.store(hash, std::memory_order_relaxed);
+                slot.windowStart.store(now, std::memory_order_relaxed);
+                slot.count.store(1, std::memory_order_relaxed);
+                slot.suppressed.store(0, std::memory_order_relaxed);
+                pushed.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+
+            // Start a new window if the old one expired
+            int64_t start = slot.windowStart.load(std::memory_order_relaxed);
+            if (now - start >= RATE_LIMIT_WINDOW_MS && slot.windowStart.compare_exchange_strong(start, now, std::memory_order_relaxed)) {
+                slot.count.store(0, std::memory_order_relaxed);
+            }
+
+            if (slot.count.fetch_add(1, std::memory_order_relaxed) >= RATE_LIMIT_COUNT) {
+                slot.suppressed.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            suppressed = slot.suppressed.exchange(0, std::memory_order_relaxed);
+            pushed.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+
+        void writeJson(FILE* file, const Message& msg) {
+            fprintf(file, "{\"ts\":%" PRId64 ".%09" PRId64 ",\"level\":\"%s\",\"msg\":\"", msg.timestamp / 1000000000, msg.timestamp % 1000000000, TYPE_STR[msg.type]);
+            for (int i = 0; i < msg.len; i++) {
+                char c = msg.text[i];
+                if (c == '"' || c == '\\') {
+                    fputc('\\', file);
+                    fputc(c, file);
+                }
+                else if ((uint8_t)c < 0x20) {
+                    fprintf(file, "\\u%04x", (int)(uint8_t)c);
+                }
+                else {
+                    fputc(c, file);
+                }
+            }
+            fprintf(file, "\"");
+            if (msg.suppressed) { fprintf(file, ",\"suppressed\":%" PRIu32, msg.suppressed); }
+            fprintf(file, "}\n");
+        }
+
+        void writeMessage(const Message& msg) {
+            // Get time
+            time_t nowt = msg.timestamp / 1000000000;
+            int ms = (msg.timestamp / 1000000) % 1000;
+            tm nowc;
+            localtime_r(&nowt, &nowc);
+
+            // Print message
+            FILE* outStream = (msg.type == TYPE_ERROR) ? stderr : stdout;
+            if (msg.suppressed) {
+                fprintf(outStream, COLOR_WHITE "[%02d/%02d/%02d %02d:%02d:%02d.%03d] [%s%s" COLOR_WHITE "] %s (repeated %" PRIu32 " more times)\n",
+                        nowc.tm_mday, nowc.tm_mon + 1, nowc.tm_year + 1900, nowc.tm_hour, nowc.tm_min, nowc.tm_sec, ms, TYPE_COLORS[msg.type], TYPE_STR[msg.type], msg.text, msg.suppressed);
+            }
+            else {
+                fprintf(outStream, COLOR_WHITE "[%02d/%02d/%02d %02d:%02d:%02d.%03d] [%s%s" COLOR_WHITE "] %s\n",
+                        nowc.tm_mday, nowc.tm_mon + 1, nowc.tm_year + 1900, nowc.tm_hour, nowc.tm_min, nowc.tm_sec, ms, TYPE_COLORS[msg.type], TYPE_STR[msg.type], msg.text);
+            }
+
+            FILE* file = jsonFile.load();
+            if (file) { writeJson(file, msg); }
+        }
+
+        void worker() {
+            while (true) {
+                sem_wait(&sem);
+
+                // Write everything available before going back to sleep
+                bool any = false;
+                Message* msg;
+                while ((msg = queue.front()) != NULL) {
+                    writeMessage(*msg);
+                    queue.pop();
+                    written.fetch_add(1);
+                    any = true;
+                }
+
+                // Report messages lost because the queue was full
+                uint64_t lost = dropped.exchange(0, std::memory_order_relaxed);
+                if (lost) {
+                    fprintf(stdout, COLOR_WHITE "[%s%s" COLOR_WHITE "] Log queue full, %" PRIu64 " messages dropped\n", TYPE_COLORS[TYPE_WARNING], TYPE_STR[TYPE_WARNING], lost);
+                    written.fetch_add(lost);
+                    any = true;
+                }
+
+                if (any) {
+                    fflush(stdout);
+                    FILE* file = jsonFile.load();
+                    if (file) { fflush(file); }
+                }
+
+                if (!running && !queue.front()) { break; }
+            }
+        }
+
+        MessageQueue queue;
+        RateLimitSlot rateLimitSlots[RATE_LIMIT_SLOTS];
+        sem_t sem;
+        std::atomic<bool> running = false;
+        std::atomic<uint64_t> dropped = 0;
+        std::atomic<uint64_t> pushed = 0;
+        std::atomic<uint64_t> written = 0;
+        std::atomic<FILE*> jsonFile = NULL;
+        std::thread workerThread;
+    };
+
+    Logger& getLogger() {
+        // Constructed on first use so that logging from static initialisers works
+        static Logger logger;
+        return logger;
+    }
+
+    void writeDirect(Type type, const char* text) {
         FILE* outStream = (type == TYPE_ERROR) ? stderr : stdout;
+        fprintf(outStream, "[%s] %s\n", TYPE_STR[type], text);
+    }
+
+    void __log__(Type type, const char* fmt, const __ArgList__& args) {
+        if (type < minLevel.load(std::memory_order_relaxed)) { return; }
+
+        // Capture the time as early as possible
+        int64_t timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+
+        // Format into a fixed size buffer on the stack
+        char out[MSG_SIZE];
+        int outLen = 0;
+        auto append = [&](const char* str, int len) {
+            int n = std::min<int>(len, MSG_SIZE - 1 - outLen);
+            memcpy(&out[outLen], str, n);
+            outLen += n;
+        };
+        auto appendChar = [&](char c) {
+            if (outLen < MSG_SIZE - 1) { out[outLen++] = c; }
+        };
 
         // Parse format string
+        int argCount = args.count;
         bool escaped = false;
         int formatCounter = 0;
         bool inFormat = false;
         int formatLen = 0;
         char formatBuf[FORMAT_BUF_SIZE+1];
-        for (int i = 0; i < fmtLen; i++) {
+        for (int i = 0; fmt[i]; i++) {
             // Get char
             const char c = fmt[i];
 
             // If this character is escaped, don't try to parse it
             if (escaped) {
                 escaped = false;
-                out += c;
+                appendChar(c);
                 continue;
             }
 
@@ -61,7 +362,7 @@ namespace flog {
                     escaped = true;
                 }
                 else {
-                    out += c;
+                    appendChar(c);
                 }
             }
             else if (!inFormat) {
@@ -76,10 +377,11 @@ namespace flog {
                 if (!formatLen) {
                     // Use format counter as ID if available or print wrong format string
                     if (formatCounter < argCount) {
-                        out += args[formatCounter++];
+                        append(args.str[formatCounter], args.len[formatCounter]);
+                        formatCounter++;
                     }
                     else {
-                        out += "{}";
+                        append("{}", 2);
                     }
                 }
                 else {
@@ -89,12 +391,12 @@ namespace flog {
 
                     // Use ID if available or print wrong format string
                     if (formatCounter < argCount) {
-                        out += args[formatCounter];
+                        append(args.str[formatCounter], args.len[formatCounter]);
                     }
                     else {
-                        out += '{';
-                        out += formatBuf;
-                        out += '}';
+                        appendChar('{');
+                        append(formatBuf, formatLen);
+                        appendChar('}');
                     }
 
                     // Increment format counter
@@ -105,100 +407,117 @@ namespace flog {
                 formatLen = 0;
             }
             else {
-                // Add to format buffer 
+                // Add to format buffer
                 if (formatLen < FORMAT_BUF_SIZE) { formatBuf[formatLen++] = c; }
             }
         }
+        out[outLen] = 0;
 
-        // Get time
-        auto now = std::chrono::system_clock::now();
-        auto nowt = std::chrono::system_clock::to_time_t(now);
-        auto nowc = std::localtime(&nowt); // TODO: This is not threadsafe
-
-        // Write to output
-        {
-            std::lock_guard<std::mutex> lck(outMtx);
-            // Print format string
-            fprintf(outStream, COLOR_WHITE "[%02d/%02d/%02d %02d:%02d:%02d.%03d] [%s%s" COLOR_WHITE "] %s\n",
-                    nowc->tm_mday, nowc->tm_mon + 1, nowc->tm_year + 1900, nowc->tm_hour, nowc->tm_min, nowc->tm_sec, 0, TYPE_COLORS[type], TYPE_STR[type], out.c_str());
+        // Hand over to the writer thread, or write directly if it's already gone (static destruction)
+        if (loggerState == LOGGER_STATE_DESTROYED) {
+            writeDirect(type, out);
+            return;
         }
+        getLogger().push(type, timestamp, out, outLen);
+    }
+
+    void setLevel(Type level) {
+        minLevel = level;
+    }
+
+    bool setJsonSink(const std::string& path) {
+        return getLogger().setJsonSink(path);
+    }
+
+    void flush() {
+        if (loggerState != LOGGER_STATE_RUNNING) { return; }
+        getLogger().flush();
+    }
+
+    void __addArgCopy__(__ArgList__& args, const char* str, int len) {
+        if (args.count >= FLOG_MAX_ARGS) { return; }
+        int n = std::min<int>(len, FLOG_ARG_SCRATCH_SIZE - args.used);
+        memcpy(&args.scratch[args.used], str, n);
+        args.str[args.count] = &args.scratch[args.used];
+        args.len[args.count++] = n;
+        args.used += n;
+    }
+
+    // Print a number directly into the scratch space
+    template <typename... Args>
+    static void __addArgPrintf__(__ArgList__& args, const char* fmt, Args... values) {
+        if (args.count >= FLOG_MAX_ARGS) { return; }
+        int avail = FLOG_ARG_SCRATCH_SIZE - args.used;
+        int n = snprintf(&args.scratch[args.used], avail, fmt, values...);
+        n = std::clamp<int>(n, 0, std::max<int>(avail - 1, 0));
+        args.str[args.count] = &args.scratch[args.used];
+        args.len[args.count++] = n;
+        args.used += n;
+    }
+
+    void __addArg__(__ArgList__& args, bool value) {
+        __addArg__(args, value ? "true" : "false");
     }
 
-    std::string __toString__(bool value) {
-        return value ? "true" : "false";
+    void __addArg__(__ArgList__& args, char value) {
+        __addArgCopy__(args, &value, 1);
     }
 
-    std::string __toString__(char value) {
-        return std::string("")+value;
+    void __addArg__(__ArgList__& args, int8_t value) {
+        __addArgPrintf__(args, "%" PRId8, value);
     }
 
-    std::string __toString__(int8_t value) {
-        char buf[8];
-        sprintf(buf, "%" PRId8, value);
-        return buf;
+    void __addArg__(__ArgList__& args, int16_t value) {
+        __addArgPrintf__(args, "%" PRId16, value);
     }
 
-    std::string __toString__(int16_t value) {
-        char buf[16];
-        sprintf(buf, "%" PRId16, value);
-        return buf;
+    void __addArg__(__ArgList__& args, int32_t value) {
+        __addArgPrintf__(args, "%" PRId32, value);
     }
 
-    std::string __toString__(int32_t value) {
-        char buf[32];
-        sprintf(buf, "%" PRId32, value);
-        return buf;
+    void __addArg__(__ArgList__& args, int64_t value) {
+        __addArgPrintf__(args, "%" PRId64, value);
     }
 
-    std::string __toString__(int64_t value) {
-        char buf[64];
-        sprintf(buf, "%" PRId64, value);
-        return buf;
+    void __addArg__(__ArgList__& args, uint8_t value) {
+        __addArgPrintf__(args, "%" PRIu8, value);
     }
 
-    std::string __toString__(uint8_t value) {
-        char buf[8];
-        sprintf(buf, "%" PRIu8, value);
-        return buf;
+    void __addArg__(__ArgList__& args, uint16_t value) {
+        __addArgPrintf__(args, "%" PRIu16, value);
     }
 
-    std::string __toString__(uint16_t value) {
-        char buf[16];
-        sprintf(buf, "%" PRIu16, value);
-        return buf;
+    void __addArg__(__ArgList__& args, uint32_t value) {
+        __addArgPrintf__(args, "%" PRIu32, value);
     }
 
-    std::string __toString__(uint32_t value) {
-        char buf[32];
-        sprintf(buf, "%" PRIu32, value);
-        return buf;
+    void __addArg__(__ArgList__& args, uint64_t value) {
+        __addArgPrintf__(args, "%" PRIu64, value);
     }
 
-    std::string __toString__(uint64_t value) {
-        char buf[64];
-        sprintf(buf, "%" PRIu64, value);
-        return buf;
+    void __addArg__(__ArgList__& args, float value) {
+        __addArgPrintf__(args, "%f", value);
     }
 
-    std::string __toString__(float value) {
-        char buf[256];
-        sprintf(buf, "%f", value);
-        return buf;
+    void __addArg__(__ArgList__& args, double value) {
+        __addArgPrintf__(args, "%lf", value);
     }
 
-    std::string __toString__(double value) {
-        char buf[256];
-        sprintf(buf, "%lf", value);
-        return buf;
+    void __addArg__(__ArgList__& args, const char* value) {
+        // Points directly to the caller's string, it outlives the call to __log__
+        if (args.count >= FLOG_MAX_ARGS) { return; }
+        if (!value) { value = "(null)"; }
+        args.str[args.count] = value;
+        args.len[args.count++] = strlen(value);
     }
 
-    std::string __toString__(const char* value) {
-        return value;
+    void __addArg__(__ArgList__& args, const void* value) {
+        __addArgPrintf__(args, "0x%p", value);
     }
 
-    std::string __toString__(const void* value) {
-        char buf[32];
-        sprintf(buf, "0x%p", value);
-        return buf;
+    void __addArg__(__ArgList__& args, const std::string& value) {
+        if (args.count >= FLOG_MAX_ARGS) { return; }
+        args.str[args.count] = value.c_str();
+        args.len[args.count++] = value.size();
     }
-}
\ No newline at end of file
+}
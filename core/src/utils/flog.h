@@ -1,8 +1,10 @@
 #pragma once
-#include <vector>
 #include <string>
 #include <stdint.h>
 
+#define FLOG_MAX_ARGS           16
+#define FLOG_ARG_SCRATCH_SIZE   512
+
 namespace flog {
     enum Type {
         TYPE_DEBUG,
@@ -12,35 +14,53 @@ namespace flog {
         _TYPE_COUNT
     };
 
+    // Arguments converted to text on the caller's stack, no heap allocation for basic types
+    struct __ArgList__ {
+        const char* str[FLOG_MAX_ARGS];
+        int len[FLOG_MAX_ARGS];
+        int count = 0;
+        char scratch[FLOG_ARG_SCRATCH_SIZE];
+        int used = 0;
+    };
+
     // IO functions
-    void __log__(Type type, const char* fmt, const std::vector<std::string>& args);
+    void __log__(Type type, const char* fmt, const __ArgList__& args);
+
+    // Output control
+    void setLevel(Type minLevel);
+    bool setJsonSink(const std::string& path);
+    void flush();
 
     // Conversion functions
-    std::string __toString__(bool value);
-    std::string __toString__(char value);
-    std::string __toString__(int8_t value);
-    std::string __toString__(int16_t value);
-    std::string __toString__(int32_t value);
-    std::string __toString__(int64_t value);
-    std::string __toString__(uint8_t value);
-    std::string __toString__(uint16_t value);
-    std::string __toString__(uint32_t value);
-    std::string __toString__(uint64_t value);
-    std::string __toString__(float value);
-    std::string __toString__(double value);
-    std::string __toString__(const char* value);
-    std::string __toString__(const void* value);
+    void __addArg__(__ArgList__& args, bool value);
+    void __addArg__(__ArgList__& args, char value);
+    void __addArg__(__ArgList__& args, int8_t value);
+    void __addArg__(__ArgList__& args, int16_t value);
+    void __addArg__(__ArgList__& args, int32_t value);
+    void __addArg__(__ArgList__& args, int64_t value);
+    void __addArg__(__ArgList__& args, uint8_t value);
+    void __addArg__(__ArgList__& args, uint16_t value);
+    void __addArg__(__ArgList__& args, uint32_t value);
+    void __addArg__(__ArgList__& args, uint64_t value);
+    void __addArg__(__ArgList__& args, float value);
+    void __addArg__(__ArgList__& args, double value);
+    void __addArg__(__ArgList__& args, const char* value);
+    void __addArg__(__ArgList__& args, const void* value);
+    void __addArg__(__ArgList__& args, const std::string& value);
+    void __addArgCopy__(__ArgList__& args, const char* str, int len);
     template <class T>
-    std::string __toString__(const T& value) {
-        return (std::string)value;
+    void __addArg__(__ArgList__& args, const T& value) {
+        // Generic types are converted to a temporary string that has to be copied
+        std::string str = (std::string)value;
+        __addArgCopy__(args, str.c_str(), str.size());
     }
 
     // Utility to generate a list from arguments
-    inline void __genArgList__(std::vector<std::string>& args) {}
+    inline void __genArgList__(__ArgList__& args) {}
     template <typename First, typename... Others>
-    inline void __genArgList__(std::vector<std::string>& args, First first, Others... others) {
+    inline void __genArgList__(__ArgList__& args, const First& first, const Others&... others) {
         // Add argument
-        args.push_back(__toString__(first));
+        __addArg__(args, first);
 
         // Recursive call that will be unrolled since the function is inline
         __genArgList__(args, others...);
@@ -48,30 +68,30 @@ namespace flog {
 
     // Logging functions
     template <typename... Args>
-    void log(Type type, const char* fmt, Args... args) {
-        std::vector<std::string> _args;
-        _args.reserve(sizeof...(args));
+    void log(Type type, const char* fmt, const Args&... args) {
+        static_assert(sizeof...(args) <= FLOG_MAX_ARGS, "Too many arguments for flog");
+        __ArgList__ _args;
         __genArgList__(_args, args...);
         __log__(type, fmt, _args);
     }
 
     template <typename... Args>
-    inline void debug(const char* fmt, Args... args) {
+    inline void debug(const char* fmt, const Args&... args) {
         log(TYPE_DEBUG, fmt, args...);
     }
 
     template <typename... Args>
-    inline void info(const char* fmt, Args... args) {
+    inline void info(const char* fmt, const Args&... args) {
         log(TYPE_INFO, fmt, args...);
     }
 
     template <typename... Args>
-    inline void warn(const char* fmt, Args... args) {
+    inline void warn(const char* fmt, const Args&... args) {
         log(TYPE_WARNING, fmt, args...);
     }
 
     template <typename... Args>
-    inline void error(const char* fmt, Args... args) {
+    inline void error(const char* fmt, const Args&... args) {
         log(TYPE_ERROR, fmt, args...);
     }
-}
\ No newline at end of file
+}
@@ -131,26 +131,58 @@ namespace net {
         return send((const uint8_t*)str.c_str(), str.length(), dest);
     }
 
+    int Socket::sendv(const struct iovec* iov, int count, const Address* dest) {
+        // Build message
+        msghdr msg = {};
+        msg.msg_name = (void*)(dest ? &dest->addr : (raddr ? &raddr->addr : NULL));
+        msg.msg_namelen = msg.msg_name ? sizeof(sockaddr_in) : 0;
+        msg.msg_iov = (struct iovec*)iov;
+        msg.msg_iovlen = count;
+
+        // Send data
+        int err = sendmsg(sock, &msg, MSG_DONTWAIT | MSG_NOSIGNAL);
+
+        // On error, close socket
+        if (err < 0 && !WOULD_BLOCK) {
+            close();
+            return err;
+        }
+
+        return err;
+    }
+
+    int Socket::sendmany(struct mmsghdr* msgs, int count) {
+        // Default to the remote address
+        for (int i = 0; i < count; i++) {
+            if (msgs[i].msg_hdr.msg_name || !raddr) { continue; }
+            msgs[i].msg_hdr.msg_name = &raddr->addr;
+            msgs[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+        }
+
+        // Send datagrams
+        int err = sendmmsg(sock, msgs, count, MSG_DONTWAIT | MSG_NOSIGNAL);
+
+        // On error, close socket
+        if (err < 0 && !WOULD_BLOCK) {
+            close();
+            return err;
+        }
+
+        return err;
+    }
+
+    SockHandle_t Socket::handle() {
+        return sock;
+    }
+
     int Socket::recv(uint8_t* data, size_t maxLen, bool forceLen, int timeout, Address* dest) {
-        // Create FD set
-        fd_set set;
-        FD_ZERO(&set);
-        
         int read = 0;
         bool blocking = (timeout != NONBLOCKING);
         do {
-            // Wait for data or error if 
+            // Wait for data or error if blocking, poll() has no limit on the descriptor number unlike select()
             if (blocking) {
-                // Enable FD in set
-                FD_SET(sock, &set);
-
-                // Set timeout
-                timeval tv;
-                tv.tv_sec = timeout / 1000;
-                tv.tv_usec = (timeout - tv.tv_sec*1000) * 1000;
-
-                // Wait for data
-                int err = select(sock+1, &set, NULL, &set, (timeout > 0) ? &tv : NULL);
+                pollfd pfd = { sock, POLLIN, 0 };
+                int err = poll(&pfd, 1, (timeout > 0) ? timeout : -1);
                 if (err <= 0) { return err; }
             }
 
@@ -204,19 +236,10 @@ namespace net {
     }
 
     std::shared_ptr<Socket> Listener::accept(Address* dest, int timeout) {
-        // Create FD set
-        fd_set set;
-        FD_ZERO(&set);
-        FD_SET(sock, &set);
-
-        // Define timeout
-        timeval tv;
-        tv.tv_sec = timeout / 1000;
-        tv.tv_usec = (timeout - tv.tv_sec*1000) * 1000;
-
-        // Wait for data or error
+        // Wait for a connection or error
         if (timeout != NONBLOCKING) {
-            int err = select(sock+1, &set, NULL, &set, (timeout > 0) ? &tv : NULL);
+            pollfd pfd = { sock, POLLIN, 0 };
+            int err = poll(&pfd, 1, (timeout > 0) ? timeout : -1);
             if (err <= 0) { return NULL; }
         }
 
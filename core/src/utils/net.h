@@ -9,6 +9,7 @@
 #include <strings.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <netinet/in.h>
 #include <netdb.h>
 #include <signal.h>
@@ -138,6 +139,29 @@ namespace net {
          */
         int sendstr(const std::string& str, const Address* dest = NULL);
 
+        /**
+         * Send several buffers in one call without copying them together first. Never blocks.
+         * @param iov Buffers to be sent, in order. UDP sockets send them as a single datagram.
+         * @param count Number of buffers.
+         * @param dest Destination address. NULL to use the default remote address.
+         * @return Number of bytes sent, can be less than requested on TCP. -1 means would block or error.
+         */
+        int sendv(const struct iovec* iov, int count, const Address* dest = NULL);
+
+        /**
+         * Send multiple UDP datagrams in one call. Never blocks.
+         * @param msgs Datagrams to be sent. Those with a NULL msg_name go to the default remote address.
+         * @param count Number of datagrams.
+         * @return Number of datagrams sent. -1 means would block or error.
+         */
+        int sendmany(struct mmsghdr* msgs, int count);
+
+        /**
+         * Get the OS handle of the socket, to wait on it alongside other sockets.
+         * @return Socket handle.
+         */
+        SockHandle_t handle();
+
         /**
          * Receive data from socket.
          * @param data Buffer to read the data into.
@@ -1,7 +1,20 @@
 #include <utils/networking.h>
+#include <utils/reactor.h>
 #include <assert.h>
 #include <utils/flog.h>
 #include <stdexcept>
+#include <fcntl.h>
+#include <poll.h>
+#include <errno.h>
+#include <string.h>
+
+// Queued buffers handed to the kernel per system call
+#define CONN_MAX_IOV        64
+
+// Reads done per reactor event before giving the other sockets a chance
+#define CONN_READ_BATCH     16
+
+#define WOULD_BLOCK (errno == EAGAIN || errno == EWOULDBLOCK)
 
 namespace net {
 
@@ -10,128 +23,169 @@ namespace net {
         _udp = udp;
         remoteAddr = raddr;
         connectionOpen = true;
-        readWorkerThread = std::thread(&ConnClass::readWorker, this);
-        writeWorkerThread = std::thread(&ConnClass::writeWorker, this);
+
+        // All I/O is non-blocking, the blocking calls wait with poll() and the rest is done by the reactor
+        fcntl(_sock, F_SETFL, fcntl(_sock, F_GETFL) | O_NONBLOCK);
+        registered = Reactor::get()->add(_sock, 0, eventHandler, this);
     }
 
     ConnClass::~ConnClass() {
         ConnClass::close();
+        ::close(_sock);
     }
 
     void ConnClass::close() {
-        std::lock_guard lck(closeMtx);
-        // Set stopWorkers to true
+        // Wake up anything blocked on the socket
+        bool unregister;
         {
-            std::lock_guard lck1(readQueueMtx);
-            std::lock_guard lck2(writeQueueMtx);
-            stopWorkers = true;
+            std::lock_guard lck(closeMtx);
+            std::lock_guard lck2(mtx);
+            if (connectionOpen) { ::shutdown(_sock, SHUT_RDWR); }
+            connectionOpen = false;
+            unregister = registered;
+            registered = false;
         }
+        readCnd.notify_all();
+        writeCnd.notify_all();
+        connectionOpenCnd.notify_all();
 
-        // Notify the workers of the change
-        readQueueCnd.notify_all();
-        writeQueueCnd.notify_all();
-
-        if (connectionOpen) {
-            ::shutdown(_sock, SHUT_RDWR);
-            ::close(_sock);
-        }
+        // Wait for the reactor to be done with the connection. No lock is held so that a handler
+        // closing the connection itself doesn't deadlock. The socket stays valid until destruction
+        // so that threads still using it can't hit a reused one.
+        if (unregister) { Reactor::get()->remove(_sock); }
 
-        // Wait for the theads to terminate
-        if (readWorkerThread.joinable()) { readWorkerThread.join(); }
-        if (writeWorkerThread.joinable()) { writeWorkerThread.join(); }
+        // The connection may have been removed from the reactor by its own handler, which then keeps
+        // running for a while. Only the reactor thread itself can't wait for it.
+        if (Reactor::get()->isReactorThread()) { return; }
+        std::unique_lock lck(mtx);
+        dispatchCnd.wait(lck, [this]() { return !dispatching; });
+    }
 
+    void ConnClass::closeAfterFlush() {
+        // Let whoever is writing close it once the queue is empty
         {
-            std::lock_guard lck(connectionOpenMtx);
-            connectionOpen = false;
+            std::lock_guard lck(mtx);
+            if (!writeQueue.empty() || writing) {
+                closePending = true;
+                return;
+            }
         }
-        connectionOpenCnd.notify_all();
+        close();
     }
 
     bool ConnClass::isOpen() {
+        std::lock_guard lck(mtx);
         return connectionOpen;
     }
 
     void ConnClass::waitForEnd() {
-        std::unique_lock lck(readQueueMtx);
+        std::unique_lock lck(mtx);
         connectionOpenCnd.wait(lck, [this]() { return !connectionOpen; });
     }
 
     int ConnClass::read(int count, uint8_t* buf, bool enforceSize) {
-        if (!connectionOpen) { return -1; }
-        std::lock_guard lck(readMtx);
-        int ret;
-
-        if (_udp) {
-            socklen_t fromLen = sizeof(remoteAddr);
-            ret = recvfrom(_sock, (char*)buf, count, 0, (struct sockaddr*)&remoteAddr, &fromLen);
-            if (ret <= 0) {
-                {
-                    std::lock_guard lck(connectionOpenMtx);
-                    connectionOpen = false;
-                }
-                connectionOpenCnd.notify_all();
-                return -1;
-            }
-            return count;
+        // Take the socket over from the reactor
+        {
+            std::unique_lock lck(mtx);
+            readCnd.wait(lck, [this]() { return !reading || !connectionOpen; });
+            if (!connectionOpen) { return -1; }
+            reading = true;
+            updateEvents();
         }
 
         int beenRead = 0;
+        bool ok = true;
         while (beenRead < count) {
-            ret = recv(_sock, (char*)&buf[beenRead], count - beenRead, 0);
+            int ret;
+            if (_udp) {
+                socklen_t fromLen = sizeof(remoteAddr);
+                ret = recvfrom(_sock, (char*)buf, count, 0, (struct sockaddr*)&remoteAddr, &fromLen);
+            }
+            else {
+                ret = recv(_sock, (char*)&buf[beenRead], count - beenRead, 0);
+            }
 
+            if (ret < 0 && WOULD_BLOCK) {
+                if (!waitFor(POLLIN)) { ok = false; break; }
+                continue;
+            }
             if (ret <= 0) {
-                {
-                    std::lock_guard lck(connectionOpenMtx);
-                    connectionOpen = false;
-                }
-                connectionOpenCnd.notify_all();
-                return -1;
+                ok = false;
+                break;
             }
 
-            if (!enforceSize) { return ret; }
-
             beenRead += ret;
+            if (_udp || !enforceSize) { break; }
         }
 
+        // Hand it back
+        {
+            std::lock_guard lck(mtx);
+            reading = false;
+            updateEvents();
+        }
+        readCnd.notify_all();
+
+        if (!ok) {
+            setClosed();
+            return -1;
+        }
         return beenRead;
     }
 
     bool ConnClass::write(int count, uint8_t* buf) {
-        if (!connectionOpen) { return false; }
-        std::lock_guard lck(writeMtx);
-        int ret;
+        // Never block the reactor, queue the data instead
+        if (Reactor::get()->isReactorThread()) { return writeAsync(count, buf); }
 
-        if (_udp) {
-            ret = sendto(_sock, (char*)buf, count, 0, (struct sockaddr*)&remoteAddr, sizeof(remoteAddr));
-            if (ret <= 0) {
-                {
-                    std::lock_guard lck(connectionOpenMtx);
-                    connectionOpen = false;
-                }
-                connectionOpenCnd.notify_all();
-            }
-            return (ret > 0);
+        // Let the queued data go out first to keep the order
+        {
+            std::unique_lock lck(mtx);
+            writeCnd.wait(lck, [this]() { return (writeQueue.empty() && !writing) || !connectionOpen; });
+            if (!connectionOpen) { return false; }
+            writing = true;
         }
 
         int beenWritten = 0;
+        bool ok = true;
         while (beenWritten < count) {
-            ret = send(_sock, (char*)buf, count, 0);
+            int ret;
+            if (_udp) {
+                ret = sendto(_sock, (char*)buf, count, MSG_NOSIGNAL, (struct sockaddr*)&remoteAddr, sizeof(remoteAddr));
+            }
+            else {
+                ret = send(_sock, (char*)&buf[beenWritten], count - beenWritten, MSG_NOSIGNAL);
+            }
+
+            if (ret < 0 && WOULD_BLOCK) {
+                if (!waitFor(POLLOUT)) { ok = false; break; }
+                continue;
+            }
             if (ret <= 0) {
-                {
-                    std::lock_guard lck(connectionOpenMtx);
-                    connectionOpen = false;
-                }
-                connectionOpenCnd.notify_all();
-                return false;
+                ok = false;
+                break;
             }
-            beenWritten += ret;
+
+            beenWritten += _udp ? count : ret;
         }
-        
-        return true;
+
+        bool closeNow;
+        {
+            std::lock_guard lck(mtx);
+            writing = false;
+            closeNow = closePending && writeQueue.empty();
+            updateEvents();
+        }
+        writeCnd.notify_all();
+
+        if (!ok) { setClosed(); }
+        if (closeNow) { close(); }
+        return ok;
     }
 
     void ConnClass::readAsync(int count, uint8_t* buf, void (*handler)(int count, uint8_t* buf, void* ctx), void* ctx, bool enforceSize) {
+        std::lock_guard lck(mtx);
         if (!connectionOpen) { return; }
+        
         // Create entry
         ConnReadEntry entry;
         entry.count = count;
@@ -139,89 +193,279 @@ namespace net {
         entry.handler = handler;
         entry.ctx = ctx;
         entry.enforceSize = enforceSize;
+        entry.done = 0;
 
-        // Add entry to queue
+        // Add entry to queue and let the reactor know there's something to read
+        readQueue.push_back(entry);
+        updateEvents();
+    }
+
+    bool ConnClass::writeAsync(int count, const uint8_t* buf) {
+        iovec iov = { (void*)buf, (size_t)count };
+        return writeAsync(&iov, 1);
+    }
+
+    bool ConnClass::writeAsync(const struct iovec* iov, int iovcnt) {
+        // Gather the buffers into a single queue entry
         {
-            std::lock_guard lck(readQueueMtx);
-            readQueue.push_back(entry);
+            std::lock_guard lck(mtx);
+            if (!connectionOpen) { return false; }
+            size_t total = 0;
+            for (int i = 0; i < iovcnt; i++) { total += iov[i].iov_len; }
+            std::vector<uint8_t> data(total);
+            size_t offset = 0;
+            for (int i = 0; i < iovcnt; i++) {
+                memcpy(&data[offset], iov[i].iov_base, iov[i].iov_len);
+                offset += iov[i].iov_len;
+            }
+            writeQueue.push_back(std::move(data));
+            queuedBytes += total;
         }
 
-        // Notify read worker
-        readQueueCnd.notify_all();
+        // Try sending right away, the reactor only takes over once the socket is full
+        flushWrites();
+
+        // Signal congestion if it didn't all go through
+        void (*handler)(bool congested, void* ctx) = NULL;
+        void* ctx = NULL;
+        {
+            std::lock_guard lck(mtx);
+            if (backpressureHandler && !congested && queuedBytes > highWater) {
+                congested = true;
+                handler = backpressureHandler;
+                ctx = backpressureCtx;
+            }
+        }
+        if (handler) { handler(true, ctx); }
+        return true;
     }
 
-    void ConnClass::writeAsync(int count, uint8_t* buf) {
-        if (!connectionOpen) { return; }
-        // Create entry
-        ConnWriteEntry entry;
-        entry.count = count;
-        entry.buf = buf;
+    int ConnClass::getQueuedBytes() {
+        std::lock_guard lck(mtx);
+        return queuedBytes;
+    }
 
-        // Add entry to queue
+    void ConnClass::setBackpressureHandler(int highWater, int lowWater, void (*handler)(bool congested, void* ctx), void* ctx) {
+        std::lock_guard lck(mtx);
+        this->highWater = highWater;
+        this->lowWater = lowWater;
+        backpressureHandler = handler;
+        backpressureCtx = ctx;
+        congested = false;
+    }
+
+    void ConnClass::setCloseHandler(void (*handler)(void* ctx), void* ctx) {
+        std::lock_guard lck(mtx);
+        closeHandler = handler;
+        closeCtx = ctx;
+    }
+
+    void ConnClass::eventHandler(int fd, uint32_t events, void* ctx) {
+        ConnClass* _this = (ConnClass*)ctx;
         {
-            std::lock_guard lck(writeQueueMtx);
-            writeQueue.push_back(entry);
+            std::lock_guard lck(_this->mtx);
+            _this->dispatching = true;
+        }
+
+        if (events & EPOLLIN) { _this->handleRead(); }
+        if (events & EPOLLOUT) { _this->flushWrites(); }
+
+        if ((events & EPOLLHUP) || ((events & EPOLLERR) && !_this->_udp)) {
+            _this->setClosed();
         }
+        else if (events & EPOLLERR) {
+            // ICMP errors caused by earlier datagrams, clear them
+            int err;
+            socklen_t len = sizeof(err);
+            getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len);
+        }
+
+        // Nothing else will happen on a dead connection
+        if (!_this->isOpen()) { Reactor::get()->remove(fd); }
 
-        // Notify write worker
-        writeQueueCnd.notify_all();
+        // The connection may be destroyed as soon as this is cleared, it must be the last access to it
+        std::lock_guard lck(_this->mtx);
+        _this->dispatching = false;
+        _this->dispatchCnd.notify_all();
     }
 
-    void ConnClass::readWorker() {
-        while (true) {
-            // Wait for wakeup and exit if it's for terminating the thread
-            std::unique_lock lck(readQueueMtx);
-            readQueueCnd.wait(lck, [this]() { return (readQueue.size() > 0 || stopWorkers); });
-            if (stopWorkers || !connectionOpen) { return; }
-
-            // Pop first element off the list
-            ConnReadEntry entry = readQueue[0];
-            readQueue.erase(readQueue.begin());
-            lck.unlock();
+    void ConnClass::handleRead() {
+        for (int i = 0; i < CONN_READ_BATCH; i++) {
+            // Get the pending read, unless a blocking read has the socket
+            ConnReadEntry entry;
+            {
+                std::lock_guard lck(mtx);
+                if (!connectionOpen || reading || readQueue.empty()) { return; }
+                entry = readQueue.front();
+                reading = true;
+            }
 
-            // Read from socket and send data to the handler
-            int ret = read(entry.count, entry.buf, entry.enforceSize);
-            if (ret <= 0) {
-                {
-                    std::lock_guard lck(connectionOpenMtx);
-                    connectionOpen = false;
+            int ret;
+            if (_udp) {
+                socklen_t fromLen = sizeof(remoteAddr);
+                ret = recvfrom(_sock, (char*)entry.buf, entry.count, 0, (struct sockaddr*)&remoteAddr, &fromLen);
+            }
+            else {
+                ret = recv(_sock, (char*)&entry.buf[entry.done], entry.count - entry.done, 0);
+            }
+            bool wouldBlock = (ret < 0 && WOULD_BLOCK);
+
+            bool complete = false;
+            {
+                std::lock_guard lck(mtx);
+                reading = false;
+                if (ret > 0 && connectionOpen) {
+                    entry.done += ret;
+                    complete = (_udp || !entry.enforceSize || entry.done >= entry.count);
+                    if (complete) {
+                        readQueue.pop_front();
+                    }
+                    else {
+                        readQueue.front().done = entry.done;
+                    }
                 }
-                connectionOpenCnd.notify_all();
+                updateEvents();
+            }
+            readCnd.notify_all();
+
+            if (ret <= 0) {
+                if (!wouldBlock) { setClosed(); }
                 return;
             }
-            entry.handler(ret, entry.buf, entry.ctx);
+
+            // Hand the data over, the handler usually queues the next read
+            if (complete) { entry.handler(entry.done, entry.buf, entry.ctx); }
         }
     }
 
-    void ConnClass::writeWorker() {
-        while (true) {
-            // Wait for wakeup and exit if it's for terminating the thread
-            std::unique_lock lck(writeQueueMtx);
-            writeQueueCnd.wait(lck, [this]() { return (writeQueue.size() > 0 || stopWorkers); });
-            if (stopWorkers || !connectionOpen) { return; }
-
-            // Pop first element off the list
-            ConnWriteEntry entry = writeQueue[0];
-            writeQueue.erase(writeQueue.begin());
+    void ConnClass::flushWrites() {
+        std::unique_lock lck(mtx);
+        if (!connectionOpen || writing || writeQueue.empty()) { return; }
+        writing = true;
+
+        bool failed = false;
+        while (!writeQueue.empty()) {
+            // Gather as many queued buffers as possible. Only the thread holding writing pops
+            // the queue, so they stay valid after unlocking.
+            iovec iov[CONN_MAX_IOV];
+            int n = 0;
+            size_t total = 0;
+            for (auto it = writeQueue.begin(); it != writeQueue.end() && n < CONN_MAX_IOV; it++) {
+                int offset = (n == 0) ? writeOffset : 0;
+                iov[n++] = { &(*it)[offset], it->size() - offset };
+                total += it->size() - offset;
+            }
             lck.unlock();
 
-            // Write to socket
-            if (!write(entry.count, entry.buf)) {
-                {
-                    std::lock_guard lck(connectionOpenMtx);
-                    connectionOpen = false;
+            int ret;
+            if (_udp) {
+                // One datagram per buffer
+                mmsghdr msgs[CONN_MAX_IOV];
+                for (int i = 0; i < n; i++) {
+                    msgs[i] = {};
+                    msgs[i].msg_hdr.msg_name = &remoteAddr;
+                    msgs[i].msg_hdr.msg_namelen = sizeof(remoteAddr);
+                    msgs[i].msg_hdr.msg_iov = &iov[i];
+                    msgs[i].msg_hdr.msg_iovlen = 1;
                 }
-                connectionOpenCnd.notify_all();
-                return;
+                ret = sendmmsg(_sock, msgs, n, MSG_DONTWAIT | MSG_NOSIGNAL);
+            }
+            else {
+                msghdr msg = {};
+                msg.msg_iov = iov;
+                msg.msg_iovlen = n;
+                ret = sendmsg(_sock, &msg, MSG_DONTWAIT | MSG_NOSIGNAL);
             }
+            bool wouldBlock = (ret < 0 && WOULD_BLOCK);
+
+            lck.lock();
+            if (ret < 0) {
+                failed = !wouldBlock;
+                break;
+            }
+
+            // Pop what went through completely
+            if (_udp) {
+                for (int i = 0; i < ret; i++) {
+                    queuedBytes -= writeQueue.front().size();
+                    writeQueue.pop_front();
+                }
+            }
+            else {
+                int sent = ret + writeOffset;
+                while (!writeQueue.empty() && sent >= writeQueue.front().size()) {
+                    sent -= writeQueue.front().size();
+                    queuedBytes -= writeQueue.front().size();
+                    writeQueue.pop_front();
+                }
+                writeOffset = sent;
+            }
+
+            // Socket is full, wait for the reactor to say there's space again
+            if (ret < (_udp ? n : (int)total)) { break; }
+        }
+        writing = false;
+        bool closeNow = closePending && writeQueue.empty();
+        updateEvents();
+
+        // Signal the end of the congestion
+        void (*handler)(bool congested, void* ctx) = NULL;
+        void* ctx = NULL;
+        if (congested && queuedBytes <= lowWater) {
+            congested = false;
+            handler = backpressureHandler;
+            ctx = backpressureCtx;
         }
+        lck.unlock();
+        writeCnd.notify_all();
+
+        if (failed) { setClosed(); }
+        if (handler) { handler(false, ctx); }
+        if (closeNow) { close(); }
+    }
+
+    bool ConnClass::waitFor(short events) {
+        pollfd pfd = { _sock, events, 0 };
+        while (poll(&pfd, 1, -1) < 0) {
+            if (errno != EINTR) { return false; }
+        }
+        return isOpen();
+    }
+
+    void ConnClass::updateEvents() {
+        // Only watch for what the reactor has to do, a blocking call owning the socket takes care of itself
+        uint32_t ev = 0;
+        if (!readQueue.empty() && !reading) { ev |= EPOLLIN; }
+        if (!writeQueue.empty() && !writing) { ev |= EPOLLOUT; }
+        if (ev == events || !connectionOpen) { return; }
+        events = ev;
+        Reactor::get()->modify(_sock, events);
+    }
+
+    void ConnClass::setClosed() {
+        void (*handler)(void* ctx) = NULL;
+        void* ctx = NULL;
+        {
+            std::lock_guard lck(mtx);
+            if (!connectionOpen) { return; }
+            connectionOpen = false;
+            ::shutdown(_sock, SHUT_RDWR);
+            handler = closeHandler;
+            ctx = closeCtx;
+        }
+        readCnd.notify_all();
+        writeCnd.notify_all();
+        connectionOpenCnd.notify_all();
+
+        if (handler) { handler(ctx); }
     }
 
 
     ListenerClass::ListenerClass(Socket listenSock) {
         sock = listenSock;
         listening = true;
-        acceptWorkerThread = std::thread(&ListenerClass::worker, this);
+        fcntl(sock, F_SETFL, fcntl(sock, F_GETFL) | O_NONBLOCK);
+        registered = Reactor::get()->add(sock, 0, eventHandler, this);
     }
 
     ListenerClass::~ListenerClass() {
@@ -229,84 +473,101 @@ namespace net {
     }
 
     Conn ListenerClass::accept() {
-        if (!listening) { return NULL; }
-        std::lock_guard lck(acceptMtx);
-        Socket _sock;
+        while (listening) {
+            Socket _sock = ::accept(sock, NULL, NULL);
+            if (_sock >= 0) { return Conn(new ConnClass(_sock)); }
+            if (!WOULD_BLOCK) {
+                listening = false;
+                throw std::runtime_error("Could not accept connection");
+            }
 
-        // Accept socket
-        _sock = ::accept(sock, NULL, NULL);
-        if (_sock < 0) {
-            listening = false;
-            throw std::runtime_error("Could not bind socket");
-            return NULL;
+            // Wait for a connection
+            pollfd pfd = { sock, POLLIN, 0 };
+            poll(&pfd, 1, -1);
         }
-
-        return Conn(new ConnClass(_sock));
+        return NULL;
     }
 
     void ListenerClass::acceptAsync(void (*handler)(Conn conn, void* ctx), void* ctx) {
+        std::lock_guard lck(acceptQueueMtx);
         if (!listening) { return; }
+
         // Create entry
         ListenerAcceptEntry entry;
         entry.handler = handler;
         entry.ctx = ctx;
 
-        // Add entry to queue
-        {
-            std::lock_guard lck(acceptQueueMtx);
-            acceptQueue.push_back(entry);
-        }
-
-        // Notify write worker
-        acceptQueueCnd.notify_all();
+        // Add entry to queue and let the reactor know we're waiting for a connection
+        acceptQueue.push_back(entry);
+        Reactor::get()->modify(sock, EPOLLIN);
     }
 
     void ListenerClass::close() {
+        Socket _sock;
+        bool unregister;
         {
-            std::lock_guard lck(acceptQueueMtx);
-            stopWorker = true;
+            std::lock_guard lck(closeMtx);
+            std::lock_guard lck2(acceptQueueMtx);
+            listening = false;
+            acceptQueue.clear();
+            _sock = sock;
+            sock = -1;
+            unregister = registered;
+            registered = false;
         }
-        acceptQueueCnd.notify_all();
 
-        if (listening) {
-            ::shutdown(sock, SHUT_RDWR);
-            ::close(sock);
+        // Same as for connections, no lock is held while waiting for the reactor and the handler
+        // may have removed itself and still be running
+        if (_sock >= 0) {
+            ::shutdown(_sock, SHUT_RDWR);
+            if (unregister) { Reactor::get()->remove(_sock); }
         }
-
-        if (acceptWorkerThread.joinable()) { acceptWorkerThread.join(); }
-
-        listening = false;
+        if (!Reactor::get()->isReactorThread()) {
+            std::unique_lock lck(acceptQueueMtx);
+            dispatchCnd.wait(lck, [this]() { return !dispatching; });
+        }
+        if (_sock >= 0) { ::close(_sock); }
     }
 
     bool ListenerClass::isListening() {
         return listening;
     }
 
-    void ListenerClass::worker() {
-        while (true) {
-            // Wait for wakeup and exit if it's for terminating the thread
-            std::unique_lock lck(acceptQueueMtx);
-            acceptQueueCnd.wait(lck, [this]() { return (acceptQueue.size() > 0 || stopWorker); });
-            if (stopWorker || !listening) { return; }
+    void ListenerClass::eventHandler(int fd, uint32_t events, void* ctx) {
+        ListenerClass* _this = (ListenerClass*)ctx;
+        {
+            std::lock_guard lck(_this->acceptQueueMtx);
+            _this->dispatching = true;
+        }
 
-            // Pop first element off the list
-            ListenerAcceptEntry entry = acceptQueue[0];
-            acceptQueue.erase(acceptQueue.begin());
-            lck.unlock();
+        _this->handleAccept();
 
-            // Read from socket and send data to the handler
-            try {
-                Conn client = accept();
-                if (!client) {
-                    listening = false;
-                    return;
-                }
-                entry.handler(std::move(client), entry.ctx);
-            }
-            catch (const std::exception& e) {
+        std::lock_guard lck(_this->acceptQueueMtx);
+        _this->dispatching = false;
+        _this->dispatchCnd.notify_all();
+    }
+
+    void ListenerClass::handleAccept() {
+        while (true) {
+            // Accept a client if someone is waiting for one
+            std::unique_lock lck(acceptQueueMtx);
+            if (!listening || acceptQueue.empty()) { return; }
+            Socket _sock = ::accept(sock, NULL, NULL);
+            if (_sock < 0) {
+                if (WOULD_BLOCK || errno == ECONNABORTED || errno == EINTR) { return; }
+                flog::error("Could not accept connection: {}", strerror(errno));
                 listening = false;
+                Reactor::get()->remove(sock);
                 return;
             }
+
+            // Pop first element off the list and stop watching if it was the last one
+            ListenerAcceptEntry entry = acceptQueue.front();
+            acceptQueue.pop_front();
+            if (acceptQueue.empty()) { Reactor::get()->modify(sock, 0); }
+            lck.unlock();
+
+            entry.handler(Conn(new ConnClass(_sock)), entry.ctx);
         }
     }
 
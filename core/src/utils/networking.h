@@ -2,6 +2,7 @@
 #include <stdint.h>
 #include <string>
 #include <vector>
+#include <deque>
 #include <mutex>
 #include <inttypes.h>
 #include <memory>
@@ -12,6 +13,7 @@
 #include <strings.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <netinet/in.h>
 #include <netdb.h>
 #include <signal.h>
@@ -26,13 +28,13 @@ namespace net {
         void (*handler)(int count, uint8_t* buf, void* ctx);
         void* ctx;
         bool enforceSize;
+        int done;
     };
 
-    struct ConnWriteEntry {
-        int count;
-        uint8_t* buf;
-    };
-
+    // Connection serviced by the shared network reactor, no thread is started per connection. Async
+    // handlers run on the reactor thread and must not block. A connection must not be destroyed from
+    // one of its own handlers, close() it instead. Closing or destroying it from any other thread
+    // waits for a handler still running.
     class ConnClass {
     public:
         ConnClass(Socket sock, struct sockaddr_in raddr = {}, bool udp = false);
@@ -42,31 +44,59 @@ namespace net {
         bool isOpen();
         void waitForEnd();
 
+        // Closes the connection once the data queued by writeAsync went out, without blocking
+        void closeAfterFlush();
+
         int read(int count, uint8_t* buf, bool enforceSize = true);
         bool write(int count, uint8_t* buf);
         void readAsync(int count, uint8_t* buf, void (*handler)(int count, uint8_t* buf, void* ctx), void* ctx, bool enforceSize = true);
-        void writeAsync(int count, uint8_t* buf);
+
+        // The data is copied, the buffers can be reused as soon as these return
+        bool writeAsync(int count, const uint8_t* buf);
+        bool writeAsync(const struct iovec* iov, int iovcnt);
+        int getQueuedBytes();
+
+        // The handler is called with true once more than highWater bytes are queued for writing, and
+        // with false once it's back down to lowWater. Called from whatever thread caused the change.
+        void setBackpressureHandler(int highWater, int lowWater, void (*handler)(bool congested, void* ctx), void* ctx);
+
+        // Called once, from the thread that noticed, when the connection is lost without close() being called
+        void setCloseHandler(void (*handler)(void* ctx), void* ctx);
 
     private:
-        void readWorker();
-        void writeWorker();
+        static void eventHandler(int fd, uint32_t events, void* ctx);
+        void handleRead();
+        void flushWrites();
+        bool waitFor(short events);
+        void updateEvents();
+        void setClosed();
 
-        bool stopWorkers = false;
         bool connectionOpen = false;
-
-        std::mutex readMtx;
-        std::mutex writeMtx;
-        std::mutex readQueueMtx;
-        std::mutex writeQueueMtx;
-        std::mutex connectionOpenMtx;
+        bool registered = false;
+        bool reading = false;
+        bool writing = false;
+        bool congested = false;
+        bool dispatching = false;
+        bool closePending = false;
+
+        std::mutex mtx;
         std::mutex closeMtx;
-        std::condition_variable readQueueCnd;
-        std::condition_variable writeQueueCnd;
+        std::condition_variable dispatchCnd;
+        std::condition_variable readCnd;
+        std::condition_variable writeCnd;
         std::condition_variable connectionOpenCnd;
-        std::vector<ConnReadEntry> readQueue;
-        std::vector<ConnWriteEntry> writeQueue;
-        std::thread readWorkerThread;
-        std::thread writeWorkerThread;
+        std::deque<ConnReadEntry> readQueue;
+        std::deque<std::vector<uint8_t>> writeQueue;
+        int writeOffset = 0;
+        int queuedBytes = 0;
+        uint32_t events = 0;
+
+        int highWater = 0;
+        int lowWater = 0;
+        void (*backpressureHandler)(bool congested, void* ctx) = NULL;
+        void* backpressureCtx = NULL;
+        void (*closeHandler)(void* ctx) = NULL;
+        void* closeCtx = NULL;
 
         Socket _sock;
         bool _udp;
@@ -80,6 +110,7 @@ namespace net {
         void* ctx;
     };
 
+    // Listening socket serviced by the shared network reactor, async accept handlers run on the reactor thread
     class ListenerClass {
     public:
         ListenerClass(Socket listenSock);
@@ -92,16 +123,17 @@ namespace net {
         bool isListening();
 
     private:
-        void worker();
+        static void eventHandler(int fd, uint32_t events, void* ctx);
+        void handleAccept();
 
         bool listening = false;
-        bool stopWorker = false;
+        bool registered = false;
+        bool dispatching = false;
 
-        std::mutex acceptMtx;
         std::mutex acceptQueueMtx;
-        std::condition_variable acceptQueueCnd;
-        std::vector<ListenerAcceptEntry> acceptQueue;
-        std::thread acceptWorkerThread;
+        std::mutex closeMtx;
+        std::condition_variable dispatchCnd;
+        std::deque<ListenerAcceptEntry> acceptQueue;
 
         Socket sock;
     };
@@ -0,0 +1,145 @@
+#include <utils/reactor.h>
+#include <utils/flog.h>
+#include <utils/thread_role.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+
+// Events fetched per call to epoll_wait
+#define REACTOR_MAX_EVENTS  64
+
+// Marks the wake up event in the epoll data
+#define REACTOR_WAKE_ID     0
+
+namespace net {
+    Reactor::Reactor() {
+        epfd = epoll_create1(EPOLL_CLOEXEC);
+        wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (epfd < 0 || wakeFd < 0) {
+            flog::error("Could not create the network reactor: {}", strerror(errno));
+            return;
+        }
+
+        // Register the wake up event used to stop the thread
+        epoll_event ev = {};
+        ev.events = EPOLLIN;
+        ev.data.u64 = REACTOR_WAKE_ID;
+        epoll_ctl(epfd, EPOLL_CTL_ADD, wakeFd, &ev);
+
+        std::lock_guard<std::mutex> lck(mtx);
+        running = true;
+        workerThread = std::thread(&Reactor::worker, this);
+        workerId = workerThread.get_id();
+    }
+
+    Reactor::~Reactor() {
+        {
+            std::lock_guard<std::mutex> lck(mtx);
+            running = false;
+        }
+        if (wakeFd >= 0) {
+            uint64_t val = 1;
+            ::write(wakeFd, &val, sizeof(val));
+        }
+        if (workerThread.joinable()) { workerThread.join(); }
+        if (wakeFd >= 0) { ::close(wakeFd); }
+        if (epfd >= 0) { ::close(epfd); }
+    }
+
+    Reactor* Reactor::get() {
+        // Never destroyed, modules may still be closing their sockets while the process exits
+        static Reactor* reactor = new Reactor();
+        return reactor;
+    }
+
+    bool Reactor::add(int fd, uint32_t events, ReactorHandler handler, void* ctx) {
+        std::lock_guard<std::mutex> lck(mtx);
+        if (!running) { return false; }
+
+        // Replace any stale entry left by a file descriptor that was closed without being removed
+        auto entry = std::make_shared<Entry>();
+        entry->fd = fd;
+        entry->id = nextId++;
+        if (nextId == REACTOR_WAKE_ID) { nextId++; }
+        entry->handler = handler;
+        entry->ctx = ctx;
+        entries[fd] = entry;
+
+        epoll_event ev = {};
+        ev.events = events;
+        ev.data.u64 = ((uint64_t)entry->id << 32) | (uint32_t)fd;
+        if (epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) < 0 && (errno != EEXIST || epoll_ctl(epfd, EPOLL_CTL_MOD, fd, &ev) < 0)) {
+            flog::error("Could not add socket to the network reactor: {}", strerror(errno));
+            entries.erase(fd);
+            return false;
+        }
+        return true;
+    }
+
+    bool Reactor::modify(int fd, uint32_t events) {
+        std::lock_guard<std::mutex> lck(mtx);
+        auto it = entries.find(fd);
+        if (it == entries.end()) { return false; }
+
+        epoll_event ev = {};
+        ev.events = events;
+        ev.data.u64 = ((uint64_t)it->second->id << 32) | (uint32_t)fd;
+        return (epoll_ctl(epfd, EPOLL_CTL_MOD, fd, &ev) == 0);
+    }
+
+    void Reactor::remove(int fd) {
+        std::unique_lock<std::mutex> lck(mtx);
+        auto it = entries.find(fd);
+        if (it == entries.end()) { return; }
+        uint32_t id = it->second->id;
+        entries.erase(it);
+        epoll_ctl(epfd, EPOLL_CTL_DEL, fd, NULL);
+
+        // Wait for the handler to return if it's running
+        if (std::this_thread::get_id() == workerId) { return; }
+        dispatchCnd.wait(lck, [=]() { return dispatching != id; });
+    }
+
+    bool Reactor::isReactorThread() {
+        return std::this_thread::get_id() == workerId;
+    }
+
+    void Reactor::worker() {
+        thread_role::apply(THREAD_ROLE_BACKGROUND, "net-reactor");
+        epoll_event events[REACTOR_MAX_EVENTS];
+
+        while (true) {
+            int count = epoll_wait(epfd, events, REACTOR_MAX_EVENTS, -1);
+            if (count < 0) {
+                if (errno == EINTR) { continue; }
+                flog::error("Network reactor failed: {}", strerror(errno));
+                return;
+            }
+
+            for (int i = 0; i < count; i++) {
+                uint32_t id = events[i].data.u64 >> 32;
+                int fd = events[i].data.u64 & 0xFFFFFFFF;
+
+                // Exit if woken up to stop
+                std::unique_lock<std::mutex> lck(mtx);
+                if (!running) { return; }
+                if (id == REACTOR_WAKE_ID) { continue; }
+
+                // Skip events of entries removed by a previous handler of this batch
+                auto it = entries.find(fd);
+                if (it == entries.end() || it->second->id != id) { continue; }
+                std::shared_ptr<Entry> entry = it->second;
+                dispatching = id;
+                lck.unlock();
+
+                entry->handler(fd, events[i].events, entry->ctx);
+
+                lck.lock();
+                dispatching = 0;
+                lck.unlock();
+                dispatchCnd.notify_all();
+            }
+        }
+    }
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <stdint.h>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <unordered_map>
+#include <memory>
+#include <sys/epoll.h>
+
+namespace net {
+    typedef void (*ReactorHandler)(int fd, uint32_t events, void* ctx);
+
+    // Single epoll thread watching every socket of the application. Handlers are called on that thread
+    // and must not block, anything slow has to be handed off to a thread of its own.
+    class Reactor {
+    public:
+        Reactor();
+        ~Reactor();
+
+        // Reactor shared by the core and all modules, started on first use
+        static Reactor* get();
+
+        /**
+         * Watch a file descriptor.
+         * @param fd File descriptor, should be in non-blocking mode.
+         * @param events EPOLLIN and/or EPOLLOUT. EPOLLHUP and EPOLLERR are always reported.
+         * @param handler Called from the reactor thread with the events that occurred.
+         * @param ctx Context passed to the handler.
+         * @return True on success, false otherwise.
+         */
+        bool add(int fd, uint32_t events, ReactorHandler handler, void* ctx);
+
+        /**
+         * Change the events watched on a file descriptor. Can be called from any thread.
+         * @param fd File descriptor.
+         * @param events EPOLLIN and/or EPOLLOUT.
+         * @return True on success, false otherwise.
+         */
+        bool modify(int fd, uint32_t events);
+
+        /**
+         * Stop watching a file descriptor. Must be called before closing it. Once this returns the
+         * handler is not running and won't be called again, except when called from the reactor
+         * thread itself where the handler calling it obviously keeps running until it returns.
+         * @param fd File descriptor.
+         */
+        void remove(int fd);
+
+        /**
+         * Check if the calling thread is the reactor thread.
+         * @return True if it is, false otherwise.
+         */
+        bool isReactorThread();
+
+    private:
+        struct Entry {
+            int fd;
+            uint32_t id;
+            ReactorHandler handler;
+            void* ctx;
+        };
+
+        void worker();
+
+        int epfd = -1;
+        int wakeFd = -1;
+
+        std::mutex mtx;
+        std::condition_variable dispatchCnd;
+        std::unordered_map<int, std::shared_ptr<Entry>> entries;
+        uint32_t nextId = 1;
+        uint32_t dispatching = 0;
+
+        bool running = false;
+        std::thread workerThread;
+        std::thread::id workerId;
+    };
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <atomic>
+#include <mutex>
+#include <type_traits>
+
+// Sequence lock for small, trivially copyable state that is written rarely and read often.
+// Readers never block and never stall writers, they simply retry if a write happened during the copy.
+// Writers are serialised by a mutex so that several threads can update the same state.
+template <class T>
+class SeqLock {
+    static_assert(std::is_trivially_copyable<T>::value, "SeqLock requires a trivially copyable type");
+public:
+    T load() const {
+        T copy;
+        while (true) {
+            unsigned int before = seq.load(std::memory_order_acquire);
+            if (before & 1) { continue; }
+            copy = data;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (seq.load(std::memory_order_relaxed) == before) { return copy; }
+        }
+    }
+
+    // Call func(T&) to modify the state in place
+    template <class Func>
+    void update(Func func) {
+        std::lock_guard<std::mutex> lck(writeMtx);
+        seq.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        func(data);
+        seq.fetch_add(1, std::memory_order_release);
+    }
+
+private:
+    T data{};
+    std::atomic<unsigned int> seq = 0;
+    std::mutex writeMtx;
+};
@@ -0,0 +1,125 @@
+#include "thread_role.h"
+#include <mutex>
+#include <algorithm>
+#include <string.h>
+#include <errno.h>
+#include <utils/flog.h>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#endif
+
+namespace thread_role {
+    namespace {
+        const char* ROLE_NAMES[_THREAD_ROLE_COUNT] = {
+            "source",
+            "dspCritical",
+            "dspBulk",
+            "decoder",
+            "gui",
+            "background"
+        };
+
+        std::mutex mtx;
+        Policy policies[_THREAD_ROLE_COUNT];
+
+#ifdef __linux__
+        // What the process was started with (taskset, chrt, nice), used for anything a policy leaves unset
+        cpu_set_t startupCpus;
+        int startupSched = SCHED_OTHER;
+        sched_param startupParam = {};
+        int startupNice = 0;
+#endif
+
+        // Background work gives way to everything else until the config says otherwise. Static init
+        // runs on the main thread before any other thread is started.
+        struct DefaultPolicies {
+            DefaultPolicies() {
+                policies[THREAD_ROLE_BACKGROUND].nice = 10;
+#ifdef __linux__
+                CPU_ZERO(&startupCpus);
+                if (sched_getaffinity(0, sizeof(startupCpus), &startupCpus)) { CPU_ZERO(&startupCpus); }
+                startupSched = sched_getscheduler(0);
+                if (startupSched < 0 || sched_getparam(0, &startupParam)) {
+                    startupSched = SCHED_OTHER;
+                    startupParam.sched_priority = 0;
+                }
+                errno = 0;
+                int nice = getpriority(PRIO_PROCESS, 0);
+                if (!errno) { startupNice = nice; }
+#endif
+            }
+        } defaultPolicies;
+
+        // Only complain once per role, failures usually mean missing privileges
+        bool warned[_THREAD_ROLE_COUNT] = { false };
+
+        void warnOnce(ThreadRole role, const char* what, int err) {
+            std::lock_guard<std::mutex> lck(mtx);
+            if (warned[role]) { return; }
+            warned[role] = true;
+            flog::warn("Could not set the {0} of '{1}' threads: {2}", what, ROLE_NAMES[role], strerror(err));
+        }
+    }
+
+    const char* getName(ThreadRole role) {
+        return ROLE_NAMES[role];
+    }
+
+    void setPolicy(ThreadRole role, const Policy& policy) {
+        std::lock_guard<std::mutex> lck(mtx);
+        policies[role] = policy;
+        warned[role] = false;
+    }
+
+    Policy getPolicy(ThreadRole role) {
+        std::lock_guard<std::mutex> lck(mtx);
+        return policies[role];
+    }
+
+    void apply(ThreadRole role, const std::string& name) {
+#ifdef __linux__
+        Policy policy = getPolicy(role);
+        pthread_t self = pthread_self();
+        pthread_setname_np(self, name.substr(0, 15).c_str());
+
+        // Everything is set explicitly since threads inherit the policy of the thread that created them,
+        // what the policy leaves unset goes back to what the process was started with
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        int coreCount = sysconf(_SC_NPROCESSORS_CONF);
+        for (int cpu : policy.cpus) {
+            if (cpu >= 0 && cpu < coreCount && cpu < CPU_SETSIZE) { CPU_SET(cpu, &set); }
+        }
+        if (!CPU_COUNT(&set)) { set = startupCpus; }
+        if (CPU_COUNT(&set)) {
+            int err = pthread_setaffinity_np(self, sizeof(set), &set);
+            if (err) { warnOnce(role, "affinity", err); }
+        }
+
+        int sched = startupSched;
+        sched_param param = startupParam;
+        if (policy.rtPriority > 0) {
+            sched = SCHED_FIFO;
+            param.sched_priority = std::min<int>(policy.rtPriority, 99);
+        }
+        int err = pthread_setschedparam(self, sched, &param);
+        if (err) { warnOnce(role, "real-time priority", err); }
+
+        // The nice level is per thread on Linux and only matters to the normal schedulers. It's relative to
+        // the one of the process and left alone when already right, lowering it needs privileges.
+        if (sched != SCHED_FIFO && sched != SCHED_RR) {
+            pid_t tid = syscall(SYS_gettid);
+            int nice = std::clamp<int>(startupNice + policy.nice, -20, 19);
+            errno = 0;
+            int current = getpriority(PRIO_PROCESS, tid);
+            if ((errno || current != nice) && setpriority(PRIO_PROCESS, tid, nice)) {
+                warnOnce(role, "nice level", errno);
+            }
+        }
+#endif
+    }
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <string>
+#include <vector>
+
+enum ThreadRole {
+    THREAD_ROLE_SOURCE,         // Hardware callbacks feeding the IQ stream
+    THREAD_ROLE_DSP_CRITICAL,   // IQ front-end, anything that drops samples when late
+    THREAD_ROLE_DSP_BULK,       // VFOs, demodulators and the scheduler pool
+    THREAD_ROLE_DECODER,        // Decoders that can buffer
+    THREAD_ROLE_GUI,            // Render loop and input devices
+    THREAD_ROLE_BACKGROUND,     // Config saving, downloads, logging, device scans
+    _THREAD_ROLE_COUNT
+};
+
+namespace thread_role {
+    struct Policy {
+        std::vector<int> cpus;  // Cores the thread may run on, empty for the ones the process started with
+        int rtPriority = 0;     // SCHED_FIFO priority from 1 to 99, 0 keeps the scheduler the process started with
+        int nice = 0;           // Added to the nice level of the process, only used with the normal schedulers
+    };
+
+    // Name used for the role in the config
+    const char* getName(ThreadRole role);
+
+    // Policies are only applied to the threads that start after the change
+    void setPolicy(ThreadRole role, const Policy& policy);
+    Policy getPolicy(ThreadRole role);
+
+    // Apply the policy of the role to the calling thread and name it, names are cut to 15 characters
+    void apply(ThreadRole role, const std::string& name);
+}
@@ -1,5 +1,6 @@
 #pragma once
 #include <dsp/block.h>
+#include <dsp/fec/interleaved_rs.h>
 #include <inttypes.h>
 
 // WTF???
@@ -68,57 +69,40 @@ namespace dsp {
         void init(stream<uint8_t>* in) {
             _in = in;
 
-            for (int i = 0; i < 5; i++) { memset(buffers[i], 0, 255); }
-            for (int i = 0; i < 5; i++) { memset(outBuffers[i], 0, 255); }
-            rs = correct_reed_solomon_create(correct_rs_primitive_polynomial_ccsds, 120, 11, 16);
-            if (rs == NULL) { printf("Error creating the reed solomon decoder\n"); }
+            memset(frame, 0, sizeof(frame));
+            memset(decoded, 0, sizeof(decoded));
+            rs.init(correct_rs_primitive_polynomial_ccsds, 120, 11, 16, 5);
 
             generic_block<FalconRS>::registerInput(_in);
             generic_block<FalconRS>::registerOutput(&out);
         }
 
+        fec::RSStats getStats() {
+            return rs.getStats();
+        }
+
         int run() {
             count = _in->read();
             if (count < 0) { return -1; }
 
             uint8_t* data = _in->readBuf + 4;
 
-            // Deinterleave
+            // Back to the conventional basis, the decoder deinterleaves the codewords itself
             for (int i = 0; i < 255 * 5; i++) {
-                buffers[i % 5][i / 5] = fromDB[data[i]];
+                frame[i] = fromDB[data[i]];
             }
 
             // Reed the solomon :weary:
-            int result = 0;
-            result = correct_reed_solomon_decode(rs, buffers[0], 255, outBuffers[0]);
-            if (result == -1) {
-                _in->flush();
-                return count;
-            }
-            result = correct_reed_solomon_decode(rs, buffers[1], 255, outBuffers[1]);
-            if (result == -1) {
-                _in->flush();
-                return count;
-            }
-            result = correct_reed_solomon_decode(rs, buffers[2], 255, outBuffers[2]);
-            if (result == -1) {
-                _in->flush();
-                return count;
-            }
-            result = correct_reed_solomon_decode(rs, buffers[3], 255, outBuffers[3]);
-            if (result == -1) {
-                _in->flush();
-                return count;
-            }
-            result = correct_reed_solomon_decode(rs, buffers[4], 255, outBuffers[4]);
-            if (result == -1) {
+            if (!rs.decode(frame, decoded)) {
                 _in->flush();
                 return count;
             }
 
-            // Reinterleave
+            // Reinterleave, the parity is left as zeros
             for (int i = 0; i < 255 * 5; i++) {
-                out.writeBuf[i] = toDB[outBuffers[i % 5][i / 5]] ^ randVals[i % 255];
+                int j = i / 5;
+                uint8_t sym = (j < 239) ? decoded[((i % 5) * 239) + j] : 0;
+                out.writeBuf[i] = toDB[sym] ^ randVals[i % 255];
             }
 
             out.swap(255 * 5);
@@ -131,9 +115,9 @@ namespace dsp {
 
     private:
         int count;
-        uint8_t buffers[5][255];
-        uint8_t outBuffers[5][255];
-        correct_reed_solomon* rs;
+        uint8_t frame[255 * 5];
+        uint8_t decoded[239 * 5];
+        fec::InterleavedRS rs;
 
         stream<uint8_t>* _in;
     };
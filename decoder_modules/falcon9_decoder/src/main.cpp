@@ -137,6 +137,10 @@ private:
         ImGui::SetNextItemWidth(menuWidth);
         _this->symDiag.draw();
 
+        dsp::fec::RSStats stats = _this->falconRS.getStats();
+        ImGui::Text("Frames: %llu (%llu failed)", (unsigned long long)stats.frames, (unsigned long long)stats.failedFrames);
+        ImGui::Text("Corrected symbols: %llu", (unsigned long long)stats.correctedSymbols);
+
         if (_this->logsVisible) {
             if (ImGui::Button("Hide logs", ImVec2(menuWidth, 0))) { _this->logsVisible = false; }
         }
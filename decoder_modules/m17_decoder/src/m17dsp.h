@@ -651,6 +651,7 @@ namespace dsp {
             _sampleRate = sampleRate;
 
             demod.init(input, M17_BAUDRATE, sampleRate, M17_DEVIATION, 31, M17_RRC_ALPHA, 1e-6f, 0.01f, 0.01f);
+            demod.setAccuracy(math::POLAR_ACCURACY_FAST);
             doubler.init(&demod.out);
             slice.init(&doubler.outA);
             demux.init(&slice.out);
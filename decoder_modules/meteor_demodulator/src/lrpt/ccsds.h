@@ -0,0 +1,29 @@
+#pragma once
+#include <stdint.h>
+
+// Attached sync marker in front of every CADU
+#define LRPT_ASM                0x1ACFFC1D
+#define LRPT_ASM_SIZE           4
+
+// Transfer frame sizes, in bytes
+#define LRPT_CADU_SIZE          1024
+#define LRPT_VCDU_SIZE          892
+
+// RS(255,223) interleaved by 4 over the CADU after the ASM
+#define LRPT_RS_INTERLEAVE      4
+#define LRPT_RS_BLOCK_SIZE      255
+#define LRPT_RS_PARITY_SIZE     32
+#define LRPT_RS_FIRST_ROOT      112
+#define LRPT_RS_ROOT_GAP        11
+
+namespace lrpt::ccsds {
+    // Conventional to dual basis and back, the RS codewords are transmitted in dual basis
+    extern const uint8_t toDualBasis[256];
+    extern const uint8_t fromDualBasis[256];
+
+    // CCSDS pseudo-random sequence (x^8 + x^7 + x^5 + x^3 + 1, all ones seed), restarts after every ASM
+    extern const uint8_t pseudoRandom[255];
+
+    // XOR the data following the ASM with the pseudo-random sequence
+    void derandomize(uint8_t* data, int count);
+}
@@ -0,0 +1,174 @@
+#include "frame_decoder.h"
+#include "frame_sync.h"
+#include <dsp/scheduler.h>
+#include <dsp/buffer/buffer.h>
+#include <atomic>
+#include <string.h>
+
+extern "C" {
+    #include <correct.h>
+}
+
+// Polynomials of the CCSDS r=1/2 k=7 code in libcorrect's bit order
+static const correct_convolutional_polynomial_t LRPT_CONV_POLYNOMIAL[] = { 0117, 0155 };
+
+namespace lrpt {
+    struct FrameDecoder::Codeword : public dsp::task {
+        void wake() {}
+        void execute();
+
+        Frame* frame;
+        int index;
+        correct_reed_solomon* rs;
+        uint8_t block[LRPT_RS_BLOCK_SIZE];
+        uint8_t decoded[LRPT_RS_BLOCK_SIZE - LRPT_RS_PARITY_SIZE];
+        bool valid;
+    };
+
+    struct FrameDecoder::Frame : public dsp::task {
+        Frame(FrameDecoder* decoder) {
+            this->decoder = decoder;
+            soft = dsp::buffer::alloc<uint8_t>(LRPT_FRAME_SOFT_SIZE);
+            cadu = dsp::buffer::alloc<uint8_t>(LRPT_FRAME_SOFT_SIZE / 8);
+
+            // The decoders keep state while running so each frame has its own
+            conv = correct_convolutional_create(2, 7, LRPT_CONV_POLYNOMIAL);
+            for (int i = 0; i < LRPT_RS_INTERLEAVE; i++) {
+                codewords[i].frame = this;
+                codewords[i].index = i;
+                codewords[i].rs = correct_reed_solomon_create(correct_rs_primitive_polynomial_ccsds, LRPT_RS_FIRST_ROOT, LRPT_RS_ROOT_GAP, LRPT_RS_PARITY_SIZE);
+            }
+        }
+
+        ~Frame() {
+            correct_convolutional_destroy(conv);
+            for (int i = 0; i < LRPT_RS_INTERLEAVE; i++) {
+                correct_reed_solomon_destroy(codewords[i].rs);
+            }
+            dsp::buffer::free(soft);
+            dsp::buffer::free(cadu);
+        }
+
+        void wake() {}
+
+        void execute() {
+            // Viterbi, the margin after the frame is decoded too but only the CADU is kept
+            correct_convolutional_decode_soft(conv, soft, LRPT_FRAME_SOFT_SIZE, cadu);
+            ccsds::derandomize(&cadu[LRPT_ASM_SIZE], LRPT_CADU_SIZE - LRPT_ASM_SIZE);
+
+            // Error correct the codewords in parallel, the last one to finish completes the frame
+            remaining = LRPT_RS_INTERLEAVE;
+            for (int i = 0; i < LRPT_RS_INTERLEAVE; i++) {
+                dsp::scheduler::schedule(&codewords[i]);
+            }
+        }
+
+        bool isValid() {
+            for (int i = 0; i < LRPT_RS_INTERLEAVE; i++) {
+                if (!codewords[i].valid) { return false; }
+            }
+            return true;
+        }
+
+        FrameDecoder* decoder;
+        uint64_t seq;
+        uint8_t* soft;
+        uint8_t* cadu;
+        correct_convolutional* conv;
+        Codeword codewords[LRPT_RS_INTERLEAVE];
+        std::atomic<int> remaining;
+    };
+
+    void FrameDecoder::Codeword::execute() {
+        // Deinterleave and go from the dual basis used on the air to the conventional one
+        uint8_t* data = &frame->cadu[LRPT_ASM_SIZE];
+        for (int i = 0; i < LRPT_RS_BLOCK_SIZE; i++) {
+            block[i] = ccsds::fromDualBasis[data[(i * LRPT_RS_INTERLEAVE) + index]];
+        }
+
+        // Only write back the data if it could be corrected, the parity isn't used anymore
+        valid = (correct_reed_solomon_decode(rs, block, LRPT_RS_BLOCK_SIZE, decoded) >= 0);
+        if (valid) {
+            for (int i = 0; i < LRPT_RS_BLOCK_SIZE - LRPT_RS_PARITY_SIZE; i++) {
+                data[(i * LRPT_RS_INTERLEAVE) + index] = ccsds::toDualBasis[decoded[i]];
+            }
+        }
+
+        if (frame->remaining.fetch_sub(1) == 1) {
+            frame->decoder->complete(frame);
+        }
+    }
+
+    FrameDecoder::FrameDecoder(void (*handler)(uint8_t* cadu, bool valid, void* ctx), void* ctx) {
+        _handler = handler;
+        _ctx = ctx;
+    }
+
+    FrameDecoder::~FrameDecoder() {
+        flush();
+        for (auto& frame : frames) { delete frame; }
+    }
+
+    bool FrameDecoder::push(const uint8_t* soft) {
+        Frame* frame;
+        {
+            std::lock_guard<std::mutex> lck(mtx);
+            if (!freeFrames.empty()) {
+                frame = freeFrames.back();
+                freeFrames.pop_back();
+            }
+            else if (frames.size() < LRPT_MAX_FRAMES_IN_FLIGHT) {
+                frame = new Frame(this);
+                frames.push_back(frame);
+            }
+            else {
+                return false;
+            }
+            frame->seq = pushSeq++;
+            inFlight++;
+        }
+
+        memcpy(frame->soft, soft, LRPT_FRAME_SOFT_SIZE);
+        dsp::scheduler::schedule(frame);
+        return true;
+    }
+
+    void FrameDecoder::flush() {
+        std::unique_lock<std::mutex> lck(mtx);
+        idleCnd.wait(lck, [this]() { return inFlight == 0; });
+    }
+
+    void FrameDecoder::complete(Frame* frame) {
+        // If another worker is already handing out frames, it'll pick this one up when its turn comes
+        {
+            std::lock_guard<std::mutex> lck(mtx);
+            ready[frame->seq] = frame;
+            if (draining) { return; }
+            draining = true;
+        }
+
+        Frame* next = NULL;
+        while (true) {
+            {
+                std::lock_guard<std::mutex> lck(mtx);
+                if (next) {
+                    freeFrames.push_back(next);
+                    inFlight--;
+                }
+
+                // Nothing can be touched after giving up the drain, flush() may be waiting to destroy the decoder
+                auto it = ready.find(nextSeq);
+                if (it == ready.end()) {
+                    draining = false;
+                    idleCnd.notify_all();
+                    return;
+                }
+                next = it->second;
+                ready.erase(it);
+                nextSeq++;
+            }
+
+            _handler(next->cadu, next->isValid(), _ctx);
+        }
+    }
+}
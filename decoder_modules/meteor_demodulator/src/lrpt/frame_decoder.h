@@ -0,0 +1,48 @@
+#pragma once
+#include <stdint.h>
+#include <mutex>
+#include <condition_variable>
+#include <map>
+#include <vector>
+#include "ccsds.h"
+
+// Frames queued on the pool at once before new ones are dropped, about 3.6s of signal
+#define LRPT_MAX_FRAMES_IN_FLIGHT   32
+
+namespace lrpt {
+    // Decodes the frames cut by FrameSync on the DSP scheduler pool. The Viterbi decoder and derandomisation of a frame
+    // run as one task, the 4 interleaved RS codewords then run as 4 parallel tasks. Frames are given to the handler
+    // one at a time and in the order they were pushed, from whichever worker finished the frame that was next in line.
+    class FrameDecoder {
+    public:
+        FrameDecoder(void (*handler)(uint8_t* cadu, bool valid, void* ctx), void* ctx);
+        ~FrameDecoder();
+
+        // Queue a frame of LRPT_FRAME_SOFT_SIZE soft bits, returns false if it was dropped because the pool is behind
+        bool push(const uint8_t* soft);
+
+        // Wait until every queued frame went through the handler
+        void flush();
+
+    private:
+        struct Frame;
+        struct Codeword;
+
+        void complete(Frame* frame);
+
+        void (*_handler)(uint8_t* cadu, bool valid, void* ctx);
+        void* _ctx;
+
+        std::mutex mtx;
+        std::condition_variable idleCnd;
+        std::vector<Frame*> frames;
+        std::vector<Frame*> freeFrames;
+        int inFlight = 0;
+
+        // Finished frames waiting for the ones before them
+        std::map<uint64_t, Frame*> ready;
+        uint64_t pushSeq = 0;
+        uint64_t nextSeq = 0;
+        bool draining = false;
+    };
+}
@@ -0,0 +1,115 @@
+#include "frame_sync.h"
+#include <dsp/buffer/buffer.h>
+#include <string.h>
+#include <algorithm>
+
+namespace lrpt {
+    // Rotations by 0, 90, 180 and 270 degrees, then the same with I and Q swapped, as received = M * sent
+    static const int AMBIGUITIES[8][4] = {
+        {  1,  0,  0,  1 },
+        {  0, -1,  1,  0 },
+        { -1,  0,  0, -1 },
+        {  0,  1, -1,  0 },
+        {  0,  1,  1,  0 },
+        {  1,  0,  0, -1 },
+        { -1,  0,  0,  1 },
+        {  0, -1, -1,  0 }
+    };
+
+    FrameSync::FrameSync(void (*handler)(const uint8_t* soft, void* ctx), void* ctx) {
+        _handler = handler;
+        _ctx = ctx;
+
+        symbols = dsp::buffer::alloc<dsp::complex_t>(LRPT_FRAME_SYMBOLS + LRPT_FRAME_MARGIN_SYMBOLS);
+        soft = dsp::buffer::alloc<uint8_t>(LRPT_FRAME_SOFT_SIZE);
+
+        // Hard decisions the encoded ASM gives after going through each ambiguity
+        for (int a = 0; a < 8; a++) {
+            const int* m = AMBIGUITIES[a];
+            uint64_t pattern = 0;
+            for (int i = LRPT_ASM_SYMBOLS - 1; i >= 0; i--) {
+                int si = ((LRPT_ENCODED_ASM >> (2 * i + 1)) & 1) ? 1 : -1;
+                int sq = ((LRPT_ENCODED_ASM >> (2 * i)) & 1) ? 1 : -1;
+                int ri = m[0] * si + m[1] * sq;
+                int rq = m[2] * si + m[3] * sq;
+                pattern = (pattern << 2) | ((ri > 0) << 1) | (rq > 0);
+            }
+            patterns[a] = pattern;
+        }
+    }
+
+    FrameSync::~FrameSync() {
+        dsp::buffer::free(symbols);
+        dsp::buffer::free(soft);
+    }
+
+    void FrameSync::process(const dsp::complex_t* in, int count) {
+        for (int i = 0; i < count; i++) {
+            shiftReg = (shiftReg << 2) | ((in[i].re > 0.0f) << 1) | (in[i].im > 0.0f);
+            symbols[symbolCount++] = in[i];
+
+            if (!locked) {
+                // Look for the ASM under every ambiguity, only the last 32 symbols need to be kept meanwhile
+                for (int a = 0; a < 8 && symbolCount >= LRPT_ASM_SYMBOLS; a++) {
+                    if (correlate(a) > LRPT_SYNC_SEARCH_THRESHOLD) { continue; }
+                    locked = true;
+                    ambiguity = a;
+                    misses = 0;
+                    break;
+                }
+                if (locked || symbolCount == LRPT_FRAME_SYMBOLS + LRPT_FRAME_MARGIN_SYMBOLS) {
+                    memmove(symbols, &symbols[symbolCount - LRPT_ASM_SYMBOLS], LRPT_ASM_SYMBOLS * sizeof(dsp::complex_t));
+                    symbolCount = LRPT_ASM_SYMBOLS;
+                }
+                continue;
+            }
+
+            // Check for the next ASM where it should be, a cycle slip in the costas loop shows up as another ambiguity
+            if (symbolCount == LRPT_FRAME_SYMBOLS + LRPT_ASM_SYMBOLS) {
+                nextFound = (correlate(ambiguity) <= LRPT_SYNC_LOCK_THRESHOLD);
+                for (int a = 0; a < 8 && !nextFound; a++) {
+                    if (correlate(a) > LRPT_SYNC_SEARCH_THRESHOLD) { continue; }
+                    nextFound = true;
+                    ambiguity = a;
+                }
+            }
+
+            if (symbolCount < LRPT_FRAME_SYMBOLS + LRPT_FRAME_MARGIN_SYMBOLS) { continue; }
+
+            // The frame is complete with its margin, hand it over and keep the margin as the start of the next one
+            emit();
+            misses = nextFound ? 0 : (misses + 1);
+            if (misses > LRPT_SYNC_MAX_MISSES) {
+                locked = false;
+                memmove(symbols, &symbols[symbolCount - LRPT_ASM_SYMBOLS], LRPT_ASM_SYMBOLS * sizeof(dsp::complex_t));
+                symbolCount = LRPT_ASM_SYMBOLS;
+                continue;
+            }
+            memmove(symbols, &symbols[LRPT_FRAME_SYMBOLS], LRPT_FRAME_MARGIN_SYMBOLS * sizeof(dsp::complex_t));
+            symbolCount = LRPT_FRAME_MARGIN_SYMBOLS;
+        }
+    }
+
+    void FrameSync::reset() {
+        shiftReg = 0;
+        symbolCount = 0;
+        locked = false;
+        misses = 0;
+    }
+
+    int FrameSync::correlate(int a) {
+        return __builtin_popcountll((shiftReg ^ patterns[a]) & LRPT_ENCODED_ASM_MASK);
+    }
+
+    void FrameSync::emit() {
+        // Undo the ambiguity, the inverse of each matrix is its transpose
+        const int* m = AMBIGUITIES[ambiguity];
+        for (int i = 0; i < LRPT_FRAME_SYMBOLS + LRPT_FRAME_MARGIN_SYMBOLS; i++) {
+            float si = m[0] * symbols[i].re + m[2] * symbols[i].im;
+            float sq = m[1] * symbols[i].re + m[3] * symbols[i].im;
+            soft[2 * i] = std::clamp<int>((si * 127.0f) + 128.0f, 0, 255);
+            soft[2 * i + 1] = std::clamp<int>((sq * 127.0f) + 128.0f, 0, 255);
+        }
+        _handler(soft, _ctx);
+    }
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <dsp/types.h>
+#include <stdint.h>
+#include "ccsds.h"
+
+// The ASM after r=1/2 k=7 convolutional coding from the zero state, 32 QPSK symbols
+#define LRPT_ENCODED_ASM            0x035D49C24FF2686BULL
+#define LRPT_ASM_SYMBOLS            32
+
+// The first 6 bits of the ASM are coded with the tail of the previous frame, only the remaining 52 coded bits are known
+#define LRPT_ENCODED_ASM_MASK       ((1ULL << 52) - 1)
+
+// A coded CADU is 8192 symbols, the decoder also gets the next ASM so the Viterbi traceback settles before the last byte
+#define LRPT_FRAME_SYMBOLS          (LRPT_CADU_SIZE * 8)
+#define LRPT_FRAME_MARGIN_SYMBOLS   64
+#define LRPT_FRAME_SOFT_SIZE        ((LRPT_FRAME_SYMBOLS + LRPT_FRAME_MARGIN_SYMBOLS) * 2)
+
+// Bit errors accepted when searching for the ASM and when checking it where it's expected
+#define LRPT_SYNC_SEARCH_THRESHOLD  6
+#define LRPT_SYNC_LOCK_THRESHOLD    14
+
+// Consecutive missing ASMs before going back to searching
+#define LRPT_SYNC_MAX_MISSES        4
+
+namespace lrpt {
+    // Finds the ASM in the QPSK symbols under any of the 8 phase/IQ swap ambiguities and cuts the stream into frames
+    // of soft bits (0 = 0, 255 = 1) starting at the ASM, corrected for the ambiguity.
+    class FrameSync {
+    public:
+        FrameSync(void (*handler)(const uint8_t* soft, void* ctx), void* ctx);
+        ~FrameSync();
+
+        void process(const dsp::complex_t* in, int count);
+        void reset();
+
+        bool isLocked() { return locked; }
+
+    private:
+        int correlate(int a);
+        void emit();
+
+        void (*_handler)(const uint8_t* soft, void* ctx);
+        void* _ctx;
+
+        // Hard decisions of the last 32 symbols and what the ASM looks like under each ambiguity
+        uint64_t shiftReg = 0;
+        uint64_t patterns[8];
+
+        dsp::complex_t* symbols;
+        int symbolCount = 0;
+        uint8_t* soft;
+
+        bool locked = false;
+        int ambiguity = 0;
+        int misses = 0;
+        bool nextFound = false;
+    };
+}
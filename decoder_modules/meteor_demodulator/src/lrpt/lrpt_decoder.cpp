@@ -0,0 +1,109 @@
+#include "lrpt_decoder.h"
+#include <fstream>
+#include <string.h>
+
+namespace lrpt {
+    LrptDecoder::LrptDecoder() : demux(packetHandler, this), decoder(caduHandler, this), sync(frameHandler, this) {}
+
+    void LrptDecoder::process(const dsp::complex_t* symbols, int count) {
+        std::lock_guard<std::mutex> lck(syncMtx);
+        sync.process(symbols, count);
+    }
+
+    void LrptDecoder::reset() {
+        // Holding the sync lock keeps new frames out while the pool finishes the queued ones
+        std::lock_guard<std::mutex> lck(syncMtx);
+        sync.reset();
+        decoder.flush();
+        demux.reset();
+        msumr.reset();
+        frames = 0;
+        validFrames = 0;
+        droppedFrames = 0;
+    }
+
+    bool LrptDecoder::isLocked() {
+        std::lock_guard<std::mutex> lck(syncMtx);
+        return sync.isLocked();
+    }
+
+    void LrptDecoder::render(uint8_t* rgba, int width, int height) {
+        int rgb[3];
+        int step = LRPT_MSUMR_WIDTH / width;
+
+        msumr.acquire();
+        pickChannels(rgb);
+        int lines = msumr.getHeight() / step;
+        int first = std::max<int>(lines - height, 0);
+        for (int y = 0; y < height && first + y < lines; y++) {
+            int line = (first + y) * step * LRPT_MSUMR_WIDTH;
+            uint8_t* out = &rgba[y * width * 4];
+            for (int c = 0; c < 3; c++) {
+                if (rgb[c] < 0) { continue; }
+                const uint8_t* in = &msumr.getChannel(rgb[c])[line];
+                for (int x = 0; x < width; x++) { out[(x * 4) + c] = in[x * step]; }
+            }
+            for (int x = 0; x < width; x++) { out[(x * 4) + 3] = 255; }
+        }
+        msumr.release();
+    }
+
+    bool LrptDecoder::saveImage(std::string path) {
+        std::ofstream file(path, std::ios::binary);
+        if (!file.is_open()) { return false; }
+
+        int rgb[3];
+        msumr.acquire();
+        pickChannels(rgb);
+        int height = msumr.getHeight();
+        file << "P6\n" << LRPT_MSUMR_WIDTH << " " << height << "\n255\n";
+        uint8_t* line = new uint8_t[LRPT_MSUMR_WIDTH * 3];
+        for (int y = 0; y < height; y++) {
+            memset(line, 0, LRPT_MSUMR_WIDTH * 3);
+            for (int c = 0; c < 3; c++) {
+                if (rgb[c] < 0) { continue; }
+                const uint8_t* in = &msumr.getChannel(rgb[c])[y * LRPT_MSUMR_WIDTH];
+                for (int x = 0; x < LRPT_MSUMR_WIDTH; x++) { line[(x * 3) + c] = in[x]; }
+            }
+            file.write((char*)line, LRPT_MSUMR_WIDTH * 3);
+        }
+        delete[] line;
+        msumr.release();
+
+        return file.good();
+    }
+
+    void LrptDecoder::frameHandler(const uint8_t* soft, void* ctx) {
+        LrptDecoder* _this = (LrptDecoder*)ctx;
+        _this->frames++;
+        if (!_this->decoder.push(soft)) { _this->droppedFrames++; }
+    }
+
+    void LrptDecoder::caduHandler(uint8_t* cadu, bool valid, void* ctx) {
+        LrptDecoder* _this = (LrptDecoder*)ctx;
+        if (!valid) { return; }
+        _this->validFrames++;
+        _this->demux.process(&cadu[LRPT_ASM_SIZE]);
+    }
+
+    void LrptDecoder::packetHandler(uint8_t* packet, int length, void* ctx) {
+        LrptDecoder* _this = (LrptDecoder*)ctx;
+        _this->msumr.process(packet, length);
+    }
+
+    void LrptDecoder::pickChannels(int* rgb) {
+        // First three channels received as blue, green and red
+        int found = 0;
+        int channels[3] = { -1, -1, -1 };
+        for (int i = 0; i < LRPT_MSUMR_CHANNELS && found < 3; i++) {
+            if (!msumr.getChannel(i).empty()) { channels[found++] = i; }
+        }
+        if (found == 3) {
+            rgb[0] = channels[2];
+            rgb[1] = channels[1];
+            rgb[2] = channels[0];
+            return;
+        }
+        rgb[0] = rgb[1] = rgb[2] = channels[0];
+    }
+}
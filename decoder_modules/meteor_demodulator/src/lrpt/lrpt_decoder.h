@@ -0,0 +1,55 @@
+#pragma once
+#include <dsp/types.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include "frame_sync.h"
+#include "frame_decoder.h"
+#include "vcdu_demux.h"
+#include "msumr.h"
+
+namespace lrpt {
+    // Full LRPT chain from the demodulated symbols to the MSU-MR images. Only the frame sync runs on the calling
+    // thread, everything after it runs on the DSP scheduler pool.
+    class LrptDecoder {
+    public:
+        LrptDecoder();
+
+        void process(const dsp::complex_t* symbols, int count);
+
+        // Wait for the frames still being decoded and clear everything
+        void reset();
+
+        bool isLocked();
+        int getFrames() { return frames; }
+        int getValidFrames() { return validFrames; }
+        int getDroppedFrames() { return droppedFrames; }
+        uint64_t getRevision() { return msumr.getRevision(); }
+
+        // Draw the latest lines of the image into an RGBA buffer, scaled down to the given width
+        void render(uint8_t* rgba, int width, int height);
+
+        // Write the whole image as a PPM file
+        bool saveImage(std::string path);
+
+    private:
+        static void frameHandler(const uint8_t* soft, void* ctx);
+        static void caduHandler(uint8_t* cadu, bool valid, void* ctx);
+        static void packetHandler(uint8_t* packet, int length, void* ctx);
+
+        // Channels shown as red, green and blue, the same one three times if there aren't enough for a composite
+        void pickChannels(int* rgb);
+
+        // Declared in reverse order of the data flow so that the decoder is flushed before the rest goes away
+        MSUMRDecoder msumr;
+        VCDUDemux demux;
+        FrameDecoder decoder;
+
+        std::mutex syncMtx;
+        FrameSync sync;
+
+        std::atomic<int> frames = 0;
+        std::atomic<int> validFrames = 0;
+        std::atomic<int> droppedFrames = 0;
+    };
+}
@@ -0,0 +1,259 @@
+#include "msumr.h"
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+
+namespace lrpt {
+    // Standard JPEG luminance tables (ITU T.81 annex K), MSU-MR doesn't transmit its own
+    static const uint8_t DC_COUNTS[16] = { 0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0 };
+    static const uint8_t DC_VALUES[12] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 };
+    static const uint8_t AC_COUNTS[16] = { 0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7D };
+    static const uint8_t AC_VALUES[162] = {
+        0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07,
+        0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xA1, 0x08, 0x23, 0x42, 0xB1, 0xC1, 0x15, 0x52, 0xD1, 0xF0,
+        0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0A, 0x16, 0x17, 0x18, 0x19, 0x1A, 0x25, 0x26, 0x27, 0x28,
+        0x29, 0x2A, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49,
+        0x4A, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5A, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+        0x6A, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7A, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+        0x8A, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9A, 0xA2, 0xA3, 0xA4, 0xA5, 0xA6, 0xA7,
+        0xA8, 0xA9, 0xAA, 0xB2, 0xB3, 0xB4, 0xB5, 0xB6, 0xB7, 0xB8, 0xB9, 0xBA, 0xC2, 0xC3, 0xC4, 0xC5,
+        0xC6, 0xC7, 0xC8, 0xC9, 0xCA, 0xD2, 0xD3, 0xD4, 0xD5, 0xD6, 0xD7, 0xD8, 0xD9, 0xDA, 0xE1, 0xE2,
+        0xE3, 0xE4, 0xE5, 0xE6, 0xE7, 0xE8, 0xE9, 0xEA, 0xF1, 0xF2, 0xF3, 0xF4, 0xF5, 0xF6, 0xF7, 0xF8,
+        0xF9, 0xFA
+    };
+    static const int STD_QUANT[64] = {
+        16, 11, 10, 16, 24, 40, 51, 61,
+        12, 12, 14, 19, 26, 58, 60, 55,
+        14, 13, 16, 24, 40, 57, 69, 56,
+        14, 17, 22, 29, 51, 87, 80, 62,
+        18, 22, 37, 56, 68, 109, 103, 77,
+        24, 35, 55, 64, 81, 104, 113, 92,
+        49, 64, 78, 87, 103, 121, 120, 101,
+        72, 92, 95, 98, 112, 100, 103, 99
+    };
+    static const int ZIGZAG[64] = {
+        0, 1, 8, 16, 9, 2, 3, 10, 17, 24, 32, 25, 18, 11, 4, 5,
+        12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13, 6, 7, 14, 21, 28,
+        35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+        58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63
+    };
+
+    void MSUMRDecoder::Huffman::init(const uint8_t* counts, const uint8_t* values) {
+        // Canonical codes, codes of each length follow on from the shorter ones
+        this->values = values;
+        int code = 0;
+        int index = 0;
+        for (int len = 1; len <= 16; len++) {
+            valuePtr[len] = index;
+            minCode[len] = code;
+            code += counts[len - 1];
+            index += counts[len - 1];
+            maxCode[len] = counts[len - 1] ? (code - 1) : -1;
+            code <<= 1;
+        }
+    }
+
+    bool MSUMRDecoder::BitReader::read(int bits, int& value) {
+        if (pos + bits > size * 8) { return false; }
+        value = 0;
+        for (int i = 0; i < bits; i++) {
+            value = (value << 1) | ((data[pos >> 3] >> (7 - (pos & 7))) & 1);
+            pos++;
+        }
+        return true;
+    }
+
+    int MSUMRDecoder::BitReader::decode(const Huffman& huff) {
+        int code = 0;
+        for (int len = 1; len <= 16; len++) {
+            int bit;
+            if (!read(1, bit)) { return -1; }
+            code = (code << 1) | bit;
+            if (code <= huff.maxCode[len]) {
+                return huff.values[huff.valuePtr[len] + code - huff.minCode[len]];
+            }
+        }
+        return -1;
+    }
+
+    MSUMRDecoder::MSUMRDecoder() {
+        dcTable.init(DC_COUNTS, DC_VALUES);
+        acTable.init(AC_COUNTS, AC_VALUES);
+
+        // IDCT basis, cosTable[x][u] = C(u) / 2 * cos((2x + 1) * u * pi / 16)
+        for (int x = 0; x < 8; x++) {
+            for (int u = 0; u < 8; u++) {
+                float cu = (u == 0) ? (1.0f / sqrtf(2.0f)) : 1.0f;
+                cosTable[x][u] = 0.5f * cu * cosf((float)((2 * x + 1) * u) * M_PI / 16.0f);
+            }
+        }
+    }
+
+    void MSUMRDecoder::process(const uint8_t* packet, int length) {
+        int apid = ((packet[0] & 0x07) << 8) | packet[1];
+        int channel = apid - LRPT_MSUMR_APID_FIRST;
+        if (channel < 0 || channel >= LRPT_MSUMR_CHANNELS) { return; }
+
+        const uint8_t* p = &packet[6];
+        length -= 6;
+        if (length <= LRPT_MSUMR_HEADER_SIZE) { return; }
+
+        // Timestamp of the scan, then the first MCU and the quality factor of the compression
+        int day = (p[0] << 8) | p[1];
+        int ms = (p[2] << 24) | (p[3] << 16) | (p[4] << 8) | p[5];
+        int firstMCU = p[8];
+        int qf = p[13];
+        if (firstMCU + LRPT_MSUMR_MCU_PER_PACKET > LRPT_MSUMR_MCU_PER_LINE) { return; }
+
+        // Scale the quantisation table like the encoder did
+        int quant[64];
+        int f = (qf > 20 && qf < 50) ? (5000 / qf) : (200 - (2 * qf));
+        for (int i = 0; i < 64; i++) {
+            quant[i] = std::max<int>(((STD_QUANT[i] * f) + 50) / 100, 1);
+        }
+
+        std::lock_guard<std::mutex> lck(mtx);
+
+        int scan = findScan(((int64_t)day * 86400000) + ms);
+        if (scan < 0) { return; }
+
+        // Grow all images when a new scan starts so they always have the same height
+        std::vector<uint8_t>& img = channels[channel];
+        if (scan >= scans || img.empty()) {
+            scans = std::max<int>(scans, scan + 1);
+            int pixels = scans * LRPT_MSUMR_MCU_SIZE * LRPT_MSUMR_WIDTH;
+            for (auto& ch : channels) {
+                if (!ch.empty() || &ch == &img) { ch.resize(pixels, 0); }
+            }
+        }
+
+        // The DC prediction restarts with every packet
+        BitReader reader = { &p[LRPT_MSUMR_HEADER_SIZE], length - LRPT_MSUMR_HEADER_SIZE, 0 };
+        int dc = 0;
+        float block[64];
+        for (int i = 0; i < LRPT_MSUMR_MCU_PER_PACKET; i++) {
+            if (!decodeMCU(reader, dc, quant, block)) { break; }
+            int x = (firstMCU + i) * LRPT_MSUMR_MCU_SIZE;
+            int y = scan * LRPT_MSUMR_MCU_SIZE;
+            idct(block, &img[(y * LRPT_MSUMR_WIDTH) + x], LRPT_MSUMR_WIDTH);
+        }
+
+        revision++;
+    }
+
+    void MSUMRDecoder::reset() {
+        std::lock_guard<std::mutex> lck(mtx);
+        for (auto& ch : channels) { ch.clear(); }
+        scans = 0;
+        timeValid = false;
+        scanPeriod = 0;
+        revision++;
+    }
+
+    void MSUMRDecoder::acquire() {
+        mtx.lock();
+    }
+
+    void MSUMRDecoder::release() {
+        mtx.unlock();
+    }
+
+    const std::vector<uint8_t>& MSUMRDecoder::getChannel(int channel) {
+        return channels[channel];
+    }
+
+    int MSUMRDecoder::getHeight() {
+        return scans * LRPT_MSUMR_MCU_SIZE;
+    }
+
+    uint64_t MSUMRDecoder::getRevision() {
+        std::lock_guard<std::mutex> lck(mtx);
+        return revision;
+    }
+
+    int MSUMRDecoder::findScan(int64_t time) {
+        if (!timeValid) {
+            timeValid = true;
+            lastTime = time;
+            lastScan = 0;
+            return 0;
+        }
+
+        // All channels of a scan carry about the same time
+        int64_t dt = time - lastTime;
+        if (llabs(dt) < LRPT_MSUMR_SAME_SCAN_TIME) { return lastScan; }
+
+        // The scan period is learned as the shortest step between scans, lost frames only make steps longer
+        if (dt > 0 && (!scanPeriod || dt < scanPeriod)) { scanPeriod = dt; }
+        int steps = scanPeriod ? std::max<int>(llround((double)llabs(dt) / (double)scanPeriod), 1) : 1;
+        if (steps > LRPT_MSUMR_MAX_SCAN_GAP) { return -1; }
+
+        // Late packets of an earlier scan don't move the reference
+        if (dt < 0) {
+            int scan = lastScan - steps;
+            return (scan >= 0) ? scan : -1;
+        }
+        lastTime = time;
+        lastScan += steps;
+        return lastScan;
+    }
+
+    bool MSUMRDecoder::decodeMCU(BitReader& reader, int& dc, const int* quant, float* block) {
+        int coeffs[64];
+        memset(coeffs, 0, sizeof(coeffs));
+
+        // DC difference to the previous MCU
+        int cat = reader.decode(dcTable);
+        if (cat < 0) { return false; }
+        int diff = 0;
+        if (cat) {
+            if (!reader.read(cat, diff)) { return false; }
+            if (diff < (1 << (cat - 1))) { diff -= (1 << cat) - 1; }
+        }
+        dc += diff;
+        coeffs[0] = dc;
+
+        // AC run lengths in zigzag order
+        for (int k = 1; k < 64;) {
+            int rs = reader.decode(acTable);
+            if (rs < 0) { return false; }
+            int run = rs >> 4;
+            int size = rs & 0x0F;
+            if (!size) {
+                if (run != 15) { break; }
+                k += 16;
+                continue;
+            }
+            k += run;
+            if (k >= 64) { return false; }
+            int val;
+            if (!reader.read(size, val)) { return false; }
+            if (val < (1 << (size - 1))) { val -= (1 << size) - 1; }
+            coeffs[ZIGZAG[k++]] = val;
+        }
+
+        for (int i = 0; i < 64; i++) {
+            block[i] = (float)(coeffs[i] * quant[i]);
+        }
+        return true;
+    }
+
+    void MSUMRDecoder::idct(const float* in, uint8_t* out, int stride) {
+        // Rows then columns
+        float tmp[64];
+        for (int v = 0; v < 8; v++) {
+            for (int x = 0; x < 8; x++) {
+                float sum = 0.0f;
+                for (int u = 0; u < 8; u++) { sum += cosTable[x][u] * in[(v * 8) + u]; }
+                tmp[(v * 8) + x] = sum;
+            }
+        }
+        for (int y = 0; y < 8; y++) {
+            for (int x = 0; x < 8; x++) {
+                float sum = 0.0f;
+                for (int v = 0; v < 8; v++) { sum += cosTable[y][v] * tmp[(v * 8) + x]; }
+                out[(y * stride) + x] = std::clamp<int>(lroundf(sum) + 128, 0, 255);
+            }
+        }
+    }
+}
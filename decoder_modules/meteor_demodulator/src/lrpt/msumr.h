@@ -0,0 +1,81 @@
+#pragma once
+#include <stdint.h>
+#include <mutex>
+#include <vector>
+
+// MSU-MR imager channels, APIDs 64 to 69
+#define LRPT_MSUMR_APID_FIRST       64
+#define LRPT_MSUMR_CHANNELS         6
+
+// Each packet holds 14 JPEG compressed 8x8 MCUs of a 196 MCU wide scan
+#define LRPT_MSUMR_WIDTH            1568
+#define LRPT_MSUMR_MCU_SIZE         8
+#define LRPT_MSUMR_MCU_PER_PACKET   14
+#define LRPT_MSUMR_MCU_PER_LINE     (LRPT_MSUMR_WIDTH / LRPT_MSUMR_MCU_SIZE)
+#define LRPT_MSUMR_HEADER_SIZE      14
+
+// Packets less than this far apart in time belong to the same scan, in ms
+#define LRPT_MSUMR_SAME_SCAN_TIME   300
+
+// Timestamps further ahead than this many scans are taken as corrupt
+#define LRPT_MSUMR_MAX_SCAN_GAP     256
+
+namespace lrpt {
+    // Decodes the MSU-MR image packets into one image per channel. The scan a packet belongs to is found from its
+    // timestamp so that lost frames leave a gap instead of shifting the rest of the image.
+    class MSUMRDecoder {
+    public:
+        MSUMRDecoder();
+
+        // Process a space packet including its primary header
+        void process(const uint8_t* packet, int length);
+        void reset();
+
+        // The images may only be read between acquire() and release()
+        void acquire();
+        void release();
+
+        // Image of a channel, LRPT_MSUMR_WIDTH wide and getHeight() lines high, empty if the channel wasn't received
+        const std::vector<uint8_t>& getChannel(int channel);
+        int getHeight();
+
+        // Incremented every time the images change
+        uint64_t getRevision();
+
+    private:
+        struct Huffman {
+            void init(const uint8_t* counts, const uint8_t* values);
+            int minCode[17];
+            int maxCode[17];
+            int valuePtr[17];
+            const uint8_t* values;
+        };
+
+        struct BitReader {
+            bool read(int bits, int& value);
+            int decode(const Huffman& huff);
+            const uint8_t* data;
+            int size;
+            int pos;
+        };
+
+        int findScan(int64_t time);
+        bool decodeMCU(BitReader& reader, int& dc, const int* quant, float* block);
+        void idct(const float* in, uint8_t* out, int stride);
+
+        Huffman dcTable;
+        Huffman acTable;
+        float cosTable[8][8];
+
+        std::mutex mtx;
+        std::vector<uint8_t> channels[LRPT_MSUMR_CHANNELS];
+        int scans = 0;
+        uint64_t revision = 0;
+
+        // Time of the most recent scan and the shortest time seen between two scans
+        bool timeValid = false;
+        int64_t lastTime;
+        int lastScan;
+        int64_t scanPeriod = 0;
+    };
+}
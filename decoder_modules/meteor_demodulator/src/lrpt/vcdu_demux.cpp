@@ -0,0 +1,62 @@
+#include "vcdu_demux.h"
+#include "ccsds.h"
+
+namespace lrpt {
+    VCDUDemux::VCDUDemux(void (*handler)(uint8_t* packet, int length, void* ctx), void* ctx) {
+        _handler = handler;
+        _ctx = ctx;
+    }
+
+    void VCDUDemux::process(const uint8_t* vcdu) {
+        int vcid = vcdu[1] & 0x3F;
+        if (vcid == LRPT_VCID_FILL) { return; }
+        Channel& ch = channels[vcid];
+
+        // A packet spanning a lost VCDU can't be completed
+        uint32_t counter = (vcdu[2] << 16) | (vcdu[3] << 8) | vcdu[4];
+        if (ch.inSync && counter != ((ch.counter + 1) & 0xFFFFFF)) {
+            ch.inSync = false;
+        }
+        ch.counter = counter;
+
+        const uint8_t* zone = &vcdu[LRPT_MPDU_DATA_OFFSET];
+        int zoneSize = LRPT_VCDU_SIZE - LRPT_MPDU_DATA_OFFSET;
+        int fhp = ((vcdu[8] & 0x07) << 8) | vcdu[9];
+
+        // No packet starts in this M_PDU, it's all the continuation of the current one
+        if (fhp == LRPT_MPDU_NO_HEADER) {
+            if (ch.inSync) { append(ch, zone, zoneSize); }
+            return;
+        }
+        if (fhp >= zoneSize) {
+            ch.inSync = false;
+            return;
+        }
+
+        // Finish the current packet, then resync on the first header
+        if (ch.inSync) { append(ch, zone, fhp); }
+        ch.packet.clear();
+        ch.inSync = true;
+        append(ch, &zone[fhp], zoneSize - fhp);
+    }
+
+    void VCDUDemux::reset() {
+        channels.clear();
+    }
+
+    void VCDUDemux::append(Channel& ch, const uint8_t* data, int count) {
+        ch.packet.insert(ch.packet.end(), data, data + count);
+
+        // Hand out every packet that is now complete
+        int offset = 0;
+        while (ch.packet.size() - offset >= LRPT_PACKET_HEADER_SIZE) {
+            uint8_t* header = &ch.packet[offset];
+            int length = LRPT_PACKET_HEADER_SIZE + ((header[4] << 8) | header[5]) + 1;
+            if (ch.packet.size() - offset < length) { break; }
+            int apid = ((header[0] & 0x07) << 8) | header[1];
+            if (apid != LRPT_APID_IDLE) { _handler(header, length, _ctx); }
+            offset += length;
+        }
+        ch.packet.erase(ch.packet.begin(), ch.packet.begin() + offset);
+    }
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <stdint.h>
+#include <map>
+#include <vector>
+
+// VCDU header and M_PDU header sizes, the packet zone fills the rest of the VCDU
+#define LRPT_VCDU_HEADER_SIZE       6
+#define LRPT_VCDU_INSERT_ZONE_SIZE  2
+#define LRPT_MPDU_HEADER_SIZE       2
+#define LRPT_MPDU_DATA_OFFSET       (LRPT_VCDU_HEADER_SIZE + LRPT_VCDU_INSERT_ZONE_SIZE + LRPT_MPDU_HEADER_SIZE)
+#define LRPT_MPDU_NO_HEADER         0x7FF
+
+#define LRPT_VCID_FILL              63
+#define LRPT_APID_IDLE              2047
+
+#define LRPT_PACKET_HEADER_SIZE     6
+
+namespace lrpt {
+    // Reassembles the CCSDS space packets spread over the M_PDUs of each virtual channel
+    class VCDUDemux {
+    public:
+        VCDUDemux(void (*handler)(uint8_t* packet, int length, void* ctx), void* ctx);
+
+        // Process the VCDU following the ASM of a CADU
+        void process(const uint8_t* vcdu);
+        void reset();
+
+    private:
+        struct Channel {
+            uint32_t counter;
+            bool inSync = false;
+            std::vector<uint8_t> packet;
+        };
+
+        void append(Channel& ch, const uint8_t* data, int count);
+
+        void (*_handler)(uint8_t* packet, int length, void* ctx);
+        void* _ctx;
+
+        std::map<int, Channel> channels;
+    };
+}
@@ -13,6 +13,8 @@
 #include <meteor_demodulator_interface.h>
 #include <gui/widgets/folder_select.h>
 #include <gui/widgets/constellation_diagram.h>
+#include <gui/widgets/image.h>
+#include "lrpt/lrpt_decoder.h"
 
 #include <fstream>
 
@@ -38,9 +40,13 @@ std::string genFileName(std::string prefix, std::string suffix) {
 
 #define INPUT_SAMPLE_RATE 150000
 
+// Live image preview, half the MSU-MR resolution
+#define PREVIEW_WIDTH   784
+#define PREVIEW_HEIGHT  512
+
 class MeteorDemodulatorModule : public ModuleManager::Instance {
 public:
-    MeteorDemodulatorModule(std::string name) : folderSelect("%ROOT%/recordings") {
+    MeteorDemodulatorModule(std::string name) : folderSelect("%ROOT%/recordings"), preview(PREVIEW_WIDTH, PREVIEW_HEIGHT) {
         this->name = name;
 
         writeBuffer = new int8_t[STREAM_BUFFER_SIZE];
@@ -60,6 +66,9 @@ public:
         if (config.conf[name].contains("oqpsk")) {
             oqpsk = config.conf[name]["oqpsk"];
         }
+        if (config.conf[name].contains("liveDecode")) {
+            liveDecode = config.conf[name]["liveDecode"];
+        }
         config.release();
 
         vfo = sigpath::vfoManager.createVFO(name, ImGui::WaterfallVFO::REF_CENTER, 0, INPUT_SAMPLE_RATE, INPUT_SAMPLE_RATE, INPUT_SAMPLE_RATE, INPUT_SAMPLE_RATE, true);
@@ -162,6 +171,40 @@ private:
             config.release(true);
         }
 
+        if (ImGui::Checkbox(CONCAT("Live decode##meteor_live_", _this->name), &_this->liveDecode)) {
+            config.acquire();
+            config.conf[_this->name]["liveDecode"] = _this->liveDecode;
+            config.release(true);
+        }
+
+        if (_this->liveDecode) {
+            // Only redraw the preview when new image data came in
+            uint64_t revision = _this->lrptDecoder.getRevision();
+            if (revision != _this->previewRevision) {
+                _this->previewRevision = revision;
+                _this->lrptDecoder.render((uint8_t*)_this->preview.buffer, PREVIEW_WIDTH, PREVIEW_HEIGHT);
+                _this->preview.swap();
+            }
+            ImGui::SetNextItemWidth(menuWidth);
+            _this->preview.draw();
+
+            ImGui::Text("%s, frames %d/%d", _this->lrptDecoder.isLocked() ? "Locked" : "Searching", _this->lrptDecoder.getValidFrames(), _this->lrptDecoder.getFrames());
+            if (_this->lrptDecoder.getDroppedFrames()) {
+                ImGui::SameLine();
+                ImGui::TextColored(ImVec4(1.0f, 0.0f, 0.0f, 1.0f), "(%d dropped)", _this->lrptDecoder.getDroppedFrames());
+            }
+
+            if (ImGui::Button(CONCAT("Reset##meteor_live_", _this->name), ImVec2(menuWidth / 2.0f, 0))) {
+                _this->lrptDecoder.reset();
+            }
+            ImGui::SameLine();
+            if (!_this->folderSelect.pathIsValid()) { style::beginDisabled(); }
+            if (ImGui::Button(CONCAT("Save image##meteor_live_", _this->name), ImVec2(ImGui::GetContentRegionAvail().x, 0))) {
+                _this->saveImage();
+            }
+            if (!_this->folderSelect.pathIsValid()) { style::endDisabled(); }
+        }
+
         if (!_this->folderSelect.pathIsValid() && _this->enabled) { style::beginDisabled(); }
 
         if (_this->recording) {
@@ -192,6 +235,8 @@ private:
 
     static void sinkHandler(dsp::complex_t* data, int count, void* ctx) {
         MeteorDemodulatorModule* _this = (MeteorDemodulatorModule*)ctx;
+        if (_this->liveDecode) { _this->lrptDecoder.process(data, count); }
+
         std::lock_guard<std::mutex> lck(_this->recMtx);
         if (!_this->recording) { return; }
         for (int i = 0; i < count; i++) {
@@ -223,6 +268,16 @@ private:
         dataWritten = 0;
     }
 
+    void saveImage() {
+        std::string filename = genFileName(folderSelect.expandString(folderSelect.path) + "/meteor", ".ppm");
+        if (lrptDecoder.saveImage(filename)) {
+            flog::info("Saved LRPT image to '{0}'", filename);
+        }
+        else {
+            flog::error("Could not save LRPT image to '{0}'", filename);
+        }
+    }
+
     static void moduleInterfaceHandler(int code, void* in, void* out, void* ctx) {
         MeteorDemodulatorModule* _this = (MeteorDemodulatorModule*)ctx;
         if (code == METEOR_DEMODULATOR_IFACE_CMD_START) {
@@ -250,6 +305,11 @@ private:
     ImGui::ConstellationDiagram constDiagram;
 
     FolderSelect folderSelect;
+    ImGui::ImageDisplay preview;
+    uint64_t previewRevision = 0;
+
+    lrpt::LrptDecoder lrptDecoder;
+    bool liveDecode = false;
 
     std::mutex recMtx;
     bool recording = false;
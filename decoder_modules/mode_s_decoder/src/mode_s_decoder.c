@@ -90,6 +90,10 @@ void prepareContext(struct mode_s_context * ctx, ModeSHandler handler) {
         ctx->aggressive = 0;
         ctx->aircraft_info_ttl = 60;
 
+        ctx->block_sample_index = 0;
+        ctx->block_timestamp = 0;
+        ctx->block_timestamp_gps = 0;
+
         memset(ctx->icao_cache, 0, sizeof(uint32_t) * MODE_S_ICAO_CACHE_LEN * 2);
 
         // Statistics
@@ -672,6 +676,13 @@ void displayModesMessage(struct mode_s_context * ctx, struct mode_s_message *mm)
         return; // Enough for --raw mode
     }
 
+    if (mm->timestamp) {
+        time_t sec = (time_t)(mm->timestamp / 1000000000LL);
+        struct tm tm;
+        gmtime_r(&sec, &tm);
+        printf("Time: %02d:%02d:%02d.%06d UTC%s\n", tm.tm_hour, tm.tm_min, tm.tm_sec,
+            (int)((mm->timestamp % 1000000000LL) / 1000), mm->timestamp_gps ? " (GPS)" : "");
+    }
     printf("CRC: %06x (%s)\n", (int)mm->crc, mm->crcok ? "ok" : "wrong");
     if (mm->errorbit != -1)
         printf("Single bit error fixed, bit %d\n", mm->errorbit);
@@ -1011,6 +1022,11 @@ good_preamble:
             // Decode the received message and update statistics
             decodeModesMessage(ctx, &mm, msg);
 
+            // Timestamp the message with the position of its preamble in the sample stream
+            mm.sample_index = ctx->block_sample_index + j;
+            mm.timestamp = ctx->block_timestamp ? ctx->block_timestamp + ((int64_t)j * 1000000000LL) / MODE_S_DEFAULT_RATE : 0;
+            mm.timestamp_gps = ctx->block_timestamp_gps;
+
             // Update statistics.
             if (mm.crcok || use_correction) {
                 if (errors == 0) ctx->stat_demodulated++;
@@ -1329,11 +1345,11 @@ struct aircraft *updateAircraftInfo(struct mode_s_context * ctx, struct mode_s_m
             if (mm->fflag) {
                 a->odd_cprlat = mm->raw_latitude;
                 a->odd_cprlon = mm->raw_longitude;
-                a->odd_cprtime = mstime();
+                a->odd_cprtime = mm->timestamp ? mm->timestamp / 1000000 : mstime();
             } else {
                 a->even_cprlat = mm->raw_latitude;
                 a->even_cprlon = mm->raw_longitude;
-                a->even_cprtime = mstime();
+                a->even_cprtime = mm->timestamp ? mm->timestamp / 1000000 : mstime();
             }
             /* If the two data is less than 10 seconds apart, compute
              * the position. */
@@ -113,6 +113,9 @@ struct mode_s_message {
     int errorbit;               // Bit corrected. -1 if no bit corrected.
     int aa1, aa2, aa3;          // ICAO Address bytes 1 2 and 3
     int phase_corrected;        // True if phase correction was applied.
+    uint64_t sample_index;      // Source sample index of the first preamble sample.
+    int64_t timestamp;          // UTC time of the first preamble sample in ns, 0 if unknown.
+    int timestamp_gps;          // True if the timestamp is disciplined by the GPS.
 
     // DF 11
     int ca;                     // Responder capabilities.
@@ -163,6 +166,11 @@ struct mode_s_context {
     int onlyaddr;                   // Print only ICAO addresses.
     int aggressive;                 // Aggressive detection algorithm.
 
+    // Timing of the first sample of the current magnitude buffer, set before calling detectModeS()
+    uint64_t block_sample_index;
+    int64_t block_timestamp;        // UTC in ns, 0 if unknown.
+    int block_timestamp_gps;
+
     // List of aircrafts
     struct aircraft *aircrafts;
     int aircraft_info_ttl;          // Aircraft informaation TTL before deletion.
@@ -20,6 +20,8 @@ namespace dsp {
             _in = in;
             block::registerInput(_in);
             //block::registerOutput(&out);
+            block::setProfileName("Mode S/Detector");
+            block::setThreadRole(THREAD_ROLE_DECODER);
             block::_block_init = true;
 
             output_buffer.reserve(10240);
@@ -52,11 +54,25 @@ namespace dsp {
                 return -1;
             }
 
+            // Let the decoder timestamp messages from the position of the block in the sample stream
+            stream_meta meta = _in->getMeta();
+            _ctx->block_sample_index = meta.sampleIndex;
+            _ctx->block_timestamp = (meta.flags & STREAM_META_VALID) ? meta.utcTime : 0;
+            _ctx->block_timestamp_gps = (meta.flags & STREAM_META_GPS_TIME) != 0;
+
+            process(count, _in->readBuf);
+
+            _in->flush();
+            return count;
+        }
+
+        // Detect messages in a block of samples, also used directly by the benchmarks
+        void process(int count, const complex_t* in) {
             // Convert values to 8-bit integer
 			int byteCount = count * 2;
             output_buffer.resize(byteCount);
             int8_t* output_buf = output_buffer.data();
-            volk_32f_s32f_convert_8i(output_buf, (float*)_in->readBuf, 128.0f, byteCount);
+            volk_32f_s32f_convert_8i(output_buf, (float*)in, 128.0f, byteCount);
 
             m_buffer.resize(count);
             uint16_t * m_buf = m_buffer.data();
@@ -70,9 +86,6 @@ namespace dsp {
             }
 
             detectModeS(_ctx, m_buf, count);
-
-            _in->flush();
-            return count;
         }
 
         //stream<uint8_t> out;
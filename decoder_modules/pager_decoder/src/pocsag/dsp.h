@@ -23,6 +23,7 @@ public:
 
         // Configure blocks
         demod.init(NULL, -4500.0, samplerate);
+        demod.setAccuracy(dsp::math::POLAR_ACCURACY_FAST);
         float taps[] = { 0.1f, 0.1f, 0.1f, 0.1f, 0.1f, 0.1f, 0.1f, 0.1f, 0.1f, 0.1f };
         shape = dsp::taps::fromArray<float>(10, taps);
         fir.init(NULL, shape);
@@ -34,6 +35,8 @@ public:
 
         // Init base
         base_type::init(in);
+        base_type::registerOutput(&soft);
+        base_type::setThreadRole(THREAD_ROLE_DECODER);
     }
 
     int process(int count, dsp::complex_t* in, float* softOut, uint8_t* out) {
@@ -46,6 +46,9 @@ namespace demod {
         virtual bool getFMIFNRAllowed() = 0;
         virtual bool getNBAllowed() = 0;
         virtual dsp::stream<dsp::stereo_t>* getOutput() = 0;
+
+        // Emitted with the new getAFSampleRate() when a setting of the demodulator changes it
+        Event<double> onAFSampleRateChanged;
     };
 }
 
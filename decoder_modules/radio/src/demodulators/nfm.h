@@ -30,6 +30,7 @@ namespace demod {
 
             // Define structure
             demod.init(input, getIFSampleRate(), bandwidth, _lowPass, _highPass);
+            demod.setAccuracy(dsp::math::POLAR_ACCURACY_FAST);
         }
 
         void start() { demod.start(); }
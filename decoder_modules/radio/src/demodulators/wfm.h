@@ -6,6 +6,10 @@
 #include <fstream>
 #include <rds.h>
 
+// With low pass the stereo decoder decimates to 50KHz, well above the 15KHz of audio. Without it the
+// output stays the full rate MPX with the pilot, L-R and RDS.
+#define WFM_AUDIO_DECIMATION    5
+
 namespace demod {
     enum RDSRegion {
         RDS_REGION_EUROPE,
@@ -72,7 +76,8 @@ namespace demod {
             }
 
             // Init DSP
-            demod.init(input, bandwidth / 2.0f, getIFSampleRate(), _stereo, _lowPass, _rds);
+            demod.init(input, bandwidth / 2.0f, getIFSampleRate(), _stereo, _lowPass, _rds, getDecimation());
+            demod.setAccuracy(dsp::math::POLAR_ACCURACY_HIGH); // Stereo separation suffers from discriminator errors
             rdsDemod.init(&demod.rdsOut, _rdsInfo);
             hs.init(&rdsDemod.out, rdsHandler, this);
             reshape.init(&rdsDemod.soft, 4096, (1187 / 30) - 4096);
@@ -108,6 +113,8 @@ namespace demod {
             }
             if (ImGui::Checkbox(("Low Pass##_radio_wfm_lowpass_" + name).c_str(), &_lowPass)) {
                 demod.setLowPass(_lowPass);
+                demod.setDecimation(getDecimation());
+                onAFSampleRateChanged.emit(getAFSampleRate());
                 _config->acquire();
                 _config->conf[name][getName()]["lowPass"] = _lowPass;
                 _config->release(true);
@@ -258,7 +265,7 @@ namespace demod {
 
         const char* getName() { return "WFM"; }
         double getIFSampleRate() { return 250000.0; }
-        double getAFSampleRate() { return getIFSampleRate(); }
+        double getAFSampleRate() { return getIFSampleRate() / getDecimation(); }
         double getDefaultBandwidth() { return 150000.0; }
         double getMinBandwidth() { return 50000.0; }
         double getMaxBandwidth() { return getIFSampleRate(); }
@@ -285,6 +292,10 @@ namespace demod {
         }
 
     private:
+        int getDecimation() {
+            return _lowPass ? WFM_AUDIO_DECIMATION : 1;
+        }
+
         static void rdsHandler(uint8_t* data, int count, void* ctx) {
             WFM* _this = (WFM*)ctx;
             _this->rdsDecode.process(data, count);
@@ -70,6 +70,9 @@ public:
         ifChainOutputChanged.handler = ifChainOutputChangeHandler;
         ifChain.init(vfo->output);
 
+        afSampleRateChangedHandler.handler = demodAFSampleRateChangeHandler;
+        afSampleRateChangedHandler.ctx = this;
+
         nb.init(NULL, 500.0 / 24000.0, 10.0);
         fmnr.init(NULL, 32);
         squelch.init(NULL, MIN_SQUELCH);
@@ -344,6 +347,7 @@ private:
             delete selectedDemod;
         }
         selectedDemod = demod;
+        selectedDemod->onAFSampleRateChanged.bindHandler(&afSampleRateChangedHandler);
 
         // Give the demodulator the most recent audio SR
         selectedDemod->AFSampRateChanged(audioSampleRate);
@@ -589,6 +593,14 @@ private:
         _this->setAudioSampleRate(sampleRate);
     }
 
+    static void demodAFSampleRateChangeHandler(double sampleRate, void* ctx) {
+        RadioModule* _this = (RadioModule*)ctx;
+        if (!_this->postProcEnabled) { return; }
+        _this->afChain.stop();
+        _this->resamp.setInSamplerate(sampleRate);
+        _this->afChain.start();
+    }
+
     static void ifChainOutputChangeHandler(dsp::stream<dsp::complex_t>* output, void* ctx) {
         RadioModule* _this = (RadioModule*)ctx;
         if (!_this->selectedDemod) { return; }
@@ -646,6 +658,7 @@ private:
     // Handlers
     EventHandler<double> onUserChangedBandwidthHandler;
     EventHandler<float> srChangeHandler;
+    EventHandler<double> afSampleRateChangedHandler;
     EventHandler<dsp::stream<dsp::complex_t>*> ifChainOutputChanged;
     EventHandler<dsp::stream<dsp::stereo_t>*> afChainOutputChanged;
 
@@ -38,6 +38,7 @@ public:
 
         // Init the rest
         base_type::init(in);
+        base_type::registerOutput(&soft);
     }
 
     void setSoftEnabled(bool enable) {
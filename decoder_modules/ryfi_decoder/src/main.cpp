@@ -99,6 +99,10 @@ private:
         ImGui::SetNextItemWidth(menuWidth);
         _this->constDiagram.draw();
 
+        dsp::fec::RSStats stats = _this->rx.getFECStats();
+        ImGui::Text("Frames: %llu (%llu failed)", (unsigned long long)stats.frames, (unsigned long long)stats.failedFrames);
+        ImGui::Text("Corrected symbols: %llu", (unsigned long long)stats.correctedSymbols);
+
         if (!_this->enabled) { style::endDisabled(); }
     }
 
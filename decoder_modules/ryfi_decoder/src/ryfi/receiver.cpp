@@ -28,6 +28,10 @@ namespace ryfi {
         demod.setInput(in);
     }
 
+    dsp::fec::RSStats Receiver::getFECStats() {
+        return rs.getStats();
+    }
+
     void Receiver::start() {
         // Do nothing if already running
         if (running) { return; }
@@ -48,6 +48,12 @@ namespace ryfi {
          * Stop the transmitter's DSP.
         */
         void stop();
+
+        /**
+         * Get the error correction statistics of the received frames.
+         * @return Statistics since the receiver was created.
+        */
+        dsp::fec::RSStats getFECStats();
         
         dsp::stream<dsp::complex_t>* softOut;
 
@@ -51,17 +51,14 @@ namespace ryfi {
     }
 
     RSDecoder::RSDecoder(dsp::stream<uint8_t>* in) {
-        // Create the convolutional encoder instance
-        rs = correct_reed_solomon_create(correct_rs_primitive_polynomial_ccsds, 1, 1, 32);
+        // Create the interleaved reed-solomon decoder
+        rs.init(correct_rs_primitive_polynomial_ccsds, 1, 1, 32, RS_BLOCK_COUNT, RS_BLOCK_ENC_SIZE);
         
         // Init the base class
         base_type::init(in);
     }
 
-    RSDecoder::~RSDecoder() {
-        // Destroy the convolutional encoder instance
-        correct_reed_solomon_destroy(rs);
-    }
+    RSDecoder::~RSDecoder() {}
 
     int RSDecoder::decode(uint8_t* in, uint8_t* out, int count) {
         // Check the size
@@ -72,23 +69,16 @@ namespace ryfi {
             in[i] ^= RS_SCRAMBLER_SEQ[i];
         }
 
-        // Go through each block
-        uint8_t block[RS_BLOCK_ENC_SIZE];
-        for (int i = 0; i < RS_BLOCK_COUNT; i++) {
-            // Deinterleave out of the frame
-            int k = 0;
-            for (int j = i; j < count; j += RS_BLOCK_COUNT) {
-                block[k++] = in[j];
-            }
-
-            // Decode block and return if decoding fails
-            int res = correct_reed_solomon_decode(rs, block, RS_BLOCK_ENC_SIZE, &out[i*RS_BLOCK_DEC_SIZE]);
-            if (res < 0) { return 0; }
-        }
+        // Deinterleave and decode all blocks, return if decoding fails
+        if (!rs.decode(in, out)) { return 0; }
 
         return RS_BLOCK_COUNT*RS_BLOCK_DEC_SIZE;
     }
 
+    dsp::fec::RSStats RSDecoder::getStats() {
+        return rs.getStats();
+    }
+
     int RSDecoder::run() {
         int count = base_type::_in->read();
         if (count < 0) { return -1; }
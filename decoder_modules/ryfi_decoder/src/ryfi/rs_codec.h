@@ -1,6 +1,7 @@
 #pragma once
 #include <stdint.h>
 #include "dsp/processor.h"
+#include "dsp/fec/interleaved_rs.h"
 
 extern "C" {
     #include "correct.h"
@@ -73,9 +74,15 @@ namespace ryfi {
         */
         int decode(uint8_t* in, uint8_t* out, int count);
 
+        /**
+         * Get the error correction statistics.
+         * @return Statistics since the decoder was created.
+        */
+        dsp::fec::RSStats getStats();
+
     private:
         int run();
 
-        correct_reed_solomon* rs;
+        dsp::fec::InterleavedRS rs;
     };
 }
\ No newline at end of file
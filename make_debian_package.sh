@@ -15,7 +15,7 @@ echo "Version: $VERSION" >> "$DIRECTORY/DEBIAN/control"
 echo 'Maintainer: UUGear' >> "$DIRECTORY/DEBIAN/control"
 echo 'Architecture: arm64' >> "$DIRECTORY/DEBIAN/control"
 echo 'Description: Receiver software for VU GPSDR, based on SDR++' >> "$DIRECTORY/DEBIAN/control"
-echo 'Depends: libglfw3,libvolk2-bin,librtlsdr0,librtaudio6' >> "$DIRECTORY/DEBIAN/control"
+echo 'Depends: libglfw3,libvolk2-bin,librtlsdr0,librtaudio6,libsqlite3-0' >> "$DIRECTORY/DEBIAN/control"
 
 # Create postinst script
 echo 'Copy postinst script'
@@ -0,0 +1,335 @@
+#include "iq_fanout.h"
+#include <dsp/buffer/buffer.h>
+#include <utils/flog.h>
+#include <utils/reactor.h>
+#include <volk/volk.h>
+#include <chrono>
+#include <algorithm>
+
+// Bytes a subscriber may have waiting before its new packets get dropped
+#define IQ_FANOUT_MAX_QUEUE     (4 * 1024 * 1024)
+
+// Packets sent per system call
+#define IQ_FANOUT_BATCH         64
+
+IQFanout::Block::Block(int capacity) {
+    data = dsp::buffer::alloc<uint8_t>(capacity);
+    this->capacity = capacity;
+}
+
+IQFanout::Block::~Block() {
+    dsp::buffer::free(data);
+}
+
+IQFanout::IQFanout() {}
+
+IQFanout::~IQFanout() {
+    stop();
+}
+
+void IQFanout::start() {
+    std::lock_guard<std::mutex> lck(mtx);
+    if (running) { return; }
+    sequence = 0;
+    resetCarry = true;
+    running = true;
+}
+
+void IQFanout::stop() {
+    std::vector<std::shared_ptr<Subscriber>> subs;
+    {
+        std::lock_guard<std::mutex> lck(mtx);
+        running = false;
+        subs.swap(subscribers);
+    }
+
+    // Close all subscribers once the reactor is done with them
+    for (auto& sub : subs) {
+        net::Reactor::get()->remove(sub->sock->handle());
+        sub->sock->close();
+    }
+}
+
+void IQFanout::setSampleType(SampleType type) {
+    std::lock_guard<std::mutex> lck(mtx);
+    sampType = type;
+    resetCarry = true;
+}
+
+void IQFanout::setPacketSize(int size) {
+    std::lock_guard<std::mutex> lck(mtx);
+    packetSize = size;
+    resetCarry = true;
+}
+
+void IQFanout::setHeaderEnabled(bool enabled) {
+    std::lock_guard<std::mutex> lck(mtx);
+    header = enabled;
+}
+
+void IQFanout::addSubscriber(std::shared_ptr<net::Socket> sock, const std::string& name) {
+    auto sub = std::make_shared<Subscriber>();
+    sub->owner = this;
+    sub->sock = sock;
+    sub->name = name;
+    sub->udp = (sock->type() == net::SOCKET_TYPE_UDP);
+
+    // TCP subscribers are watched for reads so that a disconnection is noticed even with nothing to send
+    std::lock_guard<std::mutex> lck(mtx);
+    if (!net::Reactor::get()->add(sock->handle(), sub->udp ? 0u : (uint32_t)EPOLLIN, eventHandler, sub.get())) {
+        sock->close();
+        return;
+    }
+    subscribers.push_back(sub);
+    flog::info("[IQExporter] New subscriber: {}", name);
+}
+
+int IQFanout::getSubscriberCount() {
+    std::lock_guard<std::mutex> lck(mtx);
+    return subscribers.size();
+}
+
+std::vector<IQSubscriberStats> IQFanout::getStats() {
+    std::lock_guard<std::mutex> lck(mtx);
+    std::vector<IQSubscriberStats> stats;
+    for (auto& sub : subscribers) {
+        stats.push_back({ sub->name, sub->queuedBytes, sub->sentPackets, sub->droppedPackets });
+    }
+    return stats;
+}
+
+void IQFanout::write(const dsp::complex_t* data, int count, const dsp::stream_meta& meta, double sampleRate) {
+    // Nothing to convert if nobody is listening
+    std::unique_lock<std::mutex> lck(mtx);
+    if (subscribers.empty() || !running) {
+        resetCarry = true;
+        pool.clear();
+        return;
+    }
+    SampleType type = sampType;
+    int pktSize = packetSize;
+    if (resetCarry) {
+        carry.resize(pktSize);
+        carrySize = 0;
+        resetCarry = false;
+    }
+    lck.unlock();
+
+    // Convert once, after what was left over from the previous block
+    int ss = sampleSize(type);
+    int size = carrySize + (count * ss);
+    std::shared_ptr<Block> block = getBlock(size);
+    memcpy(block->data, carry.data(), carrySize);
+    convert(data, &block->data[carrySize], count, type);
+
+    // Timing of the first sample in the buffer, going back for the ones carried over
+    int64_t firstTime;
+    uint16_t flags = 0;
+    if (meta.flags & STREAM_META_VALID) {
+        firstTime = meta.utcTime;
+        if (meta.flags & STREAM_META_GPS_TIME) { flags |= IQ_PACKET_FLAG_GPS_TIME; }
+    }
+    else {
+        firstTime = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+        flags |= IQ_PACKET_FLAG_HOST_TIME;
+    }
+    double nsPerSample = 1e9 / sampleRate;
+    firstTime -= (int64_t)((carrySize / ss) * nsPerSample);
+    int samplesPerPacket = pktSize / ss;
+
+    // Queue a reference to every full packet on each subscriber
+    int packets = size / pktSize;
+    lck.lock();
+    for (int i = 0; i < packets; i++) {
+        Packet pkt;
+        pkt.block = block;
+        pkt.data = &block->data[i * pktSize];
+        pkt.size = pktSize;
+        pkt.header.sequence = sequence++;
+        pkt.header.sampleCount = samplesPerPacket;
+        pkt.header.sampleType = type;
+        pkt.header.flags = flags;
+        pkt.header.timestamp = firstTime + (int64_t)((double)(i * samplesPerPacket) * nsPerSample);
+        if (i == 0 && (meta.flags & STREAM_META_DISCONTINUITY)) { pkt.header.flags |= IQ_PACKET_FLAG_DISCONTINUITY; }
+
+        for (auto& sub : subscribers) {
+            if (sub->queuedBytes + pktSize > IQ_FANOUT_MAX_QUEUE) {
+                sub->droppedPackets++;
+                continue;
+            }
+            sub->queue.push_back(pkt);
+            sub->queuedBytes += pktSize;
+        }
+    }
+
+    // Have the reactor send them as soon as the sockets can take it
+    for (auto& sub : subscribers) {
+        if (!sub->queue.empty()) { watchOut(sub.get(), true); }
+    }
+    lck.unlock();
+
+    // Keep the incomplete packet for next time
+    carrySize = size - (packets * pktSize);
+    memcpy(carry.data(), &block->data[packets * pktSize], carrySize);
+}
+
+int IQFanout::sampleSize(SampleType type) {
+    switch (type) {
+    case SAMPLE_TYPE_INT8:
+        return sizeof(int8_t)*2;
+    case SAMPLE_TYPE_INT16:
+        return sizeof(int16_t)*2;
+    case SAMPLE_TYPE_INT32:
+        return sizeof(int32_t)*2;
+    case SAMPLE_TYPE_FLOAT32:
+        return sizeof(dsp::complex_t);
+    default:
+        return -1;
+    }
+}
+
+std::shared_ptr<IQFanout::Block> IQFanout::getBlock(int size) {
+    // Reuse a block no subscriber holds anymore
+    for (auto& block : pool) {
+        if (block.use_count() > 1) { continue; }
+        if (block->capacity < size) { block = std::make_shared<Block>(size); }
+        return block;
+    }
+    pool.push_back(std::make_shared<Block>(size));
+    return pool.back();
+}
+
+void IQFanout::convert(const dsp::complex_t* in, uint8_t* out, int count, SampleType type) {
+    switch (type) {
+    case SAMPLE_TYPE_INT8:
+        volk_32f_s32f_convert_8i((int8_t*)out, (float*)in, 128.0f, count*2);
+        break;
+    case SAMPLE_TYPE_INT16:
+        volk_32f_s32f_convert_16i((int16_t*)out, (float*)in, 32768.0f, count*2);
+        break;
+    case SAMPLE_TYPE_INT32:
+        volk_32f_s32f_convert_32i((int32_t*)out, (float*)in, 2147483647.0f, count*2);
+        break;
+    case SAMPLE_TYPE_FLOAT32:
+        memcpy(out, in, count*sizeof(dsp::complex_t));
+        break;
+    }
+}
+
+void IQFanout::eventHandler(int fd, uint32_t events, void* ctx) {
+    Subscriber* sub = (Subscriber*)ctx;
+    IQFanout* _this = sub->owner;
+    bool alive = !(events & (EPOLLERR | EPOLLHUP));
+
+    // Anything received from a TCP subscriber is ignored, a read of 0 means it disconnected
+    if (alive && (events & EPOLLIN)) {
+        uint8_t dummy[1024];
+        alive = (sub->sock->recv(dummy, sizeof(dummy), false, net::NONBLOCKING) != 0) && sub->sock->isOpen();
+    }
+    if (alive && (events & EPOLLOUT)) {
+        alive = _this->flush(sub);
+    }
+    if (alive) { return; }
+
+    // Remove dead subscriber, unless stop() already took it over
+    std::shared_ptr<Subscriber> dead;
+    {
+        std::lock_guard<std::mutex> lck(_this->mtx);
+        auto it = std::find_if(_this->subscribers.begin(), _this->subscribers.end(), [=](auto& s) { return s.get() == sub; });
+        if (it == _this->subscribers.end()) { return; }
+        dead = *it;
+        _this->subscribers.erase(it);
+    }
+    flog::info("[IQExporter] Subscriber disconnected: {}", dead->name);
+    net::Reactor::get()->remove(fd);
+    dead->sock->close();
+}
+
+void IQFanout::watchOut(Subscriber* sub, bool enabled) {
+    // Called with the lock held
+    if (sub->watchingOut == enabled) { return; }
+    sub->watchingOut = enabled;
+    uint32_t events = sub->udp ? 0u : (uint32_t)EPOLLIN;
+    if (enabled) { events |= EPOLLOUT; }
+    net::Reactor::get()->modify(sub->sock->handle(), events);
+}
+
+bool IQFanout::flush(Subscriber* sub) {
+    return sub->udp ? flushUDP(sub) : flushTCP(sub);
+}
+
+bool IQFanout::flushTCP(Subscriber* sub) {
+    // Gather queued packets, skipping what was already sent of the first one. Only the reactor thread
+    // removes packets from the queue so they stay valid once the lock is released.
+    iovec iov[IQ_FANOUT_BATCH * 2];
+    int n = 0;
+    {
+        std::lock_guard<std::mutex> lck(mtx);
+        int skip = sub->sent;
+        for (int i = 0; i < (int)sub->queue.size() && i < IQ_FANOUT_BATCH; i++) {
+            Packet& pkt = sub->queue[i];
+            if (header) {
+                if (skip < (int)sizeof(IQPacketHeader)) {
+                    iov[n++] = { ((uint8_t*)&pkt.header) + skip, sizeof(IQPacketHeader) - skip };
+                    skip = 0;
+                }
+                else {
+                    skip -= sizeof(IQPacketHeader);
+                }
+            }
+            iov[n++] = { pkt.data + skip, (size_t)(pkt.size - skip) };
+            skip = 0;
+        }
+    }
+
+    int sent = sub->sock->sendv(iov, n);
+    if (sent < 0) { return sub->sock->isOpen(); }
+
+    // Pop whatever went through completely and remember how far into the next one we got
+    std::lock_guard<std::mutex> lck(mtx);
+    int pktBytes = header ? sizeof(IQPacketHeader) : 0;
+    sent += sub->sent;
+    while (sent > 0) {
+        Packet& pkt = sub->queue.front();
+        int total = pktBytes + pkt.size;
+        if (sent < total) { break; }
+        sent -= total;
+        sub->queuedBytes -= pkt.size;
+        sub->sentPackets++;
+        sub->queue.pop_front();
+    }
+    sub->sent = sent;
+    if (sub->queue.empty()) { watchOut(sub, false); }
+    return true;
+}
+
+bool IQFanout::flushUDP(Subscriber* sub) {
+    // One datagram per packet, header and samples gathered from their own buffers
+    mmsghdr msgs[IQ_FANOUT_BATCH];
+    iovec iov[IQ_FANOUT_BATCH][2];
+    int n = 0;
+    {
+        std::lock_guard<std::mutex> lck(mtx);
+        for (; n < (int)sub->queue.size() && n < IQ_FANOUT_BATCH; n++) {
+            Packet& pkt = sub->queue[n];
+            int iovCount = 0;
+            if (header) { iov[n][iovCount++] = { &pkt.header, sizeof(IQPacketHeader) }; }
+            iov[n][iovCount++] = { pkt.data, (size_t)pkt.size };
+            msgs[n] = {};
+            msgs[n].msg_hdr.msg_iov = iov[n];
+            msgs[n].msg_hdr.msg_iovlen = iovCount;
+        }
+    }
+
+    int sent = sub->sock->sendmany(msgs, n);
+    if (sent < 0) { return sub->sock->isOpen(); }
+
+    std::lock_guard<std::mutex> lck(mtx);
+    for (int i = 0; i < sent; i++) {
+        sub->queuedBytes -= sub->queue.front().size;
+        sub->sentPackets++;
+        sub->queue.pop_front();
+    }
+    if (sub->queue.empty()) { watchOut(sub, false); }
+    return true;
+}
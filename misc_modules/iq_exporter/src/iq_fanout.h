@@ -0,0 +1,117 @@
+#pragma once
+#include <utils/net.h>
+#include <dsp/types.h>
+#include <dsp/stream.h>
+#include <mutex>
+#include <deque>
+#include <vector>
+#include <string>
+#include <memory>
+
+// Header flags
+#define IQ_PACKET_FLAG_GPS_TIME         (1 << 0)    // Timestamp is disciplined by the GPS
+#define IQ_PACKET_FLAG_HOST_TIME        (1 << 1)    // Source has no timing, stamped with the host clock on arrival
+#define IQ_PACKET_FLAG_DISCONTINUITY    (1 << 2)    // Samples were lost by the source right before this packet
+
+enum SampleType {
+    SAMPLE_TYPE_INT8,
+    SAMPLE_TYPE_INT16,
+    SAMPLE_TYPE_INT32,
+    SAMPLE_TYPE_FLOAT32
+};
+
+#pragma pack(push, 1)
+// Optional header in front of every packet, all fields little endian
+struct IQPacketHeader {
+    uint32_t sequence;      // Incremented by one for every packet, gaps mean packets were lost
+    uint32_t sampleCount;   // Number of IQ samples following the header
+    uint16_t sampleType;    // SampleType of the samples
+    uint16_t flags;         // IQ_PACKET_FLAG_*
+    uint64_t timestamp;     // Time of the first sample, in nanoseconds since the Unix epoch
+};
+#pragma pack(pop)
+
+struct IQSubscriberStats {
+    std::string name;
+    size_t queuedBytes;
+    uint64_t sentPackets;
+    uint64_t droppedPackets;
+};
+
+// Sends the same IQ stream to any number of TCP and UDP subscribers. Each block is converted once into
+// a shared buffer and cut into packets that all subscriber queues point to. The network reactor drains the
+// queues with batched, non-blocking writes, so a slow subscriber only loses its own packets.
+class IQFanout {
+public:
+    IQFanout();
+    ~IQFanout();
+
+    void start();
+    void stop();
+
+    // Sample type, packet size (without header) and header can only be changed while stopped
+    void setSampleType(SampleType type);
+    void setPacketSize(int size);
+    void setHeaderEnabled(bool enabled);
+
+    void addSubscriber(std::shared_ptr<net::Socket> sock, const std::string& name);
+    int getSubscriberCount();
+    std::vector<IQSubscriberStats> getStats();
+
+    // Called from the DSP thread for every block
+    void write(const dsp::complex_t* data, int count, const dsp::stream_meta& meta, double sampleRate);
+
+    static int sampleSize(SampleType type);
+
+private:
+    struct Block {
+        Block(int capacity);
+        ~Block();
+        uint8_t* data;
+        int capacity;
+    };
+
+    struct Packet {
+        std::shared_ptr<Block> block;
+        uint8_t* data;
+        int size;
+        IQPacketHeader header;
+    };
+
+    struct Subscriber {
+        IQFanout* owner;
+        std::shared_ptr<net::Socket> sock;
+        std::string name;
+        bool udp;
+        std::deque<Packet> queue;
+        size_t queuedBytes = 0;
+        int sent = 0;
+        uint64_t sentPackets = 0;
+        uint64_t droppedPackets = 0;
+        bool watchingOut = false;
+    };
+
+    std::shared_ptr<Block> getBlock(int size);
+    void convert(const dsp::complex_t* in, uint8_t* out, int count, SampleType type);
+
+    static void eventHandler(int fd, uint32_t events, void* ctx);
+    void watchOut(Subscriber* sub, bool enabled);
+    bool flush(Subscriber* sub);
+    bool flushTCP(Subscriber* sub);
+    bool flushUDP(Subscriber* sub);
+
+    std::mutex mtx;
+    std::vector<std::shared_ptr<Subscriber>> subscribers;
+    SampleType sampType = SAMPLE_TYPE_INT16;
+    int packetSize = 1024;
+    bool header = false;
+    uint32_t sequence = 0;
+    bool resetCarry = true;
+
+    // Only touched by the DSP thread
+    std::vector<std::shared_ptr<Block>> pool;
+    std::vector<uint8_t> carry;
+    int carrySize = 0;
+
+    bool running = false;
+};
@@ -8,9 +8,9 @@
 #include <dsp/sink/handler_sink.h>
 #include <volk/volk.h>
 #include <signal_path/signal_path.h>
-#include <dsp/buffer/reshaper.h>
 #include <gui/dialogs/dialog_box.h>
 #include <core.h>
+#include "iq_fanout.h"
 
 SDRPP_MOD_INFO{
     /* Name:            */ "iq_exporter",
@@ -34,13 +34,6 @@ enum Protocol {
     PROTOCOL_UDP
 };
 
-enum SampleType {
-    SAMPLE_TYPE_INT8,
-    SAMPLE_TYPE_INT16,
-    SAMPLE_TYPE_INT32,
-    SAMPLE_TYPE_FLOAT32
-};
-
 class IQExporterModule : public ModuleManager::Instance {
 public:
     IQExporterModule(std::string name) {
@@ -106,6 +99,9 @@ public:
             int size = config.conf[name]["packetSize"];
             if (packetSizes.keyExists(size)) { packetSize = packetSizes.value(packetSizes.keyId(size)); }
         }
+        if (config.conf[name].contains("header")) {
+            header = config.conf[name]["header"];
+        }
         if (config.conf[name].contains("host")) {
             std::string hostStr = config.conf[name]["host"];
             strcpy(hostname, hostStr.c_str());
@@ -126,12 +122,8 @@ public:
         sampTypeId = sampleTypes.valueId(sampType);
         packetSizeId = packetSizes.valueId(packetSize);
 
-        // Allocate buffer
-        buffer = dsp::buffer::alloc<uint8_t>(STREAM_BUFFER_SIZE * sizeof(dsp::complex_t));
-
         // Init DSP
-        reshape.init(&iqStream, packetSize/sampleSize(), 0);
-        handler.init(&reshape.out, dataHandler, this);
+        handler.init(&iqStream, dataHandler, this);
 
         // Set operating mode
         setMode(nMode);
@@ -152,9 +144,6 @@ public:
 
         // Stop DSP
         setMode(MODE_NONE);
-
-        // Free buffer
-        dsp::buffer::free(buffer);
     }
 
     void postInit() {}
@@ -191,10 +180,13 @@ public:
     void start() {
         if (running) { return; }
 
-        // Acquire lock on the socket
-        std::lock_guard lck1(sockMtx);
+        // Apply stream settings and start sending
+        fanout.setSampleType(sampType);
+        fanout.setPacketSize(packetSize);
+        fanout.setHeaderEnabled(header);
+        fanout.start();
 
-        // Start listening or open UDP socket
+        // Start listening, connect or open the UDP sockets
         try {
             if (proto == PROTOCOL_TCP_SERVER) {
                 // Create listener
@@ -205,17 +197,42 @@ public:
             }
             else if (proto == PROTOCOL_TCP_CLIENT) {
                 // Connect to TCP server
-                sock = net::connect(hostname, port);
+                fanout.addSubscriber(net::connect(hostname, port), std::string(hostname) + ":" + std::to_string(port));
             }
             else {
-                // Open UDP socket
-                sock = net::openudp(hostname, port, "0.0.0.0", 0, true);
+                // Open a UDP socket for every destination, given as a comma separated list of host[:port]
+                std::string hosts = hostname;
+                size_t begin = 0;
+                while (begin < hosts.size()) {
+                    size_t end = hosts.find(',', begin);
+                    if (end == std::string::npos) { end = hosts.size(); }
+                    std::string dest = hosts.substr(begin, end - begin);
+                    begin = end + 1;
+                    dest.erase(0, dest.find_first_not_of(' '));
+                    dest.erase(dest.find_last_not_of(' ') + 1);
+                    if (dest.empty()) { continue; }
+
+                    std::string host = dest;
+                    int destPort = port;
+                    size_t colon = dest.find(':');
+                    if (colon != std::string::npos) {
+                        host = dest.substr(0, colon);
+                        destPort = std::clamp<int>(std::stoi(dest.substr(colon + 1)), 1, 65535);
+                    }
+                    fanout.addSubscriber(net::openudp(host, destPort, "0.0.0.0", 0, true), host + ":" + std::to_string(destPort));
+                }
             }
         }
         catch (const std::exception& e) {
             flog::error("[IQExporter] Could not start socket: {}", e.what());
             errorStr = e.what();
             showError = true;
+            if (listener) {
+                listener->stop();
+                if (listenWorkerThread.joinable()) { listenWorkerThread.join(); }
+                listener.reset();
+            }
+            fanout.stop();
             return;
         }
 
@@ -225,10 +242,7 @@ public:
     void stop() {
         if (!running) { return; }
 
-        // Acquire lock on the socket
-        std::lock_guard lck1(sockMtx);
-
-        // Stop listening or close UDP socket
+        // Stop listening
         if (proto == PROTOCOL_TCP_SERVER) {
             // Stop listener
             if (listener) {
@@ -240,21 +254,11 @@ public:
 
             // Free listener
             listener.reset();
-
-            // Close socket and free it
-            if (sock) {
-                sock->close();
-                sock.reset();
-            }
-        }
-        else {
-            // Close socket and free it
-            if (sock) {
-                sock->close();
-                sock.reset();
-            }
         }
 
+        // Close all subscriber sockets
+        fanout.stop();
+
         running = false;
     }
 
@@ -327,7 +331,6 @@ private:
         ImGui::FillWidth();
         if (ImGui::Combo(("##iq_exporter_samp_" + _this->name).c_str(), &_this->sampTypeId, _this->sampleTypes.txt)) {
             _this->sampType = _this->sampleTypes.value(_this->sampTypeId);
-            _this->reshape.setKeep(_this->packetSize/_this->sampleSize());
             config.acquire();
             config.conf[_this->name]["sampleType"] = _this->sampleTypes.key(_this->sampTypeId);
             config.release(true);
@@ -338,13 +341,19 @@ private:
         ImGui::FillWidth();
         if (ImGui::Combo(("##iq_exporter_pkt_sz_" + _this->name).c_str(), &_this->packetSizeId, _this->packetSizes.txt)) {
             _this->packetSize = _this->packetSizes.value(_this->packetSizeId);
-            _this->reshape.setKeep(_this->packetSize/_this->sampleSize());
             config.acquire();
             config.conf[_this->name]["packetSize"] = _this->packetSizes.key(_this->packetSizeId);
             config.release(true);
         }
 
-        // Hostname and port field
+        // Sequence number and timestamp in front of every packet
+        if (ImGui::Checkbox(("Packet header##iq_exporter_header_" + _this->name).c_str(), &_this->header)) {
+            config.acquire();
+            config.conf[_this->name]["header"] = _this->header;
+            config.release(true);
+        }
+
+        // Hostname and port field, UDP takes a comma separated list of host[:port]
         if (ImGui::InputText(("##iq_exporter_host_" + _this->name).c_str(), _this->hostname, sizeof(_this->hostname))) {
             config.acquire();
             config.conf[_this->name]["host"] = _this->hostname;
@@ -379,18 +388,19 @@ private:
             }
         }
 
-        // Check if the socket is open by attempting a read
-        bool sockOpen;
-        {
-            uint8_t dummy;
-            sockOpen = !(!_this->sock || !_this->sock->isOpen() || (_this->proto != PROTOCOL_UDP && _this->sock->recv(&dummy, 1, false, net::NONBLOCKING) == 0));
-        }
+        // Subscribers are dropped by the fanout as soon as their socket closes
+        std::vector<IQSubscriberStats> stats = _this->fanout.getStats();
 
         // Status text
         ImGui::TextUnformatted("Status:");
         ImGui::SameLine();
-        if (sockOpen) {
-            ImGui::TextColored(ImVec4(0.0, 1.0, 0.0, 1.0), (_this->proto == PROTOCOL_TCP_SERVER || _this->proto == PROTOCOL_TCP_CLIENT) ? "Connected" : "Sending");
+        if (!stats.empty()) {
+            if (_this->proto == PROTOCOL_TCP_SERVER) {
+                ImGui::TextColored(ImVec4(0.0, 1.0, 0.0, 1.0), "%d connected", (int)stats.size());
+            }
+            else {
+                ImGui::TextColored(ImVec4(0.0, 1.0, 0.0, 1.0), (_this->proto == PROTOCOL_TCP_CLIENT) ? "Connected" : "Sending");
+            }
         }
         else if (_this->listener && _this->listener->listening()) {
             ImGui::TextColored(ImVec4(1.0, 1.0, 0.0, 1.0), "Listening");
@@ -405,6 +415,11 @@ private:
             ImGui::TextUnformatted("Idle");
         }
 
+        // Per subscriber queue and loss
+        for (auto& sub : stats) {
+            ImGui::Text("%s: %d KB queued, %llu dropped", sub.name.c_str(), (int)(sub.queuedBytes / 1024), (unsigned long long)sub.droppedPackets);
+        }
+
         if (!_this->enabled) { ImGui::EndDisabled(); }
     }
 
@@ -413,7 +428,6 @@ private:
         if (!forceSet && mode == newMode) { return; }
 
         // Stop the DSP
-        reshape.stop();
         handler.stop();
 
         // Delete VFO or unbind IQ stream
@@ -435,7 +449,7 @@ private:
             vfo = sigpath::vfoManager.createVFO(name, ImGui::WaterfallVFO::REF_CENTER, 0, samplerate, samplerate, samplerate, samplerate, true);
 
             // Set its output as the input to the DSP
-            reshape.setInput(vfo->output);
+            handler.setInput(vfo->output);
         }
         else {
             // Bind IQ stream
@@ -443,11 +457,10 @@ private:
             streamBound = true;
 
             // Set its output as the input to the DSP
-            reshape.setInput(&iqStream);
+            handler.setInput(&iqStream);
         }
 
         // Start DSP
-        reshape.start();
         handler.start();
 
         // Update mode
@@ -458,73 +471,21 @@ private:
     void listenWorker() {
         while (true) {
             // Accept a client
-            auto newSock = listener->accept();
+            net::Address addr;
+            auto newSock = listener->accept(&addr);
             if (!newSock) { break; }
 
-            // Update socket
-            {
-                std::lock_guard lck(sockMtx);
-                sock = newSock;
-            }
-        }
-    }
-
-    int sampleSize() {
-        switch (sampType) {
-        case SAMPLE_TYPE_INT8:
-            return sizeof(int8_t)*2;
-        case SAMPLE_TYPE_INT16:
-            return sizeof(int16_t)*2;
-        case SAMPLE_TYPE_INT32:
-            return sizeof(int32_t)*2;
-        case SAMPLE_TYPE_FLOAT32:
-            return sizeof(dsp::complex_t);
-        default:
-            return -1;
+            // Add it to the subscribers
+            fanout.addSubscriber(newSock, addr.getIPStr() + ":" + std::to_string(addr.getPort()));
         }
     }
 
     static void dataHandler(dsp::complex_t* data, int count, void* ctx) {
         IQExporterModule* _this = (IQExporterModule*)ctx;
 
-        // Try to cquire lock on socket
-        if (!_this->sockMtx.try_lock()) { return; }
-
-        // If not valid or open, give uo
-        if (!_this->sock || !_this->sock->isOpen()) {
-            // Unlock socket mutex
-            _this->sockMtx.unlock();
-            return;
-        }
-        
-        // Convert the samples or send directory for float32
-        int size;
-        switch (_this->sampType) {
-        case SAMPLE_TYPE_INT8:
-            volk_32f_s32f_convert_8i((int8_t*)_this->buffer, (float*)data, 128.0f, count*2);
-            size = sizeof(int8_t)*2;
-            break;
-        case SAMPLE_TYPE_INT16:
-            volk_32f_s32f_convert_16i((int16_t*)_this->buffer, (float*)data, 32768.0f, count*2);
-            size = sizeof(int16_t)*2;
-            break;
-        case SAMPLE_TYPE_INT32:
-            volk_32f_s32f_convert_32i((int32_t*)_this->buffer, (float*)data, 2147483647.0f, count*2);
-            size = sizeof(int32_t)*2;
-            break;
-        case SAMPLE_TYPE_FLOAT32:
-            _this->sock->send((uint8_t*)data, count*sizeof(dsp::complex_t));
-        default:
-            // Unlock socket mutex
-            _this->sockMtx.unlock();
-            return;
-        }
-
-        // Send converted samples
-        _this->sock->send(_this->buffer, count*size);
-
-        // Unlock socket mutex
-        _this->sockMtx.unlock();
+        // Converted once and shared by all subscribers
+        double sampleRate = (_this->mode == MODE_VFO) ? _this->samplerate : sigpath::iqFrontEnd.getEffectiveSamplerate();
+        _this->fanout.write(data, count, _this->handler.getMeta(), sampleRate);
     }
 
     std::string name;
@@ -540,6 +501,7 @@ private:
     int sampTypeId;
     int packetSize = 1024;
     int packetSizeId;
+    bool header = false;
     char hostname[1024] = "localhost";
     int port = 1234;
     bool running = false;
@@ -557,14 +519,10 @@ private:
     VFOManager::VFO* vfo = NULL;
     bool streamBound = false;
     dsp::stream<dsp::complex_t> iqStream;
-    dsp::buffer::Reshaper<dsp::complex_t> reshape;
     dsp::sink::Handler<dsp::complex_t> handler;
-    uint8_t* buffer = NULL;
+    IQFanout fanout;
 
     std::thread listenWorkerThread;
-
-    std::mutex sockMtx;
-    std::shared_ptr<net::Socket> sock;
     std::shared_ptr<net::Listener> listener;
 };
 
@@ -9,6 +9,7 @@
 #include <dsp/convert/stereo_to_mono.h>
 #include <thread>
 #include <ctime>
+#include <fstream>
 #include <gui/gui.h>
 #include <filesystem>
 #include <signal_path/signal_path.h>
@@ -171,12 +172,24 @@ public:
         std::string type = (recMode == RECORDER_MODE_AUDIO) ? "audio" : "baseband";
         std::string vfoName = (recMode == RECORDER_MODE_AUDIO) ? selectedStreamName : "";
         std::string extension = ".wav";
-        std::string expandedPath = expandString(folderSelect.path + "/" + genFileName(nameTemplate, type, vfoName) + extension);
+        std::string basePath = expandString(folderSelect.path + "/" + genFileName(nameTemplate, type, vfoName));
+        std::string expandedPath = basePath + extension;
         if (!writer.open(expandedPath)) {
             flog::error("Failed to open file for recording: {0}", expandedPath);
             return;
         }
 
+        // Open the timing index written next to the recording
+        indexFile.open(basePath + ".idx");
+        if (indexFile.is_open()) {
+            indexFile << "# file_sample,source_sample_index,source_samplerate,utc_ns,flags\n";
+        }
+        else {
+            flog::warn("Failed to open timing index for recording: {0}.idx", basePath);
+        }
+        lastIndexSample = 0;
+        indexResync = true;
+
         // Open audio stream or baseband
         if (recMode == RECORDER_MODE_AUDIO) {
             // Start correct path depending on 
@@ -221,6 +234,7 @@ public:
 
         // Close file
         writer.close();
+        if (indexFile.is_open()) { indexFile.close(); }
         
         recording = false;
     }
@@ -502,8 +516,20 @@ private:
         return std::regex_replace(input, std::regex("//"), "/");
     }
 
+    // Record the timing of the next block written to the file. Entries are only written at the start,
+    // after a gap in the recording or lost samples, and otherwise once per second.
+    void writeIndex(const dsp::stream_meta& meta) {
+        if (!indexFile.is_open() || !(meta.flags & STREAM_META_VALID)) { return; }
+        uint64_t fileSample = writer.getSamplesWritten();
+        if (!indexResync && !(meta.flags & STREAM_META_DISCONTINUITY) && fileSample - lastIndexSample < samplerate) { return; }
+        indexFile << fileSample << ',' << meta.sampleIndex << ',' << (uint64_t)meta.sampleRate << ',' << meta.utcTime << ',' << meta.flags << '\n';
+        lastIndexSample = fileSample;
+        indexResync = false;
+    }
+
     static void complexHandler(dsp::complex_t* data, int count, void* ctx) {
         RecorderModule* _this = (RecorderModule*)ctx;
+        _this->writeIndex(_this->basebandSink.getMeta());
         _this->writer.write((float*)data, count);
     }
 
@@ -518,8 +544,12 @@ private:
                 if (val > absMax) { absMax = val; }
             }
             _this->ignoringSilence = (absMax < SILENCE_LVL);
-            if (_this->ignoringSilence) { return; }
+            if (_this->ignoringSilence) {
+                _this->indexResync = true;
+                return;
+            }
         }
+        _this->writeIndex(_this->stereoSink.getMeta());
         _this->writer.write((float*)data, count);
     }
 
@@ -532,8 +562,12 @@ private:
                 if (val > absMax) { absMax = val; }
             }
             _this->ignoringSilence = (absMax < SILENCE_LVL);
-            if (_this->ignoringSilence) { return; }
+            if (_this->ignoringSilence) {
+                _this->indexResync = true;
+                return;
+            }
         }
+        _this->writeIndex(_this->monoSink.getMeta());
         _this->writer.write(data, count);
     }
 
@@ -578,6 +612,9 @@ private:
     bool recording = false;
     bool ignoringSilence = false;
     wav::Writer writer;
+    std::ofstream indexFile;
+    uint64_t lastIndexSample = 0;
+    bool indexResync = false;
     std::recursive_mutex recMtx;
     dsp::stream<dsp::complex_t>* basebandStream;
     dsp::stream<dsp::stereo_t> stereoStream;
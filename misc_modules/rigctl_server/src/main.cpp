@@ -1,4 +1,5 @@
 #include <utils/networking.h>
+#include <utils/seqlock.h>
 #include <imgui.h>
 #include <module.h>
 #include <gui/gui.h>
@@ -10,10 +11,21 @@
 #include <config.h>
 #include <cctype>
 #include <radio_interface.h>
+#include <gui/tuner.h>
+#include <thread>
+#include <condition_variable>
+#include <chrono>
+#include <cmath>
 #define CONCAT(a, b) ((std::string(a) + b).c_str())
 
 #define MAX_COMMAND_LENGTH 8192
 
+// Unread response bytes after which a client gets disconnected
+#define MAX_QUEUED_RESPONSES    (64 * 1024)
+
+// Period at which the cached rig state is refreshed
+#define STATE_REFRESH_INTERVAL  std::chrono::milliseconds(50)
+
 SDRPP_MOD_INFO{
     /* Name:            */ "rigctl_server",
     /* Description:     */ "My fancy new module",
@@ -29,6 +41,15 @@ enum {
 
 ConfigManager config;
 
+// Rig state answered to read-only queries without going through the GUI
+struct RigState {
+    double freq;
+    int mode;           // RADIO_IFACE_MODE_*, -1 if the VFO isn't a radio
+    int bandwidth;
+    float strength;     // dBFS, NAN if there's no FFT
+    float squelchLevel;
+};
+
 class SigctlServerModule : public ModuleManager::Instance {
 public:
     SigctlServerModule(std::string name) {
@@ -63,8 +84,7 @@ public:
         sigpath::vfoManager.onVfoDeleted.unbindHandler(&vfoDeletedHandler);
         core::moduleManager.onInstanceCreated.unbindHandler(&modChangedHandler);
         core::moduleManager.onInstanceDeleted.unbindHandler(&modChangedHandler);
-        if (client) { client->close(); }
-        if (listener) { listener->close(); }
+        stopServer();
     }
 
     void postInit() {
@@ -184,8 +204,9 @@ private:
 
         ImGui::TextUnformatted("Status:");
         ImGui::SameLine();
-        if (_this->client && _this->client->isOpen()) {
-            ImGui::TextColored(ImVec4(0.0, 1.0, 0.0, 1.0), "Connected");
+        int clientCount = _this->reapClients();
+        if (clientCount) {
+            ImGui::TextColored(ImVec4(0.0, 1.0, 0.0, 1.0), "%d connected", clientCount);
         }
         else if (listening) {
             ImGui::TextColored(ImVec4(1.0, 1.0, 0.0, 1.0), "Listening");
@@ -196,18 +217,165 @@ private:
     }
 
     void startServer() {
+        // Clean up after a listener that died on its own
+        if (workerThread.joinable()) { stopServer(); }
+
+        refreshState();
         try {
             listener = net::listen(hostname, port);
             listener->acceptAsync(clientHandler, this);
         }
         catch (const std::exception& e) {
             flog::error("Could not start rigctl server: {}", e.what());
+            return;
         }
+
+        // Start the worker doing the retunes and refreshing the cached state
+        workerRunning = true;
+        workerThread = std::thread(&SigctlServerModule::worker, this);
     }
 
     void stopServer() {
-        if (client) { client->close(); }
-        listener->close();
+        if (listener) { listener->close(); }
+
+        // Disconnect all clients
+        std::vector<std::unique_ptr<Client>> old;
+        {
+            std::lock_guard lck(clientsMtx);
+            old.swap(clients);
+        }
+        for (auto& client : old) { client->conn->close(); }
+
+        // Stop the worker
+        {
+            std::lock_guard lck(workerMtx);
+            workerRunning = false;
+        }
+        workerCnd.notify_all();
+        if (workerThread.joinable()) { workerThread.join(); }
+    }
+
+    int reapClients() {
+        std::vector<std::unique_ptr<Client>> dead;
+        int count;
+        {
+            std::lock_guard lck(clientsMtx);
+            for (auto it = clients.begin(); it != clients.end();) {
+                if ((*it)->conn->isOpen()) {
+                    it++;
+                    continue;
+                }
+                dead.push_back(std::move(*it));
+                it = clients.erase(it);
+            }
+            count = clients.size();
+        }
+
+        // Closing waits for the network thread to be done with them
+        for (auto& client : dead) { client->conn->close(); }
+        return count;
+    }
+
+    void worker() {
+        std::unique_lock lck(workerMtx);
+        while (workerRunning) {
+            // Only retune to the last frequency of a burst, whichever client it came from
+            if (tunePending) {
+                double freq = pendingFreq;
+                tunePending = false;
+                lck.unlock();
+                std::string vfo;
+                {
+                    std::lock_guard vlck(vfoMtx);
+                    vfo = selectedVfo;
+                }
+                tuner::tune(tuner::TUNER_MODE_NORMAL, vfo, freq);
+                lck.lock();
+                continue;
+            }
+
+            // Nobody to report to, don't poll the GUI until a client connects
+            refreshPending = false;
+            lck.unlock();
+            bool idle;
+            {
+                std::lock_guard clck(clientsMtx);
+                idle = clients.empty();
+            }
+            if (!idle) { refreshState(); }
+            lck.lock();
+            auto wake = [this]() { return tunePending || refreshPending || !workerRunning; };
+            if (idle) {
+                workerCnd.wait(lck, wake);
+            }
+            else {
+                workerCnd.wait_for(lck, STATE_REFRESH_INTERVAL, wake);
+            }
+        }
+    }
+
+    void requestTune(double freq) {
+        {
+            std::lock_guard lck(workerMtx);
+            pendingFreq = freq;
+            tunePending = true;
+
+            // Reads get the new frequency right away
+            state.update([=](RigState& s) { s.freq = freq; });
+        }
+        workerCnd.notify_all();
+    }
+
+    void refreshState() {
+        std::string vfo;
+        {
+            std::lock_guard lck(vfoMtx);
+            vfo = selectedVfo;
+        }
+
+        // Frequency of the VFO, or of the SDR if there's none
+        double freq = gui::waterfall.getCenterFrequency();
+        bool vfoExists = !vfo.empty() && sigpath::vfoManager.vfoExists(vfo);
+        if (vfoExists) { freq += sigpath::vfoManager.getOffset(vfo); }
+        int bandwidth = vfoExists ? (int)sigpath::vfoManager.getBandwidth(vfo) : 0;
+
+        // Mode and squelch of the radio
+        int mode = -1;
+        float squelchLevel = 0.0f;
+        if (!vfo.empty() && core::modComManager.getModuleName(vfo) == "radio") {
+            core::modComManager.callInterface(vfo, RADIO_IFACE_CMD_GET_MODE, NULL, &mode);
+            core::modComManager.callInterface(vfo, RADIO_IFACE_CMD_GET_SQUELCH_LEVEL, NULL, &squelchLevel);
+        }
+
+        // Strongest FFT bin within the VFO, unknown if the passband is out of view
+        float strength = NAN;
+        int dataWidth = 0;
+        float* data = gui::waterfall.acquireLatestFFT(dataWidth);
+        if (data) {
+            double wfWidth = gui::waterfall.getViewBandwidth();
+            double wfStart = gui::waterfall.getViewOffset() + gui::waterfall.getCenterFrequency() - (wfWidth / 2.0);
+            double low = (freq - (bandwidth / 2.0) - wfStart) * (double)dataWidth / wfWidth;
+            double high = (freq + (bandwidth / 2.0) - wfStart) * (double)dataWidth / wfWidth;
+            if (high >= 0.0 && low < (double)dataWidth) {
+                int lowId = std::clamp<int>(low, 0, dataWidth - 1);
+                int highId = std::clamp<int>(high, 0, dataWidth - 1);
+                strength = data[lowId];
+                for (int i = lowId + 1; i <= highId; i++) {
+                    if (data[i] > strength) { strength = data[i]; }
+                }
+            }
+            gui::waterfall.releaseLatestFFT();
+        }
+
+        std::lock_guard lck(workerMtx);
+        state.update([&](RigState& s) {
+            // Keep the requested frequency until it's been applied
+            if (!tunePending) { s.freq = freq; }
+            s.mode = mode;
+            s.bandwidth = bandwidth;
+            s.strength = strength;
+            s.squelchLevel = squelchLevel;
+        });
     }
 
     void refreshModules() {
@@ -304,33 +472,61 @@ private:
         _this->selectRecorderByName(_this->selectedRecorder);
     }
 
-    static void clientHandler(net::Conn _client, void* ctx) {
+    static void clientHandler(net::Conn conn, void* ctx) {
         SigctlServerModule* _this = (SigctlServerModule*)ctx;
         //flog::info("New client!");
 
-        _this->client = std::move(_client);
-        _this->client->readAsync(1024, _this->dataBuf, dataHandler, _this, false);
-        _this->client->waitForEnd();
-        _this->client->close();
+        // Drop the clients that left
+        _this->reapClients();
 
-        //flog::info("Client disconnected!");
+        auto client = std::make_unique<Client>();
+        client->owner = _this;
+        client->conn = std::move(conn);
+        Client* c = client.get();
+        {
+            std::lock_guard lck(_this->clientsMtx);
+            _this->clients.push_back(std::move(client));
+        }
+        c->conn->readAsync(sizeof(c->buf), c->buf, dataHandler, c, false);
+
+        // Get the worker polling the state again
+        {
+            std::lock_guard lck(_this->workerMtx);
+            _this->refreshPending = true;
+        }
+        _this->workerCnd.notify_all();
 
+        // Clients are served concurrently, accept the next one right away
         _this->listener->acceptAsync(clientHandler, _this);
     }
 
     static void dataHandler(int count, uint8_t* data, void* ctx) {
-        SigctlServerModule* _this = (SigctlServerModule*)ctx;
+        Client* client = (Client*)ctx;
+        SigctlServerModule* _this = client->owner;
 
+        // Run every complete command of the chunk, clients like gpredict send them in bursts
+        std::string resp;
         for (int i = 0; i < count; i++) {
             if (data[i] == '\n') {
-                _this->commandHandler(_this->command);
-                _this->command.clear();
+                _this->commandHandler(client->command, resp);
+                client->command.clear();
                 continue;
             }
-            if (_this->command.size() < MAX_COMMAND_LENGTH) { _this->command += (char)data[i]; }
+            if (data[i] == '\r') { continue; }
+            if (client->command.size() < MAX_COMMAND_LENGTH) { client->command += (char)data[i]; }
+        }
+
+        // Answer the whole batch at once
+        if (!resp.empty()) { client->conn->writeAsync(resp.size(), (uint8_t*)resp.c_str()); }
+
+        // Drop clients that don't read their responses
+        if (client->conn->getQueuedBytes() > MAX_QUEUED_RESPONSES) {
+            flog::warn("Rigctl client isn't reading its responses, disconnecting it");
+            client->conn->close();
+            return;
         }
 
-        _this->client->readAsync(1024, _this->dataBuf, dataHandler, _this, false);
+        client->conn->readAsync(sizeof(client->buf), client->buf, dataHandler, client, false);
     }
 
     std::map<int, const char*> radioModeToString = {
@@ -344,7 +540,8 @@ private:
         { RADIO_IFACE_MODE_RAW, "RAW" }
     };
 
-    void commandHandler(std::string cmd) {
+    // Responses are appended to out, the caller sends them
+    void commandHandler(std::string cmd, std::string& out) {
         std::string corr = "";
         std::vector<std::string> parts;
         bool lastWasSpace = false;
@@ -377,52 +574,46 @@ private:
             std::string arguments;
             if (parts.size() > 1) { arguments = cmd.substr(parts[0].size()); }
             for (char c : parts[0]) {
-                commandHandler(c + arguments);
+                commandHandler(c + arguments, out);
             }
             return;
         }
 
-        flog::info("Rigctl command: '{0}'", cmd);
+        flog::debug("Rigctl command: '{0}'", cmd);
 
         // Otherwise, execute the command
         if (parts[0] == "F" || parts[0] == "\\set_freq") {
-            std::lock_guard lck(vfoMtx);
-
             // if number of arguments isn't correct, return error
             if (parts.size() != 2) {
                 resp = "RPRT 1\n";
-                client->write(resp.size(), (uint8_t*)resp.c_str());
+                out += resp;
                 return;
             }
 
             // If not controlling the VFO, return
             if (!tuningEnabled) {
                 resp = "RPRT 0\n";
-                client->write(resp.size(), (uint8_t*)resp.c_str());
+                out += resp;
                 return;
             }
 
-            // Parse frequency and assign it to the VFO
-            long long freq = std::stoll(parts[1]);
-            tuner::tune(tuner::TUNER_MODE_NORMAL, selectedVfo, freq);
+            // Parse frequency and leave the retune to the worker so that a burst only retunes once
+            char* end;
+            double freq = std::strtod(parts[1].c_str(), &end);
+            if (end == parts[1].c_str()) {
+                resp = "RPRT 1\n";
+                out += resp;
+                return;
+            }
+            requestTune(freq);
             resp = "RPRT 0\n";
-            client->write(resp.size(), (uint8_t*)resp.c_str());
+            out += resp;
         }
         else if (parts[0] == "f" || parts[0] == "\\get_freq") {
-            std::lock_guard lck(vfoMtx);
-
-            // Get center frequency of the SDR
-            double freq = gui::waterfall.getCenterFrequency();
-
-            // Add the offset of the VFO if it exists
-            if (sigpath::vfoManager.vfoExists(selectedVfo)) {
-                freq += sigpath::vfoManager.getOffset(selectedVfo);
-            }
-
-            // Respond with the frequency
+            // Respond with the cached frequency
             char buf[128];
-            sprintf(buf, "%" PRIu64 "\n", (uint64_t)freq);
-            client->write(strlen(buf), (uint8_t*)buf);
+            sprintf(buf, "%" PRIu64 "\n", (uint64_t)state.load().freq);
+            out += buf;
         }
         else if (parts[0] == "M" || parts[0] == "\\set_mode") {
             std::lock_guard lck(vfoMtx);
@@ -431,14 +622,14 @@ private:
             // If client is querying, respond accordingly
             if (parts.size() >= 2 && parts[1] == "?") {
                 resp = "FM WFM AM DSB USB CW LSB RAW\n";
-                client->write(resp.size(), (uint8_t*)resp.c_str());
+                out += resp;
                 return;
             }
 
             // if number of arguments isn't correct, return error
             if (parts.size() != 3) {
                 resp = "RPRT 1\n";
-                client->write(resp.size(), (uint8_t*)resp.c_str());
+                out += resp;
                 return;
             }
 
@@ -447,7 +638,7 @@ private:
             for (char c : parts[2]) {
                 if (!std::isdigit(c) && !(c == '-' && !pos)) {
                     resp = "RPRT 1\n";
-                    client->write(resp.size(), (uint8_t*)resp.c_str());
+                    out += resp;
                     return;
                 }
                 pos++;
@@ -461,7 +652,7 @@ private:
             });
             if (it == radioModeToString.end()) {
                 resp = "RPRT 1\n";
-                client->write(resp.size(), (uint8_t*)resp.c_str());
+                out += resp;
                 return;
             }
             int newMode = it->first;
@@ -472,27 +663,48 @@ private:
                 if (newBandwidth > 0) {
                     core::modComManager.callInterface(selectedVfo, RADIO_IFACE_CMD_SET_BANDWIDTH, &newBandwidth, NULL);
                 }
+                state.update([&](RigState& s) {
+                    s.mode = newMode;
+                    if (newBandwidth > 0) { s.bandwidth = newBandwidth; }
+                });
             }
 
-            client->write(resp.size(), (uint8_t*)resp.c_str());
+            out += resp;
         }
         else if (parts[0] == "m" || parts[0] == "\\get_mode") {
-            std::lock_guard lck(vfoMtx);
-            resp = "RAW\n";
+            // Respond with the cached mode and passband
+            RigState st = state.load();
+            auto it = radioModeToString.find(st.mode);
+            resp = std::string((it != radioModeToString.end()) ? it->second : "RAW") + "\n";
+            resp += std::to_string(st.bandwidth) + "\n";
+            out += resp;
+        }
+        else if (parts[0] == "l" || parts[0] == "\\get_level") {
+            // if number of arguments isn't correct, return error
+            if (parts.size() != 2) {
+                resp = "RPRT 1\n";
+                out += resp;
+                return;
+            }
 
-            if (!selectedVfo.empty() && core::modComManager.getModuleName(selectedVfo) == "radio") {
-                int mode;
-                core::modComManager.callInterface(selectedVfo, RADIO_IFACE_CMD_GET_MODE, NULL, &mode);
-                resp = std::string(radioModeToString[mode]) + "\n";
+            // Respond with the cached level, in dB like gqrx does
+            RigState st = state.load();
+            char buf[128];
+            if (parts[1] == "?") {
+                resp = "SQL STRENGTH\n";
             }
-            else if (!selectedVfo.empty()) {
-                resp += std::to_string((int)sigpath::vfoManager.getBandwidth(selectedVfo)) + "\n";
+            else if (parts[1] == "STRENGTH" && !std::isnan(st.strength)) {
+                sprintf(buf, "%.1f\n", st.strength);
+                resp = buf;
+            }
+            else if (parts[1] == "SQL") {
+                sprintf(buf, "%.1f\n", st.squelchLevel);
+                resp = buf;
             }
             else {
-                resp += "0\n";
+                resp = "RPRT 1\n";
             }
-
-            client->write(resp.size(), (uint8_t*)resp.c_str());
+            out += resp;
         }
         else if (parts[0] == "V" || parts[0] == "\\set_vfo") {
             std::lock_guard lck(vfoMtx);
@@ -501,7 +713,7 @@ private:
             // if number of arguments isn't correct or the VFO is not "VFO", return error
             if (parts.size() != 2) {
                 resp = "RPRT 1\n";
-                client->write(resp.size(), (uint8_t*)resp.c_str());
+                out += resp;
                 return;
             }
 
@@ -512,27 +724,27 @@ private:
                 resp = "RPRT 1\n";
             }
 
-            client->write(resp.size(), (uint8_t*)resp.c_str());
+            out += resp;
         }
         else if (parts[0] == "v" || parts[0] == "\\get_vfo") {
             std::lock_guard lck(vfoMtx);
             resp = "VFO\n";
-            client->write(resp.size(), (uint8_t*)resp.c_str());
+            out += resp;
         }
         else if (parts[0] == "\\chk_vfo") {
             std::lock_guard lck(vfoMtx);
             resp = "CHKVFO 0\n";
-            client->write(resp.size(), (uint8_t*)resp.c_str());
+            out += resp;
         }
         else if (parts[0] == "s") {
             std::lock_guard lck(vfoMtx);
             resp = "0\nVFOA\n";
-            client->write(resp.size(), (uint8_t*)resp.c_str());
+            out += resp;
         }
         else if (parts[0] == "S") {
             std::lock_guard lck(vfoMtx);
             resp = "RPRT 0\n";
-            client->write(resp.size(), (uint8_t*)resp.c_str());
+            out += resp;
         }
         else if (parts[0] == "AOS" || parts[0] == "\\recorder_start") {
             std::lock_guard lck(recorderMtx);
@@ -540,7 +752,7 @@ private:
             // If not controlling the recorder, return
             if (!recordingEnabled) {
                 resp = "RPRT 0\n";
-                client->write(resp.size(), (uint8_t*)resp.c_str());
+                out += resp;
                 return;
             }
 
@@ -554,7 +766,7 @@ private:
 
             // Respond with a success
             resp = "RPRT 0\n";
-            client->write(resp.size(), (uint8_t*)resp.c_str());
+            out += resp;
         }
         else if (parts[0] == "LOS" || parts[0] == "\\recorder_stop") {
             std::lock_guard lck(recorderMtx);
@@ -562,7 +774,7 @@ private:
             // If not controlling the recorder, return
             if (!recordingEnabled) {
                 resp = "RPRT 0\n";
-                client->write(resp.size(), (uint8_t*)resp.c_str());
+                out += resp;
                 return;
             }
 
@@ -576,7 +788,7 @@ private:
 
             // Respond with a success
             resp = "RPRT 0\n";
-            client->write(resp.size(), (uint8_t*)resp.c_str());
+            out += resp;
         }
         else if (parts[0] == "q" || parts[0] == "\\quit") {
             // Will close automatically
@@ -657,18 +869,18 @@ private:
                 "0\n" /* RIG_PARM_NONE */
                 /* Bit field list of set parm */
                 "0\n" /* RIG_PARM_NONE */;
-            client->write(resp.size(), (uint8_t*)resp.c_str());
+            out += resp;
         }
         // This get_powerstat stuff is a wordaround for WSJT-X 2.7.0
         else if (parts[0] == "\\get_powerstat") {
             resp = "1\n";
-            client->write(resp.size(), (uint8_t*)resp.c_str());
+            out += resp;
         }
         else {
             // If command is not recognized, return error
             flog::error("Rigctl client sent invalid command: '{0}'", cmd);
             resp = "RPRT 1\n";
-            client->write(resp.size(), (uint8_t*)resp.c_str());
+            out += resp;
             return;
         }
     }
@@ -676,13 +888,28 @@ private:
     std::string name;
     bool enabled = true;
 
+    struct Client {
+        SigctlServerModule* owner;
+        net::Conn conn;
+        uint8_t buf[1024];
+        std::string command;
+    };
+
     char hostname[1024];
     int port = 4532;
-    uint8_t dataBuf[1024];
     net::Listener listener;
-    net::Conn client;
-
-    std::string command = "";
+    std::mutex clientsMtx;
+    std::vector<std::unique_ptr<Client>> clients;
+
+    // Retunes are done by the worker, which also keeps the cached state fresh
+    SeqLock<RigState> state;
+    std::thread workerThread;
+    std::mutex workerMtx;
+    std::condition_variable workerCnd;
+    bool workerRunning = false;
+    bool tunePending = false;
+    bool refreshPending = false;
+    double pendingFreq = 0.0;
 
     EventHandler<std::string> modChangedHandler;
     EventHandler<VFOManager::VFO*> vfoCreatedHandler;
@@ -256,18 +256,15 @@ private:
     static void clientHandler(net::Conn client, void* ctx) {
         NetworkSink* _this = (NetworkSink*)ctx;
 
-        {
-            std::lock_guard lck(_this->connMtx);
-            _this->conn = std::move(client);
-        }
+        // Only accept the next client once this one is gone
+        client->setCloseHandler(clientClosed, _this);
 
-        if (_this->conn) {
-            _this->conn->waitForEnd();
-            _this->conn->close();
-        }
-        else {
-        }
+        std::lock_guard lck(_this->connMtx);
+        _this->conn = std::move(client);
+    }
 
+    static void clientClosed(void* ctx) {
+        NetworkSink* _this = (NetworkSink*)ctx;
         _this->listener->acceptAsync(clientHandler, _this);
     }
 
@@ -1,7 +1,9 @@
 #include <utils/flog.h>
+#include <utils/thread_role.h>
 #include <module.h>
 #include <gui/gui.h>
 #include <signal_path/signal_path.h>
+#include <signal_path/sample_clock.h>
 #include <core.h>
 #include <gui/style.h>
 #include <config.h>
@@ -294,6 +296,7 @@ private:
         rtlsdr_set_offset_tuning(_this->openDev, _this->offsetTuning);
 
         _this->asyncCount = (int)roundf(_this->sampleRate / (200 * 512)) * 512;
+        _this->sampleClock.reset(_this->sampleRate);
 
         _this->running = true;
 
@@ -301,6 +304,7 @@ private:
 
         _this->lastDataTime.store(std::chrono::steady_clock::now());
         _this->watchdogThread = std::thread([_this]() {
+            thread_role::apply(THREAD_ROLE_SOURCE, "rtlsdr-watchdog");
             while (_this->running) {
                 std::this_thread::sleep_for(std::chrono::milliseconds(50));
                 auto now = std::chrono::steady_clock::now();
@@ -540,10 +544,13 @@ private:
     }
 
     void worker() {
+        // The async handler runs on this thread
+        thread_role::apply(THREAD_ROLE_SOURCE, "rtlsdr");
         while (running) {
             rtlsdr_reset_buffer(openDev);
             rtlsdr_read_async(openDev, asyncHandler, this, 0, asyncCount);
             if (running) {
+                sampleClock.markDiscontinuity();
                 flog::warn("rtlsdr_read_async exited, retrying...");
                 std::this_thread::sleep_for(std::chrono::milliseconds(10));
             }
@@ -568,6 +575,9 @@ private:
             _this->stream.writeBuf[i].re = ((float)buf[i * 2] - 127.4) / 128.0f;
             _this->stream.writeBuf[i].im = ((float)buf[(i * 2) + 1] - 127.4) / 128.0f;
         }
+        dsp::stream_meta meta;
+        _this->sampleClock.stamp(meta, sampCount);
+        _this->stream.setMeta(meta);
         if (!_this->stream.swap(sampCount)) { return; }
     }
 
@@ -643,6 +653,7 @@ private:
     rtlsdr_dev_t* openDev;
     bool enabled = true;
     dsp::stream<dsp::complex_t> stream;
+    SampleClock sampleClock;
     double sampleRate;
     SourceManager::SourceHandler handler;
     bool running = false;
@@ -0,0 +1,172 @@
+#include "jitter_buffer.h"
+#include <dsp/stream.h>
+#include <dsp/buffer/buffer.h>
+#include <algorithm>
+#include <string.h>
+#include <math.h>
+
+// Rate at which the fastest-path baseline is allowed to rise, covers clock drift between both ends (s/s)
+#define JB_BASELINE_CREEP   0.01
+
+// Time constant over which a burst stops counting towards the target depth
+#define JB_DECAY_TIME       10.0
+
+// Margin kept on top of the worst lateness seen
+#define JB_SAFETY           1.5
+
+// Playout is sped up or slowed down by this much when the depth is more than JB_HYSTERESIS off target
+#define JB_RATE_CORRECTION  0.01
+#define JB_HYSTERESIS       0.25
+
+namespace server {
+    JitterBuffer::JitterBuffer() {}
+
+    JitterBuffer::~JitterBuffer() {
+        if (buffer) { dsp::buffer::free(buffer); }
+    }
+
+    void JitterBuffer::init(double sampleRate, double minLatency, double maxLatency) {
+        _minLatency = minLatency;
+        _maxLatency = maxLatency;
+        reset(sampleRate);
+    }
+
+    void JitterBuffer::reset(double sampleRate) {
+        std::lock_guard<std::mutex> lck(mtx);
+        _sampleRate = sampleRate;
+        allocate();
+    }
+
+    void JitterBuffer::setLatencyLimits(double minLatency, double maxLatency) {
+        std::lock_guard<std::mutex> lck(mtx);
+        _minLatency = minLatency;
+        _maxLatency = maxLatency;
+        allocate();
+    }
+
+    void JitterBuffer::push(const dsp::complex_t* data, int n, std::chrono::steady_clock::time_point arrival) {
+        std::lock_guard<std::mutex> lck(mtx);
+
+        // Transit time of the packet against the sample clock, only its variations matter
+        if (first) {
+            start = arrival;
+            lastArrival = arrival;
+            first = false;
+        }
+        received += n;
+        double now = std::chrono::duration<double>(arrival - start).count();
+        double dt = std::chrono::duration<double>(arrival - lastArrival).count();
+        double transit = now - ((double)received / _sampleRate);
+        lastArrival = arrival;
+
+        // Lowest transit is the fastest path, how late this packet is compared to it sets the depth needed
+        minTransit = std::min<double>(transit, minTransit + (dt * JB_BASELINE_CREEP));
+        lateness = std::max<double>(transit - minTransit, lateness * exp(-dt / JB_DECAY_TIME));
+        target = std::clamp<double>(lateness * JB_SAFETY, _minLatency, _maxLatency);
+
+        // Make room if needed, only the newest samples are kept if the packet is bigger than the whole buffer
+        if (n > capacity) {
+            droppedSamples += n - capacity;
+            data += n - capacity;
+            n = capacity;
+        }
+        if (count + n > capacity) { drop(count + n - capacity); }
+
+        // Write to the ring
+        int part = std::min<int>(n, capacity - writePos);
+        memcpy(&buffer[writePos], data, part * sizeof(dsp::complex_t));
+        memcpy(buffer, &data[part], (n - part) * sizeof(dsp::complex_t));
+        writePos = (writePos + n) % capacity;
+        count += n;
+
+        // After a long stall the link delivers everything at once, skip back to the target instead of keeping the delay
+        if (count > (int)(_maxLatency * _sampleRate)) {
+            drop(count - (int)(target * _sampleRate));
+        }
+    }
+
+    int JitterBuffer::pop(dsp::complex_t* data, int n) {
+        std::lock_guard<std::mutex> lck(mtx);
+
+        // Wait for the buffer to fill back up to the target before resuming playout
+        if (buffering) {
+            if (count < std::max<int>(target * _sampleRate, n)) { return 0; }
+            buffering = false;
+        }
+
+        int read = std::min<int>(n, count);
+        int part = std::min<int>(read, capacity - readPos);
+        memcpy(data, &buffer[readPos], part * sizeof(dsp::complex_t));
+        memcpy(&data[part], buffer, (read - part) * sizeof(dsp::complex_t));
+        readPos = (readPos + read) % capacity;
+        count -= read;
+
+        if (read < n) {
+            underruns++;
+            buffering = true;
+        }
+        return read;
+    }
+
+    double JitterBuffer::getRateCorrection() {
+        std::lock_guard<std::mutex> lck(mtx);
+        double depth = (double)count / _sampleRate;
+        if (depth > target * (1.0 + JB_HYSTERESIS)) { return 1.0 + JB_RATE_CORRECTION; }
+        if (depth < target * (1.0 - JB_HYSTERESIS)) { return 1.0 - JB_RATE_CORRECTION; }
+        return 1.0;
+    }
+
+    double JitterBuffer::getSampleRate() {
+        std::lock_guard<std::mutex> lck(mtx);
+        return _sampleRate;
+    }
+
+    double JitterBuffer::getLatency() {
+        std::lock_guard<std::mutex> lck(mtx);
+        return (double)count / _sampleRate;
+    }
+
+    double JitterBuffer::getTargetLatency() {
+        std::lock_guard<std::mutex> lck(mtx);
+        return target;
+    }
+
+    double JitterBuffer::getJitter() {
+        std::lock_guard<std::mutex> lck(mtx);
+        return lateness;
+    }
+
+    uint64_t JitterBuffer::getUnderruns() {
+        std::lock_guard<std::mutex> lck(mtx);
+        return underruns;
+    }
+
+    uint64_t JitterBuffer::getDroppedSamples() {
+        std::lock_guard<std::mutex> lck(mtx);
+        return droppedSamples;
+    }
+
+    void JitterBuffer::allocate() {
+        // Room for the maximum depth plus a full packet on top of it
+        if (buffer) { dsp::buffer::free(buffer); }
+        capacity = (int)ceil(_maxLatency * _sampleRate) + STREAM_BUFFER_SIZE;
+        buffer = dsp::buffer::alloc<dsp::complex_t>(capacity);
+        readPos = 0;
+        writePos = 0;
+        count = 0;
+
+        first = true;
+        received = 0;
+        minTransit = 0.0;
+        lateness = 0.0;
+        target = _minLatency;
+        buffering = true;
+    }
+
+    void JitterBuffer::drop(int n) {
+        n = std::min<int>(n, count);
+        readPos = (readPos + n) % capacity;
+        count -= n;
+        droppedSamples += n;
+    }
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <dsp/types.h>
+#include <mutex>
+#include <chrono>
+#include <stdint.h>
+
+namespace server {
+    // Buffers samples arriving in bursts and plays them out at the sample rate. The target depth follows
+    // how late packets arrive compared to the fastest one seen recently, so a clean link keeps latency low
+    // and a bursty one (Wi-Fi) buffers just enough to ride over the gaps.
+    class JitterBuffer {
+    public:
+        JitterBuffer();
+        ~JitterBuffer();
+
+        void init(double sampleRate, double minLatency, double maxLatency);
+
+        // Clears the buffer and the jitter estimate, for a new sample rate or after a restart
+        void reset(double sampleRate);
+        void setLatencyLimits(double minLatency, double maxLatency);
+
+        // Called from the receiving side with the arrival time of the packet the samples came in
+        void push(const dsp::complex_t* data, int n, std::chrono::steady_clock::time_point arrival);
+
+        // Returns the number of samples read, 0 while buffering back up to the target after an underrun
+        int pop(dsp::complex_t* data, int n);
+
+        // Playout rate factor nudging the depth back towards the target
+        double getRateCorrection();
+
+        double getSampleRate();
+        double getLatency();
+        double getTargetLatency();
+        double getJitter();
+        uint64_t getUnderruns();
+        uint64_t getDroppedSamples();
+
+    private:
+        void allocate();
+        void drop(int n);
+
+        std::mutex mtx;
+        dsp::complex_t* buffer = NULL;
+        int capacity = 0;
+        int readPos = 0;
+        int writePos = 0;
+        int count = 0;
+
+        double _sampleRate = 1000000.0;
+        double _minLatency;
+        double _maxLatency;
+
+        // Jitter estimate, in seconds
+        bool first = true;
+        std::chrono::steady_clock::time_point start;
+        std::chrono::steady_clock::time_point lastArrival;
+        uint64_t received = 0;
+        double minTransit = 0.0;
+        double lateness = 0.0;
+        double target = 0.0;
+
+        bool buffering = true;
+        uint64_t underruns = 0;
+        uint64_t droppedSamples = 0;
+    };
+}
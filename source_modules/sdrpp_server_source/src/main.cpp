@@ -0,0 +1,285 @@
+#include <utils/flog.h>
+#include <utils/networking.h>
+#include <module.h>
+#include <gui/gui.h>
+#include <signal_path/signal_path.h>
+#include <core.h>
+#include <gui/style.h>
+#include <config.h>
+#include <gui/smgui.h>
+#include <algorithm>
+#include "sdrpp_server_client.h"
+
+#define CONCAT(a, b) ((std::string(a) + b).c_str())
+
+SDRPP_MOD_INFO{
+    /* Name:            */ "sdrpp_server_source",
+    /* Description:     */ "SDR++ Server source module for SDR++",
+    /* Author:          */ "Ryzerth",
+    /* Version:         */ 0, 1, 0,
+    /* Max instances    */ 1
+};
+
+ConfigManager config;
+
+const dsp::compression::PCMType sampleTypes[] = {
+    dsp::compression::PCM_TYPE_I8,
+    dsp::compression::PCM_TYPE_I16,
+    dsp::compression::PCM_TYPE_F32
+};
+
+const char* sampleTypesTxt = "Int8\0Int16\0Float32\0";
+
+class SDRPPServerSourceModule : public ModuleManager::Instance {
+public:
+    SDRPPServerSourceModule(std::string name) {
+        this->name = name;
+
+        handler.ctx = this;
+        handler.selectHandler = menuSelected;
+        handler.deselectHandler = menuDeselected;
+        handler.menuHandler = menuHandler;
+        handler.startHandler = start;
+        handler.stopHandler = stop;
+        handler.tuneHandler = tune;
+        handler.stream = &stream;
+
+        // Load config
+        config.acquire();
+        std::string host = config.conf["hostname"];
+        strcpy(hostname, host.c_str());
+        port = config.conf["port"];
+        sampleTypeId = config.conf["sampleType"];
+        compression = config.conf["compression"];
+        minLatency = config.conf["minLatency"];
+        maxLatency = config.conf["maxLatency"];
+        config.release();
+        sampleTypeId = std::clamp<int>(sampleTypeId, 0, 2);
+
+        sigpath::sourceManager.registerSource("SDR++ Server", &handler);
+    }
+
+    ~SDRPPServerSourceModule() {
+        stop(this);
+        sigpath::sourceManager.unregisterSource("SDR++ Server");
+    }
+
+    void postInit() {}
+
+    void enable() {
+        enabled = true;
+    }
+
+    void disable() {
+        enabled = false;
+    }
+
+    bool isEnabled() {
+        return enabled;
+    }
+
+private:
+    bool connected() {
+        return client && client->isOpen();
+    }
+
+    void connect() {
+        net::Conn conn;
+        try {
+            conn = net::connect(hostname, port);
+        }
+        catch (const std::exception& e) {
+            flog::error("Could not connect to SDR++ server at {0}:{1}: {2}", hostname, port, e.what());
+            return;
+        }
+        if (!conn) {
+            flog::error("Could not connect to SDR++ server at {0}:{1}", hostname, port);
+            return;
+        }
+
+        client = std::make_unique<server::Client>(std::move(conn), &stream, sampleRateChanged, this, minLatency / 1000.0, maxLatency / 1000.0);
+        flog::info("Connected to SDR++ server at {0}:{1}", hostname, port);
+
+        // Apply the local settings, the server resets them on every connection
+        client->setSampleType(sampleTypes[sampleTypeId]);
+        client->setCompression(compression);
+        client->setFrequency(freq);
+    }
+
+    static void sampleRateChanged(double sampleRate, void* ctx) {
+        SDRPPServerSourceModule* _this = (SDRPPServerSourceModule*)ctx;
+        if (_this->selected) { core::setInputSampleRate(sampleRate); }
+    }
+
+    static void menuSelected(void* ctx) {
+        SDRPPServerSourceModule* _this = (SDRPPServerSourceModule*)ctx;
+        _this->selected = true;
+        if (_this->connected()) { core::setInputSampleRate(_this->client->getSampleRate()); }
+        flog::info("SDRPPServerSourceModule '{0}': Menu Select!", _this->name);
+    }
+
+    static void menuDeselected(void* ctx) {
+        SDRPPServerSourceModule* _this = (SDRPPServerSourceModule*)ctx;
+        _this->selected = false;
+        flog::info("SDRPPServerSourceModule '{0}': Menu Deselect!", _this->name);
+    }
+
+    static void start(void* ctx) {
+        SDRPPServerSourceModule* _this = (SDRPPServerSourceModule*)ctx;
+        if (_this->running) { return; }
+        if (!_this->connected()) {
+            flog::error("Not connected to an SDR++ server");
+            return;
+        }
+        _this->client->start();
+        _this->running = true;
+        flog::info("SDRPPServerSourceModule '{0}': Start!", _this->name);
+    }
+
+    static void stop(void* ctx) {
+        SDRPPServerSourceModule* _this = (SDRPPServerSourceModule*)ctx;
+        if (!_this->running) { return; }
+        _this->running = false;
+        if (_this->client) { _this->client->stop(); }
+        flog::info("SDRPPServerSourceModule '{0}': Stop!", _this->name);
+    }
+
+    static void tune(double freq, void* ctx) {
+        SDRPPServerSourceModule* _this = (SDRPPServerSourceModule*)ctx;
+        if (_this->connected()) { _this->client->setFrequency(freq); }
+        _this->freq = freq;
+        flog::info("SDRPPServerSourceModule '{0}': Tune: {1}!", _this->name, freq);
+    }
+
+    static void menuHandler(void* ctx) {
+        SDRPPServerSourceModule* _this = (SDRPPServerSourceModule*)ctx;
+        bool connected = _this->connected();
+
+        if (connected) { SmGui::BeginDisabled(); }
+        SmGui::FillWidth();
+        if (SmGui::InputText(CONCAT("##sdrpp_srv_host_", _this->name), _this->hostname, 1023)) {
+            config.acquire();
+            config.conf["hostname"] = _this->hostname;
+            config.release(true);
+        }
+        SmGui::SameLine();
+        SmGui::FillWidth();
+        if (SmGui::InputInt(CONCAT("##sdrpp_srv_port_", _this->name), &_this->port, 0, 0)) {
+            config.acquire();
+            config.conf["port"] = _this->port;
+            config.release(true);
+        }
+        if (connected) { SmGui::EndDisabled(); }
+
+        SmGui::FillWidth();
+        if (!connected && SmGui::Button(CONCAT("Connect##sdrpp_srv_conn_", _this->name))) {
+            _this->connect();
+        }
+        else if (connected && SmGui::Button(CONCAT("Disconnect##sdrpp_srv_conn_", _this->name))) {
+            if (_this->running) { sigpath::sourceManager.stop(); }
+            _this->client->close();
+        }
+
+        if (!connected) {
+            SmGui::Text("Status: Not connected");
+            return;
+        }
+
+        // Stream settings
+        SmGui::LeftLabel("Sample type");
+        SmGui::FillWidth();
+        if (SmGui::Combo(CONCAT("##sdrpp_srv_type_", _this->name), &_this->sampleTypeId, sampleTypesTxt)) {
+            _this->client->setSampleType(sampleTypes[_this->sampleTypeId]);
+            config.acquire();
+            config.conf["sampleType"] = _this->sampleTypeId;
+            config.release(true);
+        }
+        if (SmGui::Checkbox(CONCAT("Compression##sdrpp_srv_comp_", _this->name), &_this->compression)) {
+            _this->client->setCompression(_this->compression);
+            config.acquire();
+            config.conf["compression"] = _this->compression;
+            config.release(true);
+        }
+
+        // Jitter buffer limits
+        SmGui::LeftLabel("Min buffer (ms)");
+        SmGui::FillWidth();
+        if (SmGui::SliderInt(CONCAT("##sdrpp_srv_min_lat_", _this->name), &_this->minLatency, 5, 200)) {
+            _this->maxLatency = std::max<int>(_this->maxLatency, _this->minLatency);
+            _this->updateLatencyLimits();
+        }
+        SmGui::LeftLabel("Max buffer (ms)");
+        SmGui::FillWidth();
+        if (SmGui::SliderInt(CONCAT("##sdrpp_srv_max_lat_", _this->name), &_this->maxLatency, 50, 2000)) {
+            _this->minLatency = std::min<int>(_this->minLatency, _this->maxLatency);
+            _this->updateLatencyLimits();
+        }
+
+        // Remote device menu
+        _this->client->showMenu();
+
+        // Link statistics
+        server::ClientStats stats = _this->client->getStats();
+        char buf[1024];
+        sprintf(buf, "Buffer: %.0fms (target %.0fms, jitter %.0fms)", stats.bufferLatency * 1000.0, stats.targetLatency * 1000.0, stats.jitter * 1000.0);
+        SmGui::Text(buf);
+        sprintf(buf, "Command RTT: %.1fms", stats.commandRTT * 1000.0);
+        SmGui::Text(buf);
+        sprintf(buf, "Underruns: %llu, dropped: %llu samples, %llu packets", (unsigned long long)stats.underruns, (unsigned long long)stats.droppedSamples, (unsigned long long)stats.droppedPackets);
+        SmGui::Text(buf);
+        sprintf(buf, "Network: %.2fMB/s, %.2fMS/s (compression %.2fx)", stats.networkBytes / 1e6, stats.samples / 1e6, stats.compressionRatio);
+        SmGui::Text(buf);
+    }
+
+    void updateLatencyLimits() {
+        if (connected()) { client->setLatencyLimits(minLatency / 1000.0, maxLatency / 1000.0); }
+        config.acquire();
+        config.conf["minLatency"] = minLatency;
+        config.conf["maxLatency"] = maxLatency;
+        config.release(true);
+    }
+
+    std::string name;
+    bool enabled = true;
+    bool selected = false;
+    bool running = false;
+    double freq = 100000000.0;
+
+    dsp::stream<dsp::complex_t> stream;
+    SourceManager::SourceHandler handler;
+
+    char hostname[1024];
+    int port = 5259;
+    int sampleTypeId = 1;
+    bool compression = false;
+    int minLatency = 20;
+    int maxLatency = 500;
+
+    std::unique_ptr<server::Client> client;
+};
+
+MOD_EXPORT void _INIT_() {
+    json def = json({});
+    def["hostname"] = "localhost";
+    def["port"] = 5259;
+    def["sampleType"] = 1;
+    def["compression"] = false;
+    def["minLatency"] = 20;
+    def["maxLatency"] = 500;
+    config.setPath(core::args["root"].s() + "/sdrpp_server_source_config.json");
+    config.load(def);
+    config.enableAutoSave();
+}
+
+MOD_EXPORT ModuleManager::Instance* _CREATE_INSTANCE_(std::string name) {
+    return new SDRPPServerSourceModule(name);
+}
+
+MOD_EXPORT void _DELETE_INSTANCE_(ModuleManager::Instance* instance) {
+    delete (SDRPPServerSourceModule*)instance;
+}
+
+MOD_EXPORT void _END_() {
+    config.disableAutoSave();
+    config.save();
+}
@@ -0,0 +1,412 @@
+#include "sdrpp_server_client.h"
+#include <dsp/buffer/buffer.h>
+#include <dsp/compression/sample_stream_decompressor.h>
+#include <utils/flog.h>
+#include <utils/thread_role.h>
+#include <algorithm>
+
+// Baseband packets allowed to wait for the decoder before the oldest gets dropped
+#define CLIENT_DECODE_QUEUE_SIZE    64
+
+// Size of the blocks written to the output stream, in seconds
+#define CLIENT_PLAYOUT_BLOCK        0.005
+
+// How far playout may fall behind its schedule before it stops trying to catch up, in seconds
+#define CLIENT_MAX_LAG              0.1
+
+#define CLIENT_ACK_TIMEOUT          std::chrono::milliseconds(1000)
+#define CLIENT_STATS_PERIOD         1.0
+
+namespace server {
+    Client::Client(net::Conn conn, dsp::stream<dsp::complex_t>* out, void (*sampleRateHandler)(double sampleRate, void* ctx), void* ctx, double minLatency, double maxLatency) {
+        client = std::move(conn);
+        output = out;
+        _sampleRateHandler = sampleRateHandler;
+        _ctx = ctx;
+
+        // Allocate buffers
+        rbuf = new uint8_t[SERVER_MAX_PACKET_SIZE];
+        sbuf = new uint8_t[SERVER_MAX_PACKET_SIZE];
+        decompBuf = new uint8_t[SERVER_MAX_PACKET_SIZE];
+        samples = dsp::buffer::alloc<dsp::complex_t>(STREAM_BUFFER_SIZE);
+        dctx = ZSTD_createDCtx();
+
+        // Initialize headers
+        s_pkt_hdr = (PacketHeader*)sbuf;
+        s_cmd_hdr = (CommandHeader*)&sbuf[sizeof(PacketHeader)];
+        s_cmd_data = &sbuf[sizeof(PacketHeader) + sizeof(CommandHeader)];
+
+        jb.init(sampleRate, minLatency, maxLatency);
+        lastStats = std::chrono::steady_clock::now();
+
+        readThread = std::thread(&Client::readWorker, this);
+        decodeThread = std::thread(&Client::decodeWorker, this);
+
+        // Fetch the remote menu
+        getUI();
+    }
+
+    Client::~Client() {
+        close();
+        ZSTD_freeDCtx(dctx);
+        delete[] rbuf;
+        delete[] sbuf;
+        delete[] decompBuf;
+        dsp::buffer::free(samples);
+    }
+
+    void Client::showMenu() {
+        std::string diffId = "";
+        SmGui::DrawListElem diffValue;
+        bool syncRequired = false;
+        {
+            std::lock_guard<std::mutex> lck(dlMtx);
+            dl.draw(diffId, diffValue, syncRequired);
+        }
+        if (diffId.empty()) { return; }
+
+        // Forward the action, the server only sends the menu back when the widget asks for a sync
+        {
+            std::lock_guard<std::mutex> lck(ackMtx);
+            ackReceived = false;
+        }
+        {
+            std::lock_guard<std::mutex> lck(sendMtx);
+            int max = SERVER_MAX_PACKET_SIZE - sizeof(PacketHeader) - sizeof(CommandHeader);
+            int i = 0;
+            s_cmd_data[i++] = syncRequired;
+            SmGui::DrawListElem elemId;
+            elemId.type = SmGui::DRAW_LIST_ELEM_TYPE_STRING;
+            elemId.str = diffId;
+            i += SmGui::DrawList::storeItem(elemId, &s_cmd_data[i], max - i);
+            i += SmGui::DrawList::storeItem(diffValue, &s_cmd_data[i], max - i);
+            sendCommand(COMMAND_UI_ACTION, i);
+        }
+        if (!syncRequired) { return; }
+
+        std::vector<uint8_t> data;
+        if (!waitForAck(COMMAND_UI_ACTION, data)) {
+            flog::error("Timeout out waiting for the server to answer a UI action");
+            return;
+        }
+        std::lock_guard<std::mutex> lck(dlMtx);
+        dl.load(data.data(), data.size());
+    }
+
+    void Client::setFrequency(double freq) {
+        if (!isOpen()) { return; }
+        std::lock_guard<std::mutex> lck(sendMtx);
+        *(double*)s_cmd_data = freq;
+        sendCommand(COMMAND_SET_FREQUENCY, sizeof(double));
+    }
+
+    double Client::getSampleRate() {
+        return sampleRate;
+    }
+
+    void Client::setSampleType(dsp::compression::PCMType type) {
+        if (!isOpen()) { return; }
+        std::lock_guard<std::mutex> lck(sendMtx);
+        s_cmd_data[0] = type;
+        sendCommand(COMMAND_SET_SAMPLE_TYPE, 1);
+    }
+
+    void Client::setCompression(bool enabled) {
+        if (!isOpen()) { return; }
+        std::lock_guard<std::mutex> lck(sendMtx);
+        s_cmd_data[0] = enabled;
+        sendCommand(COMMAND_SET_COMPRESSION, 1);
+    }
+
+    void Client::setLatencyLimits(double minLatency, double maxLatency) {
+        jb.setLatencyLimits(minLatency, maxLatency);
+    }
+
+    void Client::start() {
+        if (!isOpen()) { return; }
+        {
+            std::lock_guard<std::mutex> lck(playoutMtx);
+            if (running) { return; }
+            running = true;
+        }
+
+        // Anything left from a previous run is stale
+        jb.reset(sampleRate);
+        {
+            std::lock_guard<std::mutex> lck(sendMtx);
+            sendCommand(COMMAND_START, 0);
+        }
+        playoutThread = std::thread(&Client::playoutWorker, this);
+    }
+
+    void Client::stop() {
+        {
+            std::lock_guard<std::mutex> lck(playoutMtx);
+            if (!running) { return; }
+            running = false;
+        }
+        playoutCnd.notify_all();
+        output->stopWriter();
+        if (playoutThread.joinable()) { playoutThread.join(); }
+        output->clearWriteStop();
+
+        if (!isOpen()) { return; }
+        std::lock_guard<std::mutex> lck(sendMtx);
+        sendCommand(COMMAND_STOP, 0);
+    }
+
+    void Client::close() {
+        stop();
+        client->close();
+        if (readThread.joinable()) { readThread.join(); }
+        {
+            std::lock_guard<std::mutex> lck(decodeMtx);
+            stopDecoder = true;
+        }
+        decodeCnd.notify_all();
+        if (decodeThread.joinable()) { decodeThread.join(); }
+    }
+
+    bool Client::isOpen() {
+        return client && client->isOpen();
+    }
+
+    ClientStats Client::getStats() {
+        std::lock_guard<std::mutex> lck(statsMtx);
+
+        // Rates over the last period
+        auto now = std::chrono::steady_clock::now();
+        double elapsed = std::chrono::duration<double>(now - lastStats).count();
+        if (elapsed >= CLIENT_STATS_PERIOD) {
+            uint64_t net = networkBytes;
+            uint64_t smp = decodedSamples;
+            uint64_t comp = compressedBytes;
+            uint64_t raw = rawBytes;
+            stats.networkBytes = (double)(net - lastNetworkBytes) / elapsed;
+            stats.samples = (double)(smp - lastSamples) / elapsed;
+            stats.compressionRatio = (comp > lastCompressed) ? (double)(raw - lastRaw) / (double)(comp - lastCompressed) : 1.0;
+            lastNetworkBytes = net;
+            lastSamples = smp;
+            lastCompressed = comp;
+            lastRaw = raw;
+            lastStats = now;
+        }
+
+        stats.bufferLatency = jb.getLatency();
+        stats.targetLatency = jb.getTargetLatency();
+        stats.jitter = jb.getJitter();
+        stats.commandRTT = rtt;
+        stats.underruns = jb.getUnderruns();
+        stats.droppedSamples = jb.getDroppedSamples();
+        stats.droppedPackets = droppedPackets;
+        return stats;
+    }
+
+    void Client::readWorker() {
+        thread_role::apply(THREAD_ROLE_SOURCE, "server-net");
+        PacketHeader* hdr = (PacketHeader*)rbuf;
+        uint8_t* data = &rbuf[sizeof(PacketHeader)];
+
+        while (true) {
+            // Read header then the rest of the packet
+            if (client->read(sizeof(PacketHeader), rbuf) <= 0) { break; }
+            if (hdr->size < sizeof(PacketHeader) || hdr->size > SERVER_MAX_PACKET_SIZE) {
+                flog::error("Invalid packet size received from the server: {0}", hdr->size);
+                client->close();
+                break;
+            }
+            int len = hdr->size - sizeof(PacketHeader);
+            if (len && client->read(len, data) <= 0) { break; }
+            auto arrival = std::chrono::steady_clock::now();
+            networkBytes += hdr->size;
+
+            if (hdr->type == PACKET_TYPE_BASEBAND || hdr->type == PACKET_TYPE_BASEBAND_COMPRESSED) {
+                // Hand off to the decoder, recycling a packet buffer if one is free
+                {
+                    std::lock_guard<std::mutex> lck(decodeMtx);
+                    Packet pkt;
+                    if (!freePackets.empty()) {
+                        pkt = std::move(freePackets.back());
+                        freePackets.pop_back();
+                    }
+                    pkt.data.assign(data, data + len);
+                    pkt.compressed = (hdr->type == PACKET_TYPE_BASEBAND_COMPRESSED);
+                    pkt.arrival = arrival;
+
+                    // If the decoder can't keep up, lose the oldest so the stream stays current
+                    if (decodeQueue.size() >= CLIENT_DECODE_QUEUE_SIZE) {
+                        freePackets.push_back(std::move(decodeQueue.front()));
+                        decodeQueue.pop_front();
+                        droppedPackets++;
+                    }
+                    decodeQueue.push_back(std::move(pkt));
+                }
+                decodeCnd.notify_one();
+            }
+            else if (hdr->type == PACKET_TYPE_COMMAND && len >= sizeof(CommandHeader)) {
+                CommandHeader* chdr = (CommandHeader*)data;
+                commandHandler((Command)chdr->cmd, &data[sizeof(CommandHeader)], len - sizeof(CommandHeader));
+            }
+            else if (hdr->type == PACKET_TYPE_COMMAND_ACK && len >= sizeof(CommandHeader)) {
+                CommandHeader* chdr = (CommandHeader*)data;
+                commandAckHandler((Command)chdr->cmd, &data[sizeof(CommandHeader)], len - sizeof(CommandHeader));
+            }
+            else if (hdr->type == PACKET_TYPE_ERROR && len >= 1) {
+                flog::error("SDR++ server error: {0}", (int)data[0]);
+            }
+            else {
+                flog::error("Invalid packet received from the server: type={0}, size={1}", hdr->type, hdr->size);
+            }
+        }
+
+        // Wake up anything waiting on an answer that won't come
+        ackCnd.notify_all();
+        flog::info("Disconnected from the SDR++ server");
+    }
+
+    void Client::decodeWorker() {
+        thread_role::apply(THREAD_ROLE_SOURCE, "server-decode");
+        Packet pkt;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lck(decodeMtx);
+                if (!pkt.data.empty()) { freePackets.push_back(std::move(pkt)); }
+                decodeCnd.wait(lck, [this]() { return !decodeQueue.empty() || stopDecoder; });
+                if (stopDecoder) { break; }
+                pkt = std::move(decodeQueue.front());
+                decodeQueue.pop_front();
+            }
+            decode(pkt);
+        }
+    }
+
+    void Client::playoutWorker() {
+        thread_role::apply(THREAD_ROLE_SOURCE, "server-playout");
+        auto next = std::chrono::steady_clock::now();
+
+        while (true) {
+            double sr = jb.getSampleRate();
+            int blockSize = std::clamp<int>(sr * CLIENT_PLAYOUT_BLOCK, 1, STREAM_BUFFER_SIZE);
+
+            // Pace on the sample clock, slightly faster or slower to hold the buffer at its target depth
+            double interval = (double)blockSize / (sr * jb.getRateCorrection());
+            next += std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(interval));
+            auto now = std::chrono::steady_clock::now();
+            if (next < now - std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(CLIENT_MAX_LAG))) {
+                next = now;
+            }
+            {
+                std::unique_lock<std::mutex> lck(playoutMtx);
+                playoutCnd.wait_until(lck, next, [this]() { return !running; });
+                if (!running) { break; }
+            }
+
+            // Nothing is written while the buffer fills back up
+            int count = jb.pop(output->writeBuf, blockSize);
+            if (count && !output->swap(count)) { break; }
+        }
+    }
+
+    void Client::commandHandler(Command cmd, uint8_t* data, int len) {
+        if (cmd == COMMAND_SET_SAMPLERATE && len == sizeof(double)) {
+            sampleRate = *(double*)data;
+            jb.reset(sampleRate);
+            if (_sampleRateHandler) { _sampleRateHandler(sampleRate, _ctx); }
+        }
+        else if (cmd == COMMAND_DISCONNECT) {
+            flog::error("The SDR++ server asked to disconnect, another client is probably already connected");
+            client->close();
+        }
+        else {
+            flog::error("Invalid command received from the server: {0} (len = {1})", (int)cmd, len);
+        }
+    }
+
+    void Client::commandAckHandler(Command cmd, uint8_t* data, int len) {
+        auto now = std::chrono::steady_clock::now();
+        if (cmd <= COMMAND_SET_COMPRESSION) {
+            std::lock_guard<std::mutex> lck(sendMtx);
+            rtt = std::chrono::duration<double>(now - sentTime[cmd]).count();
+        }
+        {
+            std::lock_guard<std::mutex> lck(ackMtx);
+            ackCmd = cmd;
+            ackData.assign(data, data + len);
+            ackReceived = true;
+        }
+        ackCnd.notify_all();
+    }
+
+    void Client::decode(Packet& pkt) {
+        uint8_t* payload = pkt.data.data();
+        int len = pkt.data.size();
+
+        // Undo zstd if the server compressed the stream
+        if (pkt.compressed) {
+            size_t dlen = ZSTD_decompressDCtx(dctx, decompBuf, SERVER_MAX_PACKET_SIZE, payload, len);
+            if (ZSTD_isError(dlen)) {
+                flog::error("Could not decompress baseband packet: {0}", ZSTD_getErrorName(dlen));
+                return;
+            }
+            payload = decompBuf;
+            len = dlen;
+        }
+        compressedBytes += pkt.data.size();
+        rawBytes += len;
+
+        // Check the sample stream header (compression, sample type, scaler) before converting
+        if (len < 8) { return; }
+        uint16_t sampleType = *(uint16_t*)&payload[2];
+        int sampleSize = 0;
+        if (sampleType == dsp::compression::PCM_TYPE_I8) { sampleSize = 2 * sizeof(int8_t); }
+        else if (sampleType == dsp::compression::PCM_TYPE_I16) { sampleSize = 2 * sizeof(int16_t); }
+        else if (sampleType == dsp::compression::PCM_TYPE_F32) { sampleSize = sizeof(dsp::complex_t); }
+        if (!sampleSize || (len - 8) % sampleSize || (len - 8) / sampleSize > STREAM_BUFFER_SIZE) {
+            flog::error("Invalid baseband packet received from the server");
+            return;
+        }
+
+        int count = dsp::compression::SampleStreamDecompressor::process(len, payload, samples);
+        decodedSamples += count;
+        jb.push(samples, count, pkt.arrival);
+    }
+
+    void Client::getUI() {
+        {
+            std::lock_guard<std::mutex> lck(ackMtx);
+            ackReceived = false;
+        }
+        {
+            std::lock_guard<std::mutex> lck(sendMtx);
+            sendCommand(COMMAND_GET_UI, 0);
+        }
+
+        std::vector<uint8_t> data;
+        if (!waitForAck(COMMAND_GET_UI, data)) {
+            flog::error("Timeout out waiting for the server menu");
+            return;
+        }
+        std::lock_guard<std::mutex> lck(dlMtx);
+        dl.load(data.data(), data.size());
+    }
+
+    void Client::sendPacket(PacketType type, int len) {
+        s_pkt_hdr->type = type;
+        s_pkt_hdr->size = sizeof(PacketHeader) + len;
+        client->write(s_pkt_hdr->size, sbuf);
+    }
+
+    void Client::sendCommand(Command cmd, int len) {
+        s_cmd_hdr->cmd = cmd;
+        if (cmd <= COMMAND_SET_COMPRESSION) { sentTime[cmd] = std::chrono::steady_clock::now(); }
+        sendPacket(PACKET_TYPE_COMMAND, sizeof(CommandHeader) + len);
+    }
+
+    bool Client::waitForAck(Command cmd, std::vector<uint8_t>& data) {
+        std::unique_lock<std::mutex> lck(ackMtx);
+        bool ok = ackCnd.wait_for(lck, CLIENT_ACK_TIMEOUT, [this, cmd]() { return (ackReceived && ackCmd == cmd) || !isOpen(); });
+        if (!ok || !ackReceived || ackCmd != cmd) { return false; }
+        data = ackData;
+        return true;
+    }
+}
@@ -0,0 +1,144 @@
+#pragma once
+#include <utils/networking.h>
+#include <server_protocol.h>
+#include <dsp/stream.h>
+#include <dsp/types.h>
+#include <dsp/compression/pcm_type.h>
+#include <gui/smgui.h>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+#include <chrono>
+#include <zstd.h>
+#include "jitter_buffer.h"
+
+namespace server {
+    struct ClientStats {
+        // Latency, in seconds
+        double bufferLatency;
+        double targetLatency;
+        double jitter;
+        double commandRTT;
+
+        // Loss
+        uint64_t underruns;
+        uint64_t droppedSamples;
+        uint64_t droppedPackets;
+
+        // Throughput, per second
+        double networkBytes;
+        double samples;
+        double compressionRatio;
+    };
+
+    // Connection to an SDR++ server. A reader thread parses packets and hands baseband off to a decoder
+    // thread (zstd and PCM conversion), which fills the jitter buffer. Playout to the output stream runs on
+    // its own thread at the sample rate so bursts on the link don't reach the DSP chain.
+    class Client {
+    public:
+        // sampleRateHandler is called from the network thread whenever the server changes its sample rate
+        Client(net::Conn conn, dsp::stream<dsp::complex_t>* out, void (*sampleRateHandler)(double sampleRate, void* ctx), void* ctx, double minLatency, double maxLatency);
+        ~Client();
+
+        void showMenu();
+
+        void setFrequency(double freq);
+        double getSampleRate();
+
+        void setSampleType(dsp::compression::PCMType type);
+        void setCompression(bool enabled);
+        void setLatencyLimits(double minLatency, double maxLatency);
+
+        void start();
+        void stop();
+
+        void close();
+        bool isOpen();
+
+        ClientStats getStats();
+
+    private:
+        struct Packet {
+            std::vector<uint8_t> data;
+            bool compressed;
+            std::chrono::steady_clock::time_point arrival;
+        };
+
+        void readWorker();
+        void decodeWorker();
+        void playoutWorker();
+
+        void commandHandler(Command cmd, uint8_t* data, int len);
+        void commandAckHandler(Command cmd, uint8_t* data, int len);
+        void decode(Packet& pkt);
+
+        void getUI();
+        void sendPacket(PacketType type, int len);
+        void sendCommand(Command cmd, int len);
+        bool waitForAck(Command cmd, std::vector<uint8_t>& data);
+
+        net::Conn client;
+        dsp::stream<dsp::complex_t>* output;
+        void (*_sampleRateHandler)(double sampleRate, void* ctx);
+        void* _ctx;
+        JitterBuffer jb;
+
+        std::thread readThread;
+        std::thread decodeThread;
+        std::thread playoutThread;
+
+        uint8_t* rbuf = NULL;
+        uint8_t* sbuf = NULL;
+        PacketHeader* s_pkt_hdr = NULL;
+        CommandHeader* s_cmd_hdr = NULL;
+        uint8_t* s_cmd_data = NULL;
+        std::mutex sendMtx;
+
+        // Command acknowledgements, the payload is copied out of the receive buffer
+        std::mutex ackMtx;
+        std::condition_variable ackCnd;
+        bool ackReceived = false;
+        Command ackCmd;
+        std::vector<uint8_t> ackData;
+        std::chrono::steady_clock::time_point sentTime[COMMAND_SET_COMPRESSION + 1];
+        std::atomic<double> rtt = 0.0;
+
+        // Baseband packets waiting for the decoder, recycled through the free list
+        std::mutex decodeMtx;
+        std::condition_variable decodeCnd;
+        std::deque<Packet> decodeQueue;
+        std::vector<Packet> freePackets;
+        bool stopDecoder = false;
+
+        ZSTD_DCtx* dctx = NULL;
+        uint8_t* decompBuf = NULL;
+        dsp::complex_t* samples = NULL;
+
+        // Remote UI
+        std::mutex dlMtx;
+        SmGui::DrawList dl;
+
+        std::mutex playoutMtx;
+        std::condition_variable playoutCnd;
+        bool running = false;
+
+        std::atomic<double> sampleRate = 1000000.0;
+
+        // Counters, rates are computed between calls to getStats()
+        std::atomic<uint64_t> networkBytes = 0;
+        std::atomic<uint64_t> compressedBytes = 0;
+        std::atomic<uint64_t> rawBytes = 0;
+        std::atomic<uint64_t> decodedSamples = 0;
+        std::atomic<uint64_t> droppedPackets = 0;
+        std::mutex statsMtx;
+        std::chrono::steady_clock::time_point lastStats;
+        uint64_t lastNetworkBytes = 0;
+        uint64_t lastSamples = 0;
+        uint64_t lastCompressed = 0;
+        uint64_t lastRaw = 0;
+        ClientStats stats = {};
+    };
+}